@@ -35,6 +35,26 @@
 #if GST_GL_HAVE_WINDOW_WIN32
 #include "../win32/gstglwindow_win32.h"
 #endif
+#if GST_GL_HAVE_WINDOW_HEADLESS
+#include "../headless/gstglwindow_headless.h"
+#endif
+
+#ifndef EGL_LINUX_DMA_BUF_EXT
+#define EGL_LINUX_DMA_BUF_EXT 0x3270
+#define EGL_LINUX_DRM_FOURCC_EXT 0x3271
+#define EGL_DMA_BUF_PLANE0_FD_EXT 0x3272
+#define EGL_DMA_BUF_PLANE0_OFFSET_EXT 0x3273
+#define EGL_DMA_BUF_PLANE0_PITCH_EXT 0x3274
+#endif
+#ifndef EGL_GL_TEXTURE_2D_KHR
+#define EGL_GL_TEXTURE_2D_KHR 0x30B1
+#endif
+
+/* EGL_MESA_image_dma_buf_export */
+typedef EGLBoolean (*ExportDMABUFImageQueryFunc) (EGLDisplay dpy,
+    EGLImageKHR image, int *fourcc, int *num_planes, guint64 * modifiers);
+typedef EGLBoolean (*ExportDMABUFImageFunc) (EGLDisplay dpy,
+    EGLImageKHR image, int *fds, EGLint * strides, EGLint * offsets);
 
 static gboolean gst_gl_context_egl_create_context (GstGLContext * context,
     GstGLAPI gl_api, GstGLContext * other_context, GError ** error);
@@ -162,7 +182,13 @@ gst_gl_context_egl_choose_config (GstGLContextEGL * egl,
   EGLint config_attrib[20];
 
   config_attrib[i++] = EGL_SURFACE_TYPE;
-  config_attrib[i++] = EGL_WINDOW_BIT;
+#if GST_GL_HAVE_WINDOW_HEADLESS
+  /* the surfaceless platform doesn't expose any window capable configs */
+  if (GST_GL_IS_WINDOW_HEADLESS (GST_GL_CONTEXT (egl)->window))
+    config_attrib[i++] = EGL_PBUFFER_BIT;
+  else
+#endif
+    config_attrib[i++] = EGL_WINDOW_BIT;
   config_attrib[i++] = EGL_RENDERABLE_TYPE;
   if (egl->gl_api & GST_GL_API_GLES2)
     config_attrib[i++] = EGL_OPENGL_ES2_BIT;
@@ -235,6 +261,11 @@ gst_gl_context_egl_create_context (GstGLContext * context,
   if (other_context) {
     GstGLContextEGL *other_egl = (GstGLContextEGL *) other_context;
     egl->egl_display = other_egl->egl_display;
+#if GST_GL_HAVE_WINDOW_HEADLESS
+  } else if (GST_GL_IS_WINDOW_HEADLESS (window)) {
+    /* already an EGLDisplay retrieved from the surfaceless platform */
+    egl->egl_display = (EGLDisplay) gst_gl_window_get_display (window);
+#endif
   } else {
     egl->egl_display = eglGetDisplay ((EGLNativeDisplayType)
         gst_gl_window_get_display (window));
@@ -324,6 +355,28 @@ gst_gl_context_egl_create_context (GstGLContext * context,
 
   egl_exts = eglQueryString (egl->egl_display, EGL_EXTENSIONS);
 
+  if (gst_gl_check_extension ("EGL_KHR_image_base", egl_exts)) {
+    egl->eglCreateImage = (PFNEGLCREATEIMAGEKHRPROC)
+        eglGetProcAddress ("eglCreateImageKHR");
+    egl->eglDestroyImage = (PFNEGLDESTROYIMAGEKHRPROC)
+        eglGetProcAddress ("eglDestroyImageKHR");
+  }
+  egl->have_dmabuf_import = egl->eglCreateImage && egl->eglDestroyImage
+      && gst_gl_check_extension ("EGL_EXT_image_dma_buf_import", egl_exts);
+  GST_INFO ("EGL_EXT_image_dma_buf_import supported: %s",
+      egl->have_dmabuf_import ? "yes" : "no");
+
+  if (gst_gl_check_extension ("EGL_MESA_image_dma_buf_export", egl_exts)) {
+    egl->eglExportDMABUFImageQuery =
+        eglGetProcAddress ("eglExportDMABUFImageQueryMESA");
+    egl->eglExportDMABUFImage = eglGetProcAddress ("eglExportDMABUFImageMESA");
+  }
+  egl->have_dmabuf_export = egl->eglCreateImage
+      && egl->eglExportDMABUFImageQuery && egl->eglExportDMABUFImage
+      && gst_gl_check_extension ("EGL_KHR_gl_texture_2D_image", egl_exts);
+  GST_INFO ("EGL_MESA_image_dma_buf_export supported: %s",
+      egl->have_dmabuf_export ? "yes" : "no");
+
   if (other_context == NULL) {
     /* FIXME do we want a window vfunc ? */
 #if GST_GL_HAVE_WINDOW_X11
@@ -469,3 +522,150 @@ gst_gl_context_egl_get_proc_address (GstGLContext * context, const gchar * name)
 
   return result;
 }
+
+/*
+ * gst_gl_context_egl_import_dmabuf:
+ * @egl: a #GstGLContextEGL
+ * @fd: the dmabuf file descriptor
+ * @fourcc: the DRM fourcc describing the plane
+ * @width: the width of the plane in pixels
+ * @height: the height of the plane in pixels
+ * @offset: byte offset of the plane inside @fd
+ * @stride: the stride of the plane in bytes
+ *
+ * Wraps a single plane of a dmabuf into an #EGLImageKHR through
+ * EGL_EXT_image_dma_buf_import.  The returned image can be bound to a texture
+ * with glEGLImageTargetTexture2DOES() and must be released with
+ * gst_gl_context_egl_destroy_image().
+ *
+ * Returns: the new #EGLImageKHR or %EGL_NO_IMAGE_KHR on failure
+ */
+EGLImageKHR
+gst_gl_context_egl_import_dmabuf (GstGLContextEGL * egl, gint fd,
+    guint32 fourcc, gint width, gint height, gsize offset, gint stride)
+{
+  EGLImageKHR image;
+  EGLint attribs[13];
+  gint i = 0;
+
+  g_return_val_if_fail (GST_GL_IS_CONTEXT_EGL (egl), EGL_NO_IMAGE_KHR);
+
+  if (!egl->have_dmabuf_import)
+    return EGL_NO_IMAGE_KHR;
+
+  attribs[i++] = EGL_WIDTH;
+  attribs[i++] = width;
+  attribs[i++] = EGL_HEIGHT;
+  attribs[i++] = height;
+  attribs[i++] = EGL_LINUX_DRM_FOURCC_EXT;
+  attribs[i++] = fourcc;
+  attribs[i++] = EGL_DMA_BUF_PLANE0_FD_EXT;
+  attribs[i++] = fd;
+  attribs[i++] = EGL_DMA_BUF_PLANE0_OFFSET_EXT;
+  attribs[i++] = offset;
+  attribs[i++] = EGL_DMA_BUF_PLANE0_PITCH_EXT;
+  attribs[i++] = stride;
+  attribs[i++] = EGL_NONE;
+
+  /* dmabuf imports must not specify a client buffer nor a context */
+  image = egl->eglCreateImage (egl->egl_display, EGL_NO_CONTEXT,
+      EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+  if (image == EGL_NO_IMAGE_KHR)
+    GST_WARNING ("Failed to import dmabuf %d (%" GST_FOURCC_FORMAT
+        " %dx%d, offset:%" G_GSIZE_FORMAT " stride:%d): %s", fd,
+        GST_FOURCC_ARGS (fourcc), width, height, offset, stride,
+        gst_gl_context_egl_get_error_string ());
+
+  return image;
+}
+
+/*
+ * gst_gl_context_egl_destroy_image:
+ * @egl: a #GstGLContextEGL
+ * @image: an #EGLImageKHR
+ *
+ * Destroys @image.  Textures that @image has been bound to keep their
+ * contents.
+ */
+void
+gst_gl_context_egl_destroy_image (GstGLContextEGL * egl, EGLImageKHR image)
+{
+  g_return_if_fail (GST_GL_IS_CONTEXT_EGL (egl));
+
+  if (image != EGL_NO_IMAGE_KHR && egl->eglDestroyImage)
+    egl->eglDestroyImage (egl->egl_display, image);
+}
+
+/*
+ * gst_gl_context_egl_export_dmabuf:
+ * @egl: a #GstGLContextEGL
+ * @texture: a 2D texture of @egl
+ * @fd: (out): the exported dmabuf file descriptor
+ * @fourcc: (out): the DRM fourcc of the exported buffer
+ * @stride: (out): the stride of the exported buffer in bytes
+ * @offset: (out): the offset of the data inside @fd
+ *
+ * Exports the storage of @texture as a dmabuf through
+ * EGL_MESA_image_dma_buf_export.  Only single plane textures are supported.
+ * The caller owns @fd and must not respecify @texture while @fd is in use.
+ *
+ * Must be called in the gl thread.
+ *
+ * Returns: whether the export succeeded
+ */
+gboolean
+gst_gl_context_egl_export_dmabuf (GstGLContextEGL * egl, guint texture,
+    gint * fd, guint32 * fourcc, gint * stride, gint * offset)
+{
+  ExportDMABUFImageQueryFunc export_query;
+  ExportDMABUFImageFunc export_image;
+  EGLImageKHR image;
+  gint num_planes = 0, out_fourcc = 0;
+  EGLint out_stride = 0, out_offset = 0;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (GST_GL_IS_CONTEXT_EGL (egl), FALSE);
+
+  if (!egl->have_dmabuf_export)
+    return FALSE;
+
+  export_query = (ExportDMABUFImageQueryFunc) egl->eglExportDMABUFImageQuery;
+  export_image = (ExportDMABUFImageFunc) egl->eglExportDMABUFImage;
+
+  image = egl->eglCreateImage (egl->egl_display, egl->egl_context,
+      EGL_GL_TEXTURE_2D_KHR, (EGLClientBuffer) (guintptr) texture, NULL);
+  if (image == EGL_NO_IMAGE_KHR) {
+    GST_WARNING ("Failed to create an EGLImage from texture %u: %s", texture,
+        gst_gl_context_egl_get_error_string ());
+    return FALSE;
+  }
+
+  if (!export_query (egl->egl_display, image, &out_fourcc, &num_planes, NULL)) {
+    GST_WARNING ("Failed to query the dmabuf layout of texture %u: %s",
+        texture, gst_gl_context_egl_get_error_string ());
+    goto done;
+  }
+
+  if (num_planes != 1) {
+    GST_WARNING ("Texture %u exports as %d planes, expected 1", texture,
+        num_planes);
+    goto done;
+  }
+
+  if (!export_image (egl->egl_display, image, fd, &out_stride, &out_offset)) {
+    GST_WARNING ("Failed to export texture %u: %s", texture,
+        gst_gl_context_egl_get_error_string ());
+    goto done;
+  }
+
+  *fourcc = out_fourcc;
+  *stride = out_stride;
+  *offset = out_offset;
+  ret = TRUE;
+
+done:
+  /* the dmabuf keeps the storage alive on its own */
+  gst_gl_context_egl_destroy_image (egl, image);
+
+  return ret;
+}
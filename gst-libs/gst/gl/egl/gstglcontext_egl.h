@@ -23,6 +23,7 @@
 
 #include <gst/gst.h>
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 
 #include <gst/gl/gstgl_fwd.h>
 #include <gst/gl/gstglcontext.h>
@@ -48,6 +49,16 @@ struct _GstGLContextEGL {
   EGLConfig  egl_config;
 
   GstGLAPI gl_api;
+
+  /* EGL_KHR_image_base */
+  PFNEGLCREATEIMAGEKHRPROC eglCreateImage;
+  PFNEGLDESTROYIMAGEKHRPROC eglDestroyImage;
+  /* EGL_EXT_image_dma_buf_import */
+  gboolean have_dmabuf_import;
+  /* EGL_MESA_image_dma_buf_export */
+  gpointer eglExportDMABUFImageQuery;
+  gpointer eglExportDMABUFImage;
+  gboolean have_dmabuf_export;
 };
 
 struct _GstGLContextEGLClass {
@@ -57,6 +68,14 @@ struct _GstGLContextEGLClass {
 GType gst_gl_context_egl_get_type     (void);
 GstGLContextEGL * gst_gl_context_egl_new (void);
 
+EGLImageKHR gst_gl_context_egl_import_dmabuf (GstGLContextEGL * egl, gint fd,
+                                              guint32 fourcc, gint width, gint height,
+                                              gsize offset, gint stride);
+void        gst_gl_context_egl_destroy_image (GstGLContextEGL * egl, EGLImageKHR image);
+gboolean    gst_gl_context_egl_export_dmabuf (GstGLContextEGL * egl, guint texture,
+                                              gint * fd, guint32 * fourcc,
+                                              gint * stride, gint * offset);
+
 G_END_DECLS
 
 #endif /* __GST_GL_EGL_H__ */
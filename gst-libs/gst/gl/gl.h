@@ -34,6 +34,7 @@
 #include <gst/gl/gstgldownload.h>
 #include <gst/gl/gstglmemory.h>
 #include <gst/gl/gstglbufferpool.h>
+#include <gst/gl/gstglsyncmeta.h>
 #include <gst/gl/gstglframebuffer.h>
 #include <gst/gl/gstglfilter.h>
 #include <gst/gl/gstglmixer.h>
@@ -54,3 +54,112 @@ GST_GL_EXT_FUNCTION (void, DrawBuffers,
                      (GLsizei n, const GLenum *bufs))
 GST_GL_EXT_END ()
 
+
+GST_GL_EXT_BEGIN (map_buffer_range, 3, 0,
+                  GST_GL_API_GLES3,
+                  "ARB:\0EXT\0",
+                  "map_buffer_range\0")
+GST_GL_EXT_FUNCTION (void *, MapBufferRange,
+                     (GLenum target, GLintptr offset, GLsizeiptr length,
+                      GLbitfield access))
+GST_GL_EXT_FUNCTION (void, FlushMappedBufferRange,
+                     (GLenum target, GLintptr offset, GLsizeiptr length))
+GST_GL_EXT_END ()
+
+GST_GL_EXT_BEGIN (sync, 3, 2,
+                  GST_GL_API_GLES3,
+                  "ARB:\0APPLE\0",
+                  "sync\0")
+GST_GL_EXT_FUNCTION (GLsync, FenceSync,
+                     (GLenum condition, GLbitfield flags))
+GST_GL_EXT_FUNCTION (GLboolean, IsSync,
+                     (GLsync sync))
+GST_GL_EXT_FUNCTION (void, DeleteSync,
+                     (GLsync sync))
+GST_GL_EXT_FUNCTION (GLenum, ClientWaitSync,
+                     (GLsync sync, GLbitfield flags, GLuint64 timeout))
+GST_GL_EXT_FUNCTION (void, WaitSync,
+                     (GLsync sync, GLbitfield flags, GLuint64 timeout))
+GST_GL_EXT_END ()
+
+GST_GL_EXT_BEGIN (vertex_array_object, 3, 0,
+                  GST_GL_API_GLES3,
+                  "ARB:\0OES\0",
+                  "vertex_array_object\0")
+GST_GL_EXT_FUNCTION (void, GenVertexArrays,
+                     (GLsizei n, GLuint *arrays))
+GST_GL_EXT_FUNCTION (void, DeleteVertexArrays,
+                     (GLsizei n, const GLuint *arrays))
+GST_GL_EXT_FUNCTION (void, BindVertexArray,
+                     (GLuint array))
+GST_GL_EXT_END ()
+
+/* persistently mapped buffers are not in GL core before 4.4 and not in
+ * GLES core at all */
+GST_GL_EXT_BEGIN (buffer_storage, 4, 4,
+                  0,
+                  "ARB:\0EXT\0",
+                  "buffer_storage\0")
+GST_GL_EXT_FUNCTION (void, BufferStorage,
+                     (GLenum target, GLsizeiptr size, const GLvoid *data,
+                      GLbitfield flags))
+GST_GL_EXT_END ()
+
+/* immutable texture storage, GLES2 has it through EXT_texture_storage */
+GST_GL_EXT_BEGIN (texture_storage, 4, 2,
+                  GST_GL_API_GLES3,
+                  "ARB:\0EXT\0",
+                  "texture_storage\0")
+GST_GL_EXT_FUNCTION (void, TexStorage2D,
+                     (GLenum target, GLsizei levels, GLenum internalformat,
+                      GLsizei width, GLsizei height))
+GST_GL_EXT_END ()
+
+GST_GL_EXT_BEGIN (get_program_binary, 4, 1,
+                  GST_GL_API_GLES3,
+                  "ARB:\0OES\0",
+                  "get_program_binary\0")
+GST_GL_EXT_FUNCTION (void, GetProgramBinary,
+                     (GLuint program, GLsizei bufSize, GLsizei *length,
+                      GLenum *binaryFormat, GLvoid *binary))
+GST_GL_EXT_FUNCTION (void, ProgramBinary,
+                     (GLuint program, GLenum binaryFormat,
+                      const GLvoid *binary, GLint length))
+GST_GL_EXT_END ()
+
+/* not part of GL_OES_get_program_binary */
+GST_GL_EXT_BEGIN (program_parameteri, 4, 1,
+                  GST_GL_API_GLES3,
+                  "ARB:\0",
+                  "get_program_binary\0")
+GST_GL_EXT_FUNCTION (void, ProgramParameteri,
+                     (GLuint program, GLenum pname, GLint value))
+GST_GL_EXT_END ()
+
+GST_GL_EXT_BEGIN (query_objects, 1, 5,
+                  GST_GL_API_GLES3,
+                  "ARB\0",
+                  "occlusion_query\0")
+GST_GL_EXT_FUNCTION (void, GenQueries,
+                     (GLsizei n, GLuint *ids))
+GST_GL_EXT_FUNCTION (void, DeleteQueries,
+                     (GLsizei n, const GLuint *ids))
+GST_GL_EXT_FUNCTION (void, BeginQuery,
+                     (GLenum target, GLuint id))
+GST_GL_EXT_FUNCTION (void, EndQuery,
+                     (GLenum target))
+GST_GL_EXT_FUNCTION (void, GetQueryObjectuiv,
+                     (GLuint id, GLenum pname, GLuint *params))
+GST_GL_EXT_END ()
+
+/* GLES only has these through EXT_disjoint_timer_query which also needs
+ * GL_GPU_DISJOINT_EXT to be checked, so it's not used */
+GST_GL_EXT_BEGIN (timer_query, 3, 3,
+                  0,
+                  "ARB:\0",
+                  "timer_query\0")
+GST_GL_EXT_FUNCTION (void, QueryCounter,
+                     (GLuint id, GLenum target))
+GST_GL_EXT_FUNCTION (void, GetQueryObjectui64v,
+                     (GLuint id, GLenum pname, GLuint64 *params))
+GST_GL_EXT_END ()
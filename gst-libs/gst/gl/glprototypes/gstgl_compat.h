@@ -36,5 +36,14 @@ typedef ptrdiff_t GLsizeiptr;
 #ifndef GST_GL_HAVE_GLINTPTR
 typedef ptrdiff_t GLintptr;
 #endif
+#ifndef GST_GL_HAVE_GLSYNC
+typedef gpointer GLsync;
+#endif
+#ifndef GST_GL_HAVE_GLUINT64
+typedef guint64 GLuint64;
+#endif
+#ifndef GST_GL_HAVE_GLINT64
+typedef gint64 GLint64;
+#endif
 
 #endif
@@ -55,6 +55,8 @@ typedef struct _GstGLUpload GstGLUpload;
 typedef struct _GstGLUploadClass GstGLUploadClass;
 typedef struct _GstGLUploadPrivate GstGLUploadPrivate;
 
+typedef struct _GstGLSyncMeta GstGLSyncMeta;
+
 G_END_DECLS
 
 #endif /* __GST_GL_FWD_H__ */
@@ -44,6 +44,7 @@
 
 #include "gl.h"
 #include "gstglcontext.h"
+#include "gstglprofile.h"
 
 #if GST_GL_HAVE_PLATFORM_GLX
 #include "x11/gstglcontext_glx.h"
@@ -75,6 +76,84 @@ G_DEFINE_ABSTRACT_TYPE (GstGLContext, gst_gl_context, G_TYPE_OBJECT);
 
 static gpointer gst_gl_context_create_thread (GstGLContext * context);
 static void gst_gl_context_finalize (GObject * object);
+static void _gst_gl_context_drain_commands (GstGLContext * context);
+static void _gst_gl_context_run_commands (GstGLContext * context,
+    guint64 until);
+static void _gst_gl_context_stop_commands (GstGLContext * context);
+
+/* State tracking
+ *
+ * Every GL thread has exactly one current context, so the entry points of the
+ * vtable that change the state elided below are swapped for wrappers that look
+ * up the tracker of the context current in the calling thread and only forward
+ * the calls that actually change something, through the entry points of that
+ * context.  The library and the elements keep calling through the vtable and
+ * don't need to know about the cache.  A tracker is current in every thread a
+ * #GstGLContext is activated in; a wrapper reached from any other thread has
+ * no context to forward the call to.
+ *
+ * Textures and programs live in the share group, so another context may
+ * delete a bound one and have its name reused.  Their cached bindings are
+ * forgotten whenever the context is made current and before every function
+ * run in the GL thread.
+ *
+ * Only the state changed on nearly every pass is tracked: the current program,
+ * the framebuffer, the viewport, the active texture unit with its 2D texture
+ * binding and GL_TEXTURE_2D enable, and the blend and depth test enables.
+ */
+#define STATE_MAX_TEXTURE_UNITS 32
+#define STATE_UNKNOWN G_MAXUINT
+
+typedef struct
+{
+  void GSTGLAPI (*ActiveTexture) (GLenum texture);
+  void GSTGLAPI (*BindTexture) (GLenum target, GLuint texture);
+  void GSTGLAPI (*DeleteTextures) (GLsizei n, const GLuint * textures);
+  void GSTGLAPI (*BindFramebuffer) (GLenum target, GLuint framebuffer);
+  void GSTGLAPI (*DeleteFramebuffers) (GLsizei n, const GLuint * framebuffers);
+  void GSTGLAPI (*UseProgram) (GLuint program);
+  void GSTGLAPI (*UseProgramObject) (GLuint program);
+  void GSTGLAPI (*Viewport) (GLint x, GLint y, GLsizei width, GLsizei height);
+  void GSTGLAPI (*Enable) (GLenum cap);
+  void GSTGLAPI (*Disable) (GLenum cap);
+  void GSTGLAPI (*PopAttrib) (void);
+} GstGLStateFuncs;
+
+typedef struct _GstGLStateTracker GstGLStateTracker;
+
+struct _GstGLStateTracker
+{
+  /* what the vtable of the context pointed to before the wrappers were
+   * installed */
+  GstGLStateFuncs real;
+
+  GLuint program;
+  GLuint framebuffer;
+  GLuint active_unit;
+  GLuint textures[STATE_MAX_TEXTURE_UNITS];
+  GLuint texture_2d[STATE_MAX_TEXTURE_UNITS];
+  GLint viewport[4];
+  gboolean viewport_valid;
+  GLuint blend;
+  GLuint depth_test;
+
+  guint64 n_elided;
+};
+
+static GPrivate current_state = G_PRIVATE_INIT (NULL);
+
+static void _state_tracker_invalidate (GstGLStateTracker * state);
+static void _state_tracker_invalidate_shared (GstGLStateTracker * state);
+
+#define STATE_GET_OR_RETURN(state) \
+  G_STMT_START { \
+    state = g_private_get (&current_state); \
+    if (G_UNLIKELY (!state)) { \
+      g_critical ("%s called from a thread without an active GstGLContext", \
+          G_STRFUNC); \
+      return; \
+    } \
+  } G_STMT_END
 
 struct _GstGLContextPrivate
 {
@@ -93,8 +172,43 @@ struct _GstGLContextPrivate
   GstGLContext *other_context;
   GstGLAPI gl_api;
   GError **error;
+
+  /* asynchronous commands */
+  GAsyncQueue *commands;
+  guint64 n_submitted;
+  volatile gint drain_scheduled;
+  /* commands being run in the gl thread, > 1 when a command waits on the
+   * ones queued after it */
+  guint drain_depth;
+  guint64 last_run;
+  GMutex completed_lock;
+  GCond completed_cond;
+  guint64 n_completed;
+  /* the gl thread is gone, no more commands are run */
+  gboolean stopped;
+
+  /* cached GL state, owned by the gl thread */
+  GstGLStateTracker *state;
 };
 
+typedef struct
+{
+  GstGLContextThreadFunc func;
+  gpointer data;
+  GDestroyNotify notify;
+  guint64 id;
+  const gchar *owner;
+} GstGLContextCommand;
+
+static void
+_free_command (GstGLContextCommand * cmd)
+{
+  if (cmd->notify)
+    cmd->notify (cmd->data);
+
+  g_slice_free (GstGLContextCommand, cmd);
+}
+
 GQuark
 gst_gl_context_error_quark (void)
 {
@@ -129,6 +243,11 @@ gst_gl_context_init (GstGLContext * context)
   g_cond_init (&context->priv->create_cond);
   g_cond_init (&context->priv->destroy_cond);
   context->priv->created = FALSE;
+
+  context->priv->commands =
+      g_async_queue_new_full ((GDestroyNotify) _free_command);
+  g_mutex_init (&context->priv->completed_lock);
+  g_cond_init (&context->priv->completed_cond);
 }
 
 static void
@@ -205,6 +324,10 @@ gst_gl_context_finalize (GObject * object)
   gst_gl_window_set_draw_callback (context->window, NULL, NULL, NULL);
 
   if (context->priv->alive) {
+    /* run whatever is still queued while the context is still current */
+    gst_gl_window_send_message (context->window,
+        GST_GL_WINDOW_CB (_gst_gl_context_drain_commands), context);
+
     g_mutex_lock (&context->priv->render_lock);
     GST_INFO ("send quit gl window loop");
     gst_gl_window_quit (context->window);
@@ -227,6 +350,11 @@ gst_gl_context_finalize (GObject * object)
   gst_object_unref (context->window);
   gst_object_unref (context->priv->display);
 
+  if (context->priv->state) {
+    g_slice_free (GstGLStateTracker, context->priv->state);
+    context->priv->state = NULL;
+  }
+
   if (context->gl_vtable) {
     g_slice_free (GstGLFuncs, context->gl_vtable);
     context->gl_vtable = NULL;
@@ -237,6 +365,10 @@ gst_gl_context_finalize (GObject * object)
   g_cond_clear (&context->priv->destroy_cond);
   g_cond_clear (&context->priv->create_cond);
 
+  g_async_queue_unref (context->priv->commands);
+  g_mutex_clear (&context->priv->completed_lock);
+  g_cond_clear (&context->priv->completed_cond);
+
   G_OBJECT_CLASS (gst_gl_context_parent_class)->finalize (object);
 }
 
@@ -264,6 +396,17 @@ gst_gl_context_activate (GstGLContext * context, gboolean activate)
 
   result = context_class->activate (context, activate);
 
+  if (!context->priv->state || !result)
+    return result;
+
+  if (activate) {
+    /* calls through the vtable in this thread now go to this context */
+    _state_tracker_invalidate (context->priv->state);
+    g_private_set (&current_state, context->priv->state);
+  } else if (g_private_get (&current_state) == context->priv->state) {
+    g_private_set (&current_state, NULL);
+  }
+
   return result;
 }
 
@@ -572,6 +715,325 @@ _compiled_api (void)
   return ret;
 }
 
+static void
+_state_tracker_invalidate (GstGLStateTracker * state)
+{
+  guint i;
+
+  state->program = STATE_UNKNOWN;
+  state->framebuffer = STATE_UNKNOWN;
+  state->active_unit = STATE_UNKNOWN;
+  for (i = 0; i < STATE_MAX_TEXTURE_UNITS; i++) {
+    state->textures[i] = STATE_UNKNOWN;
+    state->texture_2d[i] = STATE_UNKNOWN;
+  }
+  state->viewport_valid = FALSE;
+  state->blend = STATE_UNKNOWN;
+  state->depth_test = STATE_UNKNOWN;
+}
+
+/* forgets the bindings of the objects that other contexts of the share group
+ * can delete */
+static void
+_state_tracker_invalidate_shared (GstGLStateTracker * state)
+{
+  guint i;
+
+  state->program = STATE_UNKNOWN;
+  for (i = 0; i < STATE_MAX_TEXTURE_UNITS; i++)
+    state->textures[i] = STATE_UNKNOWN;
+}
+
+/* returns whether the cached @value already holds @new_value, recording it
+ * otherwise */
+static inline gboolean
+_state_tracker_update (GstGLStateTracker * state, GLuint * value,
+    GLuint new_value)
+{
+  if (*value == new_value) {
+    state->n_elided++;
+    return TRUE;
+  }
+
+  *value = new_value;
+  return FALSE;
+}
+
+static GLuint *
+_state_tracker_get_cap (GstGLStateTracker * state, GLenum cap)
+{
+  switch (cap) {
+    case GL_BLEND:
+      return &state->blend;
+    case GL_DEPTH_TEST:
+      return &state->depth_test;
+#if GST_GL_HAVE_OPENGL
+    case GL_TEXTURE_2D:
+      if (state->active_unit < STATE_MAX_TEXTURE_UNITS)
+        return &state->texture_2d[state->active_unit];
+      return NULL;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+static void GSTGLAPI
+_state_active_texture (GLenum texture)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  if (!_state_tracker_update (state, &state->active_unit,
+          texture - GL_TEXTURE0))
+    state->real.ActiveTexture (texture);
+}
+
+static void GSTGLAPI
+_state_bind_texture (GLenum target, GLuint texture)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  if (target != GL_TEXTURE_2D || state->active_unit >= STATE_MAX_TEXTURE_UNITS) {
+    state->real.BindTexture (target, texture);
+    return;
+  }
+
+  if (!_state_tracker_update (state, &state->textures[state->active_unit],
+          texture))
+    state->real.BindTexture (target, texture);
+}
+
+static void GSTGLAPI
+_state_delete_textures (GLsizei n, const GLuint * textures)
+{
+  GstGLStateTracker *state;
+  GLsizei i;
+  guint j;
+
+  STATE_GET_OR_RETURN (state);
+
+  /* deleting a bound texture reverts the binding to 0 */
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < STATE_MAX_TEXTURE_UNITS; j++) {
+      if (textures[i] != 0 && state->textures[j] == textures[i])
+        state->textures[j] = 0;
+    }
+  }
+
+  state->real.DeleteTextures (n, textures);
+}
+
+static void GSTGLAPI
+_state_bind_framebuffer (GLenum target, GLuint framebuffer)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  /* only one of the read/draw bindings changes */
+  if (target != GL_FRAMEBUFFER) {
+    state->framebuffer = STATE_UNKNOWN;
+    state->real.BindFramebuffer (target, framebuffer);
+    return;
+  }
+
+  if (!_state_tracker_update (state, &state->framebuffer, framebuffer))
+    state->real.BindFramebuffer (target, framebuffer);
+}
+
+static void GSTGLAPI
+_state_delete_framebuffers (GLsizei n, const GLuint * framebuffers)
+{
+  GstGLStateTracker *state;
+  GLsizei i;
+
+  STATE_GET_OR_RETURN (state);
+
+  for (i = 0; i < n; i++) {
+    if (framebuffers[i] != 0 && state->framebuffer == framebuffers[i])
+      state->framebuffer = 0;
+  }
+
+  state->real.DeleteFramebuffers (n, framebuffers);
+}
+
+static void GSTGLAPI
+_state_use_program (GLuint program)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  if (!_state_tracker_update (state, &state->program, program))
+    state->real.UseProgram (program);
+}
+
+static void GSTGLAPI
+_state_use_program_object (GLuint program)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  if (!_state_tracker_update (state, &state->program, program))
+    state->real.UseProgramObject (program);
+}
+
+static void GSTGLAPI
+_state_viewport (GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  if (state->viewport_valid && state->viewport[0] == x
+      && state->viewport[1] == y && state->viewport[2] == width
+      && state->viewport[3] == height) {
+    state->n_elided++;
+    return;
+  }
+
+  state->viewport[0] = x;
+  state->viewport[1] = y;
+  state->viewport[2] = width;
+  state->viewport[3] = height;
+  state->viewport_valid = TRUE;
+
+  state->real.Viewport (x, y, width, height);
+}
+
+static void GSTGLAPI
+_state_enable (GLenum cap)
+{
+  GstGLStateTracker *state;
+  GLuint *value;
+
+  STATE_GET_OR_RETURN (state);
+
+  value = _state_tracker_get_cap (state, cap);
+  if (!value || !_state_tracker_update (state, value, TRUE))
+    state->real.Enable (cap);
+}
+
+static void GSTGLAPI
+_state_disable (GLenum cap)
+{
+  GstGLStateTracker *state;
+  GLuint *value;
+
+  STATE_GET_OR_RETURN (state);
+
+  value = _state_tracker_get_cap (state, cap);
+  if (!value || !_state_tracker_update (state, value, FALSE))
+    state->real.Disable (cap);
+}
+
+static void GSTGLAPI
+_state_pop_attrib (void)
+{
+  GstGLStateTracker *state;
+
+  STATE_GET_OR_RETURN (state);
+
+  /* the restored groups aren't known, the program and framebuffer bindings
+   * aren't part of any of them */
+  {
+    GLuint program = state->program;
+    GLuint framebuffer = state->framebuffer;
+
+    _state_tracker_invalidate (state);
+    state->program = program;
+    state->framebuffer = framebuffer;
+  }
+
+  state->real.PopAttrib ();
+}
+
+#define WRAP_STATE_FUNC(name, wrapper) \
+  G_STMT_START { \
+    state->real.name = gl->name; \
+    if (gl->name) \
+      gl->name = wrapper; \
+  } G_STMT_END
+
+/* Called in the gl thread once the vtable has been filled */
+static void
+_install_state_tracker (GstGLContext * context)
+{
+  GstGLFuncs *gl = context->gl_vtable;
+  GstGLStateTracker *state;
+  const gchar *env = g_getenv ("GST_GL_STATE_TRACKER");
+
+  if (env && g_strcmp0 (env, "0") == 0)
+    return;
+
+  state = g_slice_new0 (GstGLStateTracker);
+
+  WRAP_STATE_FUNC (ActiveTexture, _state_active_texture);
+  WRAP_STATE_FUNC (BindTexture, _state_bind_texture);
+  WRAP_STATE_FUNC (DeleteTextures, _state_delete_textures);
+  WRAP_STATE_FUNC (BindFramebuffer, _state_bind_framebuffer);
+  WRAP_STATE_FUNC (DeleteFramebuffers, _state_delete_framebuffers);
+  WRAP_STATE_FUNC (UseProgram, _state_use_program);
+  WRAP_STATE_FUNC (UseProgramObject, _state_use_program_object);
+  WRAP_STATE_FUNC (Viewport, _state_viewport);
+  WRAP_STATE_FUNC (Enable, _state_enable);
+  WRAP_STATE_FUNC (Disable, _state_disable);
+  WRAP_STATE_FUNC (PopAttrib, _state_pop_attrib);
+
+  _state_tracker_invalidate (state);
+
+  context->priv->state = state;
+  g_private_set (&current_state, state);
+}
+
+#undef WRAP_STATE_FUNC
+
+/**
+ * gst_gl_context_invalidate_state:
+ * @context: a #GstGLContext
+ *
+ * Forget the GL state @context has cached.  The library issues the state
+ * changes through the functions in the #GstGLFuncs of @context, which skip
+ * the calls that wouldn't change anything.  Code that changes the same state
+ * without going through them, e.g. by calling the GL entry points directly,
+ * must call this before handing control back.
+ *
+ * Must be called in the GL thread of @context.
+ */
+void
+gst_gl_context_invalidate_state (GstGLContext * context)
+{
+  g_return_if_fail (GST_GL_IS_CONTEXT (context));
+
+  if (context->priv->state)
+    _state_tracker_invalidate (context->priv->state);
+}
+
+/**
+ * gst_gl_context_get_n_elided_state_changes:
+ * @context: a #GstGLContext
+ *
+ * Returns: the number of state changes made through the #GstGLFuncs of
+ * @context that were not forwarded to the driver because they wouldn't have
+ * changed anything.  The value is updated from the GL thread of @context
+ * without synchronisation and is only meant for profiling.
+ */
+guint64
+gst_gl_context_get_n_elided_state_changes (GstGLContext * context)
+{
+  g_return_val_if_fail (GST_GL_IS_CONTEXT (context), 0);
+
+  if (!context->priv->state)
+    return 0;
+
+  return context->priv->state->n_elided;
+}
+
 static void
 _unlock_create_thread (GstGLContext * context)
 {
@@ -580,6 +1042,25 @@ _unlock_create_thread (GstGLContext * context)
 
 //gboolean
 //gst_gl_context_create (GstGLContext * context, GstGLContext * other_context, GError ** error)
+/* The helpers in gstglutils.c keep GL objects per context as qdata.  The
+ * context may share its objects with others that live on, so those are
+ * deleted here while the context is still current rather than left behind
+ * when the qdata is dropped at finalize. */
+static const gchar *gl_qdata_names[] = {
+  "GstGLTexturePool",
+  "GstGLFullscreenQuad",
+};
+
+static void
+_free_gl_qdata (GstGLContext * context)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (gl_qdata_names); i++)
+    g_object_set_qdata (G_OBJECT (context),
+        g_quark_from_static_string (gl_qdata_names[i]), NULL);
+}
+
 static gpointer
 gst_gl_context_create_thread (GstGLContext * context)
 {
@@ -699,6 +1180,8 @@ gst_gl_context_create_thread (GstGLContext * context)
   if (!ret)
     goto failure;
 
+  _install_state_tracker (context);
+
   context->priv->alive = TRUE;
 
   g_cond_signal (&context->priv->create_cond);
@@ -711,9 +1194,16 @@ gst_gl_context_create_thread (GstGLContext * context)
 
   GST_INFO ("loop exited\n");
 
+  /* nothing will dispatch the commands queued from now on, run the ones
+   * still there while the context is current */
+  _gst_gl_context_run_commands (context, 0);
+
+  _free_gl_qdata (context);
+
   g_mutex_lock (&context->priv->render_lock);
 
   context->priv->alive = FALSE;
+  _gst_gl_context_stop_commands (context);
 
   if (window_class->close) {
     window_class->close (context->window);
@@ -723,6 +1213,12 @@ gst_gl_context_create_thread (GstGLContext * context)
 
   context_class->destroy_context (context);
 
+  if (context->priv->state) {
+    GST_INFO ("elided %" G_GUINT64_FORMAT " redundant state changes",
+        context->priv->state->n_elided);
+    g_private_set (&current_state, NULL);
+  }
+
   if (context->window->close)
     context->window->close (context->window->close_data);
 
@@ -734,6 +1230,7 @@ gst_gl_context_create_thread (GstGLContext * context)
 
 failure:
   {
+    _gst_gl_context_stop_commands (context);
     g_cond_signal (&context->priv->create_cond);
     g_mutex_unlock (&context->priv->render_lock);
     return NULL;
@@ -782,14 +1279,28 @@ typedef struct
   GstGLContext *context;
   GstGLContextThreadFunc func;
   gpointer data;
+  const gchar *owner;
 } RunGenericData;
 
 static void
 _gst_gl_context_thread_run_generic (RunGenericData * data)
 {
+  const gchar *owner;
+
+  /* keep the ordering with respect to previously queued async commands,
+   * unless called from one of them */
+  if (data->context->priv->drain_depth == 0)
+    _gst_gl_context_drain_commands (data->context);
+
   GST_TRACE ("running function:%p data:%p", data->func, data->data);
 
+  if (data->context->priv->state)
+    _state_tracker_invalidate_shared (data->context->priv->state);
+
+  /* attribute the profiled passes to the caller's element */
+  owner = gst_gl_profile_set_owner (data->owner);
   data->func (data->context, data->data);
+  gst_gl_profile_set_owner (owner);
 }
 
 /**
@@ -815,6 +1326,7 @@ gst_gl_context_thread_add (GstGLContext * context,
   rdata.context = context;
   rdata.data = data;
   rdata.func = func;
+  rdata.owner = gst_gl_profile_get_owner ();
 
   window = gst_gl_context_get_window (context);
 
@@ -823,3 +1335,168 @@ gst_gl_context_thread_add (GstGLContext * context,
 
   gst_object_unref (window);
 }
+
+/* Called in the gl thread.  Runs the queued commands up to and including
+ * @until, or all of them when @until is 0. */
+static void
+_gst_gl_context_run_commands (GstGLContext * context, guint64 until)
+{
+  GstGLContextPrivate *priv = context->priv;
+  GstGLContextCommand *cmd;
+  guint n = 0;
+
+  while ((until == 0 || priv->last_run < until)
+      && (cmd = g_async_queue_try_pop (priv->commands))) {
+    const gchar *owner;
+
+    GST_TRACE ("running queued function:%p data:%p id:%" G_GUINT64_FORMAT,
+        cmd->func, cmd->data, cmd->id);
+
+    if (priv->state)
+      _state_tracker_invalidate_shared (priv->state);
+
+    priv->drain_depth++;
+    owner = gst_gl_profile_set_owner (cmd->owner);
+    cmd->func (context, cmd->data);
+    gst_gl_profile_set_owner (owner);
+    priv->drain_depth--;
+
+    priv->last_run = cmd->id;
+    n++;
+
+    _free_command (cmd);
+
+    /* a command is only complete once the one that waited on it is, which
+     * keeps the completed ids in order for the other threads */
+    if (priv->drain_depth == 0) {
+      g_mutex_lock (&priv->completed_lock);
+      priv->n_completed = priv->last_run;
+      g_cond_broadcast (&priv->completed_cond);
+      g_mutex_unlock (&priv->completed_lock);
+    }
+  }
+
+  if (n > 0)
+    GST_TRACE ("ran %u queued functions", n);
+}
+
+/* Called in the gl thread.  Runs all the queued commands in one go. */
+static void
+_gst_gl_context_drain_commands (GstGLContext * context)
+{
+  /* clear the flag before popping so that a command pushed after the queue
+   * was found empty schedules another drain */
+  g_atomic_int_set (&context->priv->drain_scheduled, 0);
+
+  _gst_gl_context_run_commands (context, 0);
+}
+
+/* Called in the gl thread when it exits, releases the waiters */
+static void
+_gst_gl_context_stop_commands (GstGLContext * context)
+{
+  GstGLContextPrivate *priv = context->priv;
+
+  g_mutex_lock (&priv->completed_lock);
+  priv->stopped = TRUE;
+  g_cond_broadcast (&priv->completed_cond);
+  g_mutex_unlock (&priv->completed_lock);
+}
+
+/**
+ * gst_gl_context_thread_add_async:
+ * @context: a #GstGLContext
+ * @func: a #GstGLContextThreadFunc
+ * @data: (closure): user data to call @func with
+ * @notify: (destroy): called when @data is not needed anymore
+ *
+ * Queue @func to be executed in the OpenGL thread of @context with @data
+ * without waiting for it to run.  Commands queued from any thread are
+ * executed in order, and commands queued before a call to
+ * gst_gl_context_thread_add() are guaranteed to have run before the function
+ * passed to it.  Consecutive commands are dispatched to the OpenGL thread in
+ * a single batch.
+ *
+ * Use gst_gl_context_thread_wait() with the returned id to wait for @func to
+ * complete.
+ *
+ * MT-safe
+ *
+ * Returns: an id identifying the queued command
+ */
+guint64
+gst_gl_context_thread_add_async (GstGLContext * context,
+    GstGLContextThreadFunc func, gpointer data, GDestroyNotify notify)
+{
+  GstGLContextPrivate *priv;
+  GstGLContextCommand *cmd;
+  GstGLWindow *window;
+  guint64 id;
+
+  g_return_val_if_fail (GST_GL_IS_CONTEXT (context), 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  priv = context->priv;
+
+  cmd = g_slice_new (GstGLContextCommand);
+  cmd->func = func;
+  cmd->data = data;
+  cmd->notify = notify;
+  cmd->owner = gst_gl_profile_get_owner ();
+
+  /* ids must increase in queue order */
+  g_async_queue_lock (priv->commands);
+  id = cmd->id = ++priv->n_submitted;
+  g_async_queue_push_unlocked (priv->commands, cmd);
+  g_async_queue_unlock (priv->commands);
+
+  GST_TRACE ("queued function:%p data:%p id:%" G_GUINT64_FORMAT, func, data,
+      id);
+
+  if (g_atomic_int_compare_and_exchange (&priv->drain_scheduled, 0, 1)) {
+    window = gst_gl_context_get_window (context);
+    gst_gl_window_send_message_async (window,
+        GST_GL_WINDOW_CB (_gst_gl_context_drain_commands), context, NULL);
+    gst_object_unref (window);
+  }
+
+  return id;
+}
+
+/**
+ * gst_gl_context_thread_wait:
+ * @context: a #GstGLContext
+ * @id: an id returned by gst_gl_context_thread_add_async()
+ *
+ * Blocks until the command identified by @id (and every command queued before
+ * it) has been executed.  When called from the OpenGL thread of @context,
+ * including from a command queued with gst_gl_context_thread_add_async(), the
+ * pending commands up to @id are executed directly.
+ *
+ * Returns immediately once the OpenGL thread of @context has exited, the
+ * commands queued after that are never executed.
+ *
+ * MT-safe
+ */
+void
+gst_gl_context_thread_wait (GstGLContext * context, guint64 id)
+{
+  GstGLContextPrivate *priv;
+
+  g_return_if_fail (GST_GL_IS_CONTEXT (context));
+
+  priv = context->priv;
+
+  if (priv->gl_thread == g_thread_self ()) {
+    _gst_gl_context_run_commands (context, id);
+    return;
+  }
+
+  g_mutex_lock (&priv->completed_lock);
+  while (priv->n_completed < id && !priv->stopped)
+    g_cond_wait (&priv->completed_cond, &priv->completed_lock);
+  if (priv->n_completed < id)
+    GST_WARNING ("gl thread exited before running command %" G_GUINT64_FORMAT,
+        id);
+  g_mutex_unlock (&priv->completed_lock);
+}
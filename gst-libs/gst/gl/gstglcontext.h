@@ -122,10 +122,17 @@ gpointer      gst_gl_context_default_get_proc_address (GstGLContext *context, co
 gboolean      gst_gl_context_set_window (GstGLContext *context, GstGLWindow *window);
 GstGLWindow * gst_gl_context_get_window (GstGLContext *context);
 
+void          gst_gl_context_invalidate_state           (GstGLContext *context);
+guint64       gst_gl_context_get_n_elided_state_changes (GstGLContext *context);
+
 /* FIXME: remove */
 void gst_gl_context_thread_add (GstGLContext * context,
     GstGLContextThreadFunc func, gpointer data);
 
+guint64 gst_gl_context_thread_add_async (GstGLContext * context,
+    GstGLContextThreadFunc func, gpointer data, GDestroyNotify notify);
+void    gst_gl_context_thread_wait      (GstGLContext * context, guint64 id);
+
 G_END_DECLS
 
 #endif /* __GST_GL_CONTEXT_H__ */
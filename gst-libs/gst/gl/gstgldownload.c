@@ -23,9 +23,42 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 
 #include "gl.h"
 #include "gstgldownload.h"
+#include "gstglprofile.h"
+
+#if GST_GL_HAVE_PLATFORM_EGL
+#include <unistd.h>
+#include <gst/allocators/gstdmabuf.h>
+#include "egl/gstglcontext_egl.h"
+#endif
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+#ifndef GL_MEDIUM_FLOAT
+#define GL_MEDIUM_FLOAT 0x8DF1
+#endif
+#ifndef GL_HIGH_FLOAT
+#define GL_HIGH_FLOAT 0x8DF2
+#endif
 
 /**
  * SECTION:gstgldownload
@@ -35,8 +68,22 @@
  * #GstGLDownload is an object that downloads GL textures into system memory.
  *
  * A #GstGLDownload can be created with gst_gl_download_new()
+ *
+ * gst_gl_download_perform_with_data() reads the texture back before
+ * returning.  gst_gl_download_submit() and gst_gl_download_retrieve() split
+ * that in two: up to #GstGLDownload:max-pending readbacks are queued into
+ * pixel pack buffers and retrieved later, in submission order, which lets the
+ * transfer of one frame overlap with the rendering of the next ones.
+ * gst_gl_download_flush() discards the readbacks that are still pending.
+ *
+ * On EGL contexts supporting EGL_MESA_image_dma_buf_export,
+ * gst_gl_download_perform_with_dmabuf() hands the texture itself to
+ * downstream as dmabuf memory instead of reading it back.
  */
 
+#define N_SLOTS GST_GL_DOWNLOAD_MAX_PENDING
+#define DEFAULT_MAX_PENDING 2
+
 #define USING_OPENGL(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL)
 #define USING_OPENGL3(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL3)
 #define USING_GLES(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES)
@@ -50,6 +97,8 @@ static gboolean _init_download_shader (GstGLContext * context,
 static gboolean _gst_gl_download_perform_with_data_unlocked (GstGLDownload *
     download, GLuint texture_id, gpointer data[GST_VIDEO_MAX_PLANES]);
 
+static void _do_download_draw_packed (GstGLContext * context,
+    GstGLDownload * download);
 #if GST_GL_HAVE_OPENGL
 static void _do_download_draw_rgb_opengl (GstGLContext * context,
     GstGLDownload * download);
@@ -95,28 +144,6 @@ static const gchar *text_shader_YUY2_UYVY_opengl =
     "  gl_FragColor=vec4(%s);\n"
     "}\n";
 
-static const gchar *text_shader_I420_YV12_opengl =
-    "uniform sampler2D tex;\n"
-    "uniform float w, h;\n"
-    RGB_TO_YUV_COEFFICIENTS
-    "void main(void) {\n"
-    "  vec3 rgb1, rgb2;\n"
-    "  float y,u,v;\n"
-    "  vec2 nxy=gl_TexCoord[0].xy;\n"
-    "  vec2 nxy2=nxy*2.0;\n"
-    "  rgb1=texture2D(tex,nxy).rgb;\n"
-    "  rgb2=texture2D(tex,nxy2).rgb;\n"
-    "  y=dot(rgb1, ycoeff);\n"
-    "  u=dot(rgb2, ucoeff);\n"
-    "  v=dot(rgb2, vcoeff);\n"
-    "  y+=offset.x;\n"
-    "  u+=offset.y;\n"
-    "  v+=offset.z;\n"
-    "  gl_FragData[0] = vec4(y, 0.0, 0.0, 1.0);\n"
-    "  gl_FragData[1] = vec4(u, 0.0, 0.0, 1.0);\n"
-    "  gl_FragData[2] = vec4(v, 0.0, 0.0, 1.0);\n"
-    "}\n";
-
 static const gchar *text_shader_AYUV_opengl =
     "uniform sampler2D tex;\n"
     RGB_TO_YUV_COEFFICIENTS
@@ -161,11 +188,6 @@ static const gchar *text_shader_YUY2_UYVY_gles2 =
     "  gl_FragColor=vec4(%s);\n"
     "}\n";
 
-/* no OpenGL ES 2.0 support because for now it's not possible
- * to attach multiple textures to a frame buffer object
- */
-#define text_shader_I420_YV12_gles2 NULL
-
 static const gchar *text_shader_AYUV_gles2 =
     "precision mediump float;\n"
     "varying vec2 v_texCoord;\n"
@@ -217,12 +239,75 @@ static const gchar *text_shader_RGB_gles2 =
     "}                                                   \n";
 #endif /* GST_GL_HAVE_GLES2 */
 
+/* Planar and semi-planar formats are rendered in one pass into an RGBA
+ * texture whose rows are the rows of the whole frame as laid out in system
+ * memory, every texel holding 4 consecutive bytes.  Each byte works out
+ * which component, line and sample it belongs to from the plane layout of
+ * the GstVideoInfo.  The byte offsets are computed in floating point, which
+ * limits the frame size to the integers exactly representable in a float. */
+static const gchar *text_vertex_shader_packed =
+    "attribute vec4 a_position;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = a_position;\n"
+    "}\n";
+
+static const gchar *text_shader_packed =
+    "#ifdef GL_ES\n"
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "#endif\n"
+    "uniform sampler2D tex;\n"
+    "uniform float row_stride;\n"
+    /* the frame is drawn in bands of rows small enough for the byte offsets
+     * to be exact floats, everything is relative to the band's first byte */
+    "uniform float first_row;\n"
+    /* per component: plane start, plane end, line stride, sample stride */
+    "uniform vec4 plane_layout[3];\n"
+    /* per component: byte in the line and line of the band's first byte */
+    "uniform vec2 band_origin[3];\n"
+    /* per component: offset in the sample, samples per line,
+     * texture coordinates per sample */
+    "uniform vec4 sampling[3];\n"
+    RGB_TO_YUV_COEFFICIENTS
+    "float get_byte(float b) {\n"
+    "  for (int c = 0; c < 3; c++) {\n"
+    "    vec4 l = plane_layout[c];\n"
+    "    vec4 s = sampling[c];\n"
+    "    if (b >= l.x && b < l.y) {\n"
+    "      float rel = b + band_origin[c].x;\n"
+    "      float line = floor((rel + 0.5) / l.z);\n"
+    "      float x = rel - line * l.z;\n"
+    "      float i = floor((x + 0.5) / l.w);\n"
+    "      line += band_origin[c].y;\n"
+    "      if (abs(x - i * l.w - s.x) < 0.5 && i < s.y) {\n"
+    "        vec3 rgb = texture2D(tex, (vec2(i, line) + 0.5) * s.zw).rgb;\n"
+    "        if (c == 0)\n"
+    "          return dot(rgb, ycoeff) + offset.x;\n"
+    "        else if (c == 1)\n"
+    "          return dot(rgb, ucoeff) + offset.y;\n"
+    "        else\n"
+    "          return dot(rgb, vcoeff) + offset.z;\n"
+    "      }\n"
+    "    }\n"
+    "  }\n"
+    "  return 0.0;\n"
+    "}\n"
+    "void main(void) {\n"
+    "  vec2 pos = floor(gl_FragCoord.xy);\n"
+    "  float b = (pos.y - first_row) * row_stride + pos.x * 4.0;\n"
+    "  gl_FragColor = vec4(get_byte(b), get_byte(b + 1.0),\n"
+    "      get_byte(b + 2.0), get_byte(b + 3.0));\n"
+    "}\n";
+
 /* *INDENT-ON* */
 
 struct _GstGLDownloadPrivate
 {
   const gchar *YUY2_UYVY;
-  const gchar *I420_YV12;
   const gchar *AYUV;
   const gchar *ARGB;
   const gchar *vert_shader;
@@ -231,6 +316,44 @@ struct _GstGLDownloadPrivate
   void (*do_yuv) (GstGLContext * context, GstGLDownload * download);
 
   gboolean result;
+
+  /* single pass planar download, in texels of the packed frame */
+  guint packed_width;
+  guint packed_height;
+  /* rows of the packed frame drawn at once */
+  guint band_rows;
+  /* used when the planes passed in aren't laid out like the packed frame */
+  guint8 *staging;
+
+  /* pipelined readback, a ring of pixel pack buffers or of system memory
+   * copies when those aren't supported */
+  gboolean slots_initted;
+  gboolean use_pbo;
+  guint max_pending;
+  /* the number of slots of the current ring, max_pending when created */
+  guint n_slots;
+  GLuint pbo[N_SLOTS];
+  GLsync pbo_sync[N_SLOTS];
+  guint8 *slot_data[N_SLOTS];
+  guint64 slot_frame[N_SLOTS];
+  guint slot_index;
+  guint n_pending;
+  guint64 n_submitted;
+  gsize slot_size;
+  gsize slot_offset[GST_VIDEO_MAX_PLANES];
+  gsize slot_plane_size[GST_VIDEO_MAX_PLANES];
+  /* set while _do_download() reads into the next slot */
+  gboolean submitting;
+  gpointer *retrieve_data;
+  guint64 retrieve_frame;
+
+  /* dmabuf export */
+  GstAllocator *dmabuf_allocator;
+  GLuint export_texture;
+  gint export_fd;
+  guint32 export_fourcc;
+  gint export_stride;
+  gint export_offset;
 };
 
 GST_DEBUG_CATEGORY_STATIC (gst_gl_download_debug);
@@ -239,9 +362,21 @@ GST_DEBUG_CATEGORY_STATIC (gst_gl_download_debug);
 #define DEBUG_INIT \
   GST_DEBUG_CATEGORY_INIT (gst_gl_download_debug, "gldownload", 0, "download");
 
+enum
+{
+  PROP_0,
+  PROP_MAX_PENDING
+};
+
 G_DEFINE_TYPE_WITH_CODE (GstGLDownload, gst_gl_download, G_TYPE_OBJECT,
     DEBUG_INIT);
 static void gst_gl_download_finalize (GObject * object);
+static void gst_gl_download_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_gl_download_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static void _cleanup_download_slots (GstGLContext * context,
+    GstGLDownload * download);
 
 #define GST_GL_DOWNLOAD_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
     GST_TYPE_GL_DOWNLOAD, GstGLDownloadPrivate))
@@ -249,9 +384,27 @@ static void gst_gl_download_finalize (GObject * object);
 static void
 gst_gl_download_class_init (GstGLDownloadClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
   g_type_class_add_private (klass, sizeof (GstGLDownloadPrivate));
 
-  G_OBJECT_CLASS (klass)->finalize = gst_gl_download_finalize;
+  gobject_class->finalize = gst_gl_download_finalize;
+  gobject_class->set_property = gst_gl_download_set_property;
+  gobject_class->get_property = gst_gl_download_get_property;
+
+  /**
+   * GstGLDownload:max-pending:
+   *
+   * The number of readbacks queued with gst_gl_download_submit() that can be
+   * pending at a time.  Each one holds a frame sized pixel pack buffer and
+   * delays the result by a frame.  A new value is used once the pending
+   * readbacks have been retrieved.
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING,
+      g_param_spec_uint ("max-pending", "Maximum pending",
+          "Maximum number of readbacks in flight", 1,
+          GST_GL_DOWNLOAD_MAX_PENDING, DEFAULT_MAX_PENDING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -272,9 +425,45 @@ gst_gl_download_init (GstGLDownload * download)
   download->shader_attr_position_loc = 0;
   download->shader_attr_texture_loc = 0;
 
+  download->priv->max_pending = DEFAULT_MAX_PENDING;
+
   gst_video_info_init (&download->info);
 }
 
+static void
+gst_gl_download_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstGLDownload *download = GST_GL_DOWNLOAD (object);
+
+  switch (prop_id) {
+    case PROP_MAX_PENDING:
+      g_mutex_lock (&download->lock);
+      download->priv->max_pending = g_value_get_uint (value);
+      g_mutex_unlock (&download->lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_gl_download_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstGLDownload *download = GST_GL_DOWNLOAD (object);
+
+  switch (prop_id) {
+    case PROP_MAX_PENDING:
+      g_value_set_uint (value, download->priv->max_pending);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 /**
  * gst_gl_download_new:
  * @context: a #GstGLContext
@@ -295,7 +484,6 @@ gst_gl_download_new (GstGLContext * context)
 #if GST_GL_HAVE_OPENGL
   if (USING_OPENGL (context)) {
     priv->YUY2_UYVY = text_shader_YUY2_UYVY_opengl;
-    priv->I420_YV12 = text_shader_I420_YV12_opengl;
     priv->AYUV = text_shader_AYUV_opengl;
     priv->ARGB = NULL;
     priv->vert_shader = text_vertex_shader_opengl;
@@ -306,7 +494,6 @@ gst_gl_download_new (GstGLContext * context)
 #if GST_GL_HAVE_GLES2
   if (USING_GLES2 (context)) {
     priv->YUY2_UYVY = text_shader_YUY2_UYVY_gles2;
-    priv->I420_YV12 = text_shader_I420_YV12_gles2;
     priv->AYUV = text_shader_AYUV_gles2;
     priv->ARGB = text_shader_ARGB_gles2;
     priv->vert_shader = text_vertex_shader_gles2;
@@ -347,6 +534,16 @@ gst_gl_download_finalize (GObject * object)
     gst_object_unref (download->shader);
     download->shader = NULL;
   }
+  if (download->priv->slots_initted) {
+    gst_gl_context_thread_add (download->context,
+        (GstGLContextThreadFunc) _cleanup_download_slots, download);
+  }
+  if (download->priv->dmabuf_allocator) {
+    gst_object_unref (download->priv->dmabuf_allocator);
+    download->priv->dmabuf_allocator = NULL;
+  }
+  g_free (download->priv->staging);
+  download->priv->staging = NULL;
 
   if (download->context) {
     gst_object_unref (download->context);
@@ -474,6 +671,391 @@ gst_gl_download_perform_with_data (GstGLDownload * download, GLuint texture_id,
   return ret;
 }
 
+/**
+ * gst_gl_download_submit:
+ * @download: a #GstGLDownload
+ * @texture_id: the texture id to download
+ * @frame: (out) (allow-none): the number identifying this readback
+ *
+ * Queues the readback of @texture_id without waiting for it to complete.
+ * The result is retrieved with gst_gl_download_retrieve(), in submission
+ * order.  The readbacks are numbered from 0 in the order they are submitted.
+ *
+ * At most #GstGLDownload:max-pending readbacks can be pending at a time.
+ * When pixel pack buffers or sync objects are not supported, the readback is
+ * performed synchronously into an internal copy.
+ *
+ * Returns: whether the readback was queued
+ */
+gboolean
+gst_gl_download_submit (GstGLDownload * download, GLuint texture_id,
+    guint64 * frame)
+{
+  GstGLDownloadPrivate *priv;
+  gboolean ret;
+
+  g_return_val_if_fail (download != NULL, FALSE);
+  g_return_val_if_fail (texture_id > 0, FALSE);
+
+  priv = download->priv;
+
+  g_mutex_lock (&download->lock);
+
+  if (!download->initted || priv->n_pending >= (priv->slots_initted ?
+          priv->n_slots : priv->max_pending)) {
+    g_mutex_unlock (&download->lock);
+    return FALSE;
+  }
+
+  /* max-pending changed, the ring is recreated once it's empty */
+  if (priv->slots_initted && priv->n_pending == 0
+      && priv->n_slots != priv->max_pending)
+    gst_gl_context_thread_add (download->context,
+        (GstGLContextThreadFunc) _cleanup_download_slots, download);
+
+  download->in_texture = texture_id;
+  priv->submitting = TRUE;
+
+  gst_gl_context_thread_add (download->context,
+      (GstGLContextThreadFunc) _do_download, download);
+
+  priv->submitting = FALSE;
+  ret = priv->result;
+
+  if (ret && frame)
+    *frame = priv->n_submitted;
+  if (ret)
+    priv->n_submitted++;
+
+  g_mutex_unlock (&download->lock);
+
+  return ret;
+}
+
+/**
+ * gst_gl_download_retrieve:
+ * @download: a #GstGLDownload
+ * @data: (out): where the downloaded data should go
+ * @frame: (out) (allow-none): the number of the readback that was retrieved
+ *
+ * Waits for the oldest readback queued with gst_gl_download_submit() to
+ * complete and copies it into @data.  @frame is set to the number that
+ * gst_gl_download_submit() returned for it.
+ *
+ * Returns: whether a readback was pending and could be retrieved
+ */
+gboolean
+gst_gl_download_retrieve (GstGLDownload * download,
+    gpointer data[GST_VIDEO_MAX_PLANES], guint64 * frame)
+{
+  GstGLDownloadPrivate *priv;
+  gboolean ret;
+  guint i;
+
+  g_return_val_if_fail (download != NULL, FALSE);
+
+  priv = download->priv;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&download->info); i++) {
+    g_return_val_if_fail (data[i] != NULL, FALSE);
+  }
+
+  g_mutex_lock (&download->lock);
+
+  if (priv->n_pending == 0) {
+    g_mutex_unlock (&download->lock);
+    return FALSE;
+  }
+
+  priv->retrieve_data = data;
+
+  gst_gl_context_thread_add (download->context,
+      (GstGLContextThreadFunc) _do_download_retrieve, download);
+
+  priv->retrieve_data = NULL;
+  ret = priv->result;
+
+  if (frame)
+    *frame = priv->retrieve_frame;
+
+  g_mutex_unlock (&download->lock);
+
+  return ret;
+}
+
+/* Called in the gl thread */
+static void
+_do_download_flush (GstGLContext * context, GstGLDownload * download)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
+  guint i;
+
+  GST_DEBUG ("discarding %u pending downloads", priv->n_pending);
+
+  for (i = 0; i < priv->n_slots; i++) {
+    if (priv->pbo_sync[i]) {
+      gl->DeleteSync (priv->pbo_sync[i]);
+      priv->pbo_sync[i] = NULL;
+    }
+  }
+
+  priv->slot_index = 0;
+  priv->n_pending = 0;
+}
+
+/**
+ * gst_gl_download_flush:
+ * @download: a #GstGLDownload
+ *
+ * Discards the readbacks queued with gst_gl_download_submit() that have not
+ * been retrieved yet.  The numbering of the readbacks is not reset.
+ */
+void
+gst_gl_download_flush (GstGLDownload * download)
+{
+  g_return_if_fail (download != NULL);
+
+  g_mutex_lock (&download->lock);
+
+  if (download->priv->n_pending > 0)
+    gst_gl_context_thread_add (download->context,
+        (GstGLContextThreadFunc) _do_download_flush, download);
+
+  g_mutex_unlock (&download->lock);
+}
+
+/**
+ * gst_gl_download_get_n_pending:
+ * @download: a #GstGLDownload
+ *
+ * Returns: the number of readbacks queued with gst_gl_download_submit() that
+ * have not been retrieved yet
+ */
+guint
+gst_gl_download_get_n_pending (GstGLDownload * download)
+{
+  guint ret;
+
+  g_return_val_if_fail (download != NULL, 0);
+
+  g_mutex_lock (&download->lock);
+  ret = download->priv->n_pending;
+  g_mutex_unlock (&download->lock);
+
+  return ret;
+}
+
+#if GST_GL_HAVE_PLATFORM_EGL
+/* from drm_fourcc.h */
+#define DRM_FORMAT_ABGR8888 GST_MAKE_FOURCC ('A', 'B', '2', '4')
+
+typedef struct
+{
+  GstGLContext *context;
+  GLuint texture;
+} ExportedTexture;
+
+/* called when the dmabuf memory wrapping the texture is freed */
+static void
+_exported_texture_free (ExportedTexture * exported, GstMiniObject * mem)
+{
+  gst_gl_context_del_texture (exported->context, &exported->texture);
+  gst_object_unref (exported->context);
+  g_slice_free (ExportedTexture, exported);
+}
+
+/* Called in the gl thread */
+static void
+_do_export_dmabuf (GstGLContext * context, GstGLDownload * download)
+{
+  GstGLDownloadPrivate *priv = download->priv;
+
+  /* submit the rendering before the buffer leaves GL, the implicit fence on
+   * the dmabuf orders any later access after it */
+  context->gl_vtable->Flush ();
+
+  priv->result =
+      gst_gl_context_egl_export_dmabuf (GST_GL_CONTEXT_EGL (context),
+      priv->export_texture, &priv->export_fd, &priv->export_fourcc,
+      &priv->export_stride, &priv->export_offset);
+}
+
+/* Called in the gl thread */
+static void
+_probe_dmabuf_export (GstGLContext * context, gboolean * result)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLuint texture = 0;
+  guint32 fourcc = 0;
+  gint fd = -1, stride, offset;
+
+  *result = FALSE;
+
+  if (!GST_GL_IS_CONTEXT_EGL (context)
+      || !GST_GL_CONTEXT_EGL (context)->have_dmabuf_export)
+    return;
+
+  /* the extension being there doesn't mean the driver exports the textures
+   * we render into, try one */
+  gl->GenTextures (1, &texture);
+  gl->BindTexture (GL_TEXTURE_2D, texture);
+  gst_gl_context_tex_storage_2d (context, GL_RGBA, GL_UNSIGNED_BYTE, 16, 16);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+
+  if (gst_gl_context_egl_export_dmabuf (GST_GL_CONTEXT_EGL (context), texture,
+          &fd, &fourcc, &stride, &offset)) {
+    *result = fourcc == DRM_FORMAT_ABGR8888;
+    close (fd);
+  }
+
+  gl->DeleteTextures (1, &texture);
+}
+#endif
+
+/**
+ * gst_gl_download_check_dmabuf_export:
+ * @context: a #GstGLContext
+ *
+ * Checks whether gst_gl_download_perform_with_dmabuf() can export the
+ * #GST_VIDEO_FORMAT_RGBA textures of @context.  The first call exports a
+ * texture in the OpenGL thread of @context, the result is cached.
+ *
+ * Elements should only offer #GST_CAPS_FEATURE_MEMORY_DMABUF caps when this
+ * returns %TRUE.
+ *
+ * Returns: whether textures of @context can be exported as dmabuf
+ */
+gboolean
+gst_gl_download_check_dmabuf_export (GstGLContext * context)
+{
+#if GST_GL_HAVE_PLATFORM_EGL
+  static GQuark quark = 0;
+  gpointer probed;
+  gboolean result;
+
+  g_return_val_if_fail (GST_GL_IS_CONTEXT (context), FALSE);
+
+  if (!quark)
+    quark = g_quark_from_static_string ("GstGLDownloadDMABufExport");
+
+  probed = g_object_get_qdata (G_OBJECT (context), quark);
+  if (probed)
+    return GPOINTER_TO_INT (probed) == 2;
+
+  gst_gl_context_thread_add (context,
+      (GstGLContextThreadFunc) _probe_dmabuf_export, &result);
+
+  g_object_set_qdata (G_OBJECT (context), quark, GINT_TO_POINTER (result + 1));
+
+  return result;
+#else
+  return FALSE;
+#endif
+}
+
+/**
+ * gst_gl_download_perform_with_dmabuf:
+ * @download: a #GstGLDownload
+ * @texture_id: the texture id to export
+ * @buffer: the #GstBuffer to add the exported memory to
+ *
+ * Exports @texture_id as dmabuf memory and appends it to @buffer together
+ * with a #GstVideoMeta describing its stride and offset, instead of reading
+ * the pixels back into system memory.
+ *
+ * @texture_id is consumed by this call.  On success, it is released with
+ * gst_gl_context_del_texture() once the appended memory is freed, so
+ * a new texture must be rendered into for every frame.
+ *
+ * Only #GST_VIDEO_FORMAT_RGBA is supported and the context must be an EGL
+ * context that supports EGL_MESA_image_dma_buf_export.
+ *
+ * Returns: whether the export was successful
+ */
+gboolean
+gst_gl_download_perform_with_dmabuf (GstGLDownload * download,
+    GLuint texture_id, GstBuffer * buffer)
+{
+#if GST_GL_HAVE_PLATFORM_EGL
+  GstGLDownloadPrivate *priv;
+  ExportedTexture *exported;
+  GstMemory *mem;
+  gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+  gint stride[GST_VIDEO_MAX_PLANES] = { 0, };
+  guint width, height;
+  guint32 fourcc;
+  gint fd;
+#endif
+
+  g_return_val_if_fail (download != NULL, FALSE);
+  g_return_val_if_fail (texture_id > 0, FALSE);
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), FALSE);
+
+#if GST_GL_HAVE_PLATFORM_EGL
+  priv = download->priv;
+
+  if (!GST_GL_IS_CONTEXT_EGL (download->context)
+      || GST_VIDEO_INFO_FORMAT (&download->info) != GST_VIDEO_FORMAT_RGBA)
+    goto error;
+
+  width = GST_VIDEO_INFO_WIDTH (&download->info);
+  height = GST_VIDEO_INFO_HEIGHT (&download->info);
+
+  g_mutex_lock (&download->lock);
+
+  priv->export_texture = texture_id;
+  gst_gl_context_thread_add (download->context,
+      (GstGLContextThreadFunc) _do_export_dmabuf, download);
+
+  if (!priv->result) {
+    g_mutex_unlock (&download->lock);
+    goto error;
+  }
+
+  fd = priv->export_fd;
+  fourcc = priv->export_fourcc;
+  offset[0] = priv->export_offset;
+  stride[0] = priv->export_stride;
+
+  if (!priv->dmabuf_allocator)
+    priv->dmabuf_allocator = gst_dmabuf_allocator_new ();
+
+  g_mutex_unlock (&download->lock);
+
+  if (fourcc != DRM_FORMAT_ABGR8888) {
+    GST_WARNING_OBJECT (download, "texture %u exported with unexpected "
+        "format %" GST_FOURCC_FORMAT, texture_id, GST_FOURCC_ARGS (fourcc));
+    close (fd);
+    goto error;
+  }
+
+  GST_LOG_OBJECT (download, "exported texture %u as dmabuf fd:%i "
+      "offset:%" G_GSIZE_FORMAT " stride:%i", texture_id, fd, offset[0],
+      stride[0]);
+
+  mem = gst_dmabuf_allocator_alloc (priv->dmabuf_allocator, fd,
+      offset[0] + stride[0] * height);
+
+  exported = g_slice_new (ExportedTexture);
+  exported->context = gst_object_ref (download->context);
+  exported->texture = texture_id;
+  gst_mini_object_weak_ref (GST_MINI_OBJECT_CAST (mem),
+      (GstMiniObjectNotify) _exported_texture_free, exported);
+
+  gst_buffer_append_memory (buffer, mem);
+  gst_buffer_add_video_meta_full (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_FORMAT_RGBA, width, height, 1, offset, stride);
+
+  return TRUE;
+
+error:
+#endif
+  gst_gl_context_del_texture (download->context, &texture_id);
+
+  return FALSE;
+}
+
 static gboolean
 _gst_gl_download_perform_with_data_unlocked (GstGLDownload * download,
     GLuint texture_id, gpointer data[GST_VIDEO_MAX_PLANES])
@@ -502,6 +1084,116 @@ _gst_gl_download_perform_with_data_unlocked (GstGLDownload * download,
   return download->priv->result;
 }
 
+/* Called in the gl thread
+ *
+ * The largest byte offset the packed shader can compute exactly.  Desktop GL
+ * floats are IEEE singles, GLES2 only guarantees 16 bits of mantissa for
+ * highp and 10 bits for mediump, which is all there is when the fragment
+ * shader lacks highp. */
+static guint
+_get_packed_offset_limit (GstGLContext * context)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLint range[2] = { 0, 0 };
+  GLint precision = 23;
+
+  if (USING_GLES2 (context)) {
+    precision = 0;
+    if (gl->GetShaderPrecisionFormat) {
+      gl->GetShaderPrecisionFormat (GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range,
+          &precision);
+      if (precision <= 0)
+        gl->GetShaderPrecisionFormat (GL_FRAGMENT_SHADER, GL_MEDIUM_FLOAT,
+            range, &precision);
+    }
+    if (precision <= 0)
+      precision = 10;
+  }
+
+  /* keep half a unit of margin for the divisions in the shader */
+  return 1 << CLAMP (precision - 1, 1, 22);
+}
+
+/* Called in the gl thread */
+static gboolean
+_init_download_packed (GstGLContext * context, GstGLDownload * download)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
+  gsize row_stride = GST_VIDEO_INFO_PLANE_STRIDE (&download->info, 0);
+  gsize size = GST_VIDEO_INFO_SIZE (&download->info);
+  guint limit = _get_packed_offset_limit (context);
+  GLint max_size = 0;
+
+  if (!gl->GenFramebuffers) {
+    gst_gl_context_set_error (context,
+        "Context, EXT_framebuffer_object supported: no");
+    return FALSE;
+  }
+
+  /* every texel of the target holds 4 bytes of the frame */
+  if (row_stride % 4 != 0 || size % 4 != 0) {
+    gst_gl_context_set_error (context, "Cannot download %s frames with a "
+        "stride of %" G_GSIZE_FORMAT, gst_video_format_to_string
+        (GST_VIDEO_INFO_FORMAT (&download->info)), row_stride);
+    return FALSE;
+  }
+
+  priv->packed_width = row_stride / 4;
+  priv->packed_height = (size + row_stride - 1) / row_stride;
+
+  /* a band must hold at least one row plus the offset of its first byte in
+   * the line of a plane, the rows themselves are addressed through
+   * gl_FragCoord and the texture coordinates */
+  if (row_stride > limit / 2 || priv->packed_height > limit) {
+    gst_gl_context_set_error (context, "Frames with a stride of %"
+        G_GSIZE_FORMAT " and %u rows exceed the shader precision (%u)",
+        row_stride, priv->packed_height, limit);
+    return FALSE;
+  }
+  priv->band_rows = limit / row_stride - 1;
+
+  gl->GetIntegerv (GL_MAX_TEXTURE_SIZE, &max_size);
+  if ((GLint) priv->packed_width > max_size
+      || (GLint) priv->packed_height > max_size) {
+    gst_gl_context_set_error (context, "Packed frame of %ux%u exceeds the "
+        "maximum texture size %i", priv->packed_width, priv->packed_height,
+        max_size);
+    return FALSE;
+  }
+
+  GST_INFO ("downloading %s in a single pass through a %ux%u target, "
+      "%u rows per draw",
+      gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (&download->info)),
+      priv->packed_width, priv->packed_height, priv->band_rows);
+
+  gl->GenTextures (1, &download->out_texture[0]);
+  gl->BindTexture (GL_TEXTURE_2D, download->out_texture[0]);
+  gst_gl_context_tex_storage_2d (context, GL_RGBA, GL_UNSIGNED_BYTE,
+      priv->packed_width, priv->packed_height);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+
+  /* no depth testing is done, so no depth buffer */
+  gl->GenFramebuffers (1, &download->fbo);
+  gl->BindFramebuffer (GL_FRAMEBUFFER, download->fbo);
+  gl->FramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+      GL_TEXTURE_2D, download->out_texture[0], 0);
+
+  if (!gst_gl_context_check_framebuffer_status (context)) {
+    gst_gl_context_set_error (context, "GL framebuffer status incomplete");
+    gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
+    return FALSE;
+  }
+
+  gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
+
+  return TRUE;
+}
+
 static void
 _init_download (GstGLContext * context, GstGLDownload * download)
 {
@@ -549,8 +1241,6 @@ _init_download (GstGLContext * context, GstGLDownload * download)
     case GST_VIDEO_FORMAT_BGR:
     case GST_VIDEO_FORMAT_YUY2:
     case GST_VIDEO_FORMAT_UYVY:
-    case GST_VIDEO_FORMAT_I420:
-    case GST_VIDEO_FORMAT_YV12:
     case GST_VIDEO_FORMAT_AYUV:
       /* color space conversion is needed */
     {
@@ -590,8 +1280,8 @@ _init_download (GstGLContext * context, GstGLDownload * download)
       /* setup a first texture to render to */
       gl->GenTextures (1, &download->out_texture[0]);
       gl->BindTexture (GL_TEXTURE_2D, download->out_texture[0]);
-      gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
-          out_width, out_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+      gst_gl_context_tex_storage_2d (context, GL_RGBA, GL_UNSIGNED_BYTE,
+          out_width, out_height);
       gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
       gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
       gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -601,37 +1291,6 @@ _init_download (GstGLContext * context, GstGLDownload * download)
       gl->FramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
           GL_TEXTURE_2D, download->out_texture[0], 0);
 
-      if (v_format == GST_VIDEO_FORMAT_I420 ||
-          v_format == GST_VIDEO_FORMAT_YV12) {
-        /* setup a second texture to render to */
-        gl->GenTextures (1, &download->out_texture[1]);
-        gl->BindTexture (GL_TEXTURE_2D, download->out_texture[1]);
-        gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
-            out_width, out_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        /* attach the second texture to the FBO to renderer to */
-        gl->FramebufferTexture2D (GL_FRAMEBUFFER,
-            GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, download->out_texture[1], 0);
-
-        /* setup a third texture to render to */
-        gl->GenTextures (1, &download->out_texture[2]);
-        gl->BindTexture (GL_TEXTURE_2D, download->out_texture[2]);
-        gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
-            out_width, out_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        /* attach the third texture to the FBO to renderer to */
-        gl->FramebufferTexture2D (GL_FRAMEBUFFER,
-            GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, download->out_texture[2], 0);
-      }
-
       /* attach the depth render buffer to the FBO */
       gl->FramebufferRenderbuffer (GL_FRAMEBUFFER,
           GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, download->depth_buffer);
@@ -647,6 +1306,17 @@ _init_download (GstGLContext * context, GstGLDownload * download)
       gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
     }
       break;
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y444:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y41B:
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+    case GST_VIDEO_FORMAT_GRAY8:
+      if (!_init_download_packed (context, download))
+        goto error;
+      break;
     default:
       break;
       gst_gl_context_set_error (context, "Unsupported download video format %d",
@@ -674,18 +1344,12 @@ _create_shader (GstGLContext * context, const gchar * vertex_src,
 
   g_return_val_if_fail (vertex_src != NULL || fragment_src != NULL, FALSE);
 
-  shader = gst_gl_shader_new (context);
-
-  if (vertex_src)
-    gst_gl_shader_set_vertex_source (shader, vertex_src);
-  if (fragment_src)
-    gst_gl_shader_set_fragment_source (shader, fragment_src);
-
-  if (!gst_gl_shader_compile (shader, &error)) {
+  shader = gst_gl_shader_new_cached (context, vertex_src, fragment_src,
+      &error);
+  if (!shader) {
     gst_gl_context_set_error (context, "%s", error->message);
     g_error_free (error);
     gst_gl_context_clear_shader (context);
-    gst_object_unref (shader);
     return FALSE;
   }
 
@@ -777,9 +1441,21 @@ _init_download_shader (GstGLContext * context, GstGLDownload * download)
       break;
     case GST_VIDEO_FORMAT_I420:
     case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y444:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y41B:
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+    case GST_VIDEO_FORMAT_GRAY8:
     {
-      _create_shader (context, download->priv->vert_shader,
-          download->priv->I420_YV12, &download->shader);
+      if (!_create_shader (context, text_vertex_shader_packed,
+              text_shader_packed, &download->shader))
+        return FALSE;
+
+      download->shader_attr_position_loc =
+          gst_gl_shader_get_attribute_location (download->shader,
+          "a_position");
+      download->shader_attr_texture_loc = -1;
       break;
     }
     case GST_VIDEO_FORMAT_AYUV:
@@ -858,12 +1534,145 @@ _init_download_shader (GstGLContext * context, GstGLDownload * download)
   return TRUE;
 }
 
+/* Called in the gl thread */
+static void
+_init_download_slots (GstGLContext * context, GstGLDownload * download)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
+  guint i;
+
+  /* the planes are laid out like in system memory, which lets the single
+   * pass planar download read the whole frame at once */
+  priv->slot_size = GST_VIDEO_INFO_SIZE (&download->info);
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&download->info); i++) {
+    priv->slot_offset[i] = GST_VIDEO_INFO_PLANE_OFFSET (&download->info, i);
+    priv->slot_plane_size[i] =
+        GST_VIDEO_INFO_PLANE_STRIDE (&download->info, i) *
+        GST_VIDEO_INFO_COMP_HEIGHT (&download->info, i);
+  }
+
+  priv->use_pbo = (USING_OPENGL (context) || USING_GLES3 (context))
+      && gl->GenBuffers && gl->MapBufferRange && gl->UnmapBuffer
+      && gl->FenceSync;
+  priv->n_slots = priv->max_pending;
+
+  if (priv->use_pbo) {
+    GST_INFO ("Creating %u pixel pack buffers of size %" G_GSIZE_FORMAT,
+        priv->n_slots, priv->slot_size);
+
+    gl->GenBuffers (priv->n_slots, priv->pbo);
+    for (i = 0; i < priv->n_slots; i++) {
+      gl->BindBuffer (GL_PIXEL_PACK_BUFFER, priv->pbo[i]);
+      gl->BufferData (GL_PIXEL_PACK_BUFFER, priv->slot_size, NULL,
+          GL_STREAM_READ);
+    }
+    gl->BindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+  } else {
+    GST_WARNING ("Pixel pack buffers or sync objects are not supported by "
+        "this context, submitted downloads are read back synchronously");
+
+    for (i = 0; i < priv->n_slots; i++)
+      priv->slot_data[i] = g_malloc (priv->slot_size);
+  }
+
+  priv->slot_index = 0;
+  priv->n_pending = 0;
+  priv->slots_initted = TRUE;
+}
+
+/* Called in the gl thread */
+static void
+_cleanup_download_slots (GstGLContext * context, GstGLDownload * download)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
+  guint i;
+
+  for (i = 0; i < N_SLOTS; i++) {
+    if (priv->pbo_sync[i]) {
+      gl->DeleteSync (priv->pbo_sync[i]);
+      priv->pbo_sync[i] = NULL;
+    }
+    g_free (priv->slot_data[i]);
+    priv->slot_data[i] = NULL;
+  }
+
+  if (priv->use_pbo) {
+    gl->DeleteBuffers (priv->n_slots, priv->pbo);
+    memset (priv->pbo, 0, sizeof (priv->pbo));
+  }
+
+  priv->n_pending = 0;
+  priv->slots_initted = FALSE;
+}
+
+/* Copies the oldest pending readback into retrieve_data.  Called in the gl
+ * thread */
+static void
+_do_download_retrieve (GstGLContext * context, GstGLDownload * download)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
+  guint oldest, i;
+  guint8 *ptr;
+
+  oldest = (priv->slot_index + priv->n_slots - priv->n_pending) %
+      priv->n_slots;
+
+  GST_LOG ("retrieving download of frame %" G_GUINT64_FORMAT " from slot %u, "
+      "%u pending", priv->slot_frame[oldest], oldest, priv->n_pending);
+
+  priv->retrieve_frame = priv->slot_frame[oldest];
+  priv->n_pending--;
+
+  if (!priv->use_pbo) {
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&download->info); i++)
+      memcpy (priv->retrieve_data[i],
+          priv->slot_data[oldest] + priv->slot_offset[i],
+          priv->slot_plane_size[i]);
+
+    priv->result = TRUE;
+    return;
+  }
+
+  if (gl->ClientWaitSync (priv->pbo_sync[oldest], GL_SYNC_FLUSH_COMMANDS_BIT,
+          GST_SECOND) == GL_WAIT_FAILED)
+    GST_WARNING ("Failed to wait for pixel pack buffer %u", oldest);
+  gl->DeleteSync (priv->pbo_sync[oldest]);
+  priv->pbo_sync[oldest] = NULL;
+
+  gl->BindBuffer (GL_PIXEL_PACK_BUFFER, priv->pbo[oldest]);
+  ptr = gl->MapBufferRange (GL_PIXEL_PACK_BUFFER, 0, priv->slot_size,
+      GL_MAP_READ_BIT);
+  if (!ptr) {
+    gst_gl_context_set_error (context, "Failed to map pixel pack buffer %u",
+        oldest);
+    gl->BindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+    priv->result = FALSE;
+    return;
+  }
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&download->info); i++)
+    memcpy (priv->retrieve_data[i], ptr + priv->slot_offset[i],
+        priv->slot_plane_size[i]);
+
+  gl->UnmapBuffer (GL_PIXEL_PACK_BUFFER);
+  gl->BindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+  priv->result = TRUE;
+}
+
 /* Called in the gl thread */
 static void
 _do_download (GstGLContext * context, GstGLDownload * download)
 {
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
   GstVideoFormat v_format;
   guint out_width, out_height;
+  GstGLProfileSection *section;
+  guint slot = 0, i;
 
   v_format = GST_VIDEO_INFO_FORMAT (&download->info);
   out_width = GST_VIDEO_INFO_WIDTH (&download->info);
@@ -872,6 +1681,27 @@ _do_download (GstGLContext * context, GstGLDownload * download)
   GST_TRACE ("downloading texture:%u format:%d, dimensions:%ux%u",
       download->in_texture, v_format, out_width, out_height);
 
+  section = gst_gl_profile_begin (context, "download %s %ux%u",
+      gst_video_format_to_string (v_format), out_width, out_height);
+
+  if (priv->submitting) {
+    if (!priv->slots_initted)
+      _init_download_slots (context, download);
+
+    /* read into the next slot of the ring, with pack buffers the pointers
+     * passed to glReadPixels/glGetTexImage become offsets into it */
+    slot = priv->slot_index;
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&download->info); i++) {
+      if (priv->use_pbo)
+        download->data[i] = (gpointer) priv->slot_offset[i];
+      else
+        download->data[i] = priv->slot_data[slot] + priv->slot_offset[i];
+    }
+
+    if (priv->use_pbo)
+      gl->BindBuffer (GL_PIXEL_PACK_BUFFER, priv->pbo[slot]);
+  }
+
   switch (v_format) {
     case GST_VIDEO_FORMAT_RGBx:
     case GST_VIDEO_FORMAT_BGRx:
@@ -888,12 +1718,20 @@ _do_download (GstGLContext * context, GstGLDownload * download)
       break;
     case GST_VIDEO_FORMAT_YUY2:
     case GST_VIDEO_FORMAT_UYVY:
-    case GST_VIDEO_FORMAT_I420:
-    case GST_VIDEO_FORMAT_YV12:
     case GST_VIDEO_FORMAT_AYUV:
       /* color space conversion is needed */
       download->priv->do_yuv (context, download);
       break;
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y444:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y41B:
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+    case GST_VIDEO_FORMAT_GRAY8:
+      _do_download_draw_packed (context, download);
+      break;
     default:
       gst_gl_context_set_error (context, "Unsupported download video format %d",
           v_format);
@@ -901,9 +1739,169 @@ _do_download (GstGLContext * context, GstGLDownload * download)
       break;
   }
 
+  if (priv->submitting) {
+    if (priv->use_pbo) {
+      gl->BindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+      priv->pbo_sync[slot] = gl->FenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      /* start the transfer now rather than when the result is waited on */
+      gl->Flush ();
+    }
+
+    priv->slot_frame[slot] = priv->n_submitted;
+    priv->slot_index = (slot + 1) % priv->n_slots;
+    priv->n_pending++;
+  }
+
+  gst_gl_profile_end (context, section);
+
   download->priv->result = TRUE;
 }
 
+/* Called in the gl thread */
+static void
+_do_download_draw_packed (GstGLContext * context, GstGLDownload * download)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLDownloadPrivate *priv = download->priv;
+  GstVideoInfo *info = &download->info;
+  const GstVideoFormatInfo *finfo = info->finfo;
+  gsize row_stride = GST_VIDEO_INFO_PLANE_STRIDE (info, 0);
+  gsize size = GST_VIDEO_INFO_SIZE (info);
+  guint full_rows = size / row_stride;
+  gsize plane_start[3], plane_end[3];
+  GLfloat plane_layout[3 * 4];
+  GLfloat band_origin[3 * 2];
+  GLfloat sampling[3 * 4] = { 0, };
+  GLint viewport_dim[4];
+  gboolean contiguous = TRUE;
+  guint first_row;
+  guint8 *dest;
+  guint c, i;
+
+  GST_TRACE ("doing single pass download of texture:%u (%ux%u) using fbo:%u",
+      download->in_texture, GST_VIDEO_INFO_WIDTH (info),
+      GST_VIDEO_INFO_HEIGHT (info), download->fbo);
+
+  for (c = 0; c < 3; c++) {
+    GLfloat *l = &plane_layout[4 * c];
+    GLfloat *s = &sampling[4 * c];
+    guint plane;
+    gsize start;
+    gint stride;
+
+    if (c >= GST_VIDEO_INFO_N_COMPONENTS (info)) {
+      /* an empty range, never matched */
+      plane_start[c] = plane_end[c] = 0;
+      l[2] = l[3] = 1.0;
+      continue;
+    }
+
+    plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, c);
+    start = GST_VIDEO_INFO_PLANE_OFFSET (info, plane);
+    stride = GST_VIDEO_INFO_PLANE_STRIDE (info, plane);
+
+    plane_start[c] = start;
+    plane_end[c] = start + stride * GST_VIDEO_INFO_COMP_HEIGHT (info, c);
+    l[2] = stride;
+    l[3] = GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, c);
+
+    s[0] = GST_VIDEO_FORMAT_INFO_POFFSET (finfo, c);
+    s[1] = GST_VIDEO_INFO_COMP_WIDTH (info, c);
+    s[2] = (gfloat) (1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, c)) /
+        GST_VIDEO_INFO_WIDTH (info);
+    s[3] = (gfloat) (1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, c)) /
+        GST_VIDEO_INFO_HEIGHT (info);
+  }
+
+  gl->BindFramebuffer (GL_FRAMEBUFFER, download->fbo);
+
+  gl->GetIntegerv (GL_VIEWPORT, viewport_dim);
+
+  gst_gl_shader_use (download->shader);
+
+  gl->ActiveTexture (GL_TEXTURE0);
+  gst_gl_shader_set_uniform_1i (download->shader, "tex", 0);
+  gst_gl_shader_set_uniform_1f (download->shader, "row_stride", row_stride);
+  gst_gl_shader_set_uniform_4fv (download->shader, "sampling", 3, sampling);
+  gl->BindTexture (GL_TEXTURE_2D, download->in_texture);
+
+  for (first_row = 0; first_row < priv->packed_height;
+      first_row += priv->band_rows) {
+    guint n_rows = MIN (priv->band_rows, priv->packed_height - first_row);
+    gsize base = (gsize) first_row * row_stride;
+    gsize band_end = base + (gsize) n_rows * row_stride;
+
+    for (c = 0; c < 3; c++) {
+      GLfloat *l = &plane_layout[4 * c];
+      GLfloat *o = &band_origin[2 * c];
+      gsize stride = (gsize) l[2];
+
+      /* clamp the plane to the band, so that only small values reach the
+       * shader */
+      l[0] = plane_start[c] > base ? MIN (plane_start[c], band_end) - base : 0;
+      l[1] = plane_end[c] > base ? MIN (plane_end[c], band_end) - base : 0;
+
+      if (base >= plane_start[c]) {
+        o[0] = (base - plane_start[c]) % stride;
+        o[1] = (base - plane_start[c]) / stride;
+      } else {
+        o[0] = -l[0];
+        o[1] = 0.0;
+      }
+    }
+
+    gst_gl_shader_set_uniform_1f (download->shader, "first_row", first_row);
+    gst_gl_shader_set_uniform_4fv (download->shader, "plane_layout", 3,
+        plane_layout);
+    gst_gl_shader_set_uniform_2fv (download->shader, "band_origin", 3,
+        band_origin);
+
+    /* every texel of the target is written, no need to clear it */
+    gl->Viewport (0, first_row, priv->packed_width, n_rows);
+    gst_gl_context_draw_fullscreen_quad (context,
+        download->shader_attr_position_loc, -1, FALSE);
+  }
+
+  gst_gl_context_clear_shader (context);
+
+  gl->Viewport (viewport_dim[0], viewport_dim[1], viewport_dim[2],
+      viewport_dim[3]);
+
+  /* the target has the layout of the frame in memory, read it at once when
+   * the planes passed in follow that layout too */
+  for (i = 1; i < GST_VIDEO_INFO_N_PLANES (info); i++) {
+    if ((guint8 *) download->data[i] != (guint8 *) download->data[0] +
+        GST_VIDEO_INFO_PLANE_OFFSET (info, i))
+      contiguous = FALSE;
+  }
+
+  if (contiguous) {
+    dest = download->data[0];
+  } else {
+    if (!priv->staging)
+      priv->staging = g_malloc (size);
+    dest = priv->staging;
+  }
+
+  gl->ReadPixels (0, 0, priv->packed_width, full_rows, GL_RGBA,
+      GL_UNSIGNED_BYTE, dest);
+  if (full_rows < priv->packed_height)
+    gl->ReadPixels (0, full_rows, (size - full_rows * row_stride) / 4, 1,
+        GL_RGBA, GL_UNSIGNED_BYTE, dest + full_rows * row_stride);
+
+  gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
+
+  if (!contiguous) {
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (info); i++) {
+      gsize start = GST_VIDEO_INFO_PLANE_OFFSET (info, i);
+      gsize end = i + 1 < GST_VIDEO_INFO_N_PLANES (info) ?
+          GST_VIDEO_INFO_PLANE_OFFSET (info, i + 1) : size;
+
+      memcpy (download->data[i], priv->staging + start, end - start);
+    }
+  }
+}
+
 #if GST_GL_HAVE_OPENGL
 static void
 _do_download_draw_rgb_opengl (GstGLContext * context, GstGLDownload * download)
@@ -981,18 +1979,6 @@ _do_download_draw_rgb_gles2 (GstGLContext * context, GstGLDownload * download)
 
   GLint viewport_dim[4];
 
-  const GLfloat vVertices[] = { 1.0f, -1.0f, 0.0f,
-    1.0f, 0.0f,
-    -1.0f, -1.0f, 0.0f,
-    0.0f, 0.0f,
-    -1.0f, 1.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, 1.0f
-  };
-
-  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
   gl = download->context->gl_vtable;
 
   out_width = GST_VIDEO_INFO_WIDTH (&download->info);
@@ -1010,19 +1996,13 @@ _do_download_draw_rgb_gles2 (GstGLContext * context, GstGLDownload * download)
 
   gst_gl_shader_use (download->shader);
 
-  gl->VertexAttribPointer (download->shader_attr_position_loc, 3,
-      GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), vVertices);
-  gl->VertexAttribPointer (download->shader_attr_texture_loc, 2,
-      GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), &vVertices[3]);
-
-  gl->EnableVertexAttribArray (download->shader_attr_position_loc);
-  gl->EnableVertexAttribArray (download->shader_attr_texture_loc);
-
   gl->ActiveTexture (GL_TEXTURE0);
   gst_gl_shader_set_uniform_1i (download->shader, "tex", 0);
   gl->BindTexture (GL_TEXTURE_2D, download->in_texture);
 
-  gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+  gst_gl_context_draw_fullscreen_quad (context,
+      download->shader_attr_position_loc, download->shader_attr_texture_loc,
+      FALSE);
 
   gst_gl_context_clear_shader (context);
 
@@ -1069,23 +2049,6 @@ _do_download_draw_yuv_opengl (GstGLContext * context, GstGLDownload * download)
   guint out_width = GST_VIDEO_INFO_WIDTH (&download->info);
   guint out_height = GST_VIDEO_INFO_HEIGHT (&download->info);
 
-  GLenum multipleRT[] = {
-    GL_COLOR_ATTACHMENT0,
-    GL_COLOR_ATTACHMENT1,
-    GL_COLOR_ATTACHMENT2
-  };
-
-  gfloat verts[8] = { 1.0f, -1.0f,
-    -1.0f, -1.0f,
-    -1.0f, 1.0f,
-    1.0f, 1.0f
-  };
-  gfloat texcoords[8] = { 1.0, 0.0,
-    0.0, 0.0,
-    0.0, 1.0,
-    1.0, 1.0
-  };
-
   gl = context->gl_vtable;
 
   v_format = GST_VIDEO_INFO_FORMAT (&download->info);
@@ -1130,45 +2093,13 @@ _do_download_draw_yuv_opengl (GstGLContext * context, GstGLDownload * download)
     }
       break;
 
-    case GST_VIDEO_FORMAT_I420:
-    case GST_VIDEO_FORMAT_YV12:
-    {
-      gl->DrawBuffers (3, multipleRT);
-
-      gl->ClearColor (0.0, 0.0, 0.0, 0.0);
-      gl->Clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-      gst_gl_shader_use (download->shader);
-
-      gl->MatrixMode (GL_PROJECTION);
-      gl->LoadIdentity ();
-
-      gl->ActiveTexture (GL_TEXTURE0);
-      gst_gl_shader_set_uniform_1i (download->shader, "tex", 0);
-      gst_gl_shader_set_uniform_1f (download->shader, "w", (gfloat) out_width);
-      gst_gl_shader_set_uniform_1f (download->shader, "h", (gfloat) out_height);
-      gl->BindTexture (GL_TEXTURE_2D, download->in_texture);
-    }
-      break;
-
     default:
       break;
       gst_gl_context_set_error (context,
           "Download video format inconsistensy %d", v_format);
   }
 
-  gl->ClientActiveTexture (GL_TEXTURE0);
-
-  gl->EnableClientState (GL_VERTEX_ARRAY);
-  gl->EnableClientState (GL_TEXTURE_COORD_ARRAY);
-
-  gl->VertexPointer (2, GL_FLOAT, 0, &verts);
-  gl->TexCoordPointer (2, GL_FLOAT, 0, &texcoords);
-
-  gl->DrawArrays (GL_QUADS, 0, 4);
-
-  gl->DisableClientState (GL_VERTEX_ARRAY);
-  gl->DisableClientState (GL_TEXTURE_COORD_ARRAY);
+  gst_gl_context_draw_fullscreen_quad (context, -1, -1, FALSE);
 
   gl->DrawBuffer (GL_NONE);
 
@@ -1210,42 +2141,6 @@ _do_download_draw_yuv_opengl (GstGLContext * context, GstGLDownload * download)
           GL_UNSIGNED_INT_8_8_8_8, download->data[0]);
 #endif
       break;
-    case GST_VIDEO_FORMAT_I420:
-    {
-      gl->ReadPixels (0, 0, out_width, out_height, GL_LUMINANCE,
-          GL_UNSIGNED_BYTE, download->data[0]);
-
-      gl->ReadBuffer (GL_COLOR_ATTACHMENT1);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[1]);
-
-      gl->ReadBuffer (GL_COLOR_ATTACHMENT2);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[2]);
-    }
-      break;
-    case GST_VIDEO_FORMAT_YV12:
-    {
-      gl->ReadPixels (0, 0, out_width, out_height, GL_LUMINANCE,
-          GL_UNSIGNED_BYTE, download->data[0]);
-
-      gl->ReadBuffer (GL_COLOR_ATTACHMENT1);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[2]);
-
-      gl->ReadBuffer (GL_COLOR_ATTACHMENT2);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[1]);
-    }
-      break;
     default:
       break;
       gst_gl_context_set_error (context,
@@ -1270,18 +2165,6 @@ _do_download_draw_yuv_gles2 (GstGLContext * context, GstGLDownload * download)
 
   GLint viewport_dim[4];
 
-  const GLfloat vVertices[] = { 1.0f, -1.0f, 0.0f,
-    1.0f, 0.0f,
-    -1.0f, -1.0f, 0.0f,
-    0.0f, .0f,
-    -1.0f, 1.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, 1.0f
-  };
-
-  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
   gl = context->gl_vtable;
 
   out_width = GST_VIDEO_INFO_WIDTH (&download->info);
@@ -1308,32 +2191,8 @@ _do_download_draw_yuv_gles2 (GstGLContext * context, GstGLDownload * download)
 
       gst_gl_shader_use (download->shader);
 
-      gl->VertexAttribPointer (download->shader_attr_position_loc, 3,
-          GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), vVertices);
-      gl->VertexAttribPointer (download->shader_attr_texture_loc, 2,
-          GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), &vVertices[3]);
-
-      gl->EnableVertexAttribArray (download->shader_attr_position_loc);
-      gl->EnableVertexAttribArray (download->shader_attr_texture_loc);
-
-      gl->ActiveTexture (GL_TEXTURE0);
-      gst_gl_shader_set_uniform_1i (download->shader, "tex", 0);
-      gl->BindTexture (GL_TEXTURE_2D, download->in_texture);
-    }
-      break;
-
-    case GST_VIDEO_FORMAT_I420:
-    case GST_VIDEO_FORMAT_YV12:
-    {
-      gl->ClearColor (0.0, 0.0, 0.0, 0.0);
-      gl->Clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-      gst_gl_shader_use (download->shader);
-
       gl->ActiveTexture (GL_TEXTURE0);
       gst_gl_shader_set_uniform_1i (download->shader, "tex", 0);
-      gst_gl_shader_set_uniform_1f (download->shader, "w", (gfloat) out_width);
-      gst_gl_shader_set_uniform_1f (download->shader, "h", (gfloat) out_height);
       gl->BindTexture (GL_TEXTURE_2D, download->in_texture);
     }
       break;
@@ -1345,7 +2204,9 @@ _do_download_draw_yuv_gles2 (GstGLContext * context, GstGLDownload * download)
 
   }
 
-  gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+  gst_gl_context_draw_fullscreen_quad (context,
+      download->shader_attr_position_loc, download->shader_attr_texture_loc,
+      FALSE);
 
   /* don't check if GLSL is available
    * because download yuv is not available
@@ -1376,34 +2237,6 @@ _do_download_draw_yuv_gles2 (GstGLContext * context, GstGLDownload * download)
           GL_UNSIGNED_INT_8_8_8_8, download->data[0]);
 #endif
       break;
-    case GST_VIDEO_FORMAT_I420:
-    {
-      gl->ReadPixels (0, 0, out_width, out_height, GL_LUMINANCE,
-          GL_UNSIGNED_BYTE, download->data[0]);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[1]);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[2]);
-    }
-      break;
-    case GST_VIDEO_FORMAT_YV12:
-    {
-      gl->ReadPixels (0, 0, out_width, out_height, GL_LUMINANCE,
-          GL_UNSIGNED_BYTE, download->data[0]);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[2]);
-
-      gl->ReadPixels (0, 0, GST_ROUND_UP_2 (out_width) / 2,
-          GST_ROUND_UP_2 (out_height) / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-          download->data[1]);
-    }
-      break;
     default:
       break;
       gst_gl_context_set_error (context,
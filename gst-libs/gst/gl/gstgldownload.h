@@ -87,7 +87,8 @@ struct _GstGLDownloadClass
  * The currently supported formats that can be downloaded
  */
 # define GST_GL_DOWNLOAD_FORMATS "{ RGB, RGBx, RGBA, BGR, BGRx, BGRA, xRGB, " \
-                                 "xBGR, ARGB, ABGR, I420, YV12, YUY2, UYVY, AYUV }"
+                                 "xBGR, ARGB, ABGR, I420, YV12, Y444, Y42B, " \
+                                 "Y41B, NV12, NV21, GRAY8, YUY2, UYVY, AYUV }"
 
 /**
  * GST_GL_DOWNLOAD_VIDEO_CAPS:
@@ -96,6 +97,24 @@ struct _GstGLDownloadClass
  */
 #define GST_GL_DOWNLOAD_VIDEO_CAPS GST_VIDEO_CAPS_MAKE (GST_GL_DOWNLOAD_FORMATS)
 
+#ifndef GST_CAPS_FEATURE_MEMORY_DMABUF
+/**
+ * GST_CAPS_FEATURE_MEMORY_DMABUF:
+ *
+ * The caps feature for buffers backed by dmabuf memory, as produced by
+ * gst_gl_download_perform_with_dmabuf()
+ */
+#define GST_CAPS_FEATURE_MEMORY_DMABUF "memory:DMABuf"
+#endif
+
+/**
+ * GST_GL_DOWNLOAD_MAX_PENDING:
+ *
+ * The largest value of #GstGLDownload:max-pending, the number of readbacks
+ * queued with gst_gl_download_submit() that can be pending at a time
+ */
+#define GST_GL_DOWNLOAD_MAX_PENDING 3
+
 GstGLDownload * gst_gl_download_new          (GstGLContext * context);
 
 gboolean gst_gl_download_init_format                (GstGLDownload * download, GstVideoFormat v_format,
@@ -104,6 +123,17 @@ gboolean gst_gl_download_init_format                (GstGLDownload * download, G
 gboolean gst_gl_download_perform_with_memory        (GstGLDownload * download, GstGLMemory * gl_mem);
 gboolean gst_gl_download_perform_with_data          (GstGLDownload * download, GLuint texture_id,
                                                      gpointer data[GST_VIDEO_MAX_PLANES]);
+gboolean gst_gl_download_perform_with_dmabuf        (GstGLDownload * download, GLuint texture_id,
+                                                     GstBuffer * buffer);
+gboolean gst_gl_download_check_dmabuf_export        (GstGLContext * context);
+
+gboolean gst_gl_download_submit                     (GstGLDownload * download, GLuint texture_id,
+                                                     guint64 * frame);
+gboolean gst_gl_download_retrieve                   (GstGLDownload * download,
+                                                     gpointer data[GST_VIDEO_MAX_PLANES],
+                                                     guint64 * frame);
+guint    gst_gl_download_get_n_pending              (GstGLDownload * download);
+void     gst_gl_download_flush                      (GstGLDownload * download);
 
 G_END_DECLS
 
@@ -25,10 +25,18 @@
 #endif
 
 #include "gstglfilter.h"
+#include "gstglprofile.h"
 
 #define GST_CAT_DEFAULT gst_gl_filter_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+#if GST_GL_HAVE_PLATFORM_EGL
+#define DMABUF_CAPS "; " \
+    GST_VIDEO_CAPS_MAKE_WITH_FEATURES (GST_CAPS_FEATURE_MEMORY_DMABUF, "RGBA")
+#else
+#define DMABUF_CAPS
+#endif
+
 
 static GstStaticPadTemplate gst_gl_filter_src_pad_template =
     GST_STATIC_PAD_TEMPLATE ("src",
@@ -37,7 +45,7 @@ static GstStaticPadTemplate gst_gl_filter_src_pad_template =
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (GST_GL_DOWNLOAD_FORMATS) "; "
         GST_VIDEO_CAPS_MAKE_WITH_FEATURES
         (GST_CAPS_FEATURE_META_GST_VIDEO_GL_TEXTURE_UPLOAD_META,
-            "RGBA"))
+            "RGBA") DMABUF_CAPS)
     );
 
 static GstStaticPadTemplate gst_gl_filter_sink_pad_template =
@@ -57,6 +65,18 @@ enum
   PROP_OTHER_CONTEXT
 };
 
+/* what gst_gl_filter_retrieve_frame() restores on the output buffer of a
+ * frame read back through gst_gl_download_submit() */
+typedef struct
+{
+  GstClockTime pts;
+  GstClockTime dts;
+  GstClockTime duration;
+  guint64 offset;
+  guint64 offset_end;
+  GstBufferFlags flags;
+} GstGLFilterPendingFrame;
+
 #define DEBUG_INIT \
   GST_DEBUG_CATEGORY_INIT (gst_gl_filter_debug, "glfilter", 0, "glfilter element");
 #define gst_gl_filter_parent_class parent_class
@@ -70,6 +90,8 @@ static void gst_gl_filter_get_property (GObject * object, guint prop_id,
 
 static void gst_gl_filter_set_context (GstElement * element,
     GstContext * context);
+static gboolean gst_gl_filter_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
 static gboolean gst_gl_filter_query (GstBaseTransform * trans,
     GstPadDirection direction, GstQuery * query);
 static GstCaps *gst_gl_filter_transform_caps (GstBaseTransform * bt,
@@ -87,6 +109,8 @@ static gboolean gst_gl_filter_propose_allocation (GstBaseTransform * trans,
     GstQuery * decide_query, GstQuery * query);
 static gboolean gst_gl_filter_decide_allocation (GstBaseTransform * trans,
     GstQuery * query);
+static GstFlowReturn gst_gl_filter_prepare_output_buffer (GstBaseTransform *
+    bt, GstBuffer * inbuf, GstBuffer ** outbuf);
 static gboolean gst_gl_filter_set_caps (GstBaseTransform * bt, GstCaps * incaps,
     GstCaps * outcaps);
 
@@ -111,6 +135,7 @@ gst_gl_filter_class_init (GstGLFilterClass * klass)
   GST_BASE_TRANSFORM_CLASS (klass)->fixate_caps = gst_gl_filter_fixate_caps;
   GST_BASE_TRANSFORM_CLASS (klass)->transform = gst_gl_filter_transform;
   GST_BASE_TRANSFORM_CLASS (klass)->query = gst_gl_filter_query;
+  GST_BASE_TRANSFORM_CLASS (klass)->sink_event = gst_gl_filter_sink_event;
   GST_BASE_TRANSFORM_CLASS (klass)->start = gst_gl_filter_start;
   GST_BASE_TRANSFORM_CLASS (klass)->stop = gst_gl_filter_stop;
   GST_BASE_TRANSFORM_CLASS (klass)->set_caps = gst_gl_filter_set_caps;
@@ -119,6 +144,8 @@ gst_gl_filter_class_init (GstGLFilterClass * klass)
   GST_BASE_TRANSFORM_CLASS (klass)->decide_allocation =
       gst_gl_filter_decide_allocation;
   GST_BASE_TRANSFORM_CLASS (klass)->get_unit_size = gst_gl_filter_get_unit_size;
+  GST_BASE_TRANSFORM_CLASS (klass)->prepare_output_buffer =
+      gst_gl_filter_prepare_output_buffer;
 
   element_class->set_context = gst_gl_filter_set_context;
 
@@ -147,6 +174,8 @@ gst_gl_filter_class_init (GstGLFilterClass * klass)
 static void
 gst_gl_filter_init (GstGLFilter * filter)
 {
+  g_queue_init (&filter->pending_frames);
+
   gst_gl_filter_reset (filter);
 }
 
@@ -210,6 +239,35 @@ gst_gl_filter_query (GstBaseTransform * trans, GstPadDirection direction,
           &filter->display);
       break;
     }
+    case GST_QUERY_LATENCY:
+    {
+      GstClockTime min, max;
+      gboolean live;
+      guint max_pending;
+
+      res =
+          GST_BASE_TRANSFORM_CLASS (parent_class)->query (trans, direction,
+          query);
+
+      /* system memory output is pushed max-pending - 1 frames late */
+      if (res && direction == GST_PAD_SRC && filter->download
+          && !filter->dmabuf_output
+          && GST_VIDEO_INFO_FPS_N (&filter->out_info) > 0) {
+        GstClockTime delay;
+
+        g_object_get (filter->download, "max-pending", &max_pending, NULL);
+        delay = gst_util_uint64_scale_int (GST_SECOND * (max_pending - 1),
+            GST_VIDEO_INFO_FPS_D (&filter->out_info),
+            GST_VIDEO_INFO_FPS_N (&filter->out_info));
+
+        gst_query_parse_latency (query, &live, &min, &max);
+        min += delay;
+        if (GST_CLOCK_TIME_IS_VALID (max))
+          max += delay;
+        gst_query_set_latency (query, live, min, max);
+      }
+      break;
+    }
     default:
       res =
           GST_BASE_TRANSFORM_CLASS (parent_class)->query (trans, direction,
@@ -220,11 +278,156 @@ gst_gl_filter_query (GstBaseTransform * trans, GstPadDirection direction,
   return res;
 }
 
+static void
+gst_gl_filter_clear_pending_frames (GstGLFilter * filter)
+{
+  GstGLFilterPendingFrame *pending;
+
+  while ((pending = g_queue_pop_head (&filter->pending_frames)))
+    g_slice_free (GstGLFilterPendingFrame, pending);
+}
+
+/* waits for the oldest readback queued by gst_gl_filter_submit_frame() and
+ * puts it into @outbuf along with the timestamps and flags of the frame it
+ * was rendered for */
+static gboolean
+gst_gl_filter_retrieve_frame (GstGLFilter * filter, GstVideoFrame * out_frame,
+    GstBuffer * outbuf)
+{
+  GstGLFilterPendingFrame *pending;
+  gboolean ret;
+
+  ret = gst_gl_download_retrieve (filter->download, out_frame->data, NULL);
+
+  pending = g_queue_pop_head (&filter->pending_frames);
+  g_assert (pending != NULL);
+
+  GST_BUFFER_PTS (outbuf) = pending->pts;
+  GST_BUFFER_DTS (outbuf) = pending->dts;
+  GST_BUFFER_DURATION (outbuf) = pending->duration;
+  GST_BUFFER_OFFSET (outbuf) = pending->offset;
+  GST_BUFFER_OFFSET_END (outbuf) = pending->offset_end;
+  GST_BUFFER_FLAGS (outbuf) =
+      (GST_BUFFER_FLAGS (outbuf) & GST_BUFFER_FLAG_TAG_MEMORY) | pending->flags;
+
+  g_slice_free (GstGLFilterPendingFrame, pending);
+
+  return ret;
+}
+
+/* queues the readback of @out_tex for @outbuf.  Once max-pending readbacks
+ * are in flight the oldest one is retrieved into @outbuf, otherwise
+ * output_delayed is set and @outbuf is dropped */
+static gboolean
+gst_gl_filter_submit_frame (GstGLFilter * filter, guint out_tex,
+    GstVideoFrame * out_frame, GstBuffer * outbuf)
+{
+  GstGLFilterPendingFrame *pending;
+  guint max_pending;
+
+  if (!gst_gl_download_submit (filter->download, out_tex, NULL))
+    return FALSE;
+
+  pending = g_slice_new (GstGLFilterPendingFrame);
+  pending->pts = GST_BUFFER_PTS (outbuf);
+  pending->dts = GST_BUFFER_DTS (outbuf);
+  pending->duration = GST_BUFFER_DURATION (outbuf);
+  pending->offset = GST_BUFFER_OFFSET (outbuf);
+  pending->offset_end = GST_BUFFER_OFFSET_END (outbuf);
+  pending->flags = GST_BUFFER_FLAGS (outbuf) & ~GST_BUFFER_FLAG_TAG_MEMORY;
+  g_queue_push_tail (&filter->pending_frames, pending);
+
+  g_object_get (filter->download, "max-pending", &max_pending, NULL);
+  if (gst_gl_download_get_n_pending (filter->download) < max_pending) {
+    filter->output_delayed = TRUE;
+    return TRUE;
+  }
+
+  return gst_gl_filter_retrieve_frame (filter, out_frame, outbuf);
+}
+
+/* pushes the frames that are still being read back, before the segment or
+ * the output format changes and on EOS */
+static GstFlowReturn
+gst_gl_filter_drain (GstGLFilter * filter)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (!filter->download)
+    return GST_FLOW_OK;
+
+  while (ret == GST_FLOW_OK
+      && gst_gl_download_get_n_pending (filter->download) > 0) {
+    GstVideoFrame out_frame;
+    GstBuffer *outbuf;
+
+    outbuf = gst_buffer_new_allocate (NULL,
+        GST_VIDEO_INFO_SIZE (&filter->out_info), NULL);
+
+    if (!gst_video_frame_map (&out_frame, &filter->out_info, outbuf,
+            GST_MAP_WRITE)) {
+      gst_buffer_unref (outbuf);
+      ret = GST_FLOW_ERROR;
+      break;
+    }
+
+    if (!gst_gl_filter_retrieve_frame (filter, &out_frame, outbuf)) {
+      gst_video_frame_unmap (&out_frame);
+      gst_buffer_unref (outbuf);
+      GST_ELEMENT_ERROR (filter, RESOURCE, NOT_FOUND,
+          ("%s", "Failed to download video frame"), (NULL));
+      ret = GST_FLOW_ERROR;
+      break;
+    }
+
+    gst_video_frame_unmap (&out_frame);
+
+    GST_LOG_OBJECT (filter, "pushing pending frame %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (GST_BUFFER_PTS (outbuf)));
+
+    ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (filter), outbuf);
+  }
+
+  if (ret != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT (filter, "dropping the pending frames, %s",
+        gst_flow_get_name (ret));
+    gst_gl_download_flush (filter->download);
+    gst_gl_filter_clear_pending_frames (filter);
+  }
+
+  return ret;
+}
+
+static gboolean
+gst_gl_filter_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstGLFilter *filter = GST_GL_FILTER (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEGMENT:
+    case GST_EVENT_EOS:
+      gst_gl_filter_drain (filter);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      if (filter->download)
+        gst_gl_download_flush (filter->download);
+      gst_gl_filter_clear_pending_frames (filter);
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
 static void
 gst_gl_filter_reset (GstGLFilter * filter)
 {
   GstGLFilterClass *filter_class = GST_GL_FILTER_GET_CLASS (filter);
 
+  gst_gl_filter_clear_pending_frames (filter);
+  filter->output_delayed = FALSE;
+
   if (filter->upload) {
     gst_object_unref (filter->upload);
     filter->upload = NULL;
@@ -260,6 +463,7 @@ gst_gl_filter_reset (GstGLFilter * filter)
   filter->fbo = 0;
   filter->depthbuffer = 0;
   filter->default_shader = NULL;
+  filter->dmabuf_export = FALSE;
   if (filter->other_context)
     gst_object_unref (filter->other_context);
   filter->other_context = NULL;
@@ -644,16 +848,37 @@ done:
   return othercaps;
 }
 
+/* drops the memory:DMABuf structures from @caps */
+static GstCaps *
+_remove_dmabuf_caps (GstCaps * caps)
+{
+  gint i;
+
+  caps = gst_caps_make_writable (caps);
+
+  for (i = gst_caps_get_size (caps) - 1; i >= 0; i--) {
+    if (gst_caps_features_contains (gst_caps_get_features (caps, i),
+            GST_CAPS_FEATURE_MEMORY_DMABUF))
+      gst_caps_remove_structure (caps, i);
+  }
+
+  return caps;
+}
+
 static GstCaps *
 gst_gl_filter_transform_caps (GstBaseTransform * bt,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter)
 {
+  GstGLFilter *gl_filter = GST_GL_FILTER (bt);
   GstCaps *newcaps, *result;
 
-  if (direction == GST_PAD_SINK)
+  if (direction == GST_PAD_SINK) {
     newcaps =
         gst_static_pad_template_get_caps (&gst_gl_filter_src_pad_template);
-  else if (direction == GST_PAD_SRC)
+    /* until the context is known to export them */
+    if (!gl_filter->dmabuf_export)
+      newcaps = _remove_dmabuf_caps (newcaps);
+  } else if (direction == GST_PAD_SRC)
     newcaps =
         gst_static_pad_template_get_caps (&gst_gl_filter_sink_pad_template);
   else
@@ -696,11 +921,29 @@ gst_gl_filter_set_caps (GstBaseTransform * bt, GstCaps * incaps,
   filter = GST_GL_FILTER (bt);
   filter_class = GST_GL_FILTER_GET_CLASS (filter);
 
+  /* push the frames still being read back in the current format */
+  gst_gl_filter_drain (filter);
+
   if (!gst_video_info_from_caps (&filter->in_info, incaps))
     goto wrong_caps;
   if (!gst_video_info_from_caps (&filter->out_info, outcaps))
     goto wrong_caps;
 
+  filter->dmabuf_output =
+      gst_caps_features_contains (gst_caps_get_features (outcaps, 0),
+      GST_CAPS_FEATURE_MEMORY_DMABUF);
+  /* the export only handles RGBA */
+  if (filter->dmabuf_output
+      && GST_VIDEO_INFO_FORMAT (&filter->out_info) != GST_VIDEO_FORMAT_RGBA)
+    goto wrong_caps;
+
+  /* the download is set up for the output format and memory, see
+   * gst_gl_filter_filter_texture() */
+  if (filter->download) {
+    gst_object_unref (filter->download);
+    filter->download = NULL;
+  }
+
   if (filter_class->set_caps) {
     if (!filter_class->set_caps (filter, incaps, outcaps))
       goto error;
@@ -878,6 +1121,14 @@ gst_gl_filter_decide_allocation (GstBaseTransform * trans, GstQuery * query)
       goto context_error;
   }
 
+  /* memory:DMABuf can be offered now that the context is known, let
+   * downstream pick it on the next negotiation */
+  if (!filter->dmabuf_export
+      && gst_gl_download_check_dmabuf_export (filter->context)) {
+    filter->dmabuf_export = TRUE;
+    gst_pad_mark_reconfigure (GST_BASE_TRANSFORM_SRC_PAD (trans));
+  }
+
   in_width = GST_VIDEO_INFO_WIDTH (&filter->in_info);
   in_height = GST_VIDEO_INFO_HEIGHT (&filter->in_info);
   out_width = GST_VIDEO_INFO_WIDTH (&filter->out_info);
@@ -939,6 +1190,134 @@ error:
   }
 }
 
+static GstFlowReturn
+gst_gl_filter_prepare_output_buffer (GstBaseTransform * bt, GstBuffer * inbuf,
+    GstBuffer ** outbuf)
+{
+  GstGLFilter *filter = GST_GL_FILTER (bt);
+
+  /* the exported memory is added by gst_gl_filter_filter_texture() */
+  if (filter->dmabuf_output) {
+    *outbuf = gst_buffer_new ();
+    gst_buffer_copy_into (*outbuf, inbuf,
+        GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+    return GST_FLOW_OK;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->prepare_output_buffer (bt,
+      inbuf, outbuf);
+}
+
+/* whether @inbuf is #GstGLMemory whose planes are handed to filter_planes
+ * instead of converting it */
+static gboolean
+_use_planes (GstGLFilter * filter, GstBuffer * inbuf)
+{
+  GstGLFilterClass *filter_class = GST_GL_FILTER_GET_CLASS (filter);
+
+  if (!filter_class->filter_planes)
+    return FALSE;
+
+  if (gst_buffer_n_memory (inbuf) != 1
+      || !gst_is_gl_memory (gst_buffer_peek_memory (inbuf, 0)))
+    return FALSE;
+
+  /* one texture per plane with the luma alone in the first one */
+  switch (GST_VIDEO_INFO_FORMAT (&filter->in_info)) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y41B:
+    case GST_VIDEO_FORMAT_Y444:
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+    case GST_VIDEO_FORMAT_NV16:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+static gboolean
+_filter_texture (GstGLFilter * filter, guint in_tex, const guint * in_planes,
+    guint out_tex)
+{
+  GstGLFilterClass *filter_class = GST_GL_FILTER_GET_CLASS (filter);
+
+  if (in_planes) {
+    GST_DEBUG ("calling filter_planes with textures in:%u,%u,%u out:%u",
+        in_planes[0], in_planes[1], in_planes[2], out_tex);
+
+    return filter_class->filter_planes (filter, in_planes, out_tex);
+  }
+
+  GST_DEBUG ("calling filter_texture with textures in:%u out:%u", in_tex,
+      out_tex);
+
+  return filter_class->filter_texture (filter, in_tex, out_tex);
+}
+
+/* renders into a new texture that is exported as dmabuf memory into @outbuf */
+static gboolean
+gst_gl_filter_filter_texture_dmabuf (GstGLFilter * filter, guint in_tex,
+    const guint * in_planes, GstBuffer * outbuf)
+{
+  guint out_width, out_height;
+  GLuint out_tex = 0;
+
+  out_width = GST_VIDEO_INFO_WIDTH (&filter->out_info);
+  out_height = GST_VIDEO_INFO_HEIGHT (&filter->out_info);
+
+  if (!filter->download) {
+    filter->download = gst_gl_download_new (filter->context);
+
+    if (!gst_gl_download_init_format (filter->download,
+            GST_VIDEO_FORMAT_RGBA, out_width, out_height)) {
+      GST_ELEMENT_ERROR (filter, RESOURCE, NOT_FOUND,
+          ("%s", "Failed to init download format"), (NULL));
+      return FALSE;
+    }
+  }
+
+  /* downstream keeps reading from the texture after we return, so every
+   * frame is rendered into its own one */
+  gst_gl_context_gen_texture (filter->context, &out_tex,
+      GST_VIDEO_FORMAT_RGBA, out_width, out_height);
+
+  if (!_filter_texture (filter, in_tex, in_planes, out_tex)) {
+    gst_gl_context_del_texture (filter->context, &out_tex);
+    return FALSE;
+  }
+
+  if (!gst_gl_download_perform_with_dmabuf (filter->download, out_tex,
+          outbuf)) {
+    /* stop offering dmabuf and go back to system memory, the frame is
+     * dropped by gst_gl_filter_transform() */
+    GST_WARNING_OBJECT (filter, "Failed to export video frame, "
+        "renegotiating");
+    filter->dmabuf_export = FALSE;
+    gst_pad_mark_reconfigure (GST_BASE_TRANSFORM_SRC_PAD (filter));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+_has_download_layout (GstGLFilter * filter, GstVideoFrame * frame)
+{
+  guint i;
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (frame); i++) {
+    if (GST_VIDEO_FRAME_PLANE_STRIDE (frame, i) !=
+        GST_VIDEO_INFO_PLANE_STRIDE (&filter->out_info, i))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 /**
  * gst_gl_filter_filter_texture:
  * @filter: a #GstGLFilter
@@ -946,7 +1325,18 @@ error:
  * @outbuf: an output buffer
  *
  * Perform automatic upload if needed, call filter_texture vfunc and then an
- * automatic download if needed.
+ * automatic download if needed.  #GstGLMemory input is not uploaded but
+ * mapped with #GST_MAP_GL_PLANES and passed to the filter_planes vfunc when
+ * the subclass has one and the format allows it.  When the output caps carry the
+ * memory:DMABuf feature, the rendered texture is exported into @outbuf
+ * instead of being downloaded.  A #GstGLSyncMeta is set on @outbuf when
+ * it contains #GstGLMemory.
+ *
+ * System memory output is read back asynchronously: @outbuf receives the
+ * frame rendered #GstGLDownload:max-pending - 1 calls earlier, along with
+ * its timestamps and flags, and is dropped until that many frames have been
+ * rendered.  The remaining frames are pushed on EOS, on a new segment and
+ * before the caps change, and discarded on flush.
  *
  * Returns: whether the transformation succeeded
  */
@@ -959,12 +1349,42 @@ gst_gl_filter_filter_texture (GstGLFilter * filter, GstBuffer * inbuf,
   GstVideoFrame out_frame;
   gboolean ret, out_gl_mem;
   GstVideoGLTextureUploadMeta *out_tex_upload_meta;
+  GstMemory *planes_mem = NULL;
+  GstMapInfo planes_info;
+  const guint *in_planes = NULL;
 
   filter_class = GST_GL_FILTER_GET_CLASS (filter);
 
-  if (!gst_gl_upload_perform_with_buffer (filter->upload, inbuf, &in_tex))
+  in_tex = 0;
+  if (_use_planes (filter, inbuf)) {
+    GstGLSyncMeta *sync_meta = gst_buffer_get_gl_sync_meta (inbuf);
+
+    if (sync_meta)
+      gst_gl_sync_meta_wait (sync_meta, filter->context);
+
+    planes_mem = gst_buffer_peek_memory (inbuf, 0);
+    if (gst_memory_map (planes_mem, &planes_info,
+            GST_MAP_READ | GST_MAP_GL | GST_MAP_GL_PLANES)) {
+      in_planes = (const guint *) planes_info.data;
+    } else {
+      GST_DEBUG_OBJECT (filter, "Failed to map the planes of %"
+          GST_PTR_FORMAT ", converting it", inbuf);
+      planes_mem = NULL;
+    }
+  }
+
+  if (!in_planes
+      && !gst_gl_upload_perform_with_buffer (filter->upload, inbuf, &in_tex))
     return FALSE;
 
+  g_assert (filter_class->filter_texture);
+
+  if (filter->dmabuf_output) {
+    ret = gst_gl_filter_filter_texture_dmabuf (filter, in_tex, in_planes,
+        outbuf);
+    goto inbuf_error;
+  }
+
   if (!gst_video_frame_map (&out_frame, &filter->out_info, outbuf,
           GST_MAP_WRITE | GST_MAP_GL)) {
     ret = FALSE;
@@ -996,15 +1416,29 @@ gst_gl_filter_filter_texture (GstGLFilter * filter, GstBuffer * inbuf,
     out_tex = filter->out_tex_id;
   }
 
-  GST_DEBUG ("calling filter_texture with textures in:%i out:%i", in_tex,
-      out_tex);
+  ret = _filter_texture (filter, in_tex, in_planes, out_tex);
 
-  g_assert (filter_class->filter_texture);
-  ret = filter_class->filter_texture (filter, in_tex, out_tex);
+  if (out_gl_mem) {
+    GstGLSyncMeta *sync_meta = gst_buffer_get_gl_sync_meta (outbuf);
+
+    if (!sync_meta)
+      sync_meta = gst_buffer_add_gl_sync_meta (filter->context, outbuf);
+    gst_gl_sync_meta_set_sync_point (sync_meta, filter->context);
+  }
 
   if (!out_gl_mem && !out_tex_upload_meta) {
-    if (!gst_gl_download_perform_with_data (filter->download, out_tex,
-            out_frame.data)) {
+    gboolean downloaded;
+
+    /* the readback overlaps with the rendering of the next frame, when the
+     * planes are laid out like gst_gl_download_retrieve() writes them */
+    if (_has_download_layout (filter, &out_frame))
+      downloaded = gst_gl_filter_submit_frame (filter, out_tex, &out_frame,
+          outbuf);
+    else
+      downloaded = gst_gl_download_perform_with_data (filter->download,
+          out_tex, out_frame.data);
+
+    if (!downloaded) {
       GST_ELEMENT_ERROR (filter, RESOURCE, NOT_FOUND,
           ("%s", "Failed to download video frame"), (NULL));
       ret = FALSE;
@@ -1015,7 +1449,10 @@ gst_gl_filter_filter_texture (GstGLFilter * filter, GstBuffer * inbuf,
 error:
   gst_video_frame_unmap (&out_frame);
 inbuf_error:
-  gst_gl_upload_release_buffer (filter->upload);
+  if (planes_mem)
+    gst_memory_unmap (planes_mem, &planes_info);
+  else
+    gst_gl_upload_release_buffer (filter->upload);
 
   return ret;
 }
@@ -1026,6 +1463,7 @@ gst_gl_filter_transform (GstBaseTransform * bt, GstBuffer * inbuf,
 {
   GstGLFilter *filter;
   GstGLFilterClass *filter_class;
+  const gchar *owner;
 
   filter = GST_GL_FILTER (bt);
   filter_class = GST_GL_FILTER_GET_CLASS (bt);
@@ -1035,11 +1473,25 @@ gst_gl_filter_transform (GstBaseTransform * bt, GstBuffer * inbuf,
 
   g_assert (filter_class->filter || filter_class->filter_texture);
 
+  owner = gst_gl_profile_push_owner (GST_OBJECT (filter));
+
+  filter->output_delayed = FALSE;
+
   if (filter_class->filter)
     filter_class->filter (filter, inbuf, outbuf);
   else if (filter_class->filter_texture)
     gst_gl_filter_filter_texture (filter, inbuf, outbuf);
 
+  gst_gl_profile_set_owner (owner);
+
+  /* the export failed, nothing was attached to @outbuf */
+  if (filter->dmabuf_output && !filter->dmabuf_export)
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+
+  /* @outbuf is filled in by a later frame or gst_gl_filter_drain() */
+  if (filter->output_delayed)
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+
   return GST_FLOW_OK;
 }
 
@@ -1147,68 +1599,25 @@ gst_gl_filter_draw_texture (GstGLFilter * filter, GLuint texture,
     guint width, guint height)
 {
   GstGLContext *context = filter->context;
-  GstGLFuncs *gl = context->gl_vtable;
 
   GST_DEBUG ("drawing texture:%u dimensions:%ux%u", texture, width, height);
 
 #if GST_GL_HAVE_OPENGL
   if (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL) {
-    GLfloat verts[] = { -1.0f, -1.0f,
-      1.0f, -1.0f,
-      1.0f, 1.0f,
-      -1.0f, 1.0f
-    };
-    GLfloat texcoords[] = { 0.0f, 0.0f,
-      1.0f, 0.0f,
-      1.0f, 1.0f,
-      0.0f, 1.0f
-    };
+    GstGLFuncs *gl = context->gl_vtable;
 
     gl->ActiveTexture (GL_TEXTURE0);
 
     gl->Enable (GL_TEXTURE_2D);
     gl->BindTexture (GL_TEXTURE_2D, texture);
 
-    gl->ClientActiveTexture (GL_TEXTURE0);
-
-    gl->EnableClientState (GL_VERTEX_ARRAY);
-    gl->EnableClientState (GL_TEXTURE_COORD_ARRAY);
-
-    gl->VertexPointer (2, GL_FLOAT, 0, &verts);
-    gl->TexCoordPointer (2, GL_FLOAT, 0, &texcoords);
-
-    gl->DrawArrays (GL_TRIANGLE_FAN, 0, 4);
-
-    gl->DisableClientState (GL_VERTEX_ARRAY);
-    gl->DisableClientState (GL_TEXTURE_COORD_ARRAY);
+    gst_gl_context_draw_fullscreen_quad (context, -1, -1, FALSE);
   }
 #endif
 #if GST_GL_HAVE_GLES2
   if (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES2) {
-    const GLfloat vVertices[] = {
-      -1.0f, -1.0f, 0.0f,
-      0.0f, 0.0f,
-      1.0, -1.0f, 0.0f,
-      1.0f, 0.0f,
-      1.0f, 1.0f, 0.0f, 1.0f, 1.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f
-    };
-
-    GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
-    /* glClear (GL_COLOR_BUFFER_BIT); */
-
-    /* Load the vertex position */
-    gl->VertexAttribPointer (filter->draw_attr_position_loc, 3, GL_FLOAT,
-        GL_FALSE, 5 * sizeof (GLfloat), vVertices);
-
-    /* Load the texture coordinate */
-    gl->VertexAttribPointer (filter->draw_attr_texture_loc, 2, GL_FLOAT,
-        GL_FALSE, 5 * sizeof (GLfloat), &vVertices[3]);
-
-    gl->EnableVertexAttribArray (filter->draw_attr_position_loc);
-    gl->EnableVertexAttribArray (filter->draw_attr_texture_loc);
-
-    gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+    gst_gl_context_draw_fullscreen_quad (context,
+        filter->draw_attr_position_loc, filter->draw_attr_texture_loc, FALSE);
   }
 #endif
 }
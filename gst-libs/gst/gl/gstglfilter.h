@@ -83,6 +83,16 @@ struct _GstGLFilter
   GstGLContext      *context;
   GstGLContext      *other_context;
 
+  gboolean           dmabuf_output;
+  /* the context exports dmabuf, memory:DMABuf is only offered when set */
+  gboolean           dmabuf_export;
+
+  /* system memory output is read back through @download one frame late,
+   * the timestamps and flags of the frames still being read back */
+  GQueue             pending_frames;
+  /* no frame was read back for the current output buffer */
+  gboolean           output_delayed;
+
 #if GST_GL_HAVE_GLES2
   GLint draw_attr_position_loc;
   GLint draw_attr_texture_loc;
@@ -99,6 +109,11 @@ struct _GstGLFilter
  *          Note: If @filter exists, then @filter_texture is not run
  * @filter_texture: given @in_tex, transform it into @out_tex.  Not used
  *                  if @filter exists
+ * @filter_planes: given the native plane textures @in_planes of a
+ *                 #GstGLMemory input, transform them into @out_tex.  Used
+ *                 instead of @filter_texture for the 8 bit planar and
+ *                 semi-planar YUV formats, which then skip their conversion
+ *                 into RGBA.  Not used if @filter exists
  * @onInitFBO: perform initialization when the Framebuffer object is created
  * @onStart: called when element activates see also #GstBaseTransform
  * @onStop: called when the element deactivates e also #GstBaseTransform
@@ -113,6 +128,7 @@ struct _GstGLFilterClass
   gboolean (*set_caps)          (GstGLFilter* filter, GstCaps* incaps, GstCaps* outcaps);
   gboolean (*filter)            (GstGLFilter *filter, GstBuffer *inbuf, GstBuffer *outbuf);
   gboolean (*filter_texture)    (GstGLFilter *filter, guint in_tex, guint out_tex);
+  gboolean (*filter_planes)     (GstGLFilter *filter, const guint * in_planes, guint out_tex);
   gboolean (*onInitFBO)         (GstGLFilter *filter);
 
   void (*onStart)               (GstGLFilter *filter);
@@ -23,6 +23,7 @@
 
 #include "gl.h"
 #include "gstglframebuffer.h"
+#include "gstglprofile.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_gl_framebuffer_debug);
 #define GST_CAT_DEFAULT gst_gl_framebuffer_debug
@@ -126,8 +127,8 @@ gst_gl_framebuffer_generate (GstGLFramebuffer * frame, gint width, gint height,
   /* setup a texture to render to */
   gl->GenTextures (1, &fake_texture);
   gl->BindTexture (GL_TEXTURE_2D, fake_texture);
-  gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
-      width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  gst_gl_context_tex_storage_2d (frame->context, GL_RGBA, GL_UNSIGNED_BYTE,
+      width, height);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -169,6 +170,7 @@ gst_gl_framebuffer_use (GstGLFramebuffer * frame, gint texture_fbo_width,
     GstGLDisplayProjection projection, gpointer stuff)
 {
   const GstGLFuncs *gl;
+  GstGLProfileSection *section;
 #if GST_GL_HAVE_GLES2
   GLint viewport_dim[4];
 #endif
@@ -187,6 +189,9 @@ gst_gl_framebuffer_use (GstGLFramebuffer * frame, gint texture_fbo_width,
       "dimensions:%ux%u", fbo, texture_fbo_width,
       texture_fbo_height, texture_fbo, input_tex_width, input_tex_height);
 
+  section = gst_gl_profile_begin (frame->context, "framebuffer_use tex:%u "
+      "%ux%u", texture_fbo, texture_fbo_width, texture_fbo_height);
+
   gl->BindFramebuffer (GL_FRAMEBUFFER, fbo);
 
   /*setup a texture to render to */
@@ -241,6 +246,9 @@ gst_gl_framebuffer_use (GstGLFramebuffer * frame, gint texture_fbo_width,
 
   cb (input_tex_width, input_tex_height, input_tex, stuff);
 
+  /* the callback may have called GL directly */
+  gst_gl_context_invalidate_state (frame->context);
+
 #if GST_GL_HAVE_OPENGL
   if (gst_gl_context_get_gl_api (frame->context) & GST_GL_API_OPENGL) {
     const GLenum rt[] = { GL_NONE };
@@ -261,6 +269,8 @@ gst_gl_framebuffer_use (GstGLFramebuffer * frame, gint texture_fbo_width,
 
   gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
 
+  gst_gl_profile_end (frame->context, section);
+
   return TRUE;
 }
 
@@ -270,6 +280,7 @@ gst_gl_framebuffer_use_v2 (GstGLFramebuffer * frame, gint texture_fbo_width,
     GLuint texture_fbo, GLCB_V2 cb, gpointer stuff)
 {
   const GstGLFuncs *gl;
+  GstGLProfileSection *section;
   GLint viewport_dim[4];
 
   g_return_val_if_fail (GST_IS_GL_FRAMEBUFFER (frame), FALSE);
@@ -283,6 +294,9 @@ gst_gl_framebuffer_use_v2 (GstGLFramebuffer * frame, gint texture_fbo_width,
   GST_TRACE ("Binding v2 FBO %u dimensions:%ux%u with texture:%u ",
       fbo, texture_fbo_width, texture_fbo_height, texture_fbo);
 
+  section = gst_gl_profile_begin (frame->context, "framebuffer_use_v2 tex:%u "
+      "%ux%u", texture_fbo, texture_fbo_width, texture_fbo_height);
+
   gl->BindFramebuffer (GL_FRAMEBUFFER, fbo);
 
   /* setup a texture to render to */
@@ -306,6 +320,9 @@ gst_gl_framebuffer_use_v2 (GstGLFramebuffer * frame, gint texture_fbo_width,
   /* the opengl scene */
   cb (stuff);
 
+  /* the callback may have called GL directly */
+  gst_gl_context_invalidate_state (frame->context);
+
 #if GST_GL_HAVE_OPENGL
   gl->DrawBuffer (GL_NONE);
 #endif
@@ -315,6 +332,8 @@ gst_gl_framebuffer_use_v2 (GstGLFramebuffer * frame, gint texture_fbo_width,
 
   gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
 
+  gst_gl_profile_end (frame->context, section);
+
   return TRUE;
 }
 
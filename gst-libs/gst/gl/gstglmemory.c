@@ -39,7 +39,10 @@
  * #GstGLMemory is created through gst_gl_memory_alloc() or system memory can
  * be wrapped through gst_gl_memory_wrapped().
  *
- * Data is uploaded or downloaded from the GPU as is necessary.
+ * Data is uploaded or downloaded from the GPU as is necessary.  The texture
+ * itself is only created once the memory is used from GL and YUV data can be
+ * kept in its native planes through #GST_MAP_GL_PLANES, in which case the
+ * conversion into the texture happens on its first #GST_MAP_GL map.
  */
 
 #define USING_OPENGL(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL)
@@ -78,38 +81,207 @@ _gl_mem_init (GstGLMemory * mem, GstAllocator * allocator, GstMemory * parent,
   mem->notify = notify;
   mem->user_data = user_data;
   mem->wrapped = FALSE;
-  mem->upload = gst_gl_upload_new (context);
-  mem->download = gst_gl_download_new (context);
+  memset (mem->tex_planes, 0, sizeof (mem->tex_planes));
+  mem->n_tex_planes = 0;
+  /* borrowed from the context's converter cache on first use */
+  mem->upload = NULL;
+  mem->download = NULL;
 
   GST_CAT_DEBUG (GST_CAT_GL_MEMORY, "new GL texture memory:%p format:%u "
       "dimensions:%ux%u", mem, GST_VIDEO_INFO_FORMAT (&v_info),
       GST_VIDEO_INFO_WIDTH (&v_info), GST_VIDEO_INFO_HEIGHT (&v_info));
 }
 
+/* The texture is created on first use so that memories that only ever have
+ * their planes mapped don't hold a full RGBA copy as well */
 static GstGLMemory *
 _gl_mem_new (GstAllocator * allocator, GstMemory * parent,
     GstGLContext * context, GstVideoInfo v_info, gpointer user_data,
     GDestroyNotify notify)
 {
   GstGLMemory *mem;
-  GLuint tex_id;
 
-  gst_gl_context_gen_texture (context, &tex_id,
-      GST_VIDEO_INFO_FORMAT (&v_info), GST_VIDEO_INFO_WIDTH (&v_info),
-      GST_VIDEO_INFO_HEIGHT (&v_info));
-  if (!tex_id) {
+  mem = g_slice_alloc (sizeof (GstGLMemory));
+  _gl_mem_init (mem, allocator, parent, context, v_info, user_data, notify);
+
+  mem->tex_id = 0;
+
+  return mem;
+}
+
+static gboolean
+_gl_mem_ensure_texture (GstGLMemory * gl_mem)
+{
+  if (gl_mem->tex_id)
+    return TRUE;
+
+  gst_gl_context_gen_texture (gl_mem->context, &gl_mem->tex_id,
+      GST_VIDEO_INFO_FORMAT (&gl_mem->v_info),
+      GST_VIDEO_INFO_WIDTH (&gl_mem->v_info),
+      GST_VIDEO_INFO_HEIGHT (&gl_mem->v_info));
+  if (!gl_mem->tex_id) {
     GST_CAT_WARNING (GST_CAT_GL_MEMORY,
-        "Could not create GL texture with context:%p", context);
+        "Could not create GL texture with context:%p", gl_mem->context);
+    return FALSE;
   }
 
-  GST_CAT_TRACE (GST_CAT_GL_MEMORY, "created texture %u", tex_id);
+  GST_CAT_TRACE (GST_CAT_GL_MEMORY, "created texture %u", gl_mem->tex_id);
 
-  mem = g_slice_alloc (sizeof (GstGLMemory));
-  _gl_mem_init (mem, allocator, parent, context, v_info, user_data, notify);
+  return TRUE;
+}
 
-  mem->tex_id = tex_id;
+/* Converters are shared between all the memories of a context with the
+ * same format and dimensions instead of each memory creating its own.  The
+ * cache only keeps weak references, a converter lives for as long as there
+ * are memories using it. */
+typedef struct
+{
+  GMutex lock;
+  /* gchar * key -> GWeakRef * of a GstGLUpload or GstGLDownload */
+  GHashTable *converters;
+} GstGLMemoryConverters;
 
-  return mem;
+static void
+_free_weak_ref (GWeakRef * ref)
+{
+  g_weak_ref_clear (ref);
+  g_slice_free (GWeakRef, ref);
+}
+
+static void
+_free_converters (GstGLMemoryConverters * cache)
+{
+  g_hash_table_destroy (cache->converters);
+  g_mutex_clear (&cache->lock);
+  g_slice_free (GstGLMemoryConverters, cache);
+}
+
+static GstGLMemoryConverters *
+_get_converters (GstGLContext * context)
+{
+  static GMutex cache_lock;
+  GQuark quark = g_quark_from_static_string ("GstGLMemoryConverters");
+  GstGLMemoryConverters *cache;
+
+  g_mutex_lock (&cache_lock);
+  cache = g_object_get_qdata (G_OBJECT (context), quark);
+  if (!cache) {
+    cache = g_slice_new0 (GstGLMemoryConverters);
+    g_mutex_init (&cache->lock);
+    cache->converters = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) _free_weak_ref);
+    g_object_set_qdata_full (G_OBJECT (context), quark, cache,
+        (GDestroyNotify) _free_converters);
+  }
+  g_mutex_unlock (&cache_lock);
+
+  return cache;
+}
+
+/* The upload reads the planes with the strides of the memory so those are
+ * part of its key, the download always writes the default layout */
+static gchar *
+_converter_key (gboolean upload, GstVideoInfo * v_info)
+{
+  GString *key = g_string_new (NULL);
+  guint i;
+
+  g_string_append_printf (key, "%s:%u:%ux%u", upload ? "up" : "down",
+      GST_VIDEO_INFO_FORMAT (v_info), GST_VIDEO_INFO_WIDTH (v_info),
+      GST_VIDEO_INFO_HEIGHT (v_info));
+
+  if (upload) {
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (v_info); i++)
+      g_string_append_printf (key, ":%i", GST_VIDEO_INFO_PLANE_STRIDE (v_info,
+              i));
+  }
+
+  return g_string_free (key, FALSE);
+}
+
+/* Returns a ref to an initialized converter for @gl_mem in the direction
+ * given by @upload, creating it if needed */
+static gpointer
+_borrow_converter (GstGLMemory * gl_mem, gboolean upload)
+{
+  GstGLMemoryConverters *cache = _get_converters (gl_mem->context);
+  GstVideoInfo *v_info = &gl_mem->v_info;
+  GObject *converter;
+  GWeakRef *ref;
+  gboolean ret;
+  gchar *key;
+
+  key = _converter_key (upload, v_info);
+
+  g_mutex_lock (&cache->lock);
+
+  ref = g_hash_table_lookup (cache->converters, key);
+  converter = ref ? g_weak_ref_get (ref) : NULL;
+  if (converter) {
+    GST_CAT_TRACE (GST_CAT_GL_MEMORY, "reusing converter %p for %s",
+        converter, key);
+    g_mutex_unlock (&cache->lock);
+    g_free (key);
+    return converter;
+  }
+
+  if (upload) {
+    converter = (GObject *) gst_gl_upload_new (gl_mem->context);
+    ret = gst_gl_upload_init_format ((GstGLUpload *) converter, *v_info,
+        *v_info);
+  } else {
+    converter = (GObject *) gst_gl_download_new (gl_mem->context);
+    ret = gst_gl_download_init_format ((GstGLDownload *) converter,
+        GST_VIDEO_INFO_FORMAT (v_info), GST_VIDEO_INFO_WIDTH (v_info),
+        GST_VIDEO_INFO_HEIGHT (v_info));
+  }
+
+  if (!ret) {
+    GST_CAT_WARNING (GST_CAT_GL_MEMORY, "failed to initialize converter "
+        "for %s", key);
+    g_mutex_unlock (&cache->lock);
+    gst_object_unref (converter);
+    g_free (key);
+    return NULL;
+  }
+
+  GST_CAT_DEBUG (GST_CAT_GL_MEMORY, "created converter %p for %s",
+      converter, key);
+
+  ref = g_slice_new (GWeakRef);
+  g_weak_ref_init (ref, converter);
+  /* replaces any stale entry */
+  g_hash_table_insert (cache->converters, key, ref);
+
+  g_mutex_unlock (&cache->lock);
+
+  return converter;
+}
+
+static gboolean
+_gl_mem_ensure_upload (GstGLMemory * gl_mem)
+{
+  if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_UPLOAD_INITTED)) {
+    gl_mem->upload = _borrow_converter (gl_mem, TRUE);
+    if (!gl_mem->upload)
+      return FALSE;
+    GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_UPLOAD_INITTED);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+_gl_mem_download (GstGLMemory * gl_mem)
+{
+  if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_DOWNLOAD_INITTED)) {
+    gl_mem->download = _borrow_converter (gl_mem, FALSE);
+    if (!gl_mem->download)
+      return FALSE;
+    GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_DOWNLOAD_INITTED);
+  }
+
+  return gst_gl_download_perform_with_memory (gl_mem->download, gl_mem);
 }
 
 gpointer
@@ -119,19 +291,41 @@ _gl_mem_map (GstGLMemory * gl_mem, gsize maxsize, GstMapFlags flags)
 
   g_return_val_if_fail (maxsize == gl_mem->mem.maxsize, NULL);
 
-  if ((flags & GST_MAP_GL) == GST_MAP_GL) {
+  if ((flags & GST_MAP_GL_PLANES) == GST_MAP_GL_PLANES) {
+    if ((flags & GST_MAP_WRITE) == GST_MAP_WRITE) {
+      GST_CAT_WARNING (GST_CAT_GL_MEMORY, "the planes of GL memory %p can "
+          "only be mapped for reading", gl_mem);
+      goto error;
+    }
+
+    GST_CAT_TRACE (GST_CAT_GL_MEMORY, "mapping planes of GL memory %p for "
+        "reading", gl_mem);
+
+    /* the planes are uploaded from the data so that has to be current */
+    if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_DOWNLOAD)) {
+      if (!_gl_mem_download (gl_mem))
+        goto error;
+    }
+
+    if (!_gl_mem_ensure_upload (gl_mem))
+      goto error;
+
+    if (!gst_gl_upload_perform_planes_with_memory (gl_mem->upload, gl_mem))
+      goto error;
+
+    data = gl_mem->tex_planes;
+  } else if ((flags & GST_MAP_GL) == GST_MAP_GL) {
+    if (!_gl_mem_ensure_texture (gl_mem))
+      goto error;
+
     if ((flags & GST_MAP_READ) == GST_MAP_READ) {
       GST_CAT_TRACE (GST_CAT_GL_MEMORY, "mapping GL texture:%u for reading",
           gl_mem->tex_id);
-      if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)) {
-        if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem,
-                GST_GL_MEMORY_FLAG_UPLOAD_INITTED)) {
-          if (!gst_gl_upload_init_format (gl_mem->upload, gl_mem->v_info,
-                  gl_mem->v_info)) {
-            goto error;
-          }
-          GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_UPLOAD_INITTED);
-        }
+      if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)
+          || GST_GL_MEMORY_FLAG_IS_SET (gl_mem,
+              GST_GL_MEMORY_FLAG_NEED_CONVERT)) {
+        if (!_gl_mem_ensure_upload (gl_mem))
+          goto error;
 
         if (!gst_gl_upload_perform_with_memory (gl_mem->upload, gl_mem)) {
           goto error;
@@ -149,18 +343,7 @@ _gl_mem_map (GstGLMemory * gl_mem, gsize maxsize, GstMapFlags flags)
           "mapping GL texture:%u for reading from system memory",
           gl_mem->tex_id);
       if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_DOWNLOAD)) {
-        if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem,
-                GST_GL_MEMORY_FLAG_DOWNLOAD_INITTED)) {
-          if (!gst_gl_download_init_format (gl_mem->download,
-                  GST_VIDEO_INFO_FORMAT (&gl_mem->v_info),
-                  GST_VIDEO_INFO_WIDTH (&gl_mem->v_info),
-                  GST_VIDEO_INFO_HEIGHT (&gl_mem->v_info))) {
-            goto error;
-          }
-          GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_DOWNLOAD_INITTED);
-        }
-
-        if (!gst_gl_download_perform_with_memory (gl_mem->download, gl_mem)) {
+        if (!_gl_mem_download (gl_mem)) {
           goto error;
         }
       }
@@ -188,9 +371,12 @@ _gl_mem_unmap (GstGLMemory * gl_mem)
   if ((gl_mem->map_flags & GST_MAP_WRITE) == GST_MAP_WRITE) {
     if ((gl_mem->map_flags & GST_MAP_GL) == GST_MAP_GL) {
       GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_DOWNLOAD);
+      GST_GL_MEMORY_FLAG_UNSET (gl_mem, GST_GL_MEMORY_FLAG_NEED_CONVERT);
     } else {
       GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD);
     }
+    /* either way the planes are behind now */
+    GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_PLANE_UPLOAD);
   }
 
   gl_mem->map_flags = 0;
@@ -204,7 +390,6 @@ _gl_mem_copy_thread (GstGLContext * context, gpointer data)
   GLuint tex_id;
   GLuint rboId, fboId;
   gsize width, height;
-  GLuint gl_format;
   GstVideoFormat v_format;
   GstGLFuncs *gl;
 
@@ -214,7 +399,6 @@ _gl_mem_copy_thread (GstGLContext * context, gpointer data)
   width = GST_VIDEO_INFO_WIDTH (&src->v_info);
   height = GST_VIDEO_INFO_HEIGHT (&src->v_info);
   v_format = GST_VIDEO_INFO_FORMAT (&src->v_info);
-  gl_format = src->gl_format;
 
   gl = src->context->gl_vtable;
 
@@ -270,9 +454,9 @@ _gl_mem_copy_thread (GstGLContext * context, gpointer data)
   if (!gst_gl_context_check_framebuffer_status (src->context))
     goto fbo_error;
 
-  /* copy tex */
+  /* copy tex, the storage of the destination may be immutable */
   gl->BindTexture (GL_TEXTURE_2D, tex_id);
-  gl->CopyTexImage2D (GL_TEXTURE_2D, 0, gl_format, 0, 0, width, height, 0);
+  gl->CopyTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
   gl->BindTexture (GL_TEXTURE_2D, 0);
 
   gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
@@ -309,7 +493,10 @@ _gl_mem_copy (GstGLMemory * src, gssize offset, gssize size)
   GstGLMemory *dest;
   GstGLMemoryCopyParams copy_params;
 
-  if (GST_GL_MEMORY_FLAG_IS_SET (src, GST_GL_MEMORY_FLAG_NEED_UPLOAD)) {
+  /* the data is current whenever the texture is not */
+  if (GST_GL_MEMORY_FLAG_IS_SET (src, GST_GL_MEMORY_FLAG_NEED_UPLOAD)
+      || GST_GL_MEMORY_FLAG_IS_SET (src, GST_GL_MEMORY_FLAG_NEED_CONVERT)
+      || !src->tex_id) {
     dest = _gl_mem_new (src->mem.allocator, NULL, src->context, src->v_info,
         NULL, NULL);
     dest->data = g_malloc (src->mem.maxsize);
@@ -370,12 +557,17 @@ void
 _gl_mem_free (GstAllocator * allocator, GstMemory * mem)
 {
   GstGLMemory *gl_mem = (GstGLMemory *) mem;
+  guint i;
 
   if (gl_mem->tex_id)
     gst_gl_context_del_texture (gl_mem->context, &gl_mem->tex_id);
+  for (i = 0; i < gl_mem->n_tex_planes; i++)
+    gst_gl_context_del_texture (gl_mem->context, &gl_mem->tex_planes[i]);
 
-  gst_object_unref (gl_mem->upload);
-  gst_object_unref (gl_mem->download);
+  if (gl_mem->upload)
+    gst_object_unref (gl_mem->upload);
+  if (gl_mem->download)
+    gst_object_unref (gl_mem->download);
   gst_object_unref (gl_mem->context);
 
   if (gl_mem->notify)
@@ -404,6 +596,9 @@ gst_gl_memory_copy_into_texture (GstGLMemory * gl_mem, guint tex_id)
 {
   GstGLMemoryCopyParams copy_params;
 
+  if (!_gl_mem_ensure_texture (gl_mem))
+    return FALSE;
+
   copy_params.src = gl_mem;
   copy_params.tex_id = tex_id;
 
@@ -460,6 +655,7 @@ gst_gl_memory_wrapped (GstGLContext * context, GstVideoInfo v_info,
   mem->wrapped = TRUE;
 
   GST_GL_MEMORY_FLAG_SET (mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD);
+  GST_GL_MEMORY_FLAG_SET (mem, GST_GL_MEMORY_FLAG_NEED_PLANE_UPLOAD);
 
   return mem;
 }
@@ -50,7 +50,9 @@ typedef enum
   GST_GL_MEMORY_FLAG_DOWNLOAD_INITTED = (GST_MEMORY_FLAG_LAST << 0),
   GST_GL_MEMORY_FLAG_UPLOAD_INITTED   = (GST_MEMORY_FLAG_LAST << 1),
   GST_GL_MEMORY_FLAG_NEED_DOWNLOAD   = (GST_MEMORY_FLAG_LAST << 2),
-  GST_GL_MEMORY_FLAG_NEED_UPLOAD     = (GST_MEMORY_FLAG_LAST << 3)
+  GST_GL_MEMORY_FLAG_NEED_UPLOAD     = (GST_MEMORY_FLAG_LAST << 3),
+  GST_GL_MEMORY_FLAG_NEED_CONVERT    = (GST_MEMORY_FLAG_LAST << 4),
+  GST_GL_MEMORY_FLAG_NEED_PLANE_UPLOAD = (GST_MEMORY_FLAG_LAST << 5)
 } GstGLMemoryFlags;
 
 /**
@@ -64,17 +66,37 @@ typedef enum
  */
 #define GST_MAP_GL GST_MAP_FLAG_LAST << 1
 
+/**
+ * GST_MAP_GL_PLANES:
+ *
+ * Flag indicating that, combined with #GST_MAP_GL and #GST_MAP_READ, the
+ * planes of the memory should be mapped as they are instead of its RGBA
+ * texture.  The mapped data is an array of #GST_VIDEO_MAX_PLANES texture ids
+ * laid out as #GstGLUpload uploads them, one texture per plane except for
+ * the packed YUY2 and UYVY formats that have a luma and a chroma texture.
+ *
+ * The conversion into the RGBA texture is deferred until that is mapped, so
+ * elements that only need the native planes never pay for it.  Planes cannot
+ * be mapped for writing.
+ */
+#define GST_MAP_GL_PLANES GST_MAP_FLAG_LAST << 2
+
 /**
  * GstGLMemory:
  * @mem: the parent object
  * @context: the #GstGLContext to use for GL operations
- * @tex_id: the texture id for this memory
+ * @tex_id: the texture id for this memory, 0 until the memory is first
+ *          used from GL
  * @v_format: the video format of this texture
  * @gl_format: the format of the texture
  * @width: width of the texture
  * @height: height of the texture
- * @download: the object used to download this texture into @v_format
- * @upload: the object used to upload this texture from @v_format
+ * @download: the object used to download this texture into @v_format.
+ *            Shared with other memories of the same format and %NULL
+ *            until the first download.
+ * @upload: the object used to upload this texture from @v_format.
+ *          Shared with other memories of the same format and %NULL until
+ *          the first upload.
  *
  * Represents information about a GL texture
  */
@@ -94,6 +116,10 @@ struct _GstGLMemory
   GstMapFlags        map_flags;
   gpointer           data;
 
+  /* native planes, created on the first GST_MAP_GL_PLANES map */
+  GLuint             tex_planes[GST_VIDEO_MAX_PLANES];
+  guint              n_tex_planes;
+
   gboolean           wrapped;
   GDestroyNotify     notify;
   gpointer           user_data;
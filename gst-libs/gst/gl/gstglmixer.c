@@ -35,6 +35,14 @@
 #endif
 
 #include "gstglmixer.h"
+#include "gstglprofile.h"
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_TIMEOUT_IGNORED
+#define GL_TIMEOUT_IGNORED G_GUINT64_CONSTANT (0xFFFFFFFFFFFFFFFF)
+#endif
 
 #define GST_CAT_DEFAULT gst_gl_mixer_debug
 GST_DEBUG_CATEGORY (gst_gl_mixer_debug);
@@ -62,10 +70,23 @@ static gboolean gst_gl_mixer_src_setcaps (GstPad * pad, GstGLMixer * mix,
     GstCaps * caps);
 static void gst_gl_mixer_set_context (GstElement * element,
     GstContext * context);
-
+static void gst_gl_mixer_free_upload_contexts (GstGLMixer * mix);
+
+#define DEFAULT_PAD_XPOS   0
+#define DEFAULT_PAD_YPOS   0
+#define DEFAULT_PAD_WIDTH  0
+#define DEFAULT_PAD_HEIGHT 0
+#define DEFAULT_PAD_ZORDER 0
+#define DEFAULT_PAD_ALPHA  1.0
 enum
 {
-  PROP_PAD_0
+  PROP_PAD_0,
+  PROP_PAD_XPOS,
+  PROP_PAD_YPOS,
+  PROP_PAD_WIDTH,
+  PROP_PAD_HEIGHT,
+  PROP_PAD_ZORDER,
+  PROP_PAD_ALPHA
 };
 
 #define GST_GL_MIXER_GET_PRIVATE(obj)  \
@@ -80,8 +101,38 @@ struct _GstGLMixerPrivate
   GstAllocator *allocator;
   GstAllocationParams params;
   GstQuery *query;
+
+  /* output textures are exported as dmabuf memory */
+  gboolean dmabuf_output;
+  /* the context exports dmabuf, memory:DMABuf is only offered when set */
+  gboolean dmabuf_export;
+
+  /* contexts sharing with mix->context that the sink pads are uploaded
+   * with in parallel, n_upload_contexts is the property and
+   * upload_contexts_failed is set until the next stop when they could not
+   * be created */
+  guint n_upload_contexts;
+  gboolean upload_contexts_failed;
+  GstGLContext **upload_contexts;
+  guint upload_contexts_len;
+  GThreadPool *upload_pool;
+  GMutex upload_lock;
+  GCond upload_cond;
+  guint uploads_pending;
 };
 
+typedef struct
+{
+  GstGLMixer *mix;
+  GstGLMixerPad *pad;
+  GstGLMixerFrameData *frame;
+
+  /* signaled in the upload context once the texture is complete, set by the
+   * command fence_id of the upload context */
+  gpointer fence;
+  guint64 fence_id;
+} GstGLMixerUploadJob;
+
 G_DEFINE_TYPE (GstGLMixerPad, gst_gl_mixer_pad, GST_TYPE_PAD);
 
 static void
@@ -91,24 +142,110 @@ gst_gl_mixer_pad_class_init (GstGLMixerPadClass * klass)
 
   gobject_class->set_property = gst_gl_mixer_pad_set_property;
   gobject_class->get_property = gst_gl_mixer_pad_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
+      g_param_spec_int ("xpos", "X Position", "X Position of the picture",
+          G_MININT, G_MAXINT, DEFAULT_PAD_XPOS,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_YPOS,
+      g_param_spec_int ("ypos", "Y Position", "Y Position of the picture",
+          G_MININT, G_MAXINT, DEFAULT_PAD_YPOS,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_WIDTH,
+      g_param_spec_int ("width", "Width",
+          "Width of the picture in the output, 0 to keep the input width",
+          0, G_MAXINT, DEFAULT_PAD_WIDTH,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_HEIGHT,
+      g_param_spec_int ("height", "Height",
+          "Height of the picture in the output, 0 to keep the input height",
+          0, G_MAXINT, DEFAULT_PAD_HEIGHT,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_ZORDER,
+      g_param_spec_uint ("zorder", "Z-Order", "Z Order of the picture",
+          0, 10000, DEFAULT_PAD_ZORDER,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_ALPHA,
+      g_param_spec_double ("alpha", "Alpha", "Alpha of the picture", 0.0, 1.0,
+          DEFAULT_PAD_ALPHA,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_gl_mixer_pad_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
+  GstGLMixerPad *pad = GST_GL_MIXER_PAD (object);
+
   switch (prop_id) {
+    case PROP_PAD_XPOS:
+      g_value_set_int (value, pad->xpos);
+      break;
+    case PROP_PAD_YPOS:
+      g_value_set_int (value, pad->ypos);
+      break;
+    case PROP_PAD_WIDTH:
+      g_value_set_int (value, pad->width);
+      break;
+    case PROP_PAD_HEIGHT:
+      g_value_set_int (value, pad->height);
+      break;
+    case PROP_PAD_ZORDER:
+      g_value_set_uint (value, pad->zorder);
+      break;
+    case PROP_PAD_ALPHA:
+      g_value_set_double (value, pad->alpha);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static int
+pad_zorder_compare (const GstGLMixerPad * pad1, const GstGLMixerPad * pad2)
+{
+  return pad1->zorder - pad2->zorder;
+}
+
 static void
 gst_gl_mixer_pad_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
+  GstGLMixerPad *pad = GST_GL_MIXER_PAD (object);
+  GstGLMixer *mix;
+
   switch (prop_id) {
+    case PROP_PAD_XPOS:
+      pad->xpos = g_value_get_int (value);
+      break;
+    case PROP_PAD_YPOS:
+      pad->ypos = g_value_get_int (value);
+      break;
+    case PROP_PAD_WIDTH:
+      pad->width = g_value_get_int (value);
+      break;
+    case PROP_PAD_HEIGHT:
+      pad->height = g_value_get_int (value);
+      break;
+    case PROP_PAD_ZORDER:
+      mix = GST_GL_MIXER (gst_pad_get_parent (GST_PAD (pad)));
+      if (mix) {
+        /* keep the sink pads sorted so the inputs are drawn from the
+         * bottom up */
+        GST_GL_MIXER_LOCK (mix);
+        pad->zorder = g_value_get_uint (value);
+        mix->sinkpads = g_slist_sort (mix->sinkpads,
+            (GCompareFunc) pad_zorder_compare);
+        GST_GL_MIXER_UNLOCK (mix);
+        gst_object_unref (mix);
+      } else {
+        pad->zorder = g_value_get_uint (value);
+      }
+      break;
+    case PROP_PAD_ALPHA:
+      pad->alpha = g_value_get_double (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -180,6 +317,15 @@ gst_gl_mixer_update_src_caps (GstGLMixer * mix)
     }
 
     caps = gst_caps_new_empty_simple ("video/x-raw");
+    /* preferred over system memory when the context can export it */
+    if (mix->priv->dmabuf_export) {
+      GstCaps *dmabuf_caps = gst_caps_new_simple ("video/x-raw",
+          "format", G_TYPE_STRING, "RGBA", NULL);
+
+      gst_caps_set_features (dmabuf_caps, 0,
+          gst_caps_features_new (GST_CAPS_FEATURE_MEMORY_DMABUF, NULL));
+      caps = gst_caps_merge (dmabuf_caps, caps);
+    }
 
     peercaps = gst_pad_peer_query_caps (mix->srcpad, NULL);
     if (peercaps) {
@@ -240,6 +386,7 @@ gst_gl_mixer_pad_sink_setcaps (GstPad * pad, GstObject * parent, GstCaps * caps)
 
   mix->out_info = info;
   mixpad->in_info = info;
+  gst_buffer_replace (&mixpad->uploaded_buffer, NULL);
 
   GST_GL_MIXER_UNLOCK (mix);
 
@@ -317,6 +464,18 @@ gst_gl_mixer_pad_sink_acceptcaps (GstPad * pad, GstGLMixer * mix,
   return ret;
 }
 
+/* memory:DMABuf can be offered once the context is known to export it, let
+ * downstream pick it on the next negotiation */
+static void
+gst_gl_mixer_check_dmabuf_export (GstGLMixer * mix)
+{
+  if (!mix->priv->dmabuf_export
+      && gst_gl_download_check_dmabuf_export (mix->context)) {
+    mix->priv->dmabuf_export = TRUE;
+    gst_pad_mark_reconfigure (mix->srcpad);
+  }
+}
+
 static gboolean
 gst_gl_mixer_propose_allocation (GstGLMixer * mix,
     GstQuery * decide_query, GstQuery * query)
@@ -363,6 +522,8 @@ gst_gl_mixer_propose_allocation (GstGLMixer * mix,
       goto context_error;
   }
 
+  gst_gl_mixer_check_dmabuf_export (mix);
+
   if (pool == NULL && need_pool) {
     GstVideoInfo info;
 
@@ -496,6 +657,12 @@ gst_gl_mixer_sink_query (GstCollectPads * pads, GstCollectData * data,
 static void
 gst_gl_mixer_pad_init (GstGLMixerPad * mixerpad)
 {
+  mixerpad->xpos = DEFAULT_PAD_XPOS;
+  mixerpad->ypos = DEFAULT_PAD_YPOS;
+  mixerpad->width = DEFAULT_PAD_WIDTH;
+  mixerpad->height = DEFAULT_PAD_HEIGHT;
+  mixerpad->zorder = DEFAULT_PAD_ZORDER;
+  mixerpad->alpha = DEFAULT_PAD_ALPHA;
 }
 
 /* GLMixer signals and args */
@@ -505,18 +672,27 @@ enum
   LAST_SIGNAL
 };
 
+#define DEFAULT_UPLOAD_CONTEXTS 0
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_UPLOAD_CONTEXTS
 };
 
+#if GST_GL_HAVE_PLATFORM_EGL
+#define DMABUF_CAPS "; " \
+    GST_VIDEO_CAPS_MAKE_WITH_FEATURES (GST_CAPS_FEATURE_MEMORY_DMABUF, "RGBA")
+#else
+#define DMABUF_CAPS
+#endif
+
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (GST_GL_DOWNLOAD_FORMATS) "; "
         GST_VIDEO_CAPS_MAKE_WITH_FEATURES
         (GST_CAPS_FEATURE_META_GST_VIDEO_GL_TEXTURE_UPLOAD_META,
-            "RGBA"))
+            "RGBA") DMABUF_CAPS)
     );
 
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -643,6 +819,13 @@ gst_gl_mixer_class_init (GstGLMixerClass * klass)
   element_class->change_state = GST_DEBUG_FUNCPTR (gst_gl_mixer_change_state);
   element_class->set_context = GST_DEBUG_FUNCPTR (gst_gl_mixer_set_context);
 
+  g_object_class_install_property (gobject_class, PROP_UPLOAD_CONTEXTS,
+      g_param_spec_uint ("upload-contexts", "Upload contexts",
+          "Number of shared OpenGL contexts the inputs are uploaded with in "
+          "parallel, 0 uploads them one after the other in the mixing context",
+          0, 16, DEFAULT_UPLOAD_CONTEXTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Register the pad class */
   g_type_class_ref (GST_TYPE_GL_MIXER_PAD);
 
@@ -677,6 +860,7 @@ gst_gl_mixer_reset (GstGLMixer * mix)
     GstGLMixerCollect *mixcol = p->mixcol;
 
     gst_buffer_replace (&mixcol->buffer, NULL);
+    gst_buffer_replace (&p->uploaded_buffer, NULL);
     mixcol->start_time = -1;
     mixcol->end_time = -1;
 
@@ -718,6 +902,10 @@ gst_gl_mixer_init (GstGLMixer * mix)
 
   g_mutex_init (&mix->lock);
 
+  mix->priv->n_upload_contexts = DEFAULT_UPLOAD_CONTEXTS;
+  g_mutex_init (&mix->priv->upload_lock);
+  g_cond_init (&mix->priv->upload_cond);
+
   mix->array_buffers = 0;
   mix->display = NULL;
   mix->fbo = 0;
@@ -734,6 +922,8 @@ gst_gl_mixer_finalize (GObject * object)
 
   gst_object_unref (mix->collect);
   g_mutex_clear (&mix->lock);
+  g_mutex_clear (&mix->priv->upload_lock);
+  g_cond_clear (&mix->priv->upload_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -832,6 +1022,14 @@ gst_gl_mixer_query_caps (GstPad * pad, GstObject * parent, GstQuery * query)
 
   n = gst_caps_get_size (caps) - 1;
   for (; n >= 0; n--) {
+    /* until the context is known to export them */
+    if (!mix->priv->dmabuf_export
+        && gst_caps_features_contains (gst_caps_get_features (caps, n),
+            GST_CAPS_FEATURE_MEMORY_DMABUF)) {
+      gst_caps_remove_structure (caps, n);
+      continue;
+    }
+
     s = gst_caps_get_structure (caps, n);
     gst_structure_set (s, "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
         "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
@@ -1079,6 +1277,8 @@ gst_gl_mixer_decide_allocation (GstGLMixer * mix, GstQuery * query)
       goto context_error;
   }
 
+  gst_gl_mixer_check_dmabuf_export (mix);
+
   out_width = GST_VIDEO_INFO_WIDTH (&mix->out_info);
   out_height = GST_VIDEO_INFO_HEIGHT (&mix->out_info);
 
@@ -1222,6 +1422,7 @@ static gboolean
 gst_gl_mixer_src_setcaps (GstPad * pad, GstGLMixer * mix, GstCaps * caps)
 {
   GstGLMixerPrivate *priv = mix->priv;
+  GstGLMixerClass *mix_class = GST_GL_MIXER_GET_CLASS (mix);
   GstVideoInfo info;
   gboolean ret = TRUE;
 
@@ -1232,6 +1433,15 @@ gst_gl_mixer_src_setcaps (GstPad * pad, GstGLMixer * mix, GstCaps * caps)
     goto done;
   }
 
+  priv->dmabuf_output =
+      gst_caps_features_contains (gst_caps_get_features (caps, 0),
+      GST_CAPS_FEATURE_MEMORY_DMABUF);
+  if (priv->dmabuf_output && mix_class->process_buffers) {
+    GST_WARNING_OBJECT (mix, "dmabuf output requires process_textures");
+    ret = FALSE;
+    goto done;
+  }
+
   GST_GL_MIXER_LOCK (mix);
 
   if (GST_VIDEO_INFO_FPS_N (&mix->out_info) != GST_VIDEO_INFO_FPS_N (&info) ||
@@ -1301,8 +1511,12 @@ gst_gl_mixer_request_new_pad (GstElement * element,
     mixcol->start_time = -1;
     mixcol->end_time = -1;
 
+    /* new pads go on top of the existing ones */
+    mixpad->zorder = mix->numpads;
+
     /* Keep an internal list of mixpads for zordering */
-    mix->sinkpads = g_slist_append (mix->sinkpads, mixpad);
+    mix->sinkpads = g_slist_insert_sorted (mix->sinkpads, mixpad,
+        (GCompareFunc) pad_zorder_compare);
     mix->numpads++;
     GST_GL_MIXER_UNLOCK (mix);
   } else {
@@ -1337,6 +1551,7 @@ gst_gl_mixer_release_pad (GstElement * element, GstPad * pad)
   mixpad = GST_GL_MIXER_PAD (pad);
 
   mix->sinkpads = g_slist_remove (mix->sinkpads, pad);
+  gst_buffer_replace (&mixpad->uploaded_buffer, NULL);
   gst_child_proxy_child_removed (GST_CHILD_PROXY (mix), G_OBJECT (mixpad),
       GST_OBJECT_NAME (mixpad));
   mix->numpads--;
@@ -1521,6 +1736,158 @@ gst_gl_mixer_fill_queues (GstGLMixer * mix,
   return 1;
 }
 
+static void
+_profile_begin (GstGLContext * context, GstGLProfileSection ** section)
+{
+  *section = gst_gl_profile_begin (context, "process_textures");
+}
+
+static void
+_profile_end (GstGLContext * context, GstGLProfileSection ** section)
+{
+  gst_gl_profile_end (context, *section);
+}
+
+static void
+_insert_upload_fence (GstGLContext * context, GstGLMixerUploadJob * job)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+
+  if (gl->FenceSync) {
+    job->fence = gl->FenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    /* make sure the fence is eventually signaled without anyone waiting
+     * on it from this context */
+    gl->Flush ();
+  } else {
+    gl->Finish ();
+  }
+}
+
+static void
+_wait_upload_fences (GstGLContext * context, GstGLMixerUploadJob * jobs)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLMixerUploadJob *job;
+
+  for (job = jobs; job->mix; job++) {
+    if (!job->fence)
+      continue;
+
+    gl->WaitSync (job->fence, 0, GL_TIMEOUT_IGNORED);
+    gl->DeleteSync (job->fence);
+    job->fence = NULL;
+  }
+}
+
+static void
+_upload_pad (GstGLMixerUploadJob * job)
+{
+  GstGLMixerPad *pad = job->pad;
+  guint in_tex;
+
+  if (!gst_gl_upload_perform_with_buffer (pad->upload, pad->mixcol->buffer,
+          &in_tex)) {
+    gst_buffer_replace (&pad->uploaded_buffer, NULL);
+    pad->mapped = FALSE;
+    return;
+  }
+  pad->mapped = TRUE;
+
+  /* holding a ref keeps the buffer from being recycled and written to, so
+   * seeing it again means the texture is still up to date */
+  gst_buffer_replace (&pad->uploaded_buffer, pad->mixcol->buffer);
+  pad->uploaded_tex = in_tex;
+
+  GST_TRACE_OBJECT (pad, "uploaded %" GST_PTR_FORMAT " into texture %u",
+      pad->mixcol->buffer, in_tex);
+
+  job->frame->texture = in_tex;
+
+  /* queued behind the upload, the mixing thread waits for it only once all
+   * the pads have been submitted */
+  if (pad->upload->context != job->mix->context)
+    job->fence_id = gst_gl_context_thread_add_async (pad->upload->context,
+        (GstGLContextThreadFunc) _insert_upload_fence, job, NULL);
+}
+
+static void
+_upload_pool_func (GstGLMixerUploadJob * job, GstGLMixer * mix)
+{
+  _upload_pad (job);
+
+  g_mutex_lock (&mix->priv->upload_lock);
+  if (--mix->priv->uploads_pending == 0)
+    g_cond_signal (&mix->priv->upload_cond);
+  g_mutex_unlock (&mix->priv->upload_lock);
+}
+
+/* Each upload is a blocking round trip to the GL thread of its context so
+ * with many inputs the uploads are spread over a few contexts sharing with
+ * mix->context and performed from a pool of threads. */
+static void
+gst_gl_mixer_ensure_upload_contexts (GstGLMixer * mix)
+{
+  GstGLMixerPrivate *priv = mix->priv;
+  GError *error = NULL;
+  guint i;
+
+  if (priv->n_upload_contexts == 0 || priv->upload_contexts
+      || priv->upload_contexts_failed)
+    return;
+
+  priv->upload_contexts = g_new0 (GstGLContext *, priv->n_upload_contexts);
+  priv->upload_contexts_len = priv->n_upload_contexts;
+
+  for (i = 0; i < priv->upload_contexts_len; i++) {
+    priv->upload_contexts[i] = gst_gl_context_new (mix->display);
+    if (!gst_gl_context_create (priv->upload_contexts[i], mix->context,
+            &error)) {
+      GST_WARNING_OBJECT (mix, "failed to create upload context: %s, "
+          "uploading in the mixing context", error->message);
+      g_clear_error (&error);
+      gst_gl_mixer_free_upload_contexts (mix);
+      priv->upload_contexts_failed = TRUE;
+      return;
+    }
+  }
+
+  priv->upload_pool = g_thread_pool_new ((GFunc) _upload_pool_func, mix,
+      priv->upload_contexts_len, TRUE, &error);
+  if (!priv->upload_pool) {
+    GST_WARNING_OBJECT (mix, "failed to create upload threads: %s, "
+        "uploading in the mixing context", error->message);
+    g_clear_error (&error);
+    gst_gl_mixer_free_upload_contexts (mix);
+    priv->upload_contexts_failed = TRUE;
+    return;
+  }
+
+  GST_DEBUG_OBJECT (mix, "uploading with %u shared contexts",
+      priv->upload_contexts_len);
+}
+
+static void
+gst_gl_mixer_free_upload_contexts (GstGLMixer * mix)
+{
+  GstGLMixerPrivate *priv = mix->priv;
+  guint i;
+
+  if (priv->upload_pool) {
+    g_thread_pool_free (priv->upload_pool, FALSE, TRUE);
+    priv->upload_pool = NULL;
+  }
+
+  if (priv->upload_contexts) {
+    for (i = 0; i < priv->upload_contexts_len; i++) {
+      if (priv->upload_contexts[i])
+        gst_object_unref (priv->upload_contexts[i]);
+    }
+    g_free (priv->upload_contexts);
+    priv->upload_contexts = NULL;
+    priv->upload_contexts_len = 0;
+  }
+}
+
 gboolean
 gst_gl_mixer_process_textures (GstGLMixer * mix, GstBuffer * outbuf)
 {
@@ -1528,19 +1895,39 @@ gst_gl_mixer_process_textures (GstGLMixer * mix, GstBuffer * outbuf)
   GSList *walk = mix->sinkpads;
   GstVideoFrame out_frame;
   gboolean out_gl_wrapped = FALSE;
-  guint out_tex;
+  gboolean out_dmabuf = mix->priv->dmabuf_output;
+  guint out_tex = 0;
   guint array_index = 0;
   guint i;
-  gboolean res;
+  gboolean res = TRUE;
+  GstGLProfileSection *section = NULL;
+  GstGLMixerUploadJob *jobs;
+  guint n_jobs;
 
   GST_TRACE ("Processing buffers");
 
-  if (!gst_video_frame_map (&out_frame, &mix->out_info, outbuf,
+  if (out_dmabuf) {
+    guint out_width = GST_VIDEO_INFO_WIDTH (&mix->out_info);
+    guint out_height = GST_VIDEO_INFO_HEIGHT (&mix->out_info);
+
+    if (!mix->download) {
+      mix->download = gst_gl_download_new (mix->context);
+      if (!gst_gl_download_init_format (mix->download, GST_VIDEO_FORMAT_RGBA,
+              out_width, out_height)) {
+        GST_ELEMENT_ERROR (mix, RESOURCE, NOT_FOUND,
+            ("%s", "Failed to init download format"), (NULL));
+        return FALSE;
+      }
+    }
+
+    /* downstream keeps reading from the texture after we return, so every
+     * frame is rendered into its own one */
+    gst_gl_context_gen_texture (mix->context, &out_tex, GST_VIDEO_FORMAT_RGBA,
+        out_width, out_height);
+  } else if (!gst_video_frame_map (&out_frame, &mix->out_info, outbuf,
           GST_MAP_WRITE | GST_MAP_GL)) {
     return FALSE;
-  }
-
-  if (gst_is_gl_memory (out_frame.map[0].memory)) {
+  } else if (gst_is_gl_memory (out_frame.map[0].memory)) {
     out_tex = *(guint *) out_frame.data[0];
   } else {
     GST_INFO ("Output Buffer does not contain correct memory, "
@@ -1564,6 +1951,12 @@ gst_gl_mixer_process_textures (GstGLMixer * mix, GstBuffer * outbuf)
     out_gl_wrapped = TRUE;
   }
 
+  gst_gl_mixer_ensure_upload_contexts (mix);
+
+  /* NULL terminated for _wait_upload_fences () */
+  jobs = g_newa (GstGLMixerUploadJob, mix->frames->len + 1);
+  n_jobs = 0;
+
   while (walk) {                /* We walk with this list because it's ordered */
     GstGLMixerPad *pad = GST_GL_MIXER_PAD (walk->data);
     GstGLMixerCollect *mixcol = pad->mixcol;
@@ -1574,8 +1967,8 @@ gst_gl_mixer_process_textures (GstGLMixer * mix, GstBuffer * outbuf)
       GstClockTime timestamp;
       gint64 stream_time;
       GstSegment *seg;
-      guint in_tex;
       GstGLMixerFrameData *frame;
+      GstGLMixerUploadJob *job;
 
       frame = g_ptr_array_index (mix->frames, array_index);
       frame->pad = pad;
@@ -1593,33 +1986,105 @@ gst_gl_mixer_process_textures (GstGLMixer * mix, GstBuffer * outbuf)
         gst_object_sync_values (GST_OBJECT (pad), stream_time);
 
       if (!pad->upload) {
-        pad->upload = gst_gl_upload_new (mix->context);
+        GstGLContext *context = mix->context;
+
+        /* spread the pads over the upload contexts */
+        if (mix->priv->upload_pool)
+          context = mix->priv->upload_contexts[array_index %
+              mix->priv->upload_contexts_len];
+
+        pad->upload = gst_gl_upload_new (context);
 
         if (!gst_gl_upload_init_format (pad->upload, pad->in_info,
                 mix->out_info)) {
           GST_ELEMENT_ERROR (mix, RESOURCE, NOT_FOUND, ("%s",
                   "Failed to init upload format"), (NULL));
           res = FALSE;
-          goto out;
+          /* wait for the uploads already started */
+          break;
         }
       }
 
-      if (!gst_gl_upload_perform_with_buffer (pad->upload, mixcol->buffer,
-              &in_tex)) {
+      if (pad->uploaded_buffer == mixcol->buffer) {
+        GST_TRACE_OBJECT (pad, "reusing the texture of %" GST_PTR_FORMAT,
+            mixcol->buffer);
+        frame->texture = pad->uploaded_tex;
         ++array_index;
-        pad->mapped = FALSE;
         continue;
       }
-      pad->mapped = TRUE;
 
-      frame->texture = in_tex;
+      job = &jobs[n_jobs++];
+      job->mix = mix;
+      job->pad = pad;
+      job->frame = frame;
+      job->fence = NULL;
+      job->fence_id = 0;
+
+      if (mix->priv->upload_pool) {
+        g_mutex_lock (&mix->priv->upload_lock);
+        mix->priv->uploads_pending++;
+        g_mutex_unlock (&mix->priv->upload_lock);
+
+        g_thread_pool_push (mix->priv->upload_pool, job, NULL);
+      } else {
+        _upload_pad (job);
+      }
     }
     ++array_index;
   }
 
+  if (mix->priv->upload_pool) {
+    g_mutex_lock (&mix->priv->upload_lock);
+    while (mix->priv->uploads_pending > 0)
+      g_cond_wait (&mix->priv->upload_cond, &mix->priv->upload_lock);
+    g_mutex_unlock (&mix->priv->upload_lock);
+
+    for (i = 0; i < n_jobs; i++) {
+      if (jobs[i].fence_id)
+        gst_gl_context_thread_wait (jobs[i].pad->upload->context,
+            jobs[i].fence_id);
+    }
+
+    /* the mixing context only waits for the uploads on the GPU */
+    jobs[n_jobs].mix = NULL;
+    gst_gl_context_thread_add (mix->context,
+        (GstGLContextThreadFunc) _wait_upload_fences, jobs);
+  }
+
+  if (!res)
+    goto out;
+
+  /* the section has to be started and ended in the gl thread, only pay for
+   * the round trips when profiling */
+  if (gst_gl_profile_enabled ())
+    gst_gl_context_thread_add (mix->context,
+        (GstGLContextThreadFunc) _profile_begin, &section);
+
   mix_class->process_textures (mix, mix->frames, out_tex);
 
-  if (out_gl_wrapped) {
+  if (section)
+    gst_gl_context_thread_add (mix->context,
+        (GstGLContextThreadFunc) _profile_end, &section);
+
+  if (out_dmabuf) {
+    /* consumes out_tex */
+    res = gst_gl_download_perform_with_dmabuf (mix->download, out_tex, outbuf);
+    out_tex = 0;
+    if (!res) {
+      /* stop offering dmabuf and go back to system memory, the frame is
+       * dropped by gst_gl_mixer_collected() */
+      GST_WARNING_OBJECT (mix, "Failed to export video frame, renegotiating");
+      mix->priv->dmabuf_export = FALSE;
+      gst_pad_mark_reconfigure (mix->srcpad);
+      goto out;
+    }
+  } else if (!out_gl_wrapped) {
+    GstGLSyncMeta *sync_meta = gst_buffer_get_gl_sync_meta (outbuf);
+
+    if (!sync_meta)
+      sync_meta = gst_buffer_add_gl_sync_meta (mix->context, outbuf);
+    gst_gl_sync_meta_set_sync_point (sync_meta, mix->context);
+  } else {
     if (gst_gl_download_perform_with_data (mix->download, out_tex,
             out_frame.data)) {
       GST_ELEMENT_ERROR (mix, RESOURCE, NOT_FOUND, ("%s",
@@ -1643,7 +2108,12 @@ out:
     i++;
   }
 
-  gst_video_frame_unmap (&out_frame);
+  if (out_dmabuf) {
+    if (out_tex)
+      gst_gl_context_del_texture (mix->context, &out_tex);
+  } else {
+    gst_video_frame_unmap (&out_frame);
+  }
 
   return res;
 }
@@ -1735,6 +2205,7 @@ gst_gl_mixer_collected (GstCollectPads * pads, GstGLMixer * mix)
   GstFlowReturn ret;
   GstClockTime output_start_time, output_end_time;
   GstBuffer *outbuf = NULL;
+  const gchar *owner;
   gint res;
   gint64 jitter;
 
@@ -1748,6 +2219,10 @@ gst_gl_mixer_collected (GstCollectPads * pads, GstGLMixer * mix)
     return GST_FLOW_NOT_NEGOTIATED;
   }
 
+  /* downstream asked for it or dmabuf support changed */
+  if (gst_pad_check_reconfigure (mix->srcpad))
+    gst_gl_mixer_update_src_caps (mix);
+
   if (g_atomic_int_compare_and_exchange (&mix->flush_stop_pending, TRUE, FALSE)) {
     GST_DEBUG_OBJECT (mix, "pending flush stop");
     gst_pad_push_event (mix->srcpad, gst_event_new_flush_stop (TRUE));
@@ -1807,20 +2282,25 @@ gst_gl_mixer_collected (GstCollectPads * pads, GstGLMixer * mix)
   jitter = gst_gl_mixer_do_qos (mix, output_start_time);
   if (jitter <= 0) {
 
-    if (!mix->priv->pool_active) {
-      if (!gst_buffer_pool_set_active (mix->priv->pool, TRUE)) {
-        GST_ELEMENT_ERROR (mix, RESOURCE, SETTINGS,
-            ("failed to activate bufferpool"),
-            ("failed to activate bufferpool"));
-        ret = GST_FLOW_ERROR;
-        goto error;
+    if (mix->priv->dmabuf_output) {
+      /* the exported memory is added by gst_gl_mixer_process_textures() */
+      outbuf = gst_buffer_new ();
+    } else {
+      if (!mix->priv->pool_active) {
+        if (!gst_buffer_pool_set_active (mix->priv->pool, TRUE)) {
+          GST_ELEMENT_ERROR (mix, RESOURCE, SETTINGS,
+              ("failed to activate bufferpool"),
+              ("failed to activate bufferpool"));
+          ret = GST_FLOW_ERROR;
+          goto error;
+        }
+        mix->priv->pool_active = TRUE;
       }
-      mix->priv->pool_active = TRUE;
-    }
 
-    ret = gst_buffer_pool_acquire_buffer (mix->priv->pool, &outbuf, NULL);
-    if (ret != GST_FLOW_OK)
-      goto error;
+      ret = gst_buffer_pool_acquire_buffer (mix->priv->pool, &outbuf, NULL);
+      if (ret != GST_FLOW_OK)
+        goto error;
+    }
 
     GST_BUFFER_TIMESTAMP (outbuf) = output_start_time;
     GST_BUFFER_DURATION (outbuf) = output_end_time - output_start_time;
@@ -1831,10 +2311,20 @@ gst_gl_mixer_collected (GstCollectPads * pads, GstGLMixer * mix)
       goto error;
     }
 
-    if (mix_class->process_buffers)
+    owner = gst_gl_profile_push_owner (GST_OBJECT (mix));
+
+    if (mix_class->process_buffers) {
       gst_gl_mixer_process_buffers (mix, outbuf);
-    else if (mix_class->process_textures)
-      gst_gl_mixer_process_textures (mix, outbuf);
+    } else if (mix_class->process_textures) {
+      if (!gst_gl_mixer_process_textures (mix, outbuf)
+          && mix->priv->dmabuf_output && !mix->priv->dmabuf_export) {
+        /* the export failed, nothing was attached to @outbuf */
+        gst_buffer_unref (outbuf);
+        outbuf = NULL;
+      }
+    }
+
+    gst_gl_profile_set_owner (owner);
 
     mix->qos_processed++;
   } else {
@@ -2165,7 +2655,12 @@ static void
 gst_gl_mixer_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
+  GstGLMixer *mix = GST_GL_MIXER (object);
+
   switch (prop_id) {
+    case PROP_UPLOAD_CONTEXTS:
+      g_value_set_uint (value, mix->priv->n_upload_contexts);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2176,7 +2671,13 @@ static void
 gst_gl_mixer_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
+  GstGLMixer *mix = GST_GL_MIXER (object);
+
   switch (prop_id) {
+    case PROP_UPLOAD_CONTEXTS:
+      /* only picked up when the upload contexts are created */
+      mix->priv->n_upload_contexts = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2248,10 +2749,14 @@ gst_gl_mixer_change_state (GstElement * element, GstStateChange transition)
           gst_object_unref (pad->upload);
           pad->upload = NULL;
         }
+        gst_buffer_replace (&pad->uploaded_buffer, NULL);
 
         walk = walk->next;
       }
 
+      gst_gl_mixer_free_upload_contexts (mix);
+      mix->priv->upload_contexts_failed = FALSE;
+
       if (mix->priv->query) {
         gst_query_unref (mix->priv->query);
         mix->priv->query = NULL;
@@ -2271,6 +2776,7 @@ gst_gl_mixer_change_state (GstElement * element, GstStateChange transition)
         gst_object_unref (mix->context);
         mix->context = NULL;
       }
+      mix->priv->dmabuf_export = FALSE;
       break;
     }
     default:
@@ -61,12 +61,24 @@ struct _GstGLMixerPad
 {
   GstPad parent;                /* subclass the pad */
 
+  /* rectangle of the output the stream is scaled into, a size of 0 keeps
+   * the size of the input */
+  gint xpos, ypos;
+  gint width, height;
+  guint zorder;
+  gdouble alpha;
+
   /* <private> */
   GstGLUpload *upload;
   GstVideoInfo in_info;
   guint in_tex_id;
   gboolean mapped;
 
+  /* the last buffer uploaded and its texture, reused while the pad keeps
+   * the same buffer */
+  GstBuffer *uploaded_buffer;
+  guint uploaded_tex;
+
   GstGLMixerCollect *mixcol;
 };
 
@@ -0,0 +1,313 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdarg.h>
+
+#include "gl.h"
+#include "gstglprofile.h"
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (gst_gl_profile_debug);
+#define GST_CAT_DEFAULT gst_gl_profile_debug
+
+/* Each section records a GL_TIMESTAMP query before and after the pass.  The
+ * results are only read back once the GPU signals that they are available,
+ * usually a few frames later, so profiling never stalls the pipeline.  When
+ * more than MAX_PENDING_SECTIONS are waiting for their results, new sections
+ * only measure the CPU time. */
+#define MAX_PENDING_SECTIONS 64
+
+struct _GstGLProfileSection
+{
+  const gchar *owner;
+  gchar *pass;
+
+  GLuint queries[2];
+  gint64 cpu_start;
+  gint64 cpu_end;
+};
+
+typedef struct
+{
+  /* ended sections waiting for their query results, oldest first */
+  GQueue pending;
+  /* query objects ready for reuse */
+  GArray *free_queries;
+} GstGLProfiler;
+
+/* the element on whose behalf the current thread is doing GL work */
+static GPrivate current_owner;
+
+static void
+_init_debug (void)
+{
+  static volatile gsize _init = 0;
+
+  if (g_once_init_enter (&_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_gl_profile_debug, "glprofile", 0,
+        "OpenGL pass profiling");
+    g_once_init_leave (&_init, 1);
+  }
+}
+
+static void
+_free_section (GstGLProfileSection * section)
+{
+  g_free (section->pass);
+  g_slice_free (GstGLProfileSection, section);
+}
+
+static void
+_free_profiler (GstGLProfiler * profiler)
+{
+  /* the query objects themselves go away with the context */
+  g_queue_foreach (&profiler->pending, (GFunc) _free_section, NULL);
+  g_queue_clear (&profiler->pending);
+  g_array_free (profiler->free_queries, TRUE);
+  g_slice_free (GstGLProfiler, profiler);
+}
+
+/* Called in the gl thread */
+static GstGLProfiler *
+_get_profiler (GstGLContext * context)
+{
+  GQuark quark = g_quark_from_static_string ("GstGLProfiler");
+  GstGLProfiler *profiler;
+
+  profiler = g_object_get_qdata (G_OBJECT (context), quark);
+  if (!profiler) {
+    profiler = g_slice_new0 (GstGLProfiler);
+    g_queue_init (&profiler->pending);
+    profiler->free_queries = g_array_new (FALSE, FALSE, sizeof (GLuint));
+    g_object_set_qdata_full (G_OBJECT (context), quark, profiler,
+        (GDestroyNotify) _free_profiler);
+  }
+
+  return profiler;
+}
+
+static void
+_report (GstGLProfileSection * section, GstClockTime gpu_time)
+{
+  GstClockTime cpu_time =
+      (section->cpu_end - section->cpu_start) * GST_USECOND;
+
+  if (GST_CLOCK_TIME_IS_VALID (gpu_time)) {
+    GST_TRACE ("owner:%s pass:%s cpu:%" G_GUINT64_FORMAT " gpu:%"
+        G_GUINT64_FORMAT, section->owner ? section->owner : "(none)",
+        section->pass, cpu_time, gpu_time);
+  } else {
+    GST_TRACE ("owner:%s pass:%s cpu:%" G_GUINT64_FORMAT " gpu:-",
+        section->owner ? section->owner : "(none)", section->pass, cpu_time);
+  }
+}
+
+/* Called in the gl thread.  Reports every section whose results arrived */
+static void
+_collect (GstGLContext * context, GstGLProfiler * profiler)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLProfileSection *section;
+  GLuint64 start, end;
+  GLuint available;
+
+  while ((section = g_queue_peek_head (&profiler->pending))) {
+    available = 0;
+    gl->GetQueryObjectuiv (section->queries[1], GL_QUERY_RESULT_AVAILABLE,
+        &available);
+    /* the queries complete in order */
+    if (!available)
+      break;
+
+    gl->GetQueryObjectui64v (section->queries[0], GL_QUERY_RESULT, &start);
+    gl->GetQueryObjectui64v (section->queries[1], GL_QUERY_RESULT, &end);
+
+    _report (section, end - start);
+
+    g_array_append_vals (profiler->free_queries, section->queries, 2);
+    g_queue_pop_head (&profiler->pending);
+    _free_section (section);
+  }
+}
+
+/*
+ * gst_gl_profile_enabled:
+ *
+ * Returns: whether GL passes are currently being profiled
+ */
+gboolean
+gst_gl_profile_enabled (void)
+{
+#ifndef GST_DISABLE_GST_DEBUG
+  _init_debug ();
+
+  return gst_debug_category_get_threshold (gst_gl_profile_debug) >=
+      GST_LEVEL_TRACE;
+#else
+  return FALSE;
+#endif
+}
+
+/*
+ * gst_gl_profile_get_owner:
+ *
+ * Returns: the name of the element the calling thread is working for
+ */
+const gchar *
+gst_gl_profile_get_owner (void)
+{
+  return g_private_get (&current_owner);
+}
+
+/*
+ * gst_gl_profile_set_owner:
+ * @owner: an interned string or %NULL
+ *
+ * Sets the name the sections started from the calling thread are attributed
+ * to.  gst_gl_context_thread_add() carries it over to the GL thread.
+ *
+ * Returns: the previous owner, to be restored with this function
+ */
+const gchar *
+gst_gl_profile_set_owner (const gchar * owner)
+{
+  const gchar *prev = g_private_get (&current_owner);
+
+  g_private_set (&current_owner, (gpointer) owner);
+
+  return prev;
+}
+
+/*
+ * gst_gl_profile_push_owner:
+ * @owner: a #GstObject
+ *
+ * Attributes the sections started from the calling thread to @owner if
+ * profiling is enabled.
+ *
+ * Returns: the previous owner, to be restored with
+ * gst_gl_profile_set_owner()
+ */
+const gchar *
+gst_gl_profile_push_owner (GstObject * owner)
+{
+  if (!gst_gl_profile_enabled ())
+    return gst_gl_profile_get_owner ();
+
+  return gst_gl_profile_set_owner (g_intern_string (GST_OBJECT_NAME (owner)));
+}
+
+/*
+ * gst_gl_profile_begin:
+ * @context: a #GstGLContext
+ * @format: printf style name of the pass
+ *
+ * Starts measuring a pass.  Sections may be nested.
+ *
+ * Must be called in the GL thread.
+ *
+ * Returns: the section to pass to gst_gl_profile_end() or %NULL if
+ * profiling is disabled
+ */
+GstGLProfileSection *
+gst_gl_profile_begin (GstGLContext * context, const gchar * format, ...)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLProfileSection *section;
+  GstGLProfiler *profiler;
+  va_list args;
+
+  if (!gst_gl_profile_enabled ())
+    return NULL;
+
+  profiler = _get_profiler (context);
+
+  section = g_slice_new0 (GstGLProfileSection);
+  section->owner = gst_gl_profile_get_owner ();
+  va_start (args, format);
+  section->pass = g_strdup_vprintf (format, args);
+  va_end (args);
+
+  if (gl->GenQueries && gl->GetQueryObjectuiv && gl->QueryCounter
+      && gl->GetQueryObjectui64v && profiler->pending.length < MAX_PENDING_SECTIONS) {
+    if (profiler->free_queries->len >= 2) {
+      guint len = profiler->free_queries->len;
+
+      section->queries[0] = g_array_index (profiler->free_queries, GLuint,
+          len - 2);
+      section->queries[1] = g_array_index (profiler->free_queries, GLuint,
+          len - 1);
+      g_array_set_size (profiler->free_queries, len - 2);
+    } else {
+      gl->GenQueries (2, section->queries);
+    }
+
+    gl->QueryCounter (section->queries[0], GL_TIMESTAMP);
+  }
+
+  section->cpu_start = g_get_monotonic_time ();
+
+  return section;
+}
+
+/*
+ * gst_gl_profile_end:
+ * @context: a #GstGLContext
+ * @section: (allow-none): a section returned by gst_gl_profile_begin()
+ *
+ * Finishes measuring @section.  Its GPU time is reported once available.
+ *
+ * Must be called in the GL thread.
+ */
+void
+gst_gl_profile_end (GstGLContext * context, GstGLProfileSection * section)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLProfiler *profiler;
+
+  if (!section)
+    return;
+
+  section->cpu_end = g_get_monotonic_time ();
+  profiler = _get_profiler (context);
+
+  if (section->queries[0]) {
+    gl->QueryCounter (section->queries[1], GL_TIMESTAMP);
+    g_queue_push_tail (&profiler->pending, section);
+  } else {
+    _report (section, GST_CLOCK_TIME_NONE);
+    _free_section (section);
+  }
+
+  _collect (context, profiler);
+}
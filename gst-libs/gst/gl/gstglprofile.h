@@ -0,0 +1,45 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_GL_PROFILE_H__
+#define __GST_GL_PROFILE_H__
+
+#include <gst/gl/gl.h>
+
+G_BEGIN_DECLS
+
+/* Internal to the library.  Measures the CPU and GPU time spent in the
+ * GL passes and reports it in the glprofile debug category at the TRACE
+ * level, i.e. GST_DEBUG=glprofile:7.  Nothing is measured otherwise. */
+
+typedef struct _GstGLProfileSection GstGLProfileSection;
+
+gboolean              gst_gl_profile_enabled    (void);
+
+const gchar *         gst_gl_profile_get_owner  (void);
+const gchar *         gst_gl_profile_set_owner  (const gchar * owner);
+const gchar *         gst_gl_profile_push_owner (GstObject * owner);
+
+GstGLProfileSection * gst_gl_profile_begin      (GstGLContext * context, const gchar * format, ...) G_GNUC_PRINTF (2, 3);
+void                  gst_gl_profile_end        (GstGLContext * context, GstGLProfileSection * section);
+
+G_END_DECLS
+
+#endif /* __GST_GL_PROFILE_H__ */
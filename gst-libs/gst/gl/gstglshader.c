@@ -22,12 +22,35 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include "gl.h"
 #include "gstglshader.h"
 
 #ifndef GL_COMPILE_STATUS
 #define GL_COMPILE_STATUS             0x8B81
 #endif
+#ifndef GL_ACTIVE_UNIFORMS
+#define GL_ACTIVE_UNIFORMS            0x8B86
+#endif
+#ifndef GL_ACTIVE_UNIFORM_MAX_LENGTH
+#define GL_ACTIVE_UNIFORM_MAX_LENGTH  0x8B87
+#endif
+#ifndef GL_ACTIVE_ATTRIBUTES
+#define GL_ACTIVE_ATTRIBUTES          0x8B89
+#endif
+#ifndef GL_ACTIVE_ATTRIBUTE_MAX_LENGTH
+#define GL_ACTIVE_ATTRIBUTE_MAX_LENGTH 0x8B8A
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH      0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
 #ifndef GLhandleARB
 #define GLhandleARB GLuint
 #endif
@@ -71,6 +94,53 @@ enum
   PROP_ACTIVE                   /* unused */
 };
 
+/* identifies which setter last wrote a uniform so that e.g. a 2f write is
+ * never mistaken for an identical 1fv write of the same bytes */
+enum
+{
+  UNIFORM_1F = 1,
+  UNIFORM_1FV,
+  UNIFORM_1I,
+  UNIFORM_1IV,
+  UNIFORM_2F,
+  UNIFORM_2FV,
+  UNIFORM_2I,
+  UNIFORM_2IV,
+  UNIFORM_3F,
+  UNIFORM_3FV,
+  UNIFORM_3I,
+  UNIFORM_3IV,
+  UNIFORM_4F,
+  UNIFORM_4FV,
+  UNIFORM_4I,
+  UNIFORM_4IV,
+  UNIFORM_MATRIX_2FV,
+  UNIFORM_MATRIX_3FV,
+  UNIFORM_MATRIX_4FV,
+  UNIFORM_MATRIX_2X3FV,
+  UNIFORM_MATRIX_2X4FV,
+  UNIFORM_MATRIX_3X2FV,
+  UNIFORM_MATRIX_3X4FV,
+  UNIFORM_MATRIX_4X2FV,
+  UNIFORM_MATRIX_4X3FV,
+
+  UNIFORM_TRANSPOSED = 0x100
+};
+
+/* large enough for a mat4, bigger values are always written */
+#define MAX_CACHED_UNIFORM_SIZE (16 * sizeof (gfloat))
+
+typedef struct _GstGLShaderUniform
+{
+  GLint location;
+
+  /* last value written through this shader */
+  gboolean valid;
+  guint tag;
+  gsize size;
+  guint8 value[MAX_CACHED_UNIFORM_SIZE];
+} GstGLShaderUniform;
+
 struct _GstGLShaderPrivate
 {
   gchar *vertex_src;
@@ -83,6 +153,14 @@ struct _GstGLShaderPrivate
   gboolean compiled;
   gboolean active;
 
+  /* handed out by gst_gl_shader_new_cached(), sources must not change */
+  gboolean shared;
+
+  /* name -> GstGLShaderUniform, filled at link time */
+  GHashTable *uniforms;
+  /* name -> attribute location */
+  GHashTable *attributes;
+
   GstGLShaderVTable vtable;
 };
 
@@ -136,6 +214,9 @@ gst_gl_shader_finalize (GObject * object)
   priv->vertex_handle = 0;
   priv->program_handle = 0;
 
+  g_hash_table_destroy (priv->uniforms);
+  g_hash_table_destroy (priv->attributes);
+
   if (shader->context) {
     gst_object_unref (shader->context);
     shader->context = NULL;
@@ -236,6 +317,8 @@ gst_gl_shader_set_vertex_source (GstGLShader * shader, const gchar * src)
 
   priv = shader->priv;
 
+  g_return_if_fail (!priv->shared);
+
   if (gst_gl_shader_is_compiled (shader))
     gst_gl_shader_release (shader);
 
@@ -254,6 +337,8 @@ gst_gl_shader_set_fragment_source (GstGLShader * shader, const gchar * src)
 
   priv = shader->priv;
 
+  g_return_if_fail (!priv->shared);
+
   if (gst_gl_shader_is_compiled (shader))
     gst_gl_shader_release (shader);
 
@@ -276,6 +361,148 @@ gst_gl_shader_get_fragment_source (GstGLShader * shader)
   return shader->priv->fragment_src;
 }
 
+static void
+_free_uniform (GstGLShaderUniform * uniform)
+{
+  g_slice_free (GstGLShaderUniform, uniform);
+}
+
+static GstGLShaderUniform *
+_add_uniform (GstGLShader * shader, const gchar * name, GLint location)
+{
+  GstGLShaderUniform *uniform = g_slice_new0 (GstGLShaderUniform);
+
+  uniform->location = location;
+  g_hash_table_insert (shader->priv->uniforms, g_strdup (name), uniform);
+
+  return uniform;
+}
+
+static GstGLShaderUniform *
+_get_uniform (GstGLShader * shader, const gchar * name)
+{
+  GstGLShaderPrivate *priv = shader->priv;
+  GstGLShaderUniform *uniform;
+
+  uniform = g_hash_table_lookup (priv->uniforms, name);
+  if (!uniform) {
+    /* not reported as active (e.g. optimized out), remember the answer so
+     * we only ask once */
+    GstGLFuncs *gl = shader->context->gl_vtable;
+    GLint location = gl->GetUniformLocation (priv->program_handle, name);
+
+    GST_TRACE ("uniform '%s' not in cache, location %i", name, location);
+    uniform = _add_uniform (shader, name, location);
+  }
+
+  return uniform;
+}
+
+/* Returns whether @value differs from the value last written to @uniform
+ * and if so, records it as the current one */
+static gboolean
+_uniform_changed (GstGLShaderUniform * uniform, guint tag,
+    gconstpointer value, gsize size)
+{
+  /* writes to location -1 are silently ignored by GL */
+  if (uniform->location == -1)
+    return FALSE;
+
+  if (size > MAX_CACHED_UNIFORM_SIZE) {
+    uniform->valid = FALSE;
+    return TRUE;
+  }
+
+  if (uniform->valid && uniform->tag == tag && uniform->size == size
+      && memcmp (uniform->value, value, size) == 0)
+    return FALSE;
+
+  memcpy (uniform->value, value, size);
+  uniform->tag = tag;
+  uniform->size = size;
+  uniform->valid = TRUE;
+
+  return TRUE;
+}
+
+static void
+_introspect_program (GstGLShader * shader)
+{
+  GstGLShaderPrivate *priv = shader->priv;
+  GstGLFuncs *gl = shader->context->gl_vtable;
+  GLint n_uniforms = 0, n_attributes = 0, max_length = 0;
+  gchar *name;
+  GLint i;
+
+  if (gl->GetActiveUniform) {
+    priv->vtable.GetProgramiv (priv->program_handle, GL_ACTIVE_UNIFORMS,
+        &n_uniforms);
+    priv->vtable.GetProgramiv (priv->program_handle,
+        GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    name = g_malloc0 (MAX (max_length, 1) + 1);
+    for (i = 0; i < n_uniforms; i++) {
+      GLsizei len = 0;
+      GLint size;
+      GLenum type;
+      GLint location;
+      gchar *bracket;
+
+      gl->GetActiveUniform (priv->program_handle, i, MAX (max_length, 1) + 1,
+          &len, &size, &type, name);
+      if (len <= 0)
+        continue;
+      name[len] = '\0';
+
+      location = gl->GetUniformLocation (priv->program_handle, name);
+      _add_uniform (shader, name, location);
+
+      /* arrays are reported as "name[0]" but are usually set as "name" */
+      if ((bracket = strstr (name, "[0]")) && bracket[3] == '\0') {
+        *bracket = '\0';
+        _add_uniform (shader, name, location);
+      }
+
+      GST_TRACE ("shader %u uniform '%s' at %i", priv->program_handle,
+          name, location);
+    }
+    g_free (name);
+  }
+
+  if (gl->GetActiveAttrib) {
+    max_length = 0;
+    priv->vtable.GetProgramiv (priv->program_handle, GL_ACTIVE_ATTRIBUTES,
+        &n_attributes);
+    priv->vtable.GetProgramiv (priv->program_handle,
+        GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+
+    name = g_malloc0 (MAX (max_length, 1) + 1);
+    for (i = 0; i < n_attributes; i++) {
+      GLsizei len = 0;
+      GLint size;
+      GLenum type;
+      GLint location;
+
+      gl->GetActiveAttrib (priv->program_handle, i, MAX (max_length, 1) + 1,
+          &len, &size, &type, name);
+      if (len <= 0)
+        continue;
+      name[len] = '\0';
+
+      location = gl->GetAttribLocation (priv->program_handle, name);
+      g_hash_table_insert (priv->attributes, g_strdup (name),
+          GINT_TO_POINTER (location));
+
+      GST_TRACE ("shader %u attribute '%s' at %i", priv->program_handle,
+          name, location);
+    }
+    g_free (name);
+  }
+
+  GST_DEBUG ("shader %u has %i active uniforms and %i active attributes",
+      priv->program_handle, n_uniforms, n_attributes);
+}
+
 static void
 gst_gl_shader_init (GstGLShader * self)
 {
@@ -292,6 +519,11 @@ gst_gl_shader_init (GstGLShader * self)
 
   priv->compiled = FALSE;
   priv->active = FALSE;         /* unused at the moment */
+
+  priv->uniforms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) _free_uniform);
+  priv->attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
 }
 
 gboolean
@@ -352,6 +584,335 @@ gst_gl_shader_new (GstGLContext * context)
   return shader;
 }
 
+typedef struct
+{
+  GMutex lock;
+  /* hash of the sources -> GWeakRef to a compiled GstGLShader */
+  GHashTable *shaders;
+
+  /* where on-disk program binaries are stored and the driver that produced
+   * them, or NULL if they are not used */
+  gchar *binary_dir;
+  gchar *driver_id;
+} GstGLShaderCache;
+
+/* on-disk program binaries are stored as the magic, the binary format as
+ * a native endian guint32 and then the binary itself */
+#define PROGRAM_BINARY_MAGIC "GSTGLPB1"
+#define PROGRAM_BINARY_HEADER_SIZE 12
+
+static void
+_free_weak_ref (GWeakRef * ref)
+{
+  g_weak_ref_clear (ref);
+  g_slice_free (GWeakRef, ref);
+}
+
+static void
+_free_shader_cache (GstGLShaderCache * cache)
+{
+  g_hash_table_destroy (cache->shaders);
+  g_free (cache->binary_dir);
+  g_free (cache->driver_id);
+  g_mutex_clear (&cache->lock);
+  g_slice_free (GstGLShaderCache, cache);
+}
+
+/* The on-disk program binary cache is only used when GST_GL_SHADER_CACHE is
+ * set, to 1 for the default location in the user cache directory or to the
+ * directory to use */
+static gchar *
+_get_binary_dir (void)
+{
+  const gchar *env = g_getenv ("GST_GL_SHADER_CACHE");
+
+  if (!env || !*env || g_strcmp0 (env, "0") == 0)
+    return NULL;
+
+  if (g_strcmp0 (env, "1") == 0)
+    return g_build_filename (g_get_user_cache_dir (), "gstreamer-1.0",
+        "gl-programs", NULL);
+
+  return g_strdup (env);
+}
+
+/* Called in the gl thread */
+static gchar *
+_get_driver_id (GstGLContext * context)
+{
+  GstGLFuncs *gl = context->gl_vtable;
+  GLint n_formats = 0;
+
+  if (!gl->CreateProgram || !gl->GetProgramBinary || !gl->ProgramBinary)
+    return NULL;
+
+  /* some drivers expose the entry points but no format to use with them */
+  gl->GetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  if (n_formats <= 0)
+    return NULL;
+
+  return g_strdup_printf ("%u\n%s\n%s\n%s\n%s",
+      gst_gl_context_get_gl_api (context),
+      (const gchar *) gl->GetString (GL_VENDOR),
+      (const gchar *) gl->GetString (GL_RENDERER),
+      (const gchar *) gl->GetString (GL_VERSION),
+      (const gchar *) gl->GetString (GL_SHADING_LANGUAGE_VERSION));
+}
+
+/* Called in the gl thread */
+static GstGLShaderCache *
+_get_shader_cache (GstGLContext * context)
+{
+  static GMutex cache_lock;
+  GQuark quark = g_quark_from_static_string ("GstGLShaderCache");
+  GstGLShaderCache *cache;
+
+  g_mutex_lock (&cache_lock);
+  cache = g_object_get_qdata (G_OBJECT (context), quark);
+  if (!cache) {
+    cache = g_slice_new0 (GstGLShaderCache);
+    g_mutex_init (&cache->lock);
+    cache->shaders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) _free_weak_ref);
+    cache->binary_dir = _get_binary_dir ();
+    if (cache->binary_dir)
+      cache->driver_id = _get_driver_id (context);
+    GST_DEBUG ("program binaries are %s",
+        cache->driver_id ? "enabled" : "disabled");
+    g_object_set_qdata_full (G_OBJECT (context), quark, cache,
+        (GDestroyNotify) _free_shader_cache);
+  }
+  g_mutex_unlock (&cache_lock);
+
+  return cache;
+}
+
+static gchar *
+_hash_shader_sources (GstGLContext * context, const gchar * driver_id,
+    const gchar * vertex_src, const gchar * fragment_src)
+{
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  guint32 api = gst_gl_context_get_gl_api (context);
+  gchar *ret;
+
+  if (driver_id)
+    g_checksum_update (checksum, (const guchar *) driver_id,
+        strlen (driver_id) + 1);
+  /* a leading tag keeps (NULL, "x") and ("x", NULL) apart */
+  g_checksum_update (checksum, (const guchar *) &api, sizeof (api));
+  g_checksum_update (checksum, (const guchar *) (vertex_src ? "v" : "-"), 1);
+  if (vertex_src)
+    g_checksum_update (checksum, (const guchar *) vertex_src,
+        strlen (vertex_src) + 1);
+  g_checksum_update (checksum, (const guchar *) (fragment_src ? "f" : "-"), 1);
+  if (fragment_src)
+    g_checksum_update (checksum, (const guchar *) fragment_src,
+        strlen (fragment_src) + 1);
+
+  ret = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return ret;
+}
+
+/**
+ * gst_gl_shader_new_cached:
+ * @context: a #GstGLContext
+ * @vertex_src: (allow-none): the vertex shader source
+ * @fragment_src: (allow-none): the fragment shader source
+ * @error: a #GError or %NULL
+ *
+ * Retrieves a compiled shader for the given sources, reusing the one that
+ * was previously built for the same sources in @context if it is still
+ * alive.  The returned shader is shared between all the callers so its
+ * sources must not be changed.
+ *
+ * The uniforms belong to the shared program, not to the caller: values set
+ * by one user, sampler units included, are still there when the next user
+ * draws with it.  A user therefore has to set every uniform its draw reads
+ * each time before drawing and must not rely on the initial values of a
+ * freshly linked program.
+ *
+ * Must be called in @context's GL thread.
+ *
+ * Returns: (transfer full): a compiled #GstGLShader or %NULL on error
+ */
+GstGLShader *
+gst_gl_shader_new_cached (GstGLContext * context, const gchar * vertex_src,
+    const gchar * fragment_src, GError ** error)
+{
+  GstGLShaderCache *cache;
+  GstGLShader *shader;
+  GWeakRef *ref;
+  gchar *key;
+
+  g_return_val_if_fail (GST_GL_IS_CONTEXT (context), NULL);
+  g_return_val_if_fail (vertex_src != NULL || fragment_src != NULL, NULL);
+
+  cache = _get_shader_cache (context);
+  key = _hash_shader_sources (context, NULL, vertex_src, fragment_src);
+
+  g_mutex_lock (&cache->lock);
+
+  ref = g_hash_table_lookup (cache->shaders, key);
+  /* NULL if the last user went away */
+  if (ref && (shader = g_weak_ref_get (ref))) {
+    g_mutex_unlock (&cache->lock);
+    GST_TRACE ("reusing shader %u for %s", shader->priv->program_handle, key);
+    g_free (key);
+    return shader;
+  }
+
+  shader = gst_gl_shader_new (context);
+  if (vertex_src)
+    gst_gl_shader_set_vertex_source (shader, vertex_src);
+  if (fragment_src)
+    gst_gl_shader_set_fragment_source (shader, fragment_src);
+
+  if (!gst_gl_shader_compile (shader, error)) {
+    g_mutex_unlock (&cache->lock);
+    if (error && !*error)
+      g_set_error (error, GST_GL_SHADER_ERROR, GST_GL_SHADER_ERROR_PROGRAM,
+          "Failed to create shader program");
+    gst_object_unref (shader);
+    g_free (key);
+    return NULL;
+  }
+  shader->priv->shared = TRUE;
+
+  GST_DEBUG ("adding shader %u as %s", shader->priv->program_handle, key);
+
+  if (!ref) {
+    ref = g_slice_new0 (GWeakRef);
+    g_weak_ref_init (ref, shader);
+    g_hash_table_insert (cache->shaders, key, ref);
+  } else {
+    g_weak_ref_set (ref, shader);
+    g_free (key);
+  }
+
+  g_mutex_unlock (&cache->lock);
+
+  return shader;
+}
+
+/* Called in the gl thread.  Returns where the binary for @shader's sources
+ * lives or NULL if program binaries are not in use */
+static gchar *
+_get_program_binary_path (GstGLShader * shader)
+{
+  GstGLShaderPrivate *priv = shader->priv;
+  GstGLShaderCache *cache = _get_shader_cache (shader->context);
+  gchar *key, *filename, *path;
+
+  if (!cache->driver_id)
+    return NULL;
+
+  key = _hash_shader_sources (shader->context, cache->driver_id,
+      priv->vertex_src, priv->fragment_src);
+  filename = g_strconcat (key, ".bin", NULL);
+  path = g_build_filename (cache->binary_dir, filename, NULL);
+  g_free (filename);
+  g_free (key);
+
+  return path;
+}
+
+/* Called in the gl thread.  Returns whether the program was linked from the
+ * binary stored at @path */
+static gboolean
+_load_program_binary (GstGLShader * shader, const gchar * path)
+{
+  GstGLShaderPrivate *priv = shader->priv;
+  GstGLFuncs *gl = shader->context->gl_vtable;
+  GLint status = GL_FALSE;
+  gchar *contents = NULL;
+  gsize length = 0;
+  guint32 format;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    return FALSE;
+
+  if (length <= PROGRAM_BINARY_HEADER_SIZE
+      || memcmp (contents, PROGRAM_BINARY_MAGIC, 8) != 0) {
+    GST_WARNING ("ignoring invalid program binary %s", path);
+    g_free (contents);
+    return FALSE;
+  }
+
+  memcpy (&format, contents + 8, sizeof (format));
+  gl->ProgramBinary (priv->program_handle, format,
+      contents + PROGRAM_BINARY_HEADER_SIZE,
+      length - PROGRAM_BINARY_HEADER_SIZE);
+  g_free (contents);
+
+  /* a driver update or a different GPU makes the binary unusable */
+  priv->vtable.GetProgramiv (priv->program_handle, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    GLenum gl_err;
+    guint i;
+
+    GST_INFO ("program binary %s was rejected, compiling from source", path);
+
+    /* the rejection may be reported as a GL error as well, which would be
+     * picked up by the next caller checking glGetError() */
+    for (i = 0; i < 8 && (gl_err = gl->GetError ()) != GL_NO_ERROR; i++)
+      GST_DEBUG ("discarding GL error 0x%x", gl_err);
+
+    return FALSE;
+  }
+
+  GST_DEBUG ("shader %u loaded from program binary %s", priv->program_handle,
+      path);
+
+  return TRUE;
+}
+
+/* Called in the gl thread after a successful link */
+static void
+_save_program_binary (GstGLShader * shader, const gchar * path)
+{
+  GstGLShaderPrivate *priv = shader->priv;
+  GstGLFuncs *gl = shader->context->gl_vtable;
+  GLint length = 0;
+  GLsizei written = 0;
+  GLenum format = 0;
+  guint32 format32;
+  GError *error = NULL;
+  gchar *data, *dir;
+
+  priv->vtable.GetProgramiv (priv->program_handle, GL_PROGRAM_BINARY_LENGTH,
+      &length);
+  if (length <= 0)
+    return;
+
+  data = g_malloc (PROGRAM_BINARY_HEADER_SIZE + length);
+  gl->GetProgramBinary (priv->program_handle, length, &written, &format,
+      data + PROGRAM_BINARY_HEADER_SIZE);
+  if (written <= 0) {
+    g_free (data);
+    return;
+  }
+
+  format32 = format;
+  memcpy (data, PROGRAM_BINARY_MAGIC, 8);
+  memcpy (data + 8, &format32, sizeof (format32));
+
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  if (!g_file_set_contents (path, data, PROGRAM_BINARY_HEADER_SIZE + written,
+          &error)) {
+    GST_WARNING ("failed to write program binary: %s", error->message);
+    g_error_free (error);
+  } else {
+    GST_DEBUG ("saved program binary %s", path);
+  }
+
+  g_free (data);
+}
+
 gboolean
 gst_gl_shader_is_compiled (GstGLShader * shader)
 {
@@ -369,6 +930,7 @@ gst_gl_shader_compile (GstGLShader * shader, GError ** error)
   gchar info_buffer[2048];
   gint len = 0;
   GLint status = GL_FALSE;
+  gchar *binary_path;
 
   g_return_val_if_fail (GST_GL_IS_SHADER (shader), FALSE);
 
@@ -381,12 +943,22 @@ gst_gl_shader_compile (GstGLShader * shader, GError ** error)
   if (!_fill_vtable (shader, shader->context))
     return FALSE;
 
+  g_hash_table_remove_all (priv->uniforms);
+  g_hash_table_remove_all (priv->attributes);
+
   shader->priv->program_handle = shader->priv->vtable.CreateProgram ();
 
   GST_TRACE ("shader created %u", shader->priv->program_handle);
 
   g_return_val_if_fail (priv->program_handle, FALSE);
 
+  binary_path = _get_program_binary_path (shader);
+  if (binary_path && _load_program_binary (shader, binary_path)) {
+    g_free (binary_path);
+    goto linked;
+  }
+  g_free (binary_path);
+
   if (priv->vertex_src) {
     /* create vertex object */
     const gchar *vertex_source = priv->vertex_src;
@@ -451,6 +1023,11 @@ gst_gl_shader_compile (GstGLShader * shader, GError ** error)
     GST_LOG ("fragment shader attached %u", priv->fragment_handle);
   }
 
+  binary_path = _get_program_binary_path (shader);
+  if (binary_path && gl->ProgramParameteri)
+    gl->ProgramParameteri (priv->program_handle,
+        GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
   /* if nothing failed link shaders */
   gl->LinkProgram (priv->program_handle);
   priv->vtable.GetProgramiv (priv->program_handle, GL_LINK_STATUS, &status);
@@ -464,12 +1041,22 @@ gst_gl_shader_compile (GstGLShader * shader, GError ** error)
 
     g_set_error (error, GST_GL_SHADER_ERROR,
         GST_GL_SHADER_ERROR_LINK, "Shader Linking failed:\n%s", info_buffer);
+    g_free (binary_path);
     priv->compiled = FALSE;
     return priv->compiled;
   } else if (len > 1) {
     GST_FIXME ("shader link log:\n%s\n", info_buffer);
   }
+
+  if (binary_path) {
+    _save_program_binary (shader, binary_path);
+    g_free (binary_path);
+  }
+
+linked:
   /* success! */
+  _introspect_program (shader);
+
   priv->compiled = TRUE;
   g_object_notify (G_OBJECT (shader), "compiled");
 
@@ -505,6 +1092,10 @@ gst_gl_shader_release (GstGLShader * shader)
   if (priv->fragment_handle)
     priv->vtable.DetachShader (priv->program_handle, priv->fragment_handle);
 
+  /* the next compile creates a new program */
+  g_hash_table_remove_all (priv->uniforms);
+  g_hash_table_remove_all (priv->attributes);
+
   priv->compiled = FALSE;
   g_object_notify (G_OBJECT (shader), "compiled");
 }
@@ -581,7 +1172,8 @@ gst_gl_shader_set_uniform_1f (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gfloat values[] = { value };
 
   g_return_if_fail (shader != NULL);
 
@@ -589,9 +1181,10 @@ gst_gl_shader_set_uniform_1f (GstGLShader * shader, const gchar * name,
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform1f (location, value);
+  if (_uniform_changed (uniform, UNIFORM_1F, values, sizeof (values)))
+    gl->Uniform1f (uniform->location, value);
 }
 
 void
@@ -600,16 +1193,18 @@ gst_gl_shader_set_uniform_1fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform1fv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_1FV, value,
+          count * sizeof (gfloat)))
+    gl->Uniform1fv (uniform->location, count, value);
 }
 
 void
@@ -618,16 +1213,18 @@ gst_gl_shader_set_uniform_1i (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gint values[] = { value };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform1i (location, value);
+  if (_uniform_changed (uniform, UNIFORM_1I, values, sizeof (values)))
+    gl->Uniform1i (uniform->location, value);
 }
 
 void
@@ -636,16 +1233,18 @@ gst_gl_shader_set_uniform_1iv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform1iv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_1IV, value,
+          count * sizeof (gint)))
+    gl->Uniform1iv (uniform->location, count, value);
 }
 
 void
@@ -654,16 +1253,18 @@ gst_gl_shader_set_uniform_2f (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gfloat values[] = { value0, value1 };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform2f (location, value0, value1);
+  if (_uniform_changed (uniform, UNIFORM_2F, values, sizeof (values)))
+    gl->Uniform2f (uniform->location, value0, value1);
 }
 
 void
@@ -672,16 +1273,18 @@ gst_gl_shader_set_uniform_2fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform2fv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_2FV, value,
+          count * 2 * sizeof (gfloat)))
+    gl->Uniform2fv (uniform->location, count, value);
 }
 
 void
@@ -690,16 +1293,18 @@ gst_gl_shader_set_uniform_2i (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gint values[] = { v0, v1 };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform2i (location, v0, v1);
+  if (_uniform_changed (uniform, UNIFORM_2I, values, sizeof (values)))
+    gl->Uniform2i (uniform->location, v0, v1);
 }
 
 void
@@ -708,16 +1313,18 @@ gst_gl_shader_set_uniform_2iv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform2iv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_2IV, value,
+          count * 2 * sizeof (gint)))
+    gl->Uniform2iv (uniform->location, count, value);
 }
 
 void
@@ -726,16 +1333,18 @@ gst_gl_shader_set_uniform_3f (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gfloat values[] = { v0, v1, v2 };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform3f (location, v0, v1, v2);
+  if (_uniform_changed (uniform, UNIFORM_3F, values, sizeof (values)))
+    gl->Uniform3f (uniform->location, v0, v1, v2);
 }
 
 void
@@ -744,16 +1353,18 @@ gst_gl_shader_set_uniform_3fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform3fv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_3FV, value,
+          count * 3 * sizeof (gfloat)))
+    gl->Uniform3fv (uniform->location, count, value);
 }
 
 void
@@ -762,16 +1373,18 @@ gst_gl_shader_set_uniform_3i (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gint values[] = { v0, v1, v2 };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform3i (location, v0, v1, v2);
+  if (_uniform_changed (uniform, UNIFORM_3I, values, sizeof (values)))
+    gl->Uniform3i (uniform->location, v0, v1, v2);
 }
 
 void
@@ -780,16 +1393,18 @@ gst_gl_shader_set_uniform_3iv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform3iv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_3IV, value,
+          count * 3 * sizeof (gint)))
+    gl->Uniform3iv (uniform->location, count, value);
 }
 
 void
@@ -798,16 +1413,18 @@ gst_gl_shader_set_uniform_4f (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gfloat values[] = { v0, v1, v2, v3 };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform4f (location, v0, v1, v2, v3);
+  if (_uniform_changed (uniform, UNIFORM_4F, values, sizeof (values)))
+    gl->Uniform4f (uniform->location, v0, v1, v2, v3);
 }
 
 void
@@ -816,16 +1433,18 @@ gst_gl_shader_set_uniform_4fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform4fv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_4FV, value,
+          count * 4 * sizeof (gfloat)))
+    gl->Uniform4fv (uniform->location, count, value);
 }
 
 void
@@ -834,16 +1453,18 @@ gst_gl_shader_set_uniform_4i (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
+  gint values[] = { v0, v1, v2, v3 };
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform4i (location, v0, v1, v2, v3);
+  if (_uniform_changed (uniform, UNIFORM_4I, values, sizeof (values)))
+    gl->Uniform4i (uniform->location, v0, v1, v2, v3);
 }
 
 void
@@ -852,16 +1473,18 @@ gst_gl_shader_set_uniform_4iv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->Uniform4iv (location, count, value);
+  if (_uniform_changed (uniform, UNIFORM_4IV, value,
+          count * 4 * sizeof (gint)))
+    gl->Uniform4iv (uniform->location, count, value);
 }
 
 void
@@ -870,16 +1493,19 @@ gst_gl_shader_set_uniform_matrix_2fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix2fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_2FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 4 * sizeof (gfloat)))
+    gl->UniformMatrix2fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -888,16 +1514,19 @@ gst_gl_shader_set_uniform_matrix_3fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix3fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_3FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 9 * sizeof (gfloat)))
+    gl->UniformMatrix3fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -906,16 +1535,19 @@ gst_gl_shader_set_uniform_matrix_4fv (GstGLShader * shader, const gchar * name,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix4fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_4FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 16 * sizeof (gfloat)))
+    gl->UniformMatrix4fv (uniform->location, count, transpose, value);
 }
 
 #if GST_GL_HAVE_OPENGL
@@ -925,16 +1557,19 @@ gst_gl_shader_set_uniform_matrix_2x3fv (GstGLShader * shader,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix2x3fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_2X3FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 6 * sizeof (gfloat)))
+    gl->UniformMatrix2x3fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -943,16 +1578,19 @@ gst_gl_shader_set_uniform_matrix_2x4fv (GstGLShader * shader,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix2x4fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_2X4FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 8 * sizeof (gfloat)))
+    gl->UniformMatrix2x4fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -961,16 +1599,19 @@ gst_gl_shader_set_uniform_matrix_3x2fv (GstGLShader * shader,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix3x2fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_3X2FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 6 * sizeof (gfloat)))
+    gl->UniformMatrix3x2fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -979,16 +1620,19 @@ gst_gl_shader_set_uniform_matrix_3x4fv (GstGLShader * shader,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix3x4fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_3X4FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 12 * sizeof (gfloat)))
+    gl->UniformMatrix3x4fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -997,16 +1641,19 @@ gst_gl_shader_set_uniform_matrix_4x2fv (GstGLShader * shader,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix4x2fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_4X2FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 8 * sizeof (gfloat)))
+    gl->UniformMatrix4x2fv (uniform->location, count, transpose, value);
 }
 
 void
@@ -1015,16 +1662,19 @@ gst_gl_shader_set_uniform_matrix_4x3fv (GstGLShader * shader,
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
-  GLint location = -1;
+  GstGLShaderUniform *uniform;
 
   g_return_if_fail (shader != NULL);
   priv = shader->priv;
   g_return_if_fail (priv->program_handle != 0);
   gl = shader->context->gl_vtable;
 
-  location = gl->GetUniformLocation (priv->program_handle, name);
+  uniform = _get_uniform (shader, name);
 
-  gl->UniformMatrix4x3fv (location, count, transpose, value);
+  if (_uniform_changed (uniform,
+          UNIFORM_MATRIX_4X3FV | (transpose ? UNIFORM_TRANSPOSED : 0), value,
+          count * 12 * sizeof (gfloat)))
+    gl->UniformMatrix4x3fv (uniform->location, count, transpose, value);
 }
 #endif /* GST_GL_HAVE_OPENGL */
 
@@ -1033,13 +1683,22 @@ gst_gl_shader_get_attribute_location (GstGLShader * shader, const gchar * name)
 {
   GstGLShaderPrivate *priv;
   GstGLFuncs *gl;
+  gpointer location;
+  GLint ret;
 
   g_return_val_if_fail (shader != NULL, 0);
   priv = shader->priv;
   g_return_val_if_fail (priv->program_handle != 0, 0);
   gl = shader->context->gl_vtable;
 
-  return gl->GetAttribLocation (priv->program_handle, name);
+  if (g_hash_table_lookup_extended (priv->attributes, name, NULL, &location))
+    return GPOINTER_TO_INT (location);
+
+  ret = gl->GetAttribLocation (priv->program_handle, name);
+  g_hash_table_insert (priv->attributes, g_strdup (name),
+      GINT_TO_POINTER (ret));
+
+  return ret;
 }
 
 void
@@ -65,6 +65,8 @@ GQuark gst_gl_shader_error_quark (void);
 GType gst_gl_shader_get_type (void);
 
 GstGLShader * gst_gl_shader_new (GstGLContext *context);
+GstGLShader * gst_gl_shader_new_cached (GstGLContext *context, const gchar *vertex_src,
+                                        const gchar *fragment_src, GError **error);
 
 void          gst_gl_shader_set_vertex_source   (GstGLShader *shader, const gchar *src);
 void          gst_gl_shader_set_fragment_source (GstGLShader *shader, const gchar *src);
@@ -0,0 +1,272 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gl.h"
+#include "gstglsyncmeta.h"
+
+/**
+ * SECTION:gstglsyncmeta
+ * @short_description: synchronize the GL commands of different contexts
+ * @see_also: #GstGLContext, #GstGLMemory
+ *
+ * A #GstGLSyncMeta is attached to a buffer by the element that rendered into
+ * it.  The producer calls gst_gl_sync_meta_set_sync_point() once all of its
+ * GL commands touching the buffer have been submitted and the consumer calls
+ * gst_gl_sync_meta_wait() before submitting any GL command that reads from
+ * it.
+ *
+ * When fence sync objects are available, the GPU wait is performed by the GL
+ * server of the consumer's context with glWaitSync(), so no thread waits for
+ * the rendering itself to complete.  The thread calling
+ * gst_gl_sync_meta_wait() still waits for the GL thread of the producer to
+ * have set the sync point and then for the GL thread of the consumer to have
+ * queued the wait.  Otherwise the producer finishes its commands with
+ * glFinish() when setting the sync point.
+ */
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_TIMEOUT_IGNORED
+#define GL_TIMEOUT_IGNORED G_GUINT64_CONSTANT (0xFFFFFFFFFFFFFFFF)
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (gst_gl_sync_meta_debug);
+#define GST_CAT_DEFAULT gst_gl_sync_meta_debug
+
+static void
+_set_sync_point (GstGLContext * context, GstGLSyncMeta * sync_meta)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+
+  if (gl->FenceSync) {
+    if (sync_meta->glsync)
+      gl->DeleteSync (sync_meta->glsync);
+    sync_meta->glsync = gl->FenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    /* other contexts can only wait on a fence that reached the server */
+    gl->Flush ();
+    GST_LOG ("setting sync object %p", sync_meta->glsync);
+  } else {
+    gl->Finish ();
+  }
+}
+
+/**
+ * gst_gl_sync_meta_set_sync_point:
+ * @sync_meta: a #GstGLSyncMeta
+ * @context: the #GstGLContext that rendered into the buffer
+ *
+ * Sets a sync point in the command stream of @context.  Any previous sync
+ * point is discarded.  Must be called after all the GL commands writing to
+ * the buffer @sync_meta is attached to have been submitted.
+ */
+void
+gst_gl_sync_meta_set_sync_point (GstGLSyncMeta * sync_meta,
+    GstGLContext * context)
+{
+  g_return_if_fail (sync_meta != NULL);
+  g_return_if_fail (GST_GL_IS_CONTEXT (context));
+
+  if (sync_meta->context != context) {
+    /* the previous sync point is set by another GL thread */
+    if (sync_meta->sync_id)
+      gst_gl_context_thread_wait (sync_meta->context, sync_meta->sync_id);
+    gst_object_replace ((GstObject **) & sync_meta->context,
+        (GstObject *) context);
+  }
+
+  /* ordered with the commands already submitted by the producer, without
+   * waiting for its GL thread */
+  sync_meta->sync_id = gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _set_sync_point, sync_meta, NULL);
+}
+
+static void
+_wait (GstGLContext * context, GstGLSyncMeta * sync_meta)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+
+  GST_LOG ("waiting on sync object %p", sync_meta->glsync);
+  gl->WaitSync (sync_meta->glsync, 0, GL_TIMEOUT_IGNORED);
+}
+
+/**
+ * gst_gl_sync_meta_wait:
+ * @sync_meta: a #GstGLSyncMeta
+ * @context: the #GstGLContext that is about to read from the buffer
+ *
+ * Makes the GL commands submitted to @context from now on wait for the sync
+ * point set with gst_gl_sync_meta_set_sync_point().  The calling thread does
+ * not wait for the GPU but blocks until the GL thread of the producer has set
+ * the sync point, then until the GL thread of @context has queued the wait.
+ * Nothing is done when @context is the one the sync point was set in, as its
+ * commands are already executed in order.
+ */
+void
+gst_gl_sync_meta_wait (GstGLSyncMeta * sync_meta, GstGLContext * context)
+{
+  g_return_if_fail (sync_meta != NULL);
+  g_return_if_fail (GST_GL_IS_CONTEXT (context));
+
+  if (!sync_meta->sync_id || sync_meta->context == context)
+    return;
+
+  gst_gl_context_thread_wait (sync_meta->context, sync_meta->sync_id);
+  if (!sync_meta->glsync)
+    return;
+
+  gst_gl_context_thread_add (context, (GstGLContextThreadFunc) _wait,
+      sync_meta);
+}
+
+static gboolean
+_gst_gl_sync_meta_init (GstGLSyncMeta * sync_meta, gpointer params,
+    GstBuffer * buffer)
+{
+  sync_meta->context = NULL;
+  sync_meta->glsync = NULL;
+  sync_meta->sync_id = 0;
+
+  return TRUE;
+}
+
+static void
+_delete_sync (GstGLContext * context, gpointer glsync)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+
+  gl->DeleteSync (glsync);
+}
+
+static void
+_gst_gl_sync_meta_free (GstGLSyncMeta * sync_meta, GstBuffer * buffer)
+{
+  /* the queued sync point still writes to the meta */
+  if (sync_meta->sync_id)
+    gst_gl_context_thread_wait (sync_meta->context, sync_meta->sync_id);
+  sync_meta->sync_id = 0;
+
+  if (sync_meta->glsync)
+    gst_gl_context_thread_add_async (sync_meta->context,
+        (GstGLContextThreadFunc) _delete_sync, sync_meta->glsync, NULL);
+  sync_meta->glsync = NULL;
+
+  if (sync_meta->context)
+    gst_object_unref (sync_meta->context);
+  sync_meta->context = NULL;
+}
+
+static gboolean
+_gst_gl_sync_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstGLSyncMeta *smeta, *dmeta;
+
+  smeta = (GstGLSyncMeta *) meta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    dmeta = gst_buffer_add_gl_sync_meta (smeta->context, dest);
+    if (!dmeta)
+      return FALSE;
+
+    GST_LOG ("copying sync meta %p to %p", smeta, dmeta);
+
+    /* the copy may be read after the source buffer, and its sync object,
+     * are gone so it gets a sync point of its own */
+    if (smeta->sync_id)
+      gst_gl_sync_meta_set_sync_point (dmeta, smeta->context);
+  } else {
+    /* return FALSE, if transform type is not supported */
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+GType
+gst_gl_sync_meta_api_get_type (void)
+{
+  static volatile GType type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstGLSyncMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+const GstMetaInfo *
+gst_gl_sync_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *meta =
+        gst_meta_register (GST_GL_SYNC_META_API_TYPE, "GstGLSyncMeta",
+        sizeof (GstGLSyncMeta),
+        (GstMetaInitFunction) _gst_gl_sync_meta_init,
+        (GstMetaFreeFunction) _gst_gl_sync_meta_free,
+        _gst_gl_sync_meta_transform);
+
+    GST_DEBUG_CATEGORY_INIT (gst_gl_sync_meta_debug, "glsyncmeta", 0,
+        "OpenGL sync meta");
+
+    g_once_init_leave (&meta_info, meta);
+  }
+
+  return meta_info;
+}
+
+/**
+ * gst_buffer_add_gl_sync_meta:
+ * @context: a #GstGLContext
+ * @buffer: a #GstBuffer
+ *
+ * Attaches a #GstGLSyncMeta without a sync point to @buffer.  The meta is
+ * kept when @buffer is returned to a #GstBufferPool so that its sync object
+ * is reused by the next producer.
+ *
+ * Returns: (transfer none): the #GstGLSyncMeta added to @buffer
+ */
+GstGLSyncMeta *
+gst_buffer_add_gl_sync_meta (GstGLContext * context, GstBuffer * buffer)
+{
+  GstGLSyncMeta *sync_meta;
+
+  g_return_val_if_fail (GST_GL_IS_CONTEXT (context), NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  sync_meta =
+      (GstGLSyncMeta *) gst_buffer_add_meta (buffer, GST_GL_SYNC_META_INFO,
+      NULL);
+  if (!sync_meta)
+    return NULL;
+
+  sync_meta->context = gst_object_ref (context);
+  GST_META_FLAG_SET (sync_meta, GST_META_FLAG_POOLED);
+
+  return sync_meta;
+}
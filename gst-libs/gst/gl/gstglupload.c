@@ -23,9 +23,44 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 
 #include "gl.h"
 #include "gstglupload.h"
+#include "gstglprofile.h"
+
+#if GST_GL_HAVE_PLATFORM_EGL
+#include <gst/allocators/gstdmabuf.h>
+#include "egl/gstglcontext_egl.h"
+#endif
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
 
 /**
  * SECTION:gstglupload
@@ -35,8 +70,20 @@
  * #GstGLUpload is an object that uploads data from system memory into GL textures.
  *
  * A #GstGLUpload can be created with gst_gl_upload_new()
+ *
+ * When the #GstGLUpload:use-pbo property is set (or the GST_GL_UPLOAD_PBO
+ * environment variable is set to 1) and the context supports it, the data is
+ * staged through a ring of pixel unpack buffers so that the texture update
+ * does not block the GL thread on the driver copying from client memory.
+ *
+ * With an EGL context that supports EGL_EXT_image_dma_buf_import, buffers
+ * whose planes are all backed by dmabuf memory are imported as EGLImages and
+ * sampled directly by the conversion shader without any CPU copy.
  */
 
+/* number of pixel unpack buffers in the streaming ring */
+#define N_PBOS 3
+
 #define USING_OPENGL(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL)
 #define USING_OPENGL3(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL3)
 #define USING_GLES(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES)
@@ -44,13 +91,25 @@
 #define USING_GLES3(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES3)
 
 static void _do_upload (GstGLContext * context, GstGLUpload * upload);
+static void _do_upload_planes (GstGLContext * context, GstGLUpload * upload);
+static void _do_upload_convert (GstGLContext * context, GstGLUpload * upload);
 static gboolean _do_upload_fill (GstGLContext * context, GstGLUpload * upload);
 static gboolean _do_upload_make (GstGLContext * context, GstGLUpload * upload);
+static void _gen_input_textures (GstGLContext * context, GstGLUpload * upload,
+    GLuint * textures);
 static void _init_upload (GstGLContext * context, GstGLUpload * upload);
 static gboolean _init_upload_fbo (GstGLContext * context, GstGLUpload * upload);
 static gboolean _gst_gl_upload_perform_with_data_unlocked (GstGLUpload * upload,
     GLuint texture_id, gpointer data[GST_VIDEO_MAX_PLANES]);
 static void _do_upload_with_meta (GstGLContext * context, GstGLUpload * upload);
+static gboolean _init_upload_pbo (GstGLContext * context, GstGLUpload * upload);
+static void _cleanup_upload_pbo (GstGLContext * context, GstGLUpload * upload);
+#if GST_GL_HAVE_PLATFORM_EGL
+static gboolean _gst_gl_upload_perform_with_dmabuf_unlocked (GstGLUpload *
+    upload, GstBuffer * buffer, GLuint texture_id);
+static void _cleanup_upload_dmabuf (GstGLContext * context,
+    GstGLUpload * upload);
+#endif
 
 #if GST_GL_HAVE_OPENGL
 static gboolean _do_upload_draw_opengl (GstGLContext * context,
@@ -63,15 +122,14 @@ static gboolean _do_upload_draw_gles2 (GstGLContext * context,
 
 /* *INDENT-OFF* */
 
-/* BT. 601 standard with the following ranges:
- * Y = [16..235] (of 255)
- * Cb/Cr = [16..240] (of 255)
+/* The matrix and the range of the input colorimetry, the range offsets and
+ * scales folded into the coefficients, see _init_yuv_to_rgb()
  */
 #define YUV_TO_RGB_COEFFICIENTS \
-      "const vec3 offset = vec3(-0.0625, -0.5, -0.5);\n" \
-      "const vec3 rcoeff = vec3(1.164, 0.000, 1.596);\n" \
-      "const vec3 gcoeff = vec3(1.164,-0.391,-0.813);\n" \
-      "const vec3 bcoeff = vec3(1.164, 2.018, 0.000);\n"
+      "uniform vec3 offset;\n" \
+      "uniform vec3 rcoeff;\n" \
+      "uniform vec3 gcoeff;\n" \
+      "uniform vec3 bcoeff;\n"
 
 /** GRAY16 to RGB conversion 
  *  data transfered as GL_LUMINANCE_ALPHA then convert back to GRAY16 
@@ -82,6 +140,14 @@ static gboolean _do_upload_draw_gles2 (GstGLContext * context,
 #define COMPOSE_WEIGHT \
     "const vec2 compose_weight = vec2(0.996109, 0.003891);\n"
 
+/** 10 bit YUV samples stored in 16 bit containers
+ *  transfered as GL_LUMINANCE_ALPHA like GRAY16, the weights are the
+ *  COMPOSE_WEIGHT ones scaled by 65535/1023 so that [0~1023] maps to [0~1]
+ *  and the YUV_TO_RGB_COEFFICIENTS computed for a depth of 10 apply
+ * */
+#define COMPOSE_WEIGHT_10 \
+    "const vec2 compose_weight = vec2(63.812317, 0.249267);\n"
+
 #if GST_GL_HAVE_OPENGL
 
 static const char *frag_AYUV_opengl = {
@@ -123,6 +189,31 @@ static const char *frag_PLANAR_YUV_opengl = {
       "}"
 };
 
+/** 10 bit planar YUV to RGB conversion */
+static const char *frag_PLANAR_YUV_10_opengl = {
+      "uniform sampler2D Ytex,Utex,Vtex;\n"
+      "uniform vec2 tex_scale0;\n"
+      "uniform vec2 tex_scale1;\n"
+      "uniform vec2 tex_scale2;\n"
+      YUV_TO_RGB_COEFFICIENTS
+      COMPOSE_WEIGHT_10
+      "void main(void) {\n"
+      "  float r,g,b;\n"
+      "  vec3 yuv;\n"
+      "  yuv.x=dot(texture2D(Ytex, gl_TexCoord[0].xy * tex_scale0).%c%c,\n"
+      "      compose_weight);\n"
+      "  yuv.y=dot(texture2D(Utex, gl_TexCoord[0].xy * tex_scale1).%c%c,\n"
+      "      compose_weight);\n"
+      "  yuv.z=dot(texture2D(Vtex, gl_TexCoord[0].xy * tex_scale2).%c%c,\n"
+      "      compose_weight);\n"
+      "  yuv += offset;\n"
+      "  r = dot(yuv, rcoeff);\n"
+      "  g = dot(yuv, gcoeff);\n"
+      "  b = dot(yuv, bcoeff);\n"
+      "  gl_FragColor=vec4(r,g,b,1.0);\n"
+      "}"
+};
+
 /** NV12/NV21 to RGB conversion */
 static const char *frag_NV12_NV21_opengl = {
       "uniform sampler2D Ytex,UVtex;\n"
@@ -143,6 +234,45 @@ static const char *frag_NV12_NV21_opengl = {
       "}"
 };
 
+/** v210 to RGB conversion, every 4 words of 3 10 bit components hold 6
+ *  pixels: U0 Y0 V0, Y1 U2 Y2, V2 Y3 U4, Y4 V4 Y5.  The words are
+ *  uploaded as GL_UNSIGNED_INT_2_10_10_10_REV and sampled with GL_NEAREST */
+static const char *frag_v210_opengl = {
+      "uniform sampler2D tex;\n"
+      "uniform vec2 tex_scale0;\n"
+      "uniform vec2 tex_scale1;\n"
+      "uniform vec2 tex_scale2;\n"
+      "uniform float width;\n"
+      "uniform float tex_width;\n"
+      YUV_TO_RGB_COEFFICIENTS
+      "vec3 word(float i) {\n"
+      "  return texture2D(tex, vec2((i + 0.5) / tex_width,\n"
+      "      gl_TexCoord[0].y)).rgb;\n"
+      "}\n"
+      "void main(void) {\n"
+      "  float r,g,b;\n"
+      "  vec3 yuv;\n"
+      "  float x = floor(gl_TexCoord[0].x * width);\n"
+      "  float block = floor(x / 6.0);\n"
+      "  float pos = x - block * 6.0;\n"
+      "  vec3 w0 = word(block * 4.0);\n"
+      "  vec3 w1 = word(block * 4.0 + 1.0);\n"
+      "  vec3 w2 = word(block * 4.0 + 2.0);\n"
+      "  vec3 w3 = word(block * 4.0 + 3.0);\n"
+      "  if (pos < 2.0)\n"
+      "    yuv = vec3(pos < 1.0 ? w0.g : w1.r, w0.r, w0.b);\n"
+      "  else if (pos < 4.0)\n"
+      "    yuv = vec3(pos < 3.0 ? w1.b : w2.g, w1.g, w2.r);\n"
+      "  else\n"
+      "    yuv = vec3(pos < 5.0 ? w3.r : w3.b, w2.b, w3.g);\n"
+      "  yuv += offset;\n"
+      "  r = dot(yuv, rcoeff);\n"
+      "  g = dot(yuv, gcoeff);\n"
+      "  b = dot(yuv, bcoeff);\n"
+      "  gl_FragColor=vec4(r,g,b,1.0);\n"
+      "}"
+};
+
 /* Channel reordering for XYZ <-> ZYX conversion */
 static const char *frag_REORDER_opengl = {
       "uniform sampler2D tex;\n"
@@ -289,6 +419,38 @@ static const char *frag_PLANAR_YUV_gles2 = {
       "}"
 };
 
+/** 10 bit planar YUV to RGB conversion, the composed values need more
+ *  precision than mediump guarantees */
+static const char *frag_PLANAR_YUV_10_gles2 = {
+      "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+      "precision highp float;\n"
+      "#else\n"
+      "precision mediump float;\n"
+      "#endif\n"
+      "varying vec2 v_texcoord;\n"
+      "uniform sampler2D Ytex,Utex,Vtex;\n"
+      "uniform vec2 tex_scale0;\n"
+      "uniform vec2 tex_scale1;\n"
+      "uniform vec2 tex_scale2;\n"
+      YUV_TO_RGB_COEFFICIENTS
+      COMPOSE_WEIGHT_10
+      "void main(void) {\n"
+      "  float r,g,b;\n"
+      "  vec3 yuv;\n"
+      "  yuv.x=dot(texture2D(Ytex,v_texcoord * tex_scale0).%c%c,\n"
+      "      compose_weight);\n"
+      "  yuv.y=dot(texture2D(Utex,v_texcoord * tex_scale1).%c%c,\n"
+      "      compose_weight);\n"
+      "  yuv.z=dot(texture2D(Vtex,v_texcoord * tex_scale2).%c%c,\n"
+      "      compose_weight);\n"
+      "  yuv += offset;\n"
+      "  r = dot(yuv, rcoeff);\n"
+      "  g = dot(yuv, gcoeff);\n"
+      "  b = dot(yuv, bcoeff);\n"
+      "  gl_FragColor=vec4(r,g,b,1.0);\n"
+      "}"
+};
+
 /** NV12/NV21 to RGB conversion */
 static const char *frag_NV12_NV21_gles2 = {
       "precision mediump float;\n"
@@ -311,6 +473,55 @@ static const char *frag_NV12_NV21_gles2 = {
       "}"
 };
 
+/** v210 to RGB conversion, see frag_v210_opengl.  The words are uploaded
+ *  as bytes and their 10 bit components put back together in the shader */
+static const char *frag_v210_gles2 = {
+      "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+      "precision highp float;\n"
+      "#else\n"
+      "precision mediump float;\n"
+      "#endif\n"
+      "varying vec2 v_texcoord;\n"
+      "uniform sampler2D tex;\n"
+      "uniform vec2 tex_scale0;\n"
+      "uniform vec2 tex_scale1;\n"
+      "uniform vec2 tex_scale2;\n"
+      "uniform float width;\n"
+      "uniform float tex_width;\n"
+      YUV_TO_RGB_COEFFICIENTS
+      "vec3 word(float i) {\n"
+      "  vec4 t = floor(texture2D(tex, vec2((i + 0.5) / tex_width,\n"
+      "      v_texcoord.y)) * 255.0 + 0.5);\n"
+      "  vec3 w;\n"
+      "  w.r = t.r + mod(t.g, 4.0) * 256.0;\n"
+      "  w.g = floor(t.g / 4.0) + mod(t.b, 16.0) * 64.0;\n"
+      "  w.b = floor(t.b / 16.0) + mod(t.a, 64.0) * 16.0;\n"
+      "  return w / 1023.0;\n"
+      "}\n"
+      "void main(void) {\n"
+      "  float r,g,b;\n"
+      "  vec3 yuv;\n"
+      "  float x = floor(v_texcoord.x * width);\n"
+      "  float block = floor(x / 6.0);\n"
+      "  float pos = x - block * 6.0;\n"
+      "  vec3 w0 = word(block * 4.0);\n"
+      "  vec3 w1 = word(block * 4.0 + 1.0);\n"
+      "  vec3 w2 = word(block * 4.0 + 2.0);\n"
+      "  vec3 w3 = word(block * 4.0 + 3.0);\n"
+      "  if (pos < 2.0)\n"
+      "    yuv = vec3(pos < 1.0 ? w0.g : w1.r, w0.r, w0.b);\n"
+      "  else if (pos < 4.0)\n"
+      "    yuv = vec3(pos < 3.0 ? w1.b : w2.g, w1.g, w2.r);\n"
+      "  else\n"
+      "    yuv = vec3(pos < 5.0 ? w3.r : w3.b, w2.b, w3.g);\n"
+      "  yuv += offset;\n"
+      "  r = dot(yuv, rcoeff);\n"
+      "  g = dot(yuv, gcoeff);\n"
+      "  b = dot(yuv, bcoeff);\n"
+      "  gl_FragColor=vec4(r,g,b,1.0);\n"
+      "}"
+};
+
 /* Direct fragments copy with stride-scaling */
 static const char *frag_COPY_gles2 = {
       "precision mediump float;\n"
@@ -365,10 +576,11 @@ static const gchar *text_vertex_shader_gles2 =
 
 struct TexData
 {
-  guint internal_format, format, type, width, height;
+  guint format, type, width, height;
   gfloat tex_scaling[2];
   const gchar *shader_name;
   guint unpack_length;
+  guint filter;
 };
 
 struct _GstGLUploadPrivate
@@ -378,22 +590,65 @@ struct _GstGLUploadPrivate
 
   const gchar *YUY2_UYVY;
   const gchar *PLANAR_YUV;
+  const gchar *PLANAR_YUV_10;
+  const gchar *v210;
   const gchar *AYUV;
   const gchar *NV12_NV21;
   const gchar *REORDER;
   const gchar *COPY;
   const gchar *COMPOSE;
   const gchar *vert_shader;
+  /* how the v210 words are uploaded */
+  guint v210_type;
 
     gboolean (*draw) (GstGLContext * context, GstGLUpload * download);
 
+  /* the YUV to RGB conversion of in_info, see _init_yuv_to_rgb() */
+  gfloat yuv_offset[3];
+  gfloat yuv_coeff[3][3];
+
   struct TexData texture_info[GST_VIDEO_MAX_PLANES];
+  /* the input textures that are filled and converted from, in_texture or
+   * the plane textures of a GstGLMemory */
+  GLuint *planes;
 
   GstBuffer *buffer;
   GstVideoFrame frame;
   GstVideoGLTextureUploadMeta *meta;
   guint tex_id;
   gboolean mapped;
+
+  /* pixel unpack buffer streaming, use_pbo is the property and pbo_failed
+   * is set in the gl thread when the context cannot provide them */
+  gboolean use_pbo;
+  gboolean pbo_failed;
+  gboolean pbo_persistent;
+  GLuint pbo[N_PBOS];
+  gpointer pbo_data[N_PBOS];
+  GLsync pbo_sync[N_PBOS];
+  guint pbo_index;
+  gsize pbo_size;
+  gsize pbo_offset[GST_VIDEO_MAX_PLANES];
+  gsize pbo_plane_size[GST_VIDEO_MAX_PLANES];
+
+  /* dmabuf import through EGLImage */
+  gboolean use_dmabuf;
+  /* layout of the last buffer that failed to import, only buffers laid out
+   * differently, like after upstream renegotiated, are tried again */
+  gboolean dmabuf_failed;
+  gsize dmabuf_failed_offset[GST_VIDEO_MAX_PLANES];
+  gint dmabuf_failed_stride[GST_VIDEO_MAX_PLANES];
+  gint dmabuf_fd[GST_VIDEO_MAX_PLANES];
+  gsize dmabuf_offset[GST_VIDEO_MAX_PLANES];
+  gint dmabuf_stride[GST_VIDEO_MAX_PLANES];
+  GLuint dmabuf_texture[GST_VIDEO_MAX_PLANES];
+  GstGLShader *dmabuf_shader;
+};
+
+enum
+{
+  PROP_0,
+  PROP_USE_PBO
 };
 
 GST_DEBUG_CATEGORY_STATIC (gst_gl_upload_debug);
@@ -404,6 +659,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_gl_upload_debug);
 
 G_DEFINE_TYPE_WITH_CODE (GstGLUpload, gst_gl_upload, G_TYPE_OBJECT, DEBUG_INIT);
 static void gst_gl_upload_finalize (GObject * object);
+static void gst_gl_upload_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_gl_upload_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 #define GST_GL_UPLOAD_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
     GST_TYPE_GL_UPLOAD, GstGLUploadPrivate))
@@ -411,9 +670,25 @@ static void gst_gl_upload_finalize (GObject * object);
 static void
 gst_gl_upload_class_init (GstGLUploadClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
   g_type_class_add_private (klass, sizeof (GstGLUploadPrivate));
 
-  G_OBJECT_CLASS (klass)->finalize = gst_gl_upload_finalize;
+  gobject_class->finalize = gst_gl_upload_finalize;
+  gobject_class->set_property = gst_gl_upload_set_property;
+  gobject_class->get_property = gst_gl_upload_get_property;
+
+  /**
+   * GstGLUpload:use-pbo:
+   *
+   * Stream the data through a ring of pixel unpack buffers instead of
+   * uploading directly from client memory.  Silently falls back to the
+   * direct upload when the context lacks the required functionality.
+   */
+  g_object_class_install_property (gobject_class, PROP_USE_PBO,
+      g_param_spec_boolean ("use-pbo", "Use PBO",
+          "Upload through pixel unpack buffer objects", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -432,6 +707,44 @@ gst_gl_upload_init (GstGLUpload * upload)
 
   upload->shader_attr_position_loc = 0;
   upload->shader_attr_texture_loc = 0;
+
+  upload->priv->planes = upload->in_texture;
+
+  upload->priv->use_pbo = g_strcmp0 (g_getenv ("GST_GL_UPLOAD_PBO"), "1") == 0;
+}
+
+static void
+gst_gl_upload_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstGLUpload *upload = GST_GL_UPLOAD (object);
+
+  switch (prop_id) {
+    case PROP_USE_PBO:
+      g_mutex_lock (&upload->lock);
+      upload->priv->use_pbo = g_value_get_boolean (value);
+      g_mutex_unlock (&upload->lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_gl_upload_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstGLUpload *upload = GST_GL_UPLOAD (object);
+
+  switch (prop_id) {
+    case PROP_USE_PBO:
+      g_value_set_boolean (value, upload->priv->use_pbo);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 /**
@@ -455,6 +768,9 @@ gst_gl_upload_new (GstGLContext * context)
   if (USING_OPENGL (context)) {
     priv->YUY2_UYVY = frag_YUY2_UYVY_opengl;
     priv->PLANAR_YUV = frag_PLANAR_YUV_opengl;
+    priv->PLANAR_YUV_10 = frag_PLANAR_YUV_10_opengl;
+    priv->v210 = frag_v210_opengl;
+    priv->v210_type = GL_UNSIGNED_INT_2_10_10_10_REV;
     priv->AYUV = frag_AYUV_opengl;
     priv->REORDER = frag_REORDER_opengl;
     priv->COMPOSE = frag_COMPOSE_opengl;
@@ -468,6 +784,9 @@ gst_gl_upload_new (GstGLContext * context)
   if (USING_GLES2 (context)) {
     priv->YUY2_UYVY = frag_YUY2_UYVY_gles2;
     priv->PLANAR_YUV = frag_PLANAR_YUV_gles2;
+    priv->PLANAR_YUV_10 = frag_PLANAR_YUV_10_gles2;
+    priv->v210 = frag_v210_gles2;
+    priv->v210_type = GL_UNSIGNED_BYTE;
     priv->AYUV = frag_AYUV_gles2;
     priv->REORDER = frag_REORDER_gles2;
     priv->COMPOSE = frag_COMPOSE_gles2;
@@ -512,6 +831,16 @@ gst_gl_upload_finalize (GObject * object)
     gst_object_unref (upload->shader);
     upload->shader = NULL;
   }
+  if (upload->priv->pbo[0]) {
+    gst_gl_context_thread_add (upload->context,
+        (GstGLContextThreadFunc) _cleanup_upload_pbo, upload);
+  }
+#if GST_GL_HAVE_PLATFORM_EGL
+  if (upload->priv->dmabuf_texture[0] || upload->priv->dmabuf_shader) {
+    gst_gl_context_thread_add (upload->context,
+        (GstGLContextThreadFunc) _cleanup_upload_dmabuf, upload);
+  }
+#endif
 
   if (upload->context) {
     gst_object_unref (upload->context);
@@ -581,7 +910,8 @@ gst_gl_upload_init_format (GstGLUpload * upload, GstVideoInfo in_info,
  * @tex_id: resulting texture
  *
  * Uploads @buffer to the texture given by @tex_id.  @tex_id is valid
- * until gst_gl_upload_release_buffer() is called.
+ * until gst_gl_upload_release_buffer() is called.  If @buffer carries a
+ * #GstGLSyncMeta, the GL commands using @tex_id wait for its sync point.
  *
  * Returns: whether the upload was successful
  */
@@ -591,12 +921,17 @@ gst_gl_upload_perform_with_buffer (GstGLUpload * upload, GstBuffer * buffer,
 {
   GstMemory *mem;
   GstVideoGLTextureUploadMeta *gl_tex_upload_meta;
+  GstGLSyncMeta *sync_meta;
 
   g_return_val_if_fail (upload != NULL, FALSE);
   g_return_val_if_fail (buffer != NULL, FALSE);
   g_return_val_if_fail (tex_id != NULL, FALSE);
   g_return_val_if_fail (gst_buffer_n_memory (buffer) > 0, FALSE);
 
+  sync_meta = gst_buffer_get_gl_sync_meta (buffer);
+  if (sync_meta)
+    gst_gl_sync_meta_wait (sync_meta, upload->context);
+
   /* GstGLMemory */
   mem = gst_buffer_peek_memory (buffer, 0);
 
@@ -639,6 +974,27 @@ gst_gl_upload_perform_with_buffer (GstGLUpload * upload, GstBuffer * buffer,
       return TRUE;
     }
   }
+#if GST_GL_HAVE_PLATFORM_EGL
+  /* dmabuf */
+  if (gst_is_dmabuf_memory (mem)) {
+    gboolean res;
+
+    GST_LOG_OBJECT (upload, "Attempting upload with dmabuf");
+
+    g_mutex_lock (&upload->lock);
+    res = _gst_gl_upload_perform_with_dmabuf_unlocked (upload, buffer,
+        upload->priv->tex_id);
+    g_mutex_unlock (&upload->lock);
+
+    if (res) {
+      upload->priv->mapped = FALSE;
+      *tex_id = upload->priv->tex_id;
+      return TRUE;
+    }
+
+    GST_DEBUG_OBJECT (upload, "Upload with dmabuf failed");
+  }
+#endif
 
   GST_LOG_OBJECT (upload, "Attempting upload with raw data");
   /* GstVideoMeta map */
@@ -667,23 +1023,55 @@ gst_gl_upload_release_buffer (GstGLUpload * upload)
     gst_video_frame_unmap (&upload->priv->frame);
 }
 
-static gboolean
-_upload_memory_unlocked (GstGLUpload * upload, GstGLMemory * gl_mem,
-    guint tex_id)
+static void
+_memory_plane_data (GstGLUpload * upload, GstGLMemory * gl_mem,
+    gpointer data[GST_VIDEO_MAX_PLANES])
 {
-  gpointer data[GST_VIDEO_MAX_PLANES];
   guint i;
-  gboolean ret;
 
   for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&upload->in_info); i++) {
     data[i] = (guint8 *) gl_mem->data +
         GST_VIDEO_INFO_PLANE_OFFSET (&upload->in_info, i);
   }
+}
+
+static gboolean
+_upload_memory_unlocked (GstGLUpload * upload, GstGLMemory * gl_mem,
+    guint tex_id)
+{
+  gboolean ret;
+
+  /* once the planes of a memory exist they are kept up to date as well */
+  if (gl_mem->tex_planes[0])
+    upload->priv->planes = gl_mem->tex_planes;
+
+  if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)) {
+    gpointer data[GST_VIDEO_MAX_PLANES];
+
+    _memory_plane_data (upload, gl_mem, data);
+
+    ret = _gst_gl_upload_perform_with_data_unlocked (upload, tex_id, data);
+
+    if (ret && gl_mem->tex_planes[0])
+      GST_GL_MEMORY_FLAG_UNSET (gl_mem, GST_GL_MEMORY_FLAG_NEED_PLANE_UPLOAD);
+  } else {
+    /* only the conversion of the planes is outstanding */
+    upload->out_texture = tex_id;
+
+    GST_LOG ("Converting planes of memory %p into texture %u", gl_mem, tex_id);
+
+    gst_gl_context_thread_add (upload->context,
+        (GstGLContextThreadFunc) _do_upload_convert, upload);
+
+    ret = upload->priv->result;
+  }
 
-  ret = _gst_gl_upload_perform_with_data_unlocked (upload, tex_id, data);
+  upload->priv->planes = upload->in_texture;
 
-  if (ret && tex_id == gl_mem->tex_id)
+  if (ret && tex_id == gl_mem->tex_id) {
     GST_GL_MEMORY_FLAG_UNSET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD);
+    GST_GL_MEMORY_FLAG_UNSET (gl_mem, GST_GL_MEMORY_FLAG_NEED_CONVERT);
+  }
 
   return ret;
 }
@@ -708,9 +1096,17 @@ gst_gl_upload_perform_with_memory (GstGLUpload * upload, GstGLMemory * gl_mem)
     gst_gl_upload_init_format (upload, gl_mem->v_info, gl_mem->v_info);
   }
 
-  if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD))
+  if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)
+      && !GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_CONVERT))
     return FALSE;
 
+  /* the texture of a memory is only created once something needs it */
+  if (!gl_mem->tex_id)
+    gst_gl_context_gen_texture (upload->context, &gl_mem->tex_id,
+        GST_VIDEO_INFO_FORMAT (&gl_mem->v_info),
+        GST_VIDEO_INFO_WIDTH (&gl_mem->v_info),
+        GST_VIDEO_INFO_HEIGHT (&gl_mem->v_info));
+
   g_mutex_lock (&upload->lock);
 
   ret = _upload_memory_unlocked (upload, gl_mem, gl_mem->tex_id);
@@ -720,6 +1116,68 @@ gst_gl_upload_perform_with_memory (GstGLUpload * upload, GstGLMemory * gl_mem)
   return ret;
 }
 
+/**
+ * gst_gl_upload_perform_planes_with_memory:
+ * @upload: a #GstGLUpload
+ * @gl_mem: a #GstGLMemory
+ *
+ * Uploads the data of @gl_mem into its plane textures without converting it.
+ * The conversion into the texture of @gl_mem is deferred until that is
+ * mapped with #GST_MAP_GL or gst_gl_upload_perform_with_memory() is called.
+ *
+ * Returns: whether the upload was successful
+ */
+gboolean
+gst_gl_upload_perform_planes_with_memory (GstGLUpload * upload,
+    GstGLMemory * gl_mem)
+{
+  gboolean ret;
+
+  g_return_val_if_fail (upload != NULL, FALSE);
+  g_return_val_if_fail (gl_mem != NULL, FALSE);
+
+  if (!GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_UPLOAD_INITTED)) {
+    gst_gl_upload_init_format (upload, gl_mem->v_info, gl_mem->v_info);
+  }
+
+  if (gl_mem->tex_planes[0]
+      && !GST_GL_MEMORY_FLAG_IS_SET (gl_mem,
+          GST_GL_MEMORY_FLAG_NEED_PLANE_UPLOAD))
+    return TRUE;
+
+  /* the planes can only be recreated from the data */
+  if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_DOWNLOAD))
+    return FALSE;
+
+  g_mutex_lock (&upload->lock);
+
+  _memory_plane_data (upload, gl_mem, upload->data);
+  upload->priv->planes = gl_mem->tex_planes;
+
+  GST_LOG ("Uploading planes of memory %p", gl_mem);
+
+  gst_gl_context_thread_add (upload->context,
+      (GstGLContextThreadFunc) _do_upload_planes, upload);
+
+  upload->priv->planes = upload->in_texture;
+  ret = upload->priv->result;
+
+  if (ret) {
+    gl_mem->n_tex_planes = upload->priv->n_textures;
+    GST_GL_MEMORY_FLAG_UNSET (gl_mem, GST_GL_MEMORY_FLAG_NEED_PLANE_UPLOAD);
+
+    /* the texture is now behind the planes instead of the data */
+    if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)) {
+      GST_GL_MEMORY_FLAG_UNSET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD);
+      GST_GL_MEMORY_FLAG_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_CONVERT);
+    }
+  }
+
+  g_mutex_unlock (&upload->lock);
+
+  return ret;
+}
+
 /*
  * Uploads as a result of a call to gst_video_gl_texture_upload_meta_upload().
  * i.e. provider of GstVideoGLTextureUploadMeta
@@ -760,7 +1218,8 @@ _do_upload_for_meta (GstGLUpload * upload, GstVideoGLTextureUploadMeta * meta)
   mem = gst_buffer_peek_memory (upload->priv->buffer, 0);
 
   if (gst_is_gl_memory (mem)) {
-    if (GST_GL_MEMORY_FLAG_IS_SET (mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)) {
+    if (GST_GL_MEMORY_FLAG_IS_SET (mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD)
+        || GST_GL_MEMORY_FLAG_IS_SET (mem, GST_GL_MEMORY_FLAG_NEED_CONVERT)) {
       ret = _upload_memory_unlocked (upload, (GstGLMemory *) mem,
           upload->out_texture);
     } else {
@@ -976,18 +1435,12 @@ _create_shader (GstGLContext * context, const gchar * vertex_src,
 
   g_return_val_if_fail (vertex_src != NULL || fragment_src != NULL, FALSE);
 
-  shader = gst_gl_shader_new (context);
-
-  if (vertex_src)
-    gst_gl_shader_set_vertex_source (shader, vertex_src);
-  if (fragment_src)
-    gst_gl_shader_set_fragment_source (shader, fragment_src);
-
-  if (!gst_gl_shader_compile (shader, &error)) {
+  shader = gst_gl_shader_new_cached (context, vertex_src, fragment_src,
+      &error);
+  if (!shader) {
     gst_gl_context_set_error (context, "%s", error->message);
     g_error_free (error);
     gst_gl_context_clear_shader (context);
-    gst_object_unref (shader);
     return FALSE;
   }
 
@@ -995,7 +1448,323 @@ _create_shader (GstGLContext * context, const gchar * vertex_src,
   return TRUE;
 }
 
+#if GST_GL_HAVE_PLATFORM_EGL
+/* from drm_fourcc.h */
+#define DRM_FORMAT_R8 GST_MAKE_FOURCC ('R', '8', ' ', ' ')
+#define DRM_FORMAT_GR88 GST_MAKE_FOURCC ('G', 'R', '8', '8')
+#define DRM_FORMAT_XBGR8888 GST_MAKE_FOURCC ('X', 'B', '2', '4')
+#define DRM_FORMAT_ABGR8888 GST_MAKE_FOURCC ('A', 'B', '2', '4')
+
+/* Returns the DRM fourcc that input texture @i of @v_format is imported as or
+ * 0 if @v_format cannot be imported */
+static guint32
+_dmabuf_texture_fourcc (GstVideoFormat v_format, guint i)
+{
+  switch (v_format) {
+    case GST_VIDEO_FORMAT_RGBA:
+      return DRM_FORMAT_ABGR8888;
+    case GST_VIDEO_FORMAT_RGBx:
+      return DRM_FORMAT_XBGR8888;
+    case GST_VIDEO_FORMAT_GRAY8:
+    case GST_VIDEO_FORMAT_Y444:
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_Y42B:
+    case GST_VIDEO_FORMAT_Y41B:
+      return DRM_FORMAT_R8;
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+      return i == 0 ? DRM_FORMAT_R8 : DRM_FORMAT_GR88;
+    default:
+      return 0;
+  }
+}
+
+/* called by _do_upload_dmabuf (in the gl thread) */
+static gboolean
+_init_upload_dmabuf (GstGLContext * context, GstGLUpload * upload)
+{
+  GstGLUploadPrivate *priv = upload->priv;
+  const GstGLFuncs *gl = context->gl_vtable;
+  gchar *frag_prog = NULL;
+  gboolean res;
+
+  /* two component planes are imported as RG rather than LUMINANCE_ALPHA */
+  switch (GST_VIDEO_INFO_FORMAT (&upload->in_info)) {
+    case GST_VIDEO_FORMAT_NV12:
+      frag_prog = g_strdup_printf (priv->NV12_NV21, 'r', 'g');
+      break;
+    case GST_VIDEO_FORMAT_NV21:
+      frag_prog = g_strdup_printf (priv->NV12_NV21, 'g', 'r');
+      break;
+    default:
+      break;
+  }
+
+  if (frag_prog) {
+    res = _create_shader (context, priv->vert_shader, frag_prog,
+        &priv->dmabuf_shader);
+    g_free (frag_prog);
+    if (!res)
+      return FALSE;
+  } else {
+    priv->dmabuf_shader = gst_object_ref (upload->shader);
+  }
+
+  gl->GenTextures (priv->n_textures, priv->dmabuf_texture);
+
+  return TRUE;
+}
+
+/* called in the gl thread */
+static void
+_cleanup_upload_dmabuf (GstGLContext * context, GstGLUpload * upload)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLUploadPrivate *priv = upload->priv;
+
+  if (priv->dmabuf_texture[0]) {
+    gl->DeleteTextures (priv->n_textures, priv->dmabuf_texture);
+    memset (priv->dmabuf_texture, 0, sizeof (priv->dmabuf_texture));
+  }
+  if (priv->dmabuf_shader) {
+    gst_object_unref (priv->dmabuf_shader);
+    priv->dmabuf_shader = NULL;
+  }
+}
+
 /* Called in the gl thread */
+static void
+_do_upload_dmabuf (GstGLContext * context, GstGLUpload * upload)
+{
+  GstGLContextEGL *egl = GST_GL_CONTEXT_EGL (context);
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLUploadPrivate *priv = upload->priv;
+  struct TexData *tex = priv->texture_info;
+  EGLImageKHR images[GST_VIDEO_MAX_PLANES];
+  GstVideoFormat v_format;
+  guint i, n_images = 0;
+
+  v_format = GST_VIDEO_INFO_FORMAT (&upload->in_info);
+  priv->result = FALSE;
+
+  if (!priv->dmabuf_shader && !_init_upload_dmabuf (context, upload))
+    return;
+
+  for (i = 0; i < priv->n_textures; i++) {
+    images[i] = gst_gl_context_egl_import_dmabuf (egl, priv->dmabuf_fd[i],
+        _dmabuf_texture_fourcc (v_format, i), tex[i].width, tex[i].height,
+        priv->dmabuf_offset[i], priv->dmabuf_stride[i]);
+    if (images[i] == EGL_NO_IMAGE_KHR)
+      goto out;
+    n_images++;
+
+    GST_LOG ("imported dmabuf fd:%i offset:%" G_GSIZE_FORMAT " stride:%i "
+        "into texture no %u, id:%u, %ux%u", priv->dmabuf_fd[i],
+        priv->dmabuf_offset[i], priv->dmabuf_stride[i], i,
+        priv->dmabuf_texture[i], tex[i].width, tex[i].height);
+
+    gl->BindTexture (GL_TEXTURE_2D, priv->dmabuf_texture[i]);
+    gl->EGLImageTargetTexture2D (GL_TEXTURE_2D, images[i]);
+  }
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+
+  priv->use_dmabuf = TRUE;
+  priv->result = priv->draw (context, upload);
+  priv->use_dmabuf = FALSE;
+
+out:
+  /* the textures remain siblings of the imported buffers, the images
+   * themselves are not needed past this point */
+  for (i = 0; i < n_images; i++)
+    gst_gl_context_egl_destroy_image (egl, images[i]);
+}
+
+/* whether the planes to import are laid out like the last buffer that
+ * failed to */
+static gboolean
+_dmabuf_layout_failed (GstGLUpload * upload)
+{
+  GstGLUploadPrivate *priv = upload->priv;
+  guint i;
+
+  for (i = 0; i < priv->n_textures; i++) {
+    if (priv->dmabuf_offset[i] != priv->dmabuf_failed_offset[i]
+        || priv->dmabuf_stride[i] != priv->dmabuf_failed_stride[i])
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+_gst_gl_upload_perform_with_dmabuf_unlocked (GstGLUpload * upload,
+    GstBuffer * buffer, GLuint texture_id)
+{
+  GstGLUploadPrivate *priv = upload->priv;
+  GstVideoFormat v_format;
+  GstVideoMeta *meta;
+  guint i;
+
+  if (!GST_GL_IS_CONTEXT_EGL (upload->context)
+      || !GST_GL_CONTEXT_EGL (upload->context)->have_dmabuf_import
+      || !upload->context->gl_vtable->EGLImageTargetTexture2D) {
+    GST_DEBUG_OBJECT (upload, "dmabuf import not supported by %"
+        GST_PTR_FORMAT, upload->context);
+    return FALSE;
+  }
+
+  v_format = GST_VIDEO_INFO_FORMAT (&upload->in_info);
+  if (!_dmabuf_texture_fourcc (v_format, 0))
+    return FALSE;
+
+  meta = gst_buffer_get_video_meta (buffer);
+
+  for (i = 0; i < priv->n_textures; i++) {
+    GstMemory *mem;
+    guint plane = i, idx, length;
+    gsize offset, skip;
+
+    /* YV12 is the same as I420 except that planes 1+2 are swapped */
+    if (v_format == GST_VIDEO_FORMAT_YV12 && i > 0)
+      plane = 3 - i;
+
+    if (meta) {
+      offset = meta->offset[plane];
+      priv->dmabuf_stride[i] = meta->stride[plane];
+    } else {
+      offset = GST_VIDEO_INFO_PLANE_OFFSET (&upload->in_info, plane);
+      priv->dmabuf_stride[i] =
+          GST_VIDEO_INFO_PLANE_STRIDE (&upload->in_info, plane);
+    }
+
+    /* each plane may live in a separate dmabuf */
+    if (!gst_buffer_find_memory (buffer, offset, 1, &idx, &length, &skip))
+      return FALSE;
+
+    mem = gst_buffer_peek_memory (buffer, idx);
+    if (!gst_is_dmabuf_memory (mem))
+      return FALSE;
+
+    priv->dmabuf_fd[i] = gst_dmabuf_memory_get_fd (mem);
+    priv->dmabuf_offset[i] = mem->offset + skip;
+  }
+
+  if (priv->dmabuf_failed && _dmabuf_layout_failed (upload)) {
+    GST_LOG_OBJECT (upload, "not importing a buffer laid out like one that "
+        "failed to");
+    return FALSE;
+  }
+
+  upload->out_texture = texture_id;
+
+  gst_gl_context_thread_add (upload->context,
+      (GstGLContextThreadFunc) _do_upload_dmabuf, upload);
+
+  if (!priv->result) {
+    GST_DEBUG_OBJECT (upload, "dmabuf import failed, not trying buffers laid "
+        "out the same way again");
+    priv->dmabuf_failed = TRUE;
+    for (i = 0; i < priv->n_textures; i++) {
+      priv->dmabuf_failed_offset[i] = priv->dmabuf_offset[i];
+      priv->dmabuf_failed_stride[i] = priv->dmabuf_stride[i];
+    }
+  }
+
+  return priv->result;
+}
+#endif
+
+/* Called in the gl thread */
+/* Folds the offsets and scales of the range of in_info into the
+ * coefficients of its matrix, for samples normalized to [0..1] from the
+ * depth of the format.  Unknown matrices are taken as BT.601 and unknown
+ * ranges as limited, like before the colorimetry was looked at */
+static void
+_init_yuv_to_rgb (GstGLUpload * upload)
+{
+  GstVideoColorimetry *cinfo = &GST_VIDEO_INFO_COLORIMETRY (&upload->in_info);
+  GstGLUploadPrivate *priv = upload->priv;
+  gdouble kr, kb, kg, max, shift, yscale, cscale;
+
+  switch (cinfo->matrix) {
+    case GST_VIDEO_COLOR_MATRIX_FCC:
+      kr = 0.30;
+      kb = 0.11;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_BT709:
+      kr = 0.2126;
+      kb = 0.0722;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_SMPTE240M:
+      kr = 0.212;
+      kb = 0.087;
+      break;
+    case GST_VIDEO_COLOR_MATRIX_BT601:
+    default:
+      kr = 0.299;
+      kb = 0.114;
+      break;
+  }
+  kg = 1.0 - kr - kb;
+
+  shift = 1 << (GST_VIDEO_INFO_COMP_DEPTH (&upload->in_info, 0) - 8);
+  max = 256.0 * shift - 1.0;
+
+  if (cinfo->range == GST_VIDEO_COLOR_RANGE_0_255) {
+    priv->yuv_offset[0] = 0.0;
+    yscale = 1.0;
+    cscale = 1.0;
+  } else {
+    priv->yuv_offset[0] = -16.0 * shift / max;
+    yscale = max / (219.0 * shift);
+    cscale = max / (224.0 * shift);
+  }
+  priv->yuv_offset[1] = priv->yuv_offset[2] = -128.0 * shift / max;
+
+  priv->yuv_coeff[0][0] = yscale;
+  priv->yuv_coeff[0][1] = 0.0;
+  priv->yuv_coeff[0][2] = 2.0 * (1.0 - kr) * cscale;
+  priv->yuv_coeff[1][0] = yscale;
+  priv->yuv_coeff[1][1] = -2.0 * kb * (1.0 - kb) / kg * cscale;
+  priv->yuv_coeff[1][2] = -2.0 * kr * (1.0 - kr) / kg * cscale;
+  priv->yuv_coeff[2][0] = yscale;
+  priv->yuv_coeff[2][1] = 2.0 * (1.0 - kb) * cscale;
+  priv->yuv_coeff[2][2] = 0.0;
+
+  GST_DEBUG ("YUV to RGB for matrix %d range %d depth %u, offset %f %f, "
+      "R %f %f %f G %f %f %f B %f %f %f", cinfo->matrix, cinfo->range,
+      GST_VIDEO_INFO_COMP_DEPTH (&upload->in_info, 0), priv->yuv_offset[0],
+      priv->yuv_offset[1], priv->yuv_coeff[0][0], priv->yuv_coeff[0][1],
+      priv->yuv_coeff[0][2], priv->yuv_coeff[1][0], priv->yuv_coeff[1][1],
+      priv->yuv_coeff[1][2], priv->yuv_coeff[2][0], priv->yuv_coeff[2][1],
+      priv->yuv_coeff[2][2]);
+}
+
+/* Sets the parameters of the conversion that the shaders, cached and shared
+ * between uploads of different inputs, take as uniforms.  Called by the draw
+ * functions (in the gl thread) */
+static void
+_set_conversion_uniforms (GstGLUpload * upload, GstGLShader * shader)
+{
+  GstGLUploadPrivate *priv = upload->priv;
+
+  if (!GST_VIDEO_INFO_IS_YUV (&upload->in_info))
+    return;
+
+  gst_gl_shader_set_uniform_3fv (shader, "offset", 1, priv->yuv_offset);
+  gst_gl_shader_set_uniform_3fv (shader, "rcoeff", 1, priv->yuv_coeff[0]);
+  gst_gl_shader_set_uniform_3fv (shader, "gcoeff", 1, priv->yuv_coeff[1]);
+  gst_gl_shader_set_uniform_3fv (shader, "bcoeff", 1, priv->yuv_coeff[2]);
+
+  if (GST_VIDEO_INFO_FORMAT (&upload->in_info) == GST_VIDEO_FORMAT_v210) {
+    gst_gl_shader_set_uniform_1f (shader, "width",
+        GST_VIDEO_INFO_WIDTH (&upload->in_info));
+    gst_gl_shader_set_uniform_1f (shader, "tex_width",
+        priv->texture_info[0].width);
+  }
+}
+
 void
 _init_upload (GstGLContext * context, GstGLUpload * upload)
 {
@@ -1021,6 +1790,9 @@ _init_upload (GstGLContext * context, GstGLUpload * upload)
     goto error;
   }
 
+  if (GST_VIDEO_INFO_IS_YUV (&upload->in_info))
+    _init_yuv_to_rgb (upload);
+
   switch (v_format) {
     case GST_VIDEO_FORMAT_AYUV:
       frag_prog = (gchar *) upload->priv->AYUV;
@@ -1036,7 +1808,29 @@ _init_upload (GstGLContext * context, GstGLUpload * upload)
       free_frag_prog = FALSE;
       upload->priv->n_textures = 3;
       break;
+    case GST_VIDEO_FORMAT_I420_10LE:
+    case GST_VIDEO_FORMAT_I422_10LE:
+    case GST_VIDEO_FORMAT_Y444_10LE:
+      frag_prog = g_strdup_printf (upload->priv->PLANAR_YUV_10,
+          'a', 'r', 'a', 'r', 'a', 'r');
+      free_frag_prog = TRUE;
+      upload->priv->n_textures = 3;
+      break;
+    case GST_VIDEO_FORMAT_I420_10BE:
+    case GST_VIDEO_FORMAT_I422_10BE:
+    case GST_VIDEO_FORMAT_Y444_10BE:
+      frag_prog = g_strdup_printf (upload->priv->PLANAR_YUV_10,
+          'r', 'a', 'r', 'a', 'r', 'a');
+      free_frag_prog = TRUE;
+      upload->priv->n_textures = 3;
+      break;
+    case GST_VIDEO_FORMAT_v210:
+      frag_prog = (gchar *) upload->priv->v210;
+      free_frag_prog = FALSE;
+      upload->priv->n_textures = 1;
+      break;
     case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV16:
       frag_prog = g_strdup_printf (upload->priv->NV12_NV21, 'r', 'a');
       free_frag_prog = TRUE;
       upload->priv->n_textures = 2;
@@ -1169,8 +1963,8 @@ _init_upload_fbo (GstGLContext * context, GstGLUpload * upload)
   /* a fake texture is attached to the upload FBO (cannot init without it) */
   gl->GenTextures (1, &fake_texture);
   gl->BindTexture (GL_TEXTURE_2D, fake_texture);
-  gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, out_width, out_height,
-      0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  gst_gl_context_tex_storage_2d (context, GL_RGBA, GL_UNSIGNED_BYTE,
+      out_width, out_height);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -1207,6 +2001,7 @@ void
 _do_upload (GstGLContext * context, GstGLUpload * upload)
 {
   guint in_width, in_height, out_width, out_height;
+  GstGLProfileSection *section;
 
   out_width = GST_VIDEO_INFO_WIDTH (&upload->out_info);
   out_height = GST_VIDEO_INFO_HEIGHT (&upload->out_info);
@@ -1215,8 +2010,12 @@ _do_upload (GstGLContext * context, GstGLUpload * upload)
 
   GST_TRACE ("uploading to texture:%u dimensions:%ux%u, "
       "from textures:%u,%u,%u dimensions:%ux%u", upload->out_texture,
-      out_width, out_height, upload->in_texture[0], upload->in_texture[1],
-      upload->in_texture[2], in_width, in_height);
+      out_width, out_height, upload->priv->planes[0], upload->priv->planes[1],
+      upload->priv->planes[2], in_width, in_height);
+
+  section = gst_gl_profile_begin (context, "upload %s %ux%u",
+      gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (&upload->in_info)),
+      in_width, in_height);
 
   if (!_do_upload_fill (context, upload))
     goto error;
@@ -1224,16 +2023,56 @@ _do_upload (GstGLContext * context, GstGLUpload * upload)
   if (!upload->priv->draw (context, upload))
     goto error;
 
+  gst_gl_profile_end (context, section);
+
   upload->priv->result = TRUE;
   return;
 
 error:
   {
+    gst_gl_profile_end (context, section);
     upload->priv->result = FALSE;
     return;
   }
 }
 
+/* Called by the idle function in the gl thread, only transfers the data into
+ * the planes, creating them if needed */
+static void
+_do_upload_planes (GstGLContext * context, GstGLUpload * upload)
+{
+  GstGLProfileSection *section;
+
+  section = gst_gl_profile_begin (context, "upload planes %s %ux%u",
+      gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (&upload->in_info)),
+      GST_VIDEO_INFO_WIDTH (&upload->in_info),
+      GST_VIDEO_INFO_HEIGHT (&upload->in_info));
+
+  if (!upload->priv->planes[0])
+    _gen_input_textures (context, upload, upload->priv->planes);
+
+  upload->priv->result = _do_upload_fill (context, upload);
+
+  gst_gl_profile_end (context, section);
+}
+
+/* Called by the idle function in the gl thread, only converts planes that
+ * have already been transferred */
+static void
+_do_upload_convert (GstGLContext * context, GstGLUpload * upload)
+{
+  GstGLProfileSection *section;
+
+  section = gst_gl_profile_begin (context, "convert %s %ux%u",
+      gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (&upload->in_info)),
+      GST_VIDEO_INFO_WIDTH (&upload->in_info),
+      GST_VIDEO_INFO_HEIGHT (&upload->in_info));
+
+  upload->priv->result = upload->priv->draw (context, upload);
+
+  gst_gl_profile_end (context, section);
+}
+
 static inline guint
 _gl_format_n_components (GLenum format)
 {
@@ -1255,14 +2094,11 @@ _gl_format_n_components (GLenum format)
 gboolean
 _do_upload_make (GstGLContext * context, GstGLUpload * upload)
 {
-  GstGLFuncs *gl;
   GstVideoFormat v_format;
   guint in_height;
   struct TexData *tex = upload->priv->texture_info;
   guint i;
 
-  gl = context->gl_vtable;
-
   in_height = GST_VIDEO_INFO_HEIGHT (&upload->in_info);
   v_format = GST_VIDEO_INFO_FORMAT (&upload->in_info);
 
@@ -1276,7 +2112,6 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
     case GST_VIDEO_FORMAT_ARGB:
     case GST_VIDEO_FORMAT_ABGR:
     case GST_VIDEO_FORMAT_AYUV:
-      tex[0].internal_format = GL_RGBA;
       tex[0].format = GL_RGBA;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
@@ -1284,14 +2119,12 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
       break;
     case GST_VIDEO_FORMAT_RGB:
     case GST_VIDEO_FORMAT_BGR:
-      tex[0].internal_format = GL_RGB;
       tex[0].format = GL_RGB;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
       tex[0].shader_name = "tex";
       break;
     case GST_VIDEO_FORMAT_GRAY8:
-      tex[0].internal_format = GL_LUMINANCE;
       tex[0].format = GL_LUMINANCE;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
@@ -1299,7 +2132,6 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
       break;
     case GST_VIDEO_FORMAT_GRAY16_BE:
     case GST_VIDEO_FORMAT_GRAY16_LE:
-      tex[0].internal_format = GL_LUMINANCE_ALPHA;
       tex[0].format = GL_LUMINANCE_ALPHA;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
@@ -1307,12 +2139,10 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
       break;
     case GST_VIDEO_FORMAT_YUY2:
     case GST_VIDEO_FORMAT_UYVY:
-      tex[0].internal_format = GL_LUMINANCE_ALPHA;
       tex[0].format = GL_LUMINANCE_ALPHA;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
       tex[0].shader_name = "Ytex";
-      tex[1].internal_format = GL_RGBA8;
       tex[1].format = GL_RGBA;
       tex[1].type = GL_UNSIGNED_BYTE;
       tex[1].height = in_height;
@@ -1320,31 +2150,36 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
       break;
     case GST_VIDEO_FORMAT_NV12:
     case GST_VIDEO_FORMAT_NV21:
-      tex[0].internal_format = GL_LUMINANCE;
       tex[0].format = GL_LUMINANCE;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
       tex[0].shader_name = "Ytex";
-      tex[1].internal_format = GL_LUMINANCE_ALPHA;
       tex[1].format = GL_LUMINANCE_ALPHA;
       tex[1].type = GL_UNSIGNED_BYTE;
       tex[1].height = GST_ROUND_UP_2 (in_height) / 2;
       tex[1].shader_name = "UVtex";
       break;
+    case GST_VIDEO_FORMAT_NV16:
+      tex[0].format = GL_LUMINANCE;
+      tex[0].type = GL_UNSIGNED_BYTE;
+      tex[0].height = in_height;
+      tex[0].shader_name = "Ytex";
+      tex[1].format = GL_LUMINANCE_ALPHA;
+      tex[1].type = GL_UNSIGNED_BYTE;
+      tex[1].height = in_height;
+      tex[1].shader_name = "UVtex";
+      break;
     case GST_VIDEO_FORMAT_Y444:
     case GST_VIDEO_FORMAT_Y42B:
     case GST_VIDEO_FORMAT_Y41B:
-      tex[0].internal_format = GL_LUMINANCE;
       tex[0].format = GL_LUMINANCE;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
       tex[0].shader_name = "Ytex";
-      tex[1].internal_format = GL_LUMINANCE;
       tex[1].format = GL_LUMINANCE;
       tex[1].type = GL_UNSIGNED_BYTE;
       tex[1].height = in_height;
       tex[1].shader_name = "Utex";
-      tex[2].internal_format = GL_LUMINANCE;
       tex[2].format = GL_LUMINANCE;
       tex[2].type = GL_UNSIGNED_BYTE;
       tex[2].height = in_height;
@@ -1352,22 +2187,42 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
       break;
     case GST_VIDEO_FORMAT_I420:
     case GST_VIDEO_FORMAT_YV12:
-      tex[0].internal_format = GL_LUMINANCE;
       tex[0].format = GL_LUMINANCE;
       tex[0].type = GL_UNSIGNED_BYTE;
       tex[0].height = in_height;
       tex[0].shader_name = "Ytex";
-      tex[1].internal_format = GL_LUMINANCE;
       tex[1].format = GL_LUMINANCE;
       tex[1].type = GL_UNSIGNED_BYTE;
       tex[1].height = GST_ROUND_UP_2 (in_height) / 2;
       tex[1].shader_name = "Utex";
-      tex[2].internal_format = GL_LUMINANCE;
       tex[2].format = GL_LUMINANCE;
       tex[2].type = GL_UNSIGNED_BYTE;
       tex[2].height = GST_ROUND_UP_2 (in_height) / 2;
       tex[2].shader_name = "Vtex";
       break;
+    case GST_VIDEO_FORMAT_I420_10LE:
+    case GST_VIDEO_FORMAT_I420_10BE:
+    case GST_VIDEO_FORMAT_I422_10LE:
+    case GST_VIDEO_FORMAT_I422_10BE:
+    case GST_VIDEO_FORMAT_Y444_10LE:
+    case GST_VIDEO_FORMAT_Y444_10BE:
+      /* 16 bit containers, composed again in the shader */
+      for (i = 0; i < 3; i++) {
+        tex[i].format = GL_LUMINANCE_ALPHA;
+        tex[i].type = GL_UNSIGNED_BYTE;
+        tex[i].height = GST_VIDEO_INFO_COMP_HEIGHT (&upload->in_info, i);
+      }
+      tex[0].shader_name = "Ytex";
+      tex[1].shader_name = "Utex";
+      tex[2].shader_name = "Vtex";
+      break;
+    case GST_VIDEO_FORMAT_v210:
+      /* a texel per 32 bit word, the shader unpacks the components */
+      tex[0].format = GL_RGBA;
+      tex[0].type = upload->priv->v210_type;
+      tex[0].height = in_height;
+      tex[0].shader_name = "tex";
+      break;
     default:
       gst_gl_context_set_error (context, "Unsupported upload video format %d",
           v_format);
@@ -1378,14 +2233,17 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
   for (i = 0; i < upload->priv->n_textures; i++) {
     guint plane_stride, plane_width;
 
-    if (GST_VIDEO_INFO_IS_YUV (&upload->in_info))
+    plane_stride = GST_VIDEO_INFO_PLANE_STRIDE (&upload->in_info, i);
+    if (v_format == GST_VIDEO_FORMAT_v210)
+      /* the whole row of words, blocks of 6 pixels padded to 128 bytes */
+      plane_width = plane_stride / 4;
+    else if (GST_VIDEO_INFO_IS_YUV (&upload->in_info))
       /* For now component width and plane width are the same and the
        * plane-component mapping matches
        */
       plane_width = GST_VIDEO_INFO_COMP_WIDTH (&upload->in_info, i);
     else                        /* RGB, GRAY */
       plane_width = GST_VIDEO_INFO_WIDTH (&upload->in_info);
-    plane_stride = GST_VIDEO_INFO_PLANE_STRIDE (&upload->in_info, i);
 
     /* YUV interleaved packed formats require special attention as we upload
      * multiple textures from the same plane.
@@ -1398,6 +2256,9 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
     tex[i].width = plane_width;
     tex[i].tex_scaling[0] = 1.0f;
     tex[i].tex_scaling[1] = 1.0f;
+    /* interpolating packed words would mix their components */
+    tex[i].filter =
+        v_format == GST_VIDEO_FORMAT_v210 ? GL_NEAREST : GL_LINEAR;
 
 #if GST_GL_HAVE_OPENGL || GST_GL_HAVE_GLES3
     if (USING_OPENGL (context) || USING_GLES3 (context)) {
@@ -1411,7 +2272,11 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
       guint pstride, n_planes;
       guint j = 8;
 
-      pstride = GST_VIDEO_INFO_COMP_PSTRIDE (&upload->in_info, i);
+      /* v210 has no pixel stride, its texels are 4 byte words */
+      if (v_format == GST_VIDEO_FORMAT_v210)
+        pstride = 4;
+      else
+        pstride = GST_VIDEO_INFO_COMP_PSTRIDE (&upload->in_info, i);
       n_planes = GST_VIDEO_INFO_N_PLANES (&upload->in_info);
 
       while (j >= pstride) {
@@ -1463,16 +2328,166 @@ _do_upload_make (GstGLContext * context, GstGLUpload * upload)
     }
 #endif
 
-    gl->GenTextures (1, &upload->in_texture[i]);
-    gl->BindTexture (GL_TEXTURE_2D, upload->in_texture[i]);
+  }
+
+  _gen_input_textures (context, upload, upload->in_texture);
+
+  return TRUE;
+}
+
+/* Creates the input textures described by the texture info into @textures.
+ * Called by _do_upload_make and _do_upload_planes (in the gl thread) */
+static void
+_gen_input_textures (GstGLContext * context, GstGLUpload * upload,
+    GLuint * textures)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  struct TexData *tex = upload->priv->texture_info;
+  guint i;
+
+  for (i = 0; i < upload->priv->n_textures; i++) {
+    gl->GenTextures (1, &textures[i]);
+    gl->BindTexture (GL_TEXTURE_2D, textures[i]);
+
+    gst_gl_context_tex_storage_2d (context, tex[i].format, tex[i].type,
+        tex[i].width, tex[i].height);
+  }
+}
+
+
+/* called by _do_upload_fill (in the gl thread) */
+static gboolean
+_init_upload_pbo (GstGLContext * context, GstGLUpload * upload)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLUploadPrivate *priv = upload->priv;
+  guint i, n_planes;
+
+  if (!(USING_OPENGL (context) || USING_GLES3 (context)) || !gl->GenBuffers
+      || !gl->MapBufferRange || !gl->UnmapBuffer) {
+    GST_WARNING ("Pixel unpack buffers are not supported by this context, "
+        "falling back to uploading from client memory");
+    return FALSE;
+  }
+
+  n_planes = GST_VIDEO_INFO_N_PLANES (&upload->in_info);
+  priv->pbo_size = 0;
+  for (i = 0; i < n_planes; i++) {
+    /* plane i is component i for all the formats we support */
+    priv->pbo_offset[i] = priv->pbo_size;
+    priv->pbo_plane_size[i] =
+        GST_VIDEO_INFO_PLANE_STRIDE (&upload->in_info, i) *
+        GST_VIDEO_INFO_COMP_HEIGHT (&upload->in_info, i);
+    priv->pbo_size += GST_ROUND_UP_16 (priv->pbo_plane_size[i]);
+  }
+
+  priv->pbo_persistent = gl->BufferStorage && gl->FenceSync;
+
+  GST_INFO ("Creating %u %spixel unpack buffers of size %" G_GSIZE_FORMAT,
+      N_PBOS, priv->pbo_persistent ? "persistently mapped " : "",
+      priv->pbo_size);
+
+  gl->GenBuffers (N_PBOS, priv->pbo);
+  for (i = 0; i < N_PBOS; i++) {
+    gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, priv->pbo[i]);
 
-    gl->TexImage2D (GL_TEXTURE_2D, 0, tex[i].internal_format,
-        tex[i].width, tex[i].height, 0, tex[i].format, tex[i].type, NULL);
+    if (priv->pbo_persistent) {
+      GLbitfield flags =
+          GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+      gl->BufferStorage (GL_PIXEL_UNPACK_BUFFER, priv->pbo_size, NULL, flags);
+      priv->pbo_data[i] = gl->MapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0,
+          priv->pbo_size, flags);
+      if (!priv->pbo_data[i]) {
+        gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+        _cleanup_upload_pbo (context, upload);
+        GST_WARNING ("Failed to persistently map pixel unpack buffer");
+        return FALSE;
+      }
+    } else {
+      gl->BufferData (GL_PIXEL_UNPACK_BUFFER, priv->pbo_size, NULL,
+          GL_STREAM_DRAW);
+    }
   }
+  gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+
+  priv->pbo_index = 0;
 
   return TRUE;
 }
 
+/* called in the gl thread */
+static void
+_cleanup_upload_pbo (GstGLContext * context, GstGLUpload * upload)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLUploadPrivate *priv = upload->priv;
+  guint i;
+
+  for (i = 0; i < N_PBOS; i++) {
+    if (priv->pbo_sync[i]) {
+      gl->DeleteSync (priv->pbo_sync[i]);
+      priv->pbo_sync[i] = NULL;
+    }
+    if (priv->pbo_data[i]) {
+      gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, priv->pbo[i]);
+      gl->UnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+      priv->pbo_data[i] = NULL;
+    }
+  }
+  gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+
+  if (priv->pbo[0]) {
+    gl->DeleteBuffers (N_PBOS, priv->pbo);
+    memset (priv->pbo, 0, sizeof (priv->pbo));
+  }
+}
+
+/* Copies the client data into the next buffer in the ring and leaves it bound
+ * to GL_PIXEL_UNPACK_BUFFER.  Called by _do_upload_fill (in the gl thread) */
+static gboolean
+_do_upload_fill_pbo (GstGLContext * context, GstGLUpload * upload)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLUploadPrivate *priv = upload->priv;
+  guint idx = priv->pbo_index;
+  guint8 *ptr;
+  guint i;
+
+  gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, priv->pbo[idx]);
+
+  if (priv->pbo_persistent) {
+    if (priv->pbo_sync[idx]) {
+      if (gl->ClientWaitSync (priv->pbo_sync[idx], GL_SYNC_FLUSH_COMMANDS_BIT,
+              GST_SECOND) == GL_WAIT_FAILED)
+        GST_WARNING ("Failed to wait for pixel unpack buffer %u", idx);
+      gl->DeleteSync (priv->pbo_sync[idx]);
+      priv->pbo_sync[idx] = NULL;
+    }
+    ptr = priv->pbo_data[idx];
+  } else {
+    /* invalidating lets the driver hand us fresh storage instead of
+     * synchronizing with a previous transfer */
+    ptr = gl->MapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, priv->pbo_size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  }
+
+  if (!ptr) {
+    GST_WARNING ("Failed to map pixel unpack buffer %u, uploading from "
+        "client memory", idx);
+    gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    return FALSE;
+  }
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&upload->in_info); i++)
+    memcpy (ptr + priv->pbo_offset[i], upload->data[i],
+        priv->pbo_plane_size[i]);
+
+  if (!priv->pbo_persistent)
+    gl->UnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+
+  return TRUE;
+}
 
 /* called by gst_gl_context_thread_do_upload (in the gl thread) */
 gboolean
@@ -1482,11 +2497,20 @@ _do_upload_fill (GstGLContext * context, GstGLUpload * upload)
   GstVideoFormat v_format;
   struct TexData *tex = upload->priv->texture_info;
   const GstGLFuncs *gl = context->gl_vtable;
+  gboolean using_pbo = FALSE;
 
   v_format = GST_VIDEO_INFO_FORMAT (&upload->in_info);
 
+  if (upload->priv->use_pbo && !upload->priv->pbo_failed) {
+    if (!upload->priv->pbo[0] && !_init_upload_pbo (context, upload))
+      upload->priv->pbo_failed = TRUE;
+    else
+      using_pbo = _do_upload_fill_pbo (context, upload);
+  }
+
   for (i = 0; i < upload->priv->n_textures; i++) {
     guint data_i = i;
+    gpointer data;
 
     /* upload from the same plane */
     if (v_format == GST_VIDEO_FORMAT_YUY2 || v_format == GST_VIDEO_FORMAT_UYVY)
@@ -1510,12 +2534,32 @@ _do_upload_fill (GstGLContext * context, GstGLUpload * upload)
     }
 #endif
 
-    GST_LOG ("data transfer for texture no %u, id:%u, %ux%u %u", i,
-        upload->in_texture[i], tex[i].width, tex[i].height, data_i);
+    GST_LOG ("data transfer for texture no %u, id:%u, %ux%u %u%s", i,
+        upload->priv->planes[i], tex[i].width, tex[i].height, data_i,
+        using_pbo ? " from PBO" : "");
 
-    gl->BindTexture (GL_TEXTURE_2D, upload->in_texture[i]);
+    /* with a bound pixel unpack buffer the pointer is an offset into it */
+    if (using_pbo)
+      data = (gpointer) upload->priv->pbo_offset[data_i];
+    else
+      data = upload->data[data_i];
+
+    gl->BindTexture (GL_TEXTURE_2D, upload->priv->planes[i]);
     gl->TexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, tex[i].width, tex[i].height,
-        tex[i].format, tex[i].type, upload->data[data_i]);
+        tex[i].format, tex[i].type, data);
+  }
+
+  if (using_pbo) {
+    guint idx = upload->priv->pbo_index;
+
+    /* the persistent mapping is written to while the GPU may still be
+     * reading from it, so fence the slot before it is reused */
+    if (upload->priv->pbo_persistent)
+      upload->priv->pbo_sync[idx] =
+          gl->FenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    gl->BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    upload->priv->pbo_index = (idx + 1) % N_PBOS;
   }
 
   /* Reset to default values */
@@ -1546,21 +2590,19 @@ _do_upload_draw_opengl (GstGLContext * context, GstGLUpload * upload)
   GstGLFuncs *gl;
   guint out_width, out_height;
   struct TexData *tex = upload->priv->texture_info;
+  GstGLShader *shader = upload->shader;
+  GLuint *in_texture = upload->priv->planes;
+  gfloat unit_scaling[2] = { 1.0f, 1.0f };
   gint i;
 
-  GLfloat verts[8] = { 1.0f, -1.0f,
-    -1.0f, -1.0f,
-    -1.0f, 1.0f,
-    1.0f, 1.0f
-  };
-  GLfloat texcoords[8] = { 1.0f, 0.0f,
-    0.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f
-  };
-
   gl = context->gl_vtable;
 
+  /* imported planes carry their own stride and need no scaling */
+  if (upload->priv->use_dmabuf) {
+    shader = upload->priv->dmabuf_shader;
+    in_texture = upload->priv->dmabuf_texture;
+  }
+
   out_width = GST_VIDEO_INFO_WIDTH (&upload->out_info);
   out_height = GST_VIDEO_INFO_HEIGHT (&upload->out_info);
 
@@ -1594,7 +2636,8 @@ _do_upload_draw_opengl (GstGLContext * context, GstGLUpload * upload)
   gl->ClearColor (0.0, 0.0, 0.0, 0.0);
   gl->Clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  gst_gl_shader_use (upload->shader);
+  gst_gl_shader_use (shader);
+  _set_conversion_uniforms (upload, shader);
 
   gl->MatrixMode (GL_PROJECTION);
   gl->LoadIdentity ();
@@ -1605,28 +2648,20 @@ _do_upload_draw_opengl (GstGLContext * context, GstGLUpload * upload)
     gchar *scale_name = g_strdup_printf ("tex_scale%u", i);
 
     gl->ActiveTexture (GL_TEXTURE0 + i);
-    gst_gl_shader_set_uniform_1i (upload->shader, tex[i].shader_name, i);
-    gst_gl_shader_set_uniform_2fv (upload->shader, scale_name, 1,
+    gst_gl_shader_set_uniform_1i (shader, tex[i].shader_name, i);
+    gst_gl_shader_set_uniform_2fv (shader, scale_name, 1,
+        upload->priv->use_dmabuf ? unit_scaling :
         &tex[i].tex_scaling[0]);
     g_free (scale_name);
 
-    gl->BindTexture (GL_TEXTURE_2D, upload->in_texture[i]);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->BindTexture (GL_TEXTURE_2D, in_texture[i]);
+    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, tex[i].filter);
+    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tex[i].filter);
     gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   }
 
-  gl->EnableClientState (GL_VERTEX_ARRAY);
-  gl->EnableClientState (GL_TEXTURE_COORD_ARRAY);
-
-  gl->VertexPointer (2, GL_FLOAT, 0, &verts);
-  gl->TexCoordPointer (2, GL_FLOAT, 0, &texcoords);
-
-  gl->DrawArrays (GL_TRIANGLE_FAN, 0, 4);
-
-  gl->DisableClientState (GL_VERTEX_ARRAY);
-  gl->DisableClientState (GL_TEXTURE_COORD_ARRAY);
+  gst_gl_context_draw_fullscreen_quad (context, -1, -1, FALSE);
 
   gl->DrawBuffer (GL_NONE);
 
@@ -1655,25 +2690,26 @@ _do_upload_draw_gles2 (GstGLContext * context, GstGLUpload * upload)
 {
   GstGLFuncs *gl;
   struct TexData *tex = upload->priv->texture_info;
+  GstGLShader *shader = upload->shader;
+  GLuint *in_texture = upload->priv->planes;
+  GLint position_loc = upload->shader_attr_position_loc;
+  GLint texture_loc = upload->shader_attr_texture_loc;
+  gfloat unit_scaling[2] = { 1.0f, 1.0f };
   guint out_width, out_height;
   gint i;
 
   GLint viewport_dim[4];
 
-  const GLfloat vVertices[] = { 1.0f, -1.0f, 0.0f,
-    1.0f, 0.0f,
-    -1.0f, -1.0f, 0.0f,
-    0.0f, 0.0f,
-    -1.0f, 1.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, 1.0f
-  };
-
-  GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
   gl = context->gl_vtable;
 
+  /* imported planes carry their own stride and need no scaling */
+  if (upload->priv->use_dmabuf) {
+    shader = upload->priv->dmabuf_shader;
+    in_texture = upload->priv->dmabuf_texture;
+    position_loc = gst_gl_shader_get_attribute_location (shader, "a_position");
+    texture_loc = gst_gl_shader_get_attribute_location (shader, "a_texcoord");
+  }
+
   out_width = GST_VIDEO_INFO_WIDTH (&upload->out_info);
   out_height = GST_VIDEO_INFO_HEIGHT (&upload->out_info);
 
@@ -1695,34 +2731,29 @@ _do_upload_draw_gles2 (GstGLContext * context, GstGLUpload * upload)
   gl->ClearColor (0.0, 0.0, 0.0, 0.0);
   gl->Clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  gst_gl_shader_use (upload->shader);
-
-  gl->VertexAttribPointer (upload->shader_attr_position_loc, 3,
-      GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), vVertices);
-  gl->VertexAttribPointer (upload->shader_attr_texture_loc, 2,
-      GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), &vVertices[3]);
-
-  gl->EnableVertexAttribArray (upload->shader_attr_position_loc);
-  gl->EnableVertexAttribArray (upload->shader_attr_texture_loc);
+  gst_gl_shader_use (shader);
+  _set_conversion_uniforms (upload, shader);
 
   for (i = upload->priv->n_textures - 1; i >= 0; i--) {
     gchar *scale_name = g_strdup_printf ("tex_scale%u", i);
 
     gl->ActiveTexture (GL_TEXTURE0 + i);
-    gst_gl_shader_set_uniform_1i (upload->shader, tex[i].shader_name, i);
-    gst_gl_shader_set_uniform_2fv (upload->shader, scale_name, 1,
+    gst_gl_shader_set_uniform_1i (shader, tex[i].shader_name, i);
+    gst_gl_shader_set_uniform_2fv (shader, scale_name, 1,
+        upload->priv->use_dmabuf ? unit_scaling :
         &tex[i].tex_scaling[0]);
 
     g_free (scale_name);
 
-    gl->BindTexture (GL_TEXTURE_2D, upload->in_texture[i]);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->BindTexture (GL_TEXTURE_2D, in_texture[i]);
+    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, tex[i].filter);
+    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tex[i].filter);
     gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   }
 
-  gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+  gst_gl_context_draw_fullscreen_quad (context, position_loc, texture_loc,
+      FALSE);
 
   /* we are done with the shader */
   gst_gl_context_clear_shader (context);
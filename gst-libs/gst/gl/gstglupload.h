@@ -89,8 +89,10 @@ struct _GstGLUploadClass
  */
 #define GST_GL_UPLOAD_FORMATS "{ RGB, RGBx, RGBA, BGR, BGRx, BGRA, xRGB, " \
                                "xBGR, ARGB, ABGR, Y444, I420, YV12, Y42B, " \
-                               "Y41B, NV12, NV21, YUY2, UYVY, AYUV, " \
-                               "GRAY8, GRAY16_LE, GRAY16_BE }"
+                               "Y41B, NV12, NV21, NV16, YUY2, UYVY, AYUV, " \
+                               "GRAY8, GRAY16_LE, GRAY16_BE, I420_10LE, " \
+                               "I420_10BE, I422_10LE, I422_10BE, " \
+                               "Y444_10LE, Y444_10BE, v210 }"
 
 /**
  * GST_GL_UPLOAD_VIDEO_CAPS:
@@ -108,6 +110,7 @@ gboolean gst_gl_upload_add_video_gl_texture_upload_meta (GstGLUpload * upload, G
 gboolean gst_gl_upload_perform_with_buffer (GstGLUpload * upload, GstBuffer * buffer, guint * tex_id);
 void gst_gl_upload_release_buffer (GstGLUpload * upload);
 gboolean gst_gl_upload_perform_with_memory        (GstGLUpload * upload, GstGLMemory * gl_mem);
+gboolean gst_gl_upload_perform_planes_with_memory (GstGLUpload * upload, GstGLMemory * gl_mem);
 gboolean gst_gl_upload_perform_with_data          (GstGLUpload * upload, GLuint texture_id,
                                                    gpointer data[GST_VIDEO_MAX_PLANES]);
 
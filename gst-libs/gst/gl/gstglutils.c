@@ -44,11 +44,22 @@
 #define GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS 0x8CD9
 #endif
 
-#define USING_OPENGL(context) (gst_gl_context_get_gl_apie (context) & GST_GL_API_OPENGL)
-#define USING_OPENGL3(context) (gst_gl_context_get_gl_apie (context) & GST_GL_API_OPENGL3)
-#define USING_GLES(context) (gst_gl_context_get_gl_apie (context) & GST_GL_API_GLES)
-#define USING_GLES2(context) (gst_gl_context_get_gl_apie (context)->gl_api & GST_GL_API_GLES2)
-#define USING_GLES3(context) (gst_gl_context_get_gl_apie (context) & GST_GL_API_GLES3)
+#define USING_OPENGL(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL)
+#define USING_OPENGL3(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL3)
+#define USING_GLES(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES)
+#define USING_GLES2(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES2)
+#define USING_GLES3(context) (gst_gl_context_get_gl_api (context) & GST_GL_API_GLES3)
+
+/* sized internal formats for immutable storage, GL_RGBA8 itself is aliased
+ * to GL_RGBA in GLES2 builds */
+#define SIZED_RGBA8 0x8058
+#define SIZED_RGB8 0x8051
+#define SIZED_LUMINANCE8 0x8040
+#define SIZED_LUMINANCE8_ALPHA8 0x8045
+#define SIZED_RGB10_A2 0x8059
+#ifndef GL_UNSIGNED_INT_2_10_10_10_REV
+#define GL_UNSIGNED_INT_2_10_10_10_REV 0x8368
+#endif
 
 static gchar *error_message;
 
@@ -90,32 +101,454 @@ gst_gl_context_check_framebuffer_status (GstGLContext * context)
   return FALSE;
 }
 
-typedef struct _GenTexture
+/* Textures handed out by gst_gl_context_acquire_texture() are returned to a
+ * per-context free list by gst_gl_context_release_texture() and reused for
+ * the next request with the same dimensions.  At most MAX_FREE_TEXTURES are
+ * kept, the least recently released ones are deleted first.  The pool is
+ * only ever touched in the gl thread, the context frees it there before
+ * destroying itself so that the free list doesn't outlive it in the share
+ * group. */
+#define MAX_FREE_TEXTURES 16
+
+typedef struct
 {
-  guint width, height;
-  GstVideoFormat format;
-  guint result;
-} GenTexture;
+  GLuint id;
+  GLenum internal_format;
+  gint width, height;
+} PooledTexture;
+
+typedef struct
+{
+  GstGLContext *context;
+
+  /* GLuint -> PooledTexture of every texture currently handed out */
+  GHashTable *used;
+  /* released PooledTexture's, oldest first */
+  GQueue free;
+
+  guint64 n_generated;
+  guint64 n_reused;
+  guint64 n_deleted;
+} TexturePool;
 
 static void
-_gen_texture (GstGLContext * context, GenTexture * data)
+_free_pooled_texture (PooledTexture * tex)
 {
-  const GstGLFuncs *gl = context->gl_vtable;
+  g_slice_free (PooledTexture, tex);
+}
 
-  GST_TRACE ("Generating texture format:%u dimensions:%ux%u", data->format,
-      data->width, data->height);
+static void
+_delete_pooled_texture (PooledTexture * tex, TexturePool * pool)
+{
+  pool->context->gl_vtable->DeleteTextures (1, &tex->id);
+  pool->n_deleted++;
+  _free_pooled_texture (tex);
+}
 
-  gl->GenTextures (1, &data->result);
-  gl->BindTexture (GL_TEXTURE_2D, data->result);
-  gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, data->width,
-      data->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+/* called in the gl thread */
+static void
+_free_texture_pool (TexturePool * pool)
+{
+  /* the handed out textures are their users' responsibility */
+  g_queue_foreach (&pool->free, (GFunc) _delete_pooled_texture, pool);
+  g_queue_clear (&pool->free);
+
+  GST_DEBUG ("texture pool %p: %" G_GUINT64_FORMAT " generated, %"
+      G_GUINT64_FORMAT " reused, %" G_GUINT64_FORMAT " deleted", pool,
+      pool->n_generated, pool->n_reused, pool->n_deleted);
+
+  g_hash_table_destroy (pool->used);
+  g_slice_free (TexturePool, pool);
+}
+
+static TexturePool *
+_get_texture_pool (GstGLContext * context)
+{
+  GQuark quark = g_quark_from_static_string ("GstGLTexturePool");
+  TexturePool *pool;
+
+  pool = g_object_get_qdata (G_OBJECT (context), quark);
+  if (!pool) {
+    pool = g_slice_new0 (TexturePool);
+    pool->context = context;
+    pool->used = g_hash_table_new_full (NULL, NULL, NULL,
+        (GDestroyNotify) _free_pooled_texture);
+    g_queue_init (&pool->free);
+    g_object_set_qdata_full (G_OBJECT (context), quark, pool,
+        (GDestroyNotify) _free_texture_pool);
+  }
+
+  return pool;
+}
+
+/* the parameters of the texture bound to GL_TEXTURE_2D every texture of the
+ * pool is handed out with */
+static void
+_set_default_texture_parameters (GstGLContext * context)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
 
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+/**
+ * gst_gl_context_acquire_texture:
+ * @context: a #GstGLContext
+ * @v_format: the #GstVideoFormat the texture will hold
+ * @width: width of the texture
+ * @height: height of the texture
+ *
+ * Retrieves a texture of the given dimensions from @context's pool of
+ * released textures or creates a new one if there is none.  The contents of
+ * a recycled texture are whatever its previous user left, its filters are
+ * reset to GL_LINEAR and its wrap modes to GL_CLAMP_TO_EDGE like those of a
+ * new one.  Release it with gst_gl_context_release_texture().
+ *
+ * Must be called in the GL thread.
+ *
+ * Returns: the texture id or 0 on failure
+ */
+GLuint
+gst_gl_context_acquire_texture (GstGLContext * context,
+    GstVideoFormat v_format, gint width, gint height)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  TexturePool *pool = _get_texture_pool (context);
+  PooledTexture *tex = NULL;
+  GLuint result = 0;
+  GList *l;
+
+  GST_TRACE ("Generating texture format:%u dimensions:%dx%d", v_format,
+      width, height);
+
+  /* every texture is currently RGBA8 whatever the video format, so only the
+   * dimensions need to match */
+  for (l = pool->free.tail; l; l = l->prev) {
+    PooledTexture *t = l->data;
+
+    if (t->internal_format == GL_RGBA8 && t->width == width
+        && t->height == height) {
+      tex = t;
+      g_queue_delete_link (&pool->free, l);
+      break;
+    }
+  }
+
+  if (tex) {
+    pool->n_reused++;
+    g_hash_table_insert (pool->used, GUINT_TO_POINTER (tex->id), tex);
+    GST_LOG ("reusing texture id:%d", tex->id);
+
+    gl->BindTexture (GL_TEXTURE_2D, tex->id);
+    _set_default_texture_parameters (context);
+
+    return tex->id;
+  }
+
+  gl->GenTextures (1, &result);
+  gl->BindTexture (GL_TEXTURE_2D, result);
+  gst_gl_context_tex_storage_2d (context, GL_RGBA, GL_UNSIGNED_BYTE, width,
+      height);
+
+  _set_default_texture_parameters (context);
+
+  if (result) {
+    tex = g_slice_new (PooledTexture);
+    tex->id = result;
+    tex->internal_format = GL_RGBA8;
+    tex->width = width;
+    tex->height = height;
+    g_hash_table_insert (pool->used, GUINT_TO_POINTER (tex->id), tex);
+    pool->n_generated++;
+  }
+
+  GST_LOG ("generated texture id:%d", result);
+
+  return result;
+}
+
+/**
+ * gst_gl_context_tex_storage_2d:
+ * @context: a #GstGLContext
+ * @format: the format of the texture, GL_RGBA, GL_RGB, GL_LUMINANCE or
+ *          GL_LUMINANCE_ALPHA
+ * @type: the type of the data that will be uploaded into the texture
+ * @width: width of the texture
+ * @height: height of the texture
+ *
+ * Allocates the storage of the texture currently bound to GL_TEXTURE_2D.
+ * GL_RGBA with GL_UNSIGNED_INT_2_10_10_10_REV data is stored as GL_RGB10_A2
+ * and keeps the 10 bits of its components.
+ * Where glTexStorage2D is available and @format has a sized
+ * equivalent, the storage is immutable so that the driver does not need to
+ * revalidate the texture on every update.  Otherwise the texture is
+ * specified with glTexImage2D.  The contents of the texture are undefined and
+ * the texture cannot be respecified afterwards, update it with
+ * glTexSubImage2D.
+ *
+ * Must be called in the GL thread.
+ */
+void
+gst_gl_context_tex_storage_2d (GstGLContext * context, GLenum format,
+    GLenum type, gint width, gint height)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLenum sized_format = 0;
+
+  if (gl->TexStorage2D && type == GL_UNSIGNED_BYTE) {
+    switch (format) {
+      case GL_RGBA:
+        sized_format = SIZED_RGBA8;
+        break;
+      case GL_RGB:
+        sized_format = SIZED_RGB8;
+        break;
+      case GL_LUMINANCE:
+        /* luminance formats are gone from core profiles and GLES3 only
+         * accepts them through EXT_texture_storage */
+        if (USING_OPENGL (context))
+          sized_format = SIZED_LUMINANCE8;
+        break;
+      case GL_LUMINANCE_ALPHA:
+        if (USING_OPENGL (context))
+          sized_format = SIZED_LUMINANCE8_ALPHA8;
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (type == GL_UNSIGNED_INT_2_10_10_10_REV && format == GL_RGBA) {
+    if (gl->TexStorage2D) {
+      gl->TexStorage2D (GL_TEXTURE_2D, 1, SIZED_RGB10_A2, width, height);
+    } else {
+      gl->TexImage2D (GL_TEXTURE_2D, 0, SIZED_RGB10_A2, width, height, 0,
+          format, type, NULL);
+    }
+    return;
+  }
+
+  if (sized_format) {
+    gl->TexStorage2D (GL_TEXTURE_2D, 1, sized_format, width, height);
+    return;
+  }
+
+  gl->TexImage2D (GL_TEXTURE_2D, 0, format == GL_RGBA ? GL_RGBA8 : format,
+      width, height, 0, format, type, NULL);
+}
+
+/**
+ * gst_gl_context_release_texture:
+ * @context: a #GstGLContext
+ * @texture: a texture id
+ *
+ * Returns @texture to @context's pool for reuse by later calls to
+ * gst_gl_context_acquire_texture().  Textures that were not created by the
+ * pool are deleted.
+ *
+ * Must be called in the GL thread.
+ */
+void
+gst_gl_context_release_texture (GstGLContext * context, GLuint texture)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  TexturePool *pool = _get_texture_pool (context);
+  PooledTexture *tex;
+
+  tex = g_hash_table_lookup (pool->used, GUINT_TO_POINTER (texture));
+  if (!tex) {
+    gl->DeleteTextures (1, &texture);
+    return;
+  }
+
+  g_hash_table_steal (pool->used, GUINT_TO_POINTER (texture));
+  g_queue_push_tail (&pool->free, tex);
+
+  while (pool->free.length > MAX_FREE_TEXTURES) {
+    tex = g_queue_pop_head (&pool->free);
 
-  GST_LOG ("generated texture id:%d", data->result);
+    GST_LOG ("trimming texture id:%u dimensions:%dx%d", tex->id, tex->width,
+        tex->height);
+    gl->DeleteTextures (1, &tex->id);
+    pool->n_deleted++;
+    _free_pooled_texture (tex);
+  }
+}
+
+/* The quad drawn by every fullscreen pass of a context lives in buffer
+ * objects owned by the context rather than in client memory, so its vertices
+ * are only transferred once and the draw also works on core profiles.  Each
+ * vertex is (x, y, z, s, t), the last four vertices are the same quad with
+ * its texture coordinates flipped vertically.  Like the texture pool, the
+ * context frees the buffers in the gl thread before destroying itself. */
+#define QUAD_VERTEX_STRIDE (5 * sizeof (GLfloat))
+
+/* *INDENT-OFF* */
+static const GLfloat quad_vertices[] = {
+  -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+   1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+   1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+  -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+
+  -1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+   1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+   1.0f,  1.0f, 0.0f, 1.0f, 0.0f,
+  -1.0f,  1.0f, 0.0f, 0.0f, 0.0f,
+};
+/* *INDENT-ON* */
+
+static const GLushort quad_indices[] = { 0, 1, 2, 0, 2, 3 };
+
+typedef struct
+{
+  GstGLContext *context;
+
+  GLuint vao;
+  GLuint vertex_buffer;
+  GLuint index_buffer;
+} FullscreenQuad;
+
+/* called in the gl thread */
+static void
+_free_fullscreen_quad (FullscreenQuad * quad)
+{
+  const GstGLFuncs *gl = quad->context->gl_vtable;
+
+  GST_DEBUG ("deleting fullscreen quad vao:%u vbo:%u ibo:%u", quad->vao,
+      quad->vertex_buffer, quad->index_buffer);
+
+  if (quad->vao)
+    gl->DeleteVertexArrays (1, &quad->vao);
+  gl->DeleteBuffers (1, &quad->vertex_buffer);
+  gl->DeleteBuffers (1, &quad->index_buffer);
+
+  g_slice_free (FullscreenQuad, quad);
+}
+
+static FullscreenQuad *
+_get_fullscreen_quad (GstGLContext * context)
+{
+  GQuark quark = g_quark_from_static_string ("GstGLFullscreenQuad");
+  const GstGLFuncs *gl = context->gl_vtable;
+  FullscreenQuad *quad;
+
+  quad = g_object_get_qdata (G_OBJECT (context), quark);
+  if (quad)
+    return quad;
+
+  quad = g_slice_new0 (FullscreenQuad);
+  quad->context = context;
+
+  if (gl->GenVertexArrays) {
+    gl->GenVertexArrays (1, &quad->vao);
+    gl->BindVertexArray (quad->vao);
+  }
+
+  gl->GenBuffers (1, &quad->vertex_buffer);
+  gl->BindBuffer (GL_ARRAY_BUFFER, quad->vertex_buffer);
+  gl->BufferData (GL_ARRAY_BUFFER, sizeof (quad_vertices), quad_vertices,
+      GL_STATIC_DRAW);
+
+  gl->GenBuffers (1, &quad->index_buffer);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, quad->index_buffer);
+  gl->BufferData (GL_ELEMENT_ARRAY_BUFFER, sizeof (quad_indices),
+      quad_indices, GL_STATIC_DRAW);
+
+  GST_DEBUG ("created fullscreen quad vao:%u vbo:%u ibo:%u", quad->vao,
+      quad->vertex_buffer, quad->index_buffer);
+
+  g_object_set_qdata_full (G_OBJECT (context), quark, quad,
+      (GDestroyNotify) _free_fullscreen_quad);
+
+  return quad;
+}
+
+/**
+ * gst_gl_context_draw_fullscreen_quad:
+ * @context: a #GstGLContext
+ * @position_loc: location of the vec3 position attribute or -1
+ * @texcoord_loc: location of the vec2 texture coordinate attribute or -1
+ * @flip_y: whether the texture coordinates are flipped vertically
+ *
+ * Draws a quad covering the whole viewport from the vertex and index buffers
+ * shared by all the users of @context.  Its positions go from -1.0 to 1.0
+ * and its texture coordinates from 0.0 to 1.0.
+ *
+ * When @position_loc is -1 the quad is fed through the fixed function vertex
+ * and texture coordinate arrays instead, which is only possible with desktop
+ * OpenGL.
+ *
+ * Must be called in the GL thread.
+ */
+void
+gst_gl_context_draw_fullscreen_quad (GstGLContext * context, gint position_loc,
+    gint texcoord_loc, gboolean flip_y)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  FullscreenQuad *quad = _get_fullscreen_quad (context);
+  gsize offset = flip_y ? 4 * QUAD_VERTEX_STRIDE : 0;
+
+  if (quad->vao)
+    gl->BindVertexArray (quad->vao);
+  gl->BindBuffer (GL_ARRAY_BUFFER, quad->vertex_buffer);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, quad->index_buffer);
+
+  if (position_loc >= 0) {
+    gl->VertexAttribPointer (position_loc, 3, GL_FLOAT, GL_FALSE,
+        QUAD_VERTEX_STRIDE, (gpointer) offset);
+    gl->EnableVertexAttribArray (position_loc);
+
+    if (texcoord_loc >= 0) {
+      gl->VertexAttribPointer (texcoord_loc, 2, GL_FLOAT, GL_FALSE,
+          QUAD_VERTEX_STRIDE, (gpointer) (offset + 3 * sizeof (GLfloat)));
+      gl->EnableVertexAttribArray (texcoord_loc);
+    }
+
+    gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (gpointer) 0);
+
+    gl->DisableVertexAttribArray (position_loc);
+    if (texcoord_loc >= 0)
+      gl->DisableVertexAttribArray (texcoord_loc);
+  }
+#if GST_GL_HAVE_OPENGL
+  else if (gst_gl_context_get_gl_api (context) & GST_GL_API_OPENGL) {
+    gl->ClientActiveTexture (GL_TEXTURE0);
+
+    gl->EnableClientState (GL_VERTEX_ARRAY);
+    gl->EnableClientState (GL_TEXTURE_COORD_ARRAY);
+
+    gl->VertexPointer (3, GL_FLOAT, QUAD_VERTEX_STRIDE, (gpointer) offset);
+    gl->TexCoordPointer (2, GL_FLOAT, QUAD_VERTEX_STRIDE,
+        (gpointer) (offset + 3 * sizeof (GLfloat)));
+
+    gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (gpointer) 0);
+
+    gl->DisableClientState (GL_VERTEX_ARRAY);
+    gl->DisableClientState (GL_TEXTURE_COORD_ARRAY);
+  }
+#endif
+
+  if (quad->vao)
+    gl->BindVertexArray (0);
+  gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+typedef struct _GenTexture
+{
+  guint width, height;
+  GstVideoFormat format;
+  guint result;
+} GenTexture;
+
+static void
+_gen_texture (GstGLContext * context, GenTexture * data)
+{
+  data->result = gst_gl_context_acquire_texture (context, data->format,
+      data->width, data->height);
 }
 
 void
@@ -133,14 +566,20 @@ gst_gl_context_gen_texture (GstGLContext * context, GLuint * pTexture,
 void
 _del_texture (GstGLContext * context, guint * texture)
 {
-  glDeleteTextures (1, texture);
+  gst_gl_context_release_texture (context, *texture);
 }
 
+/* the deletion does not need to be waited for, so it is queued with the
+ * other asynchronous commands and the texture id is copied */
 void
 gst_gl_context_del_texture (GstGLContext * context, GLuint * pTexture)
 {
-  gst_gl_context_thread_add (context, (GstGLContextThreadFunc) _del_texture,
-      pTexture);
+  guint *texture = g_new (guint, 1);
+
+  *texture = *pTexture;
+
+  gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _del_texture, texture, g_free);
 }
 
 typedef struct _GenFBO
@@ -276,64 +715,83 @@ gst_gl_context_use_fbo_v2 (GstGLContext * context, gint texture_fbo_width,
 
 typedef struct _DelFBO
 {
-  GstGLFramebuffer *frame;
   GLuint fbo;
   GLuint depth;
 } DelFBO;
 
+static void
+_free_del_fbo (DelFBO * data)
+{
+  g_slice_free (DelFBO, data);
+}
+
 /* Called in the gl thread */
 static void
 _del_fbo (GstGLContext * context, DelFBO * data)
 {
-  gst_gl_framebuffer_delete (data->frame, data->fbo, data->depth);
+  const GstGLFuncs *gl = context->gl_vtable;
+
+  if (data->fbo)
+    gl->DeleteFramebuffers (1, &data->fbo);
+  if (data->depth)
+    gl->DeleteRenderbuffers (1, &data->depth);
 }
 
-/* Called by gltestsrc and glfilter */
+/* Called by gltestsrc and glfilter.  The deletion is queued without waiting
+ * for it and must not keep a reference to @context (e.g. through a
+ * #GstGLFramebuffer) as it could be the last one. */
 void
 gst_gl_context_del_fbo (GstGLContext * context, GLuint fbo, GLuint depth_buffer)
 {
-  GstGLFramebuffer *frame = gst_gl_framebuffer_new (context);
-
-  DelFBO data = { frame, fbo, depth_buffer };
+  DelFBO *data = g_slice_new (DelFBO);
 
-  gst_gl_context_thread_add (context, (GstGLContextThreadFunc) _del_fbo, &data);
+  data->fbo = fbo;
+  data->depth = depth_buffer;
 
-  gst_object_unref (frame);
+  gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _del_fbo, data, (GDestroyNotify) _free_del_fbo);
 }
 
+typedef struct
+{
+  const gchar *vert_src;
+  const gchar *frag_src;
+  GstGLShader *shader;
+} GenShader;
+
 static void
-_compile_shader (GstGLContext * context, GstGLShader ** shader)
+_compile_shader (GstGLContext * context, GenShader * data)
 {
   GError *error = NULL;
 
-  gst_gl_shader_compile (*shader, &error);
-  if (error) {
+  data->shader = gst_gl_shader_new_cached (context, data->vert_src,
+      data->frag_src, &error);
+  if (!data->shader) {
     gst_gl_context_set_error (context, "%s", error->message);
     g_error_free (error);
     error = NULL;
     gst_gl_context_clear_shader (context);
-    gst_object_unref (*shader);
-    *shader = NULL;
   }
 }
 
-/* Called by glfilter */
+/* Called by glfilter.  Identical sources share the same program */
 gboolean
 gst_gl_context_gen_shader (GstGLContext * context, const gchar * vert_src,
     const gchar * frag_src, GstGLShader ** shader)
 {
+  GenShader data;
+
   g_return_val_if_fail (frag_src != NULL || vert_src != NULL, FALSE);
   g_return_val_if_fail (shader != NULL, FALSE);
 
-  *shader = gst_gl_shader_new (context);
-
-  if (frag_src)
-    gst_gl_shader_set_fragment_source (*shader, frag_src);
-  if (vert_src)
-    gst_gl_shader_set_vertex_source (*shader, vert_src);
+  data.vert_src = vert_src;
+  data.frag_src = frag_src;
+  data.shader = NULL;
 
   gst_gl_context_thread_add (context, (GstGLContextThreadFunc) _compile_shader,
-      shader);
+      &data);
+
+  *shader = data.shader;
 
   return *shader != NULL;
 }
@@ -77,6 +77,14 @@ typedef void (*GLCB_V2) (gpointer stuff);
 void gst_gl_context_gen_texture (GstGLContext * context, GLuint * pTexture,
     GstVideoFormat v_format, GLint width, GLint height);
 void gst_gl_context_del_texture (GstGLContext * context, GLuint * pTexture);
+GLuint gst_gl_context_acquire_texture (GstGLContext * context,
+    GstVideoFormat v_format, gint width, gint height);
+void gst_gl_context_release_texture (GstGLContext * context, GLuint texture);
+void gst_gl_context_tex_storage_2d (GstGLContext * context, GLenum format,
+    GLenum type, gint width, gint height);
+
+void gst_gl_context_draw_fullscreen_quad (GstGLContext * context,
+    gint position_loc, gint texcoord_loc, gboolean flip_y);
 
 gboolean gst_gl_context_gen_fbo (GstGLContext * context, gint width, gint height,
     GLuint * fbo, GLuint * depthbuffer);
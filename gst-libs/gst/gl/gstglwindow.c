@@ -58,6 +58,9 @@
 #if GST_GL_HAVE_WINDOW_DISPMANX
 #include "dispmanx/gstglwindow_dispmanx_egl.h"
 #endif
+#if GST_GL_HAVE_WINDOW_HEADLESS
+#include "headless/gstglwindow_headless.h"
+#endif
 
 #define USING_OPENGL(display) (display->gl_api & GST_GL_API_OPENGL)
 #define USING_OPENGL3(display) (display->gl_api & GST_GL_API_OPENGL3)
@@ -160,6 +163,10 @@ gst_gl_window_new (GstGLDisplay * display)
 #if GST_GL_HAVE_WINDOW_ANDROID
   if (!window && (!user_choice || g_strstr_len (user_choice, 7, "android")))
     window = GST_GL_WINDOW (gst_gl_window_android_egl_new ());
+#endif
+#if GST_GL_HAVE_WINDOW_HEADLESS
+  if (!window && (!user_choice || g_strstr_len (user_choice, 8, "headless")))
+    window = GST_GL_WINDOW (gst_gl_window_headless_new ());
 #endif
   if (!window) {
     /* subclass returned a NULL window */
@@ -0,0 +1,270 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../gstgl_fwd.h"
+#include <gst/gl/gstglcontext.h>
+
+#include "gstglwindow_headless.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+typedef EGLDisplay (*GetPlatformDisplayFunc) (EGLenum platform,
+    void *native_display, const EGLint * attrib_list);
+
+#define GST_CAT_DEFAULT gst_gl_window_debug
+
+#define gst_gl_window_headless_parent_class parent_class
+G_DEFINE_TYPE (GstGLWindowHeadless, gst_gl_window_headless,
+    GST_GL_TYPE_WINDOW);
+
+static guintptr gst_gl_window_headless_get_window_handle (GstGLWindow *
+    window);
+static void gst_gl_window_headless_set_window_handle (GstGLWindow * window,
+    guintptr handle);
+static void gst_gl_window_headless_draw (GstGLWindow * window, guint width,
+    guint height);
+static void gst_gl_window_headless_run (GstGLWindow * window);
+static void gst_gl_window_headless_quit (GstGLWindow * window);
+static void gst_gl_window_headless_send_message_async (GstGLWindow * window,
+    GstGLWindowCB callback, gpointer data, GDestroyNotify destroy);
+static void gst_gl_window_headless_close (GstGLWindow * window);
+static gboolean gst_gl_window_headless_open (GstGLWindow * window,
+    GError ** error);
+static guintptr gst_gl_window_headless_get_display (GstGLWindow * window);
+
+static void
+gst_gl_window_headless_class_init (GstGLWindowHeadlessClass * klass)
+{
+  GstGLWindowClass *window_class = (GstGLWindowClass *) klass;
+
+  window_class->get_window_handle =
+      GST_DEBUG_FUNCPTR (gst_gl_window_headless_get_window_handle);
+  window_class->set_window_handle =
+      GST_DEBUG_FUNCPTR (gst_gl_window_headless_set_window_handle);
+  window_class->draw_unlocked =
+      GST_DEBUG_FUNCPTR (gst_gl_window_headless_draw);
+  window_class->draw = GST_DEBUG_FUNCPTR (gst_gl_window_headless_draw);
+  window_class->run = GST_DEBUG_FUNCPTR (gst_gl_window_headless_run);
+  window_class->quit = GST_DEBUG_FUNCPTR (gst_gl_window_headless_quit);
+  window_class->send_message_async =
+      GST_DEBUG_FUNCPTR (gst_gl_window_headless_send_message_async);
+  window_class->close = GST_DEBUG_FUNCPTR (gst_gl_window_headless_close);
+  window_class->open = GST_DEBUG_FUNCPTR (gst_gl_window_headless_open);
+  window_class->get_display =
+      GST_DEBUG_FUNCPTR (gst_gl_window_headless_get_display);
+}
+
+static void
+gst_gl_window_headless_init (GstGLWindowHeadless * window)
+{
+}
+
+/* Must be called in the gl thread */
+GstGLWindowHeadless *
+gst_gl_window_headless_new (void)
+{
+  GstGLWindowHeadless *window;
+
+  GST_DEBUG ("creating headless window");
+
+  window = g_object_new (GST_GL_TYPE_WINDOW_HEADLESS, NULL);
+
+  window->egldisplay = EGL_NO_DISPLAY;
+
+  return window;
+}
+
+/* Prefer the Mesa surfaceless platform so that libEGL doesn't go looking
+ * for an X11 or Wayland server when asked for the default display */
+static EGLDisplay
+_get_surfaceless_display (void)
+{
+  GetPlatformDisplayFunc get_platform_display;
+  const gchar *client_exts;
+  EGLDisplay display;
+
+  client_exts = eglQueryString (EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+  if (gst_gl_check_extension ("EGL_MESA_platform_surfaceless", client_exts)
+      && gst_gl_check_extension ("EGL_EXT_platform_base", client_exts)) {
+    get_platform_display = (GetPlatformDisplayFunc)
+        eglGetProcAddress ("eglGetPlatformDisplayEXT");
+
+    if (get_platform_display) {
+      display = get_platform_display (EGL_PLATFORM_SURFACELESS_MESA,
+          EGL_DEFAULT_DISPLAY, NULL);
+      if (display != EGL_NO_DISPLAY) {
+        GST_INFO ("using the EGL surfaceless platform");
+        return display;
+      }
+    }
+  }
+
+  GST_INFO ("EGL_MESA_platform_surfaceless not available, falling back to "
+      "the default display");
+
+  return eglGetDisplay (EGL_DEFAULT_DISPLAY);
+}
+
+static gboolean
+gst_gl_window_headless_open (GstGLWindow * window, GError ** error)
+{
+  GstGLWindowHeadless *window_headless = GST_GL_WINDOW_HEADLESS (window);
+
+  window_headless->egldisplay = _get_surfaceless_display ();
+  if (window_headless->egldisplay == EGL_NO_DISPLAY) {
+    g_set_error (error, GST_GL_WINDOW_ERROR,
+        GST_GL_WINDOW_ERROR_RESOURCE_UNAVAILABLE,
+        "Failed to retrieve an EGL display");
+    return FALSE;
+  }
+
+  window_headless->main_context = g_main_context_new ();
+  window_headless->loop =
+      g_main_loop_new (window_headless->main_context, FALSE);
+
+  return TRUE;
+}
+
+static void
+gst_gl_window_headless_close (GstGLWindow * window)
+{
+  GstGLWindowHeadless *window_headless;
+
+  window_headless = GST_GL_WINDOW_HEADLESS (window);
+
+  /* the display is terminated by the context */
+  window_headless->egldisplay = EGL_NO_DISPLAY;
+
+  g_main_loop_unref (window_headless->loop);
+  window_headless->loop = NULL;
+  g_main_context_unref (window_headless->main_context);
+  window_headless->main_context = NULL;
+}
+
+static void
+gst_gl_window_headless_run (GstGLWindow * window)
+{
+  GstGLWindowHeadless *window_headless;
+
+  window_headless = GST_GL_WINDOW_HEADLESS (window);
+
+  GST_LOG ("starting main loop");
+  g_main_loop_run (window_headless->loop);
+  GST_LOG ("exiting main loop");
+}
+
+static void
+gst_gl_window_headless_quit (GstGLWindow * window)
+{
+  GstGLWindowHeadless *window_headless;
+
+  window_headless = GST_GL_WINDOW_HEADLESS (window);
+
+  GST_LOG ("sending quit");
+
+  g_main_loop_quit (window_headless->loop);
+
+  GST_LOG ("quit sent");
+}
+
+typedef struct _GstGLMessage
+{
+  GstGLWindowCB callback;
+  gpointer data;
+  GDestroyNotify destroy;
+} GstGLMessage;
+
+static gboolean
+_run_message (GstGLMessage * message)
+{
+  if (message->callback)
+    message->callback (message->data);
+
+  if (message->destroy)
+    message->destroy (message->data);
+
+  g_slice_free (GstGLMessage, message);
+
+  return FALSE;
+}
+
+static void
+gst_gl_window_headless_send_message_async (GstGLWindow * window,
+    GstGLWindowCB callback, gpointer data, GDestroyNotify destroy)
+{
+  GstGLWindowHeadless *window_headless;
+  GstGLMessage *message;
+
+  window_headless = GST_GL_WINDOW_HEADLESS (window);
+  message = g_slice_new (GstGLMessage);
+
+  message->callback = callback;
+  message->data = data;
+  message->destroy = destroy;
+
+  g_main_context_invoke (window_headless->main_context,
+      (GSourceFunc) _run_message, message);
+}
+
+static guintptr
+gst_gl_window_headless_get_window_handle (GstGLWindow * window)
+{
+  /* no native window, the EGL context goes surfaceless */
+  return 0;
+}
+
+static void
+gst_gl_window_headless_set_window_handle (GstGLWindow * window,
+    guintptr handle)
+{
+  GST_WARNING ("a headless window cannot render into a foreign window");
+}
+
+static void
+draw_cb (gpointer data)
+{
+  GstGLWindow *window = data;
+
+  if (window->draw)
+    window->draw (window->draw_data);
+}
+
+static void
+gst_gl_window_headless_draw (GstGLWindow * window, guint width, guint height)
+{
+  gst_gl_window_send_message (window, (GstGLWindowCB) draw_cb, window);
+}
+
+static guintptr
+gst_gl_window_headless_get_display (GstGLWindow * window)
+{
+  GstGLWindowHeadless *window_headless;
+
+  window_headless = GST_GL_WINDOW_HEADLESS (window);
+
+  return (guintptr) window_headless->egldisplay;
+}
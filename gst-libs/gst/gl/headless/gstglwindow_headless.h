@@ -0,0 +1,73 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_GL_WINDOW_HEADLESS_H__
+#define __GST_GL_WINDOW_HEADLESS_H__
+
+#include <EGL/egl.h>
+
+#include <gst/gl/gl.h>
+
+G_BEGIN_DECLS
+
+#define GST_GL_TYPE_WINDOW_HEADLESS         (gst_gl_window_headless_get_type())
+#define GST_GL_WINDOW_HEADLESS(o)           (G_TYPE_CHECK_INSTANCE_CAST((o), GST_GL_TYPE_WINDOW_HEADLESS, GstGLWindowHeadless))
+#define GST_GL_WINDOW_HEADLESS_CLASS(k)     (G_TYPE_CHECK_CLASS((k), GST_GL_TYPE_WINDOW_HEADLESS, GstGLWindowHeadlessClass))
+#define GST_GL_IS_WINDOW_HEADLESS(o)        (G_TYPE_CHECK_INSTANCE_TYPE((o), GST_GL_TYPE_WINDOW_HEADLESS))
+#define GST_GL_IS_WINDOW_HEADLESS_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE((k), GST_GL_TYPE_WINDOW_HEADLESS))
+#define GST_GL_WINDOW_HEADLESS_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS((o), GST_GL_TYPE_WINDOW_HEADLESS, GstGLWindowHeadlessClass))
+
+typedef struct _GstGLWindowHeadless        GstGLWindowHeadless;
+typedef struct _GstGLWindowHeadlessClass   GstGLWindowHeadlessClass;
+
+/**
+ * GstGLWindowHeadless:
+ *
+ * A #GstGLWindow without any on-screen surface.  Rendering happens into
+ * framebuffer objects on a surfaceless (or pbuffer) EGL context and the
+ * message loop is a plain #GMainLoop, so no display server is required.
+ */
+struct _GstGLWindowHeadless {
+  /*< private >*/
+  GstGLWindow parent;
+
+  EGLDisplay egldisplay;
+
+  GMainContext *main_context;
+  GMainLoop *loop;
+
+  gpointer _reserved[GST_PADDING];
+};
+
+struct _GstGLWindowHeadlessClass {
+  /*< private >*/
+  GstGLWindowClass parent_class;
+
+  /*< private >*/
+  gpointer _reserved[GST_PADDING];
+};
+
+GType gst_gl_window_headless_get_type     (void);
+
+GstGLWindowHeadless * gst_gl_window_headless_new  (void);
+
+G_END_DECLS
+
+#endif /* __GST_GL_WINDOW_HEADLESS_H__ */
@@ -23,8 +23,9 @@
 
 #include "../gstgleffects.h"
 
-static gboolean kernel_ready = FALSE;
-static float gauss_kernel[7];
+/* the 7 taps kernel the glow used to be blurred with truncated its sigma
+ * of 10 down to about 2 pixels, keep the same look */
+#define GLOW_SIGMA 2.0
 
 static void
 gst_gl_effects_glow_step_one (gint width, gint height, guint texture,
@@ -36,21 +37,10 @@ gst_gl_effects_glow_step_one (gint width, gint height, guint texture,
   GstGLContext *context = filter->context;
   GstGLFuncs *gl = context->gl_vtable;
 
-  shader = g_hash_table_lookup (effects->shaderstable, "glow0");
-
-  if (!shader) {
-    shader = gst_gl_shader_new (context);
-    g_hash_table_insert (effects->shaderstable, "glow0", shader);
-  }
-
-  if (!gst_gl_shader_compile_and_check (shader,
-          luma_threshold_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
-    gst_gl_context_set_error (context,
-        "Failed to initialize luma threshold shader");
-    GST_ELEMENT_ERROR (effects, RESOURCE, NOT_FOUND,
-        ("%s", gst_gl_context_get_error ()), (NULL));
+  shader = gst_gl_effects_get_fragment_shader (effects, "glow0",
+      luma_threshold_fragment_source);
+  if (!shader)
     return;
-  }
 
   gl->MatrixMode (GL_PROJECTION);
   gl->LoadIdentity ();
@@ -66,95 +56,6 @@ gst_gl_effects_glow_step_one (gint width, gint height, guint texture,
   gst_gl_filter_draw_texture (filter, texture, width, height);
 }
 
-static void
-gst_gl_effects_glow_step_two (gint width, gint height, guint texture,
-    gpointer data)
-{
-  GstGLShader *shader;
-  GstGLEffects *effects = GST_GL_EFFECTS (data);
-  GstGLFilter *filter = GST_GL_FILTER (effects);
-  GstGLContext *context = filter->context;
-  GstGLFuncs *gl = context->gl_vtable;
-
-  shader = g_hash_table_lookup (effects->shaderstable, "glow1");
-
-  if (!shader) {
-    shader = gst_gl_shader_new (context);
-    g_hash_table_insert (effects->shaderstable, "glow1", shader);
-  }
-
-  if (!kernel_ready) {
-    fill_gaussian_kernel (gauss_kernel, 7, 10.0);
-    kernel_ready = TRUE;
-  }
-
-  if (!gst_gl_shader_compile_and_check (shader,
-          hconv7_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
-    gst_gl_context_set_error (context, "Failed to initialize hconv7 shader");
-    GST_ELEMENT_ERROR (effects, RESOURCE, NOT_FOUND,
-        ("%s", gst_gl_context_get_error ()), (NULL));
-    return;
-  }
-
-  gl->MatrixMode (GL_PROJECTION);
-  gl->LoadIdentity ();
-
-  gst_gl_shader_use (shader);
-
-  gl->ActiveTexture (GL_TEXTURE1);
-  gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, texture);
-  gl->Disable (GL_TEXTURE_2D);
-
-  gst_gl_shader_set_uniform_1i (shader, "tex", 1);
-  gst_gl_shader_set_uniform_1fv (shader, "kernel", 7, gauss_kernel);
-  gst_gl_shader_set_uniform_1f (shader, "height", height);
-
-  gst_gl_filter_draw_texture (filter, texture, width, height);
-}
-
-void
-gst_gl_effects_glow_step_three (gint width, gint height, guint texture,
-    gpointer data)
-{
-  GstGLShader *shader;
-  GstGLEffects *effects = GST_GL_EFFECTS (data);
-  GstGLFilter *filter = GST_GL_FILTER (effects);
-  GstGLContext *context = filter->context;
-  GstGLFuncs *gl = context->gl_vtable;
-
-  shader = g_hash_table_lookup (effects->shaderstable, "glow2");
-
-  if (!shader) {
-    shader = gst_gl_shader_new (context);
-    g_hash_table_insert (effects->shaderstable, "glow2", shader);
-  }
-
-  if (!gst_gl_shader_compile_and_check (shader,
-          vconv7_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
-    gst_gl_context_set_error (context, "Failed to initialize vcon7 shader");
-    GST_ELEMENT_ERROR (effects, RESOURCE, NOT_FOUND,
-        ("%s", gst_gl_context_get_error ()), (NULL));
-    return;
-  }
-
-  gl->MatrixMode (GL_PROJECTION);
-  gl->LoadIdentity ();
-
-  gst_gl_shader_use (shader);
-
-  gl->ActiveTexture (GL_TEXTURE1);
-  gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, texture);
-  gl->Disable (GL_TEXTURE_2D);
-
-  gst_gl_shader_set_uniform_1i (shader, "tex", 1);
-  gst_gl_shader_set_uniform_1fv (shader, "kernel", 7, gauss_kernel);
-  gst_gl_shader_set_uniform_1f (shader, "width", width);
-
-  gst_gl_filter_draw_texture (filter, texture, width, height);
-}
-
 void
 gst_gl_effects_glow_step_four (gint width, gint height, guint texture,
     gpointer data)
@@ -165,20 +66,10 @@ gst_gl_effects_glow_step_four (gint width, gint height, guint texture,
   GstGLContext *context = filter->context;
   GstGLFuncs *gl = context->gl_vtable;
 
-  shader = g_hash_table_lookup (effects->shaderstable, "glow3");
-
-  if (!shader) {
-    shader = gst_gl_shader_new (context);
-    g_hash_table_insert (effects->shaderstable, "glow3", shader);
-  }
-
-  if (!gst_gl_shader_compile_and_check (shader,
-          sum_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
-    gst_gl_context_set_error (context, "Failed to initialize sum shader");
-    GST_ELEMENT_ERROR (effects, RESOURCE, NOT_FOUND,
-        ("%s", gst_gl_context_get_error ()), (NULL));
+  shader = gst_gl_effects_get_fragment_shader (effects, "glow3",
+      sum_fragment_source);
+  if (!shader)
     return;
-  }
 
   gl->MatrixMode (GL_PROJECTION);
   gl->LoadIdentity ();
@@ -213,11 +104,13 @@ gst_gl_effects_glow (GstGLEffects * effects)
   gst_gl_filter_render_to_target (filter, TRUE, effects->intexture,
       effects->midtexture[0], gst_gl_effects_glow_step_one, effects);
   /* blur */
-  gst_gl_filter_render_to_target (filter, FALSE, effects->midtexture[0],
-      effects->midtexture[1], gst_gl_effects_glow_step_two, effects);
-  gst_gl_filter_render_to_target (filter, FALSE, effects->midtexture[1],
-      effects->midtexture[2], gst_gl_effects_glow_step_three, effects);
+  gst_gl_blur_pyramid_set_sigma (effects->blur, GLOW_SIGMA);
+  gst_gl_blur_pyramid_render (effects->blur, effects->midtexture[0],
+      GST_VIDEO_INFO_WIDTH (&filter->out_info),
+      GST_VIDEO_INFO_HEIGHT (&filter->out_info), effects->midtexture[1],
+      GST_VIDEO_INFO_WIDTH (&filter->out_info),
+      GST_VIDEO_INFO_HEIGHT (&filter->out_info));
   /* add blurred luma to intexture */
-  gst_gl_filter_render_to_target (filter, FALSE, effects->midtexture[2],
+  gst_gl_filter_render_to_target (filter, FALSE, effects->midtexture[1],
       effects->outtexture, gst_gl_effects_glow_step_four, effects);
 }
@@ -478,4 +478,75 @@ const gchar *difference_fragment_source =
   "gl_FragColor = vec4 (step (0.12, length (savedcolor - currentcolor)));"
   "}";
 
+
+/* Snippets fused into a single fragment shader by glfilterfuse.  Per-pixel
+ * snippets are functions of the form vec4 f (vec4 color), the ones sampling
+ * the neighbourhood are vec4 f (sampler2D tex, vec2 texcoord) and can use
+ * the width and height uniforms of the generated shader */
+const gchar *desaturate_snippet_source =
+  "vec4 desaturate (vec4 color) {"
+  "  float luma = dot(color.rgb, vec3(0.2125, 0.7154, 0.0721));"
+  "  return vec4(vec3(luma), color.a);"
+  "}";
+
+const gchar *luma_threshold_snippet_source =
+  "vec4 luma_threshold (vec4 color) {"
+  "  float luma = dot(color.rgb, vec3(0.2125, 0.7154, 0.0721));"
+  "  return vec4 (vec3 (smoothstep (0.30, 0.50, luma)), color.a);"
+  "}";
+
+const gchar *sin_snippet_source =
+  "vec4 sin_effect (vec4 color) {"
+  "  float luma = dot(color.rgb, vec3(0.2125, 0.7154, 0.0721));"
+  "  float hcos = color.r - 0.5*(color.g + color.b);"
+  "  float hsin = 0.866*(color.g - color.b);"
+  "  float sch = (1.0-hsin)*hcos;"
+  "  float a = smoothstep (0.3, 1.0, sch);"
+  "  float b = smoothstep (-0.4, -0.1, hsin);"
+  "  float amount = a * b;"
+  "  return color * amount + luma * (1.0 - amount);"
+  "}";
+
+const gchar *luma_to_curve_snippet_source =
+  "vec4 luma_to_curve (vec4 color, sampler1D curve) {"
+  "  float luma = dot(color.rgb, vec3(0.2125, 0.7154, 0.0721));"
+  "  return texture1D(curve, luma);"
+  "}";
+
+const gchar *rgb_to_curve_snippet_source =
+  "vec4 rgb_to_curve (vec4 color, sampler1D curve) {"
+  "  vec4 outcolor;"
+  "  outcolor.r = texture1D(curve, color.r).r;"
+  "  outcolor.g = texture1D(curve, color.g).g;"
+  "  outcolor.b = texture1D(curve, color.b).b;"
+  "  outcolor.a = color.a;"
+  "  return outcolor;"
+  "}";
+
+const gchar *hconv7_snippet_source =
+  "uniform float hkernel[7];"
+  "vec4 hconv7 (sampler2D tex, vec2 texcoord) {"
+  "  float w = 1.0 / width;"
+  "  int i;"
+  "  vec4 sum = vec4 (0.0);"
+  "  for (i = 0; i < 7; i++) {"
+  "    vec2 offset = vec2(float(i - 3) * w, 0.0);"
+  "    sum += texture2D(tex, texcoord + offset) * hkernel[i];"
+  "  }"
+  "  return sum;"
+  "}";
+
+const gchar *vconv7_snippet_source =
+  "uniform float vkernel[7];"
+  "vec4 vconv7 (sampler2D tex, vec2 texcoord) {"
+  "  float h = 1.0 / height;"
+  "  int i;"
+  "  vec4 sum = vec4 (0.0);"
+  "  for (i = 0; i < 7; i++) {"
+  "    vec2 offset = vec2(0.0, float(i - 3) * h);"
+  "    sum += texture2D(tex, texcoord + offset) * vkernel[i];"
+  "  }"
+  "  return sum;"
+  "}";
+
 /* *INDENT-ON* */
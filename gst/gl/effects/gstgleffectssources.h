@@ -53,6 +53,14 @@ extern const gchar *texture_interp_fragment_source;
 extern const gchar *difference_fragment_source;
 extern const gchar *multiply_fragment_source;
 
+extern const gchar *desaturate_snippet_source;
+extern const gchar *luma_threshold_snippet_source;
+extern const gchar *sin_snippet_source;
+extern const gchar *luma_to_curve_snippet_source;
+extern const gchar *rgb_to_curve_snippet_source;
+extern const gchar *hconv7_snippet_source;
+extern const gchar *vconv7_snippet_source;
+
 void fill_gaussian_kernel (float *kernel, int size, float sigma);
 
 #endif /* __GST_GL_EFFECTS_SOURCES_H__ */
@@ -0,0 +1,531 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "gstglblurpyramid.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_gl_blur_pyramid_debug);
+#define GST_CAT_DEFAULT gst_gl_blur_pyramid_debug
+
+/* the largest sigma, in texels, blurred without downsampling.  The kernel
+ * covers 3 sigma on each side with pairs of texels read by a single linear
+ * fetch, i.e. MAX_TAPS - 1 fetches per side */
+#define MAX_LEVEL_SIGMA 3.0
+#define MAX_TAPS 6
+#define MAX_LEVELS 8
+/* don't downsample below this size */
+#define MIN_LEVEL_SIZE 8
+
+/* *INDENT-OFF* */
+/* dual filter downsample, halfpixel is half a texel of the input */
+static const gchar *down_fragment_source =
+  "uniform sampler2D tex;"
+  "uniform vec2 halfpixel;"
+  "void main () {"
+  "  vec2 uv = gl_TexCoord[0].st;"
+  "  vec4 sum = texture2D (tex, uv) * 4.0;"
+  "  sum += texture2D (tex, uv - halfpixel);"
+  "  sum += texture2D (tex, uv + halfpixel);"
+  "  sum += texture2D (tex, uv + vec2 (halfpixel.x, -halfpixel.y));"
+  "  sum += texture2D (tex, uv - vec2 (halfpixel.x, -halfpixel.y));"
+  "  gl_FragColor = sum / 8.0;"
+  "}";
+
+/* dual filter upsample */
+static const gchar *up_fragment_source =
+  "uniform sampler2D tex;"
+  "uniform vec2 halfpixel;"
+  "void main () {"
+  "  vec2 uv = gl_TexCoord[0].st;"
+  "  vec4 sum = texture2D (tex, uv + vec2 (-halfpixel.x * 2.0, 0.0));"
+  "  sum += texture2D (tex, uv + vec2 (-halfpixel.x, halfpixel.y)) * 2.0;"
+  "  sum += texture2D (tex, uv + vec2 (0.0, halfpixel.y * 2.0));"
+  "  sum += texture2D (tex, uv + vec2 (halfpixel.x, halfpixel.y)) * 2.0;"
+  "  sum += texture2D (tex, uv + vec2 (halfpixel.x * 2.0, 0.0));"
+  "  sum += texture2D (tex, uv + vec2 (halfpixel.x, -halfpixel.y)) * 2.0;"
+  "  sum += texture2D (tex, uv + vec2 (0.0, -halfpixel.y * 2.0));"
+  "  sum += texture2D (tex, uv + vec2 (-halfpixel.x, -halfpixel.y)) * 2.0;"
+  "  gl_FragColor = sum / 12.0;"
+  "}";
+
+/* one direction of a separable gaussian, offsets are in texels along
+ * texel_step and fall between two texels to read both with one fetch */
+static const gchar *gauss_fragment_source =
+  "uniform sampler2D tex;"
+  "uniform vec2 texel_step;"
+  "uniform float offsets[6];"
+  "uniform float weights[6];"
+  "void main () {"
+  "  vec2 uv = gl_TexCoord[0].st;"
+  "  vec4 sum = texture2D (tex, uv) * weights[0];"
+  "  int i;"
+  "  for (i = 1; i < 6; i++) {"
+  "    sum += texture2D (tex, uv + texel_step * offsets[i]) * weights[i];"
+  "    sum += texture2D (tex, uv - texel_step * offsets[i]) * weights[i];"
+  "  }"
+  "  gl_FragColor = sum;"
+  "}";
+/* *INDENT-ON* */
+
+typedef enum
+{
+  PASS_DOWN,
+  PASS_UP,
+  PASS_HORIZONTAL,
+  PASS_VERTICAL
+} GstGLBlurPyramidPass;
+
+struct _GstGLBlurPyramid
+{
+  GstGLFilter *filter;
+  GstGLFramebuffer *frame;
+
+  gdouble sigma;
+  /* the sigma last reported as too large for the frame */
+  gdouble clamped_sigma;
+
+  GstGLShader *down_shader;
+  GstGLShader *up_shader;
+  GstGLShader *gauss_shader;
+
+  /* the allocated pyramid, level 0 is the output */
+  guint width;
+  guint height;
+  guint n_levels;
+  GLuint level_tex[MAX_LEVELS + 1];
+  GLuint fbo[MAX_LEVELS + 1];
+  GLuint depth[MAX_LEVELS + 1];
+  /* target of the horizontal pass at the smallest level */
+  GLuint tmp_tex;
+
+  gfloat offsets[MAX_TAPS];
+  gfloat weights[MAX_TAPS];
+
+  GstGLBlurPyramidPass pass;
+};
+
+typedef struct
+{
+  GstGLBlurPyramid *pyramid;
+  GLuint input;
+  guint in_width;
+  guint in_height;
+  GLuint output;
+  guint width;
+  guint height;
+  gboolean result;
+} RenderData;
+
+/* Called in the gl thread */
+GstGLBlurPyramid *
+gst_gl_blur_pyramid_new (GstGLFilter * filter)
+{
+  GstGLBlurPyramid *pyramid;
+  static volatile gsize _init = 0;
+
+  if (g_once_init_enter (&_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_gl_blur_pyramid_debug, "glblurpyramid", 0,
+        "OpenGL blur pyramid");
+    g_once_init_leave (&_init, 1);
+  }
+
+  pyramid = g_slice_new0 (GstGLBlurPyramid);
+  pyramid->filter = filter;
+  pyramid->frame = gst_gl_framebuffer_new (filter->context);
+  pyramid->sigma = 3.0;
+
+  return pyramid;
+}
+
+/* Called in the gl thread */
+static void
+_free_levels (GstGLBlurPyramid * pyramid)
+{
+  GstGLContext *context = pyramid->filter->context;
+  guint i;
+
+  for (i = 0; i <= pyramid->n_levels; i++) {
+    if (pyramid->level_tex[i])
+      gst_gl_context_release_texture (context, pyramid->level_tex[i]);
+    pyramid->level_tex[i] = 0;
+
+    if (pyramid->fbo[i])
+      gst_gl_framebuffer_delete (pyramid->frame, pyramid->fbo[i],
+          pyramid->depth[i]);
+    pyramid->fbo[i] = 0;
+    pyramid->depth[i] = 0;
+  }
+
+  if (pyramid->tmp_tex)
+    gst_gl_context_release_texture (context, pyramid->tmp_tex);
+  pyramid->tmp_tex = 0;
+
+  pyramid->width = pyramid->height = pyramid->n_levels = 0;
+}
+
+/* Called in the gl thread */
+void
+gst_gl_blur_pyramid_free (GstGLBlurPyramid * pyramid)
+{
+  if (!pyramid)
+    return;
+
+  _free_levels (pyramid);
+
+  if (pyramid->down_shader)
+    g_object_unref (pyramid->down_shader);
+  if (pyramid->up_shader)
+    g_object_unref (pyramid->up_shader);
+  if (pyramid->gauss_shader)
+    g_object_unref (pyramid->gauss_shader);
+
+  gst_object_unref (pyramid->frame);
+
+  g_slice_free (GstGLBlurPyramid, pyramid);
+}
+
+void
+gst_gl_blur_pyramid_set_sigma (GstGLBlurPyramid * pyramid, gdouble sigma)
+{
+  pyramid->sigma = MAX (sigma, 0.0);
+}
+
+gdouble
+gst_gl_blur_pyramid_get_sigma (GstGLBlurPyramid * pyramid)
+{
+  return pyramid->sigma;
+}
+
+/* the number of halvings needed for the remaining sigma to fit the kernel */
+static guint
+_n_levels_for (gdouble sigma, guint width, guint height, gdouble * level_sigma)
+{
+  guint n = 0;
+
+  while (sigma > MAX_LEVEL_SIGMA && n < MAX_LEVELS
+      && (width >> (n + 1)) >= MIN_LEVEL_SIZE
+      && (height >> (n + 1)) >= MIN_LEVEL_SIZE) {
+    sigma /= 2.0;
+    n++;
+  }
+
+  *level_sigma = sigma;
+
+  return n;
+}
+
+/* Folds a discrete gaussian of radius 3 sigma into pairs of texels that a
+ * single linear fetch reads with the right proportions */
+static void
+_compute_kernel (GstGLBlurPyramid * pyramid, gdouble sigma)
+{
+  gdouble g[2 * MAX_TAPS];
+  gdouble sum;
+  gint radius, i;
+
+  for (i = 0; i < MAX_TAPS; i++) {
+    pyramid->offsets[i] = 0.0;
+    pyramid->weights[i] = 0.0;
+  }
+
+  if (sigma <= 0.0) {
+    pyramid->weights[0] = 1.0;
+    return;
+  }
+
+  radius = MIN ((gint) ceil (3.0 * sigma), 2 * MAX_TAPS - 2);
+
+  sum = 0.0;
+  for (i = 0; i < 2 * MAX_TAPS; i++) {
+    g[i] = i <= radius ? exp (-(i * i) / (2.0 * sigma * sigma)) : 0.0;
+    sum += i == 0 ? g[i] : 2.0 * g[i];
+  }
+
+  pyramid->weights[0] = g[0] / sum;
+  for (i = 1; i < MAX_TAPS; i++) {
+    gint a = 2 * i - 1, b = 2 * i;
+    gdouble w = g[a] + g[b];
+
+    if (w <= 0.0)
+      break;
+
+    pyramid->weights[i] = w / sum;
+    pyramid->offsets[i] = (a * g[a] + b * g[b]) / w;
+  }
+}
+
+/* Called in the gl thread */
+static GstGLShader *
+_get_shader (GstGLBlurPyramid * pyramid, GstGLShader ** shader,
+    const gchar * fragment_source)
+{
+  GError *error = NULL;
+
+  if (*shader)
+    return *shader;
+
+  *shader = gst_gl_shader_new_cached (pyramid->filter->context, NULL,
+      fragment_source, &error);
+  if (!*shader) {
+    GST_ERROR ("Failed to compile blur shader: %s", error->message);
+    g_error_free (error);
+  }
+
+  return *shader;
+}
+
+/* Called in the gl thread */
+static gboolean
+_ensure_levels (GstGLBlurPyramid * pyramid, guint width, guint height,
+    guint n_levels)
+{
+  GstGLContext *context = pyramid->filter->context;
+  guint i;
+
+  if (pyramid->width == width && pyramid->height == height
+      && pyramid->n_levels == n_levels && pyramid->fbo[0])
+    return TRUE;
+
+  _free_levels (pyramid);
+
+  GST_DEBUG ("allocating %u levels for %ux%u", n_levels, width, height);
+
+  pyramid->width = width;
+  pyramid->height = height;
+  pyramid->n_levels = n_levels;
+
+  for (i = 0; i <= n_levels; i++) {
+    guint w = width >> i, h = height >> i;
+
+    if (!gst_gl_framebuffer_generate (pyramid->frame, w, h,
+            &pyramid->fbo[i], &pyramid->depth[i]))
+      return FALSE;
+
+    /* level 0 is the caller's output */
+    if (i > 0) {
+      pyramid->level_tex[i] = gst_gl_context_acquire_texture (context,
+          GST_VIDEO_FORMAT_RGBA, w, h);
+      if (!pyramid->level_tex[i])
+        return FALSE;
+    }
+  }
+
+  pyramid->tmp_tex = gst_gl_context_acquire_texture (context,
+      GST_VIDEO_FORMAT_RGBA, width >> n_levels, height >> n_levels);
+
+  return pyramid->tmp_tex != 0;
+}
+
+/* Called in the gl thread */
+static void
+_draw_pass (gint width, gint height, guint texture, gpointer stuff)
+{
+  GstGLBlurPyramid *pyramid = stuff;
+  GstGLFilter *filter = pyramid->filter;
+  GstGLFuncs *gl = filter->context->gl_vtable;
+  GstGLShader *shader;
+  gfloat halfpixel[2] = { 0.5 / width, 0.5 / height };
+
+  switch (pyramid->pass) {
+    case PASS_DOWN:
+      shader = pyramid->down_shader;
+      break;
+    case PASS_UP:
+      shader = pyramid->up_shader;
+      break;
+    default:
+      shader = pyramid->gauss_shader;
+      break;
+  }
+
+  gl->MatrixMode (GL_PROJECTION);
+  gl->LoadIdentity ();
+
+  gst_gl_shader_use (shader);
+
+  /* every pass relies on linear filtering, the textures of the pyramid come
+   * from the context's pool with it and _render_gl sets it on the input */
+  gl->ActiveTexture (GL_TEXTURE1);
+  gl->Enable (GL_TEXTURE_2D);
+  gl->BindTexture (GL_TEXTURE_2D, texture);
+  gl->Disable (GL_TEXTURE_2D);
+
+  gst_gl_shader_set_uniform_1i (shader, "tex", 1);
+
+  switch (pyramid->pass) {
+    case PASS_DOWN:
+    case PASS_UP:
+      gst_gl_shader_set_uniform_2f (shader, "halfpixel", halfpixel[0],
+          halfpixel[1]);
+      break;
+    case PASS_HORIZONTAL:
+      gst_gl_shader_set_uniform_2f (shader, "texel_step", 1.0 / width, 0.0);
+      gst_gl_shader_set_uniform_1fv (shader, "offsets", MAX_TAPS,
+          pyramid->offsets);
+      gst_gl_shader_set_uniform_1fv (shader, "weights", MAX_TAPS,
+          pyramid->weights);
+      break;
+    case PASS_VERTICAL:
+      gst_gl_shader_set_uniform_2f (shader, "texel_step", 0.0, 1.0 / height);
+      gst_gl_shader_set_uniform_1fv (shader, "offsets", MAX_TAPS,
+          pyramid->offsets);
+      gst_gl_shader_set_uniform_1fv (shader, "weights", MAX_TAPS,
+          pyramid->weights);
+      break;
+  }
+
+  gst_gl_filter_draw_texture (filter, texture, width, height);
+}
+
+/* Called in the gl thread */
+static void
+_render_level (GstGLBlurPyramid * pyramid, GstGLBlurPyramidPass pass,
+    GLuint input, guint in_width, guint in_height, guint level, GLuint target)
+{
+  guint width = pyramid->width >> level, height = pyramid->height >> level;
+
+  pyramid->pass = pass;
+
+  gst_gl_framebuffer_use (pyramid->frame, width, height, pyramid->fbo[level],
+      pyramid->depth[level], target, _draw_pass, in_width, in_height, input,
+      0, in_width, 0, in_height, GST_GL_DISPLAY_PROJECTION_ORTHO2D, pyramid);
+}
+
+/* Called in the gl thread */
+static void
+_render_gl (GstGLContext * context, RenderData * data)
+{
+  GstGLBlurPyramid *pyramid = data->pyramid;
+  GstGLFuncs *gl = context->gl_vtable;
+  GLint mag_filter, min_filter;
+  gdouble level_sigma;
+  guint n_levels, i, w, h;
+  GLuint input;
+
+  data->result = FALSE;
+
+  if (!_get_shader (pyramid, &pyramid->down_shader, down_fragment_source)
+      || !_get_shader (pyramid, &pyramid->up_shader, up_fragment_source)
+      || !_get_shader (pyramid, &pyramid->gauss_shader, gauss_fragment_source))
+    return;
+
+  n_levels = _n_levels_for (pyramid->sigma, data->width, data->height,
+      &level_sigma);
+  if (!_ensure_levels (pyramid, data->width, data->height, n_levels))
+    return;
+
+  /* the frame can't be halved any further, blur as much as the kernel
+   * allows rather than truncating it */
+  if (level_sigma > MAX_LEVEL_SIGMA) {
+    if (pyramid->clamped_sigma != pyramid->sigma)
+      GST_WARNING ("sigma %f is too large for %ux%u, blurring with sigma %f",
+          pyramid->sigma, data->width, data->height,
+          MAX_LEVEL_SIGMA * (1 << n_levels));
+    pyramid->clamped_sigma = pyramid->sigma;
+    level_sigma = MAX_LEVEL_SIGMA;
+  }
+
+  _compute_kernel (pyramid, level_sigma);
+
+  GST_LOG ("sigma %f, %u levels, sigma %f at the smallest level",
+      pyramid->sigma, n_levels, level_sigma);
+
+  /* sample the input linearly like the rest of the pyramid and put its
+   * filters back afterwards */
+  gl->BindTexture (GL_TEXTURE_2D, data->input);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &mag_filter);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &min_filter);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+  /* halve down to the smallest level */
+  input = data->input;
+  w = data->in_width;
+  h = data->in_height;
+  for (i = 1; i <= n_levels; i++) {
+    _render_level (pyramid, PASS_DOWN, input, w, h, i, pyramid->level_tex[i]);
+    input = pyramid->level_tex[i];
+    w = pyramid->width >> i;
+    h = pyramid->height >> i;
+  }
+
+  /* blur it */
+  _render_level (pyramid, PASS_HORIZONTAL, input, w, h, n_levels,
+      pyramid->tmp_tex);
+  _render_level (pyramid, PASS_VERTICAL, pyramid->tmp_tex,
+      pyramid->width >> n_levels, pyramid->height >> n_levels, n_levels,
+      n_levels > 0 ? pyramid->level_tex[n_levels] : data->output);
+
+  /* and bring it back up */
+  for (i = n_levels; i > 0; i--) {
+    _render_level (pyramid, PASS_UP, pyramid->level_tex[i],
+        pyramid->width >> i, pyramid->height >> i, i - 1,
+        i > 1 ? pyramid->level_tex[i - 1] : data->output);
+  }
+
+  gl->BindTexture (GL_TEXTURE_2D, data->input);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+
+  data->result = TRUE;
+}
+
+/**
+ * gst_gl_blur_pyramid_render:
+ * @pyramid: a #GstGLBlurPyramid
+ * @input: the texture to blur
+ * @in_width: width of @input
+ * @in_height: height of @input
+ * @output: the texture to render the result into
+ * @width: width of @output
+ * @height: height of @output
+ *
+ * Blurs @input into @output in a single round-trip to the GL thread.
+ *
+ * Returns: whether the blur could be rendered
+ */
+gboolean
+gst_gl_blur_pyramid_render (GstGLBlurPyramid * pyramid, GLuint input,
+    guint in_width, guint in_height, GLuint output, guint width, guint height)
+{
+  RenderData data;
+
+  g_return_val_if_fail (pyramid != NULL, FALSE);
+
+  data.pyramid = pyramid;
+  data.input = input;
+  data.in_width = in_width;
+  data.in_height = in_height;
+  data.output = output;
+  data.width = width;
+  data.height = height;
+  data.result = FALSE;
+
+  gst_gl_context_thread_add (pyramid->filter->context,
+      (GstGLContextThreadFunc) _render_gl, &data);
+
+  return data.result;
+}
@@ -0,0 +1,54 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_GL_BLUR_PYRAMID_H_
+#define _GST_GL_BLUR_PYRAMID_H_
+
+#include <gst/gl/gstglfilter.h>
+
+G_BEGIN_DECLS
+
+/* Gaussian blur whose cost doesn't depend on its radius.  Large radii are
+ * blurred on a downsampled copy of the input: the image is halved with a
+ * dual filter until the remaining sigma fits a small separable kernel, which
+ * is applied with linear sampling, and then upsampled back.  The textures of
+ * the pyramid are kept from one frame to the next.  The frame is halved at
+ * most 8 times and never below 8 pixels, larger sigmas are clamped to 3
+ * pixels times 2 to the number of halvings, e.g. 384 for 1920x1080. */
+typedef struct _GstGLBlurPyramid GstGLBlurPyramid;
+
+GstGLBlurPyramid * gst_gl_blur_pyramid_new       (GstGLFilter * filter);
+void               gst_gl_blur_pyramid_free      (GstGLBlurPyramid * pyramid);
+
+void               gst_gl_blur_pyramid_set_sigma (GstGLBlurPyramid * pyramid,
+                                                  gdouble sigma);
+gdouble            gst_gl_blur_pyramid_get_sigma (GstGLBlurPyramid * pyramid);
+
+gboolean           gst_gl_blur_pyramid_render    (GstGLBlurPyramid * pyramid,
+                                                  GLuint input,
+                                                  guint in_width,
+                                                  guint in_height,
+                                                  GLuint output,
+                                                  guint width,
+                                                  guint height);
+
+G_END_DECLS
+
+#endif /* _GST_GL_BLUR_PYRAMID_H_ */
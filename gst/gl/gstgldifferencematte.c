@@ -75,6 +75,10 @@ enum
   PROP_LOCATION,
 };
 
+/* the 7 taps kernel the matte used to be blurred with truncated its sigma
+ * of 30 down to about 2 pixels, keep the same look */
+#define MATTE_SIGMA 2.0
+
 
 /* init resources that need a gl context */
 static void
@@ -84,7 +88,7 @@ gst_gl_differencematte_init_gl_resources (GstGLFilter * filter)
   GstGLFuncs *gl = filter->context->gl_vtable;
   gint i;
 
-  for (i = 0; i < 4; i++) {
+  for (i = 0; i < 2; i++) {
     gl->GenTextures (1, &differencematte->midtexture[i]);
     gl->BindTexture (GL_TEXTURE_2D, differencematte->midtexture[i]);
     gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
@@ -98,6 +102,9 @@ gst_gl_differencematte_init_gl_resources (GstGLFilter * filter)
     differencematte->shader[i] = gst_gl_shader_new (filter->context);
   }
 
+  differencematte->blur = gst_gl_blur_pyramid_new (filter);
+  gst_gl_blur_pyramid_set_sigma (differencematte->blur, MATTE_SIGMA);
+
   if (!gst_gl_shader_compile_and_check (differencematte->shader[0],
           difference_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
     gst_gl_context_set_error (GST_GL_FILTER (differencematte)->context,
@@ -108,24 +115,6 @@ gst_gl_differencematte_init_gl_resources (GstGLFilter * filter)
   }
 
   if (!gst_gl_shader_compile_and_check (differencematte->shader[1],
-          hconv7_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
-    gst_gl_context_set_error (GST_GL_FILTER (differencematte)->context,
-        "Failed to initialize hconv7 shader");
-    GST_ELEMENT_ERROR (differencematte, RESOURCE, NOT_FOUND,
-        ("%s", gst_gl_context_get_error ()), (NULL));
-    return;
-  }
-
-  if (!gst_gl_shader_compile_and_check (differencematte->shader[2],
-          vconv7_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
-    gst_gl_context_set_error (GST_GL_FILTER (differencematte)->context,
-        "Failed to initialize vconv7 shader");
-    GST_ELEMENT_ERROR (differencematte, RESOURCE, NOT_FOUND,
-        ("%s", gst_gl_context_get_error ()), (NULL));
-    return;
-  }
-
-  if (!gst_gl_shader_compile_and_check (differencematte->shader[3],
           texture_interp_fragment_source, GST_GL_SHADER_FRAGMENT_SOURCE)) {
     gst_gl_context_set_error (GST_GL_FILTER (differencematte)->context,
         "Failed to initialize interp shader");
@@ -145,7 +134,9 @@ gst_gl_differencematte_reset_gl_resources (GstGLFilter * filter)
 
   gl->DeleteTextures (1, &differencematte->savedbgtexture);
   gl->DeleteTextures (1, &differencematte->newbgtexture);
-  for (i = 0; i < 4; i++) {
+  gst_gl_blur_pyramid_free (differencematte->blur);
+  differencematte->blur = NULL;
+  for (i = 0; i < 2; i++) {
     if (differencematte->shader[i]) {
       gst_object_unref (differencematte->shader[i]);
       differencematte->shader[i] = NULL;
@@ -200,15 +191,12 @@ gst_gl_differencematte_init (GstGLDifferenceMatte * differencematte)
 {
   differencematte->shader[0] = NULL;
   differencematte->shader[1] = NULL;
-  differencematte->shader[2] = NULL;
-  differencematte->shader[3] = NULL;
+  differencematte->blur = NULL;
   differencematte->location = NULL;
   differencematte->pixbuf = NULL;
   differencematte->savedbgtexture = 0;
   differencematte->newbgtexture = 0;
   differencematte->bg_has_changed = FALSE;
-
-  fill_gaussian_kernel (differencematte->kernel, 7, 30.0);
 }
 
 static void
@@ -333,60 +321,6 @@ gst_gl_differencematte_diff (gint width, gint height, guint texture,
   gst_gl_filter_draw_texture (filter, texture, width, height);
 }
 
-static void
-gst_gl_differencematte_hblur (gint width, gint height, guint texture,
-    gpointer stuff)
-{
-  GstGLDifferenceMatte *differencematte = GST_GL_DIFFERENCEMATTE (stuff);
-  GstGLFilter *filter = GST_GL_FILTER (stuff);
-  GstGLFuncs *gl = filter->context->gl_vtable;
-
-  gl->MatrixMode (GL_PROJECTION);
-  gl->LoadIdentity ();
-
-  gst_gl_shader_use (differencematte->shader[1]);
-
-  gl->ActiveTexture (GL_TEXTURE0);
-  gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, texture);
-  gl->Disable (GL_TEXTURE_2D);
-
-  gst_gl_shader_set_uniform_1i (differencematte->shader[1], "tex", 0);
-
-  gst_gl_shader_set_uniform_1fv (differencematte->shader[1], "kernel", 7,
-      differencematte->kernel);
-  gst_gl_shader_set_uniform_1f (differencematte->shader[1], "width", width);
-
-  gst_gl_filter_draw_texture (filter, texture, width, height);
-}
-
-static void
-gst_gl_differencematte_vblur (gint width, gint height, guint texture,
-    gpointer stuff)
-{
-  GstGLDifferenceMatte *differencematte = GST_GL_DIFFERENCEMATTE (stuff);
-  GstGLFilter *filter = GST_GL_FILTER (stuff);
-  GstGLFuncs *gl = filter->context->gl_vtable;
-
-  gl->MatrixMode (GL_PROJECTION);
-  gl->LoadIdentity ();
-
-  gst_gl_shader_use (differencematte->shader[2]);
-
-  gl->ActiveTexture (GL_TEXTURE0);
-  gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, texture);
-  gl->Disable (GL_TEXTURE_2D);
-
-  gst_gl_shader_set_uniform_1i (differencematte->shader[2], "tex", 0);
-
-  gst_gl_shader_set_uniform_1fv (differencematte->shader[2], "kernel", 7,
-      differencematte->kernel);
-  gst_gl_shader_set_uniform_1f (differencematte->shader[2], "height", height);
-
-  gst_gl_filter_draw_texture (filter, texture, width, height);
-}
-
 static void
 gst_gl_differencematte_interp (gint width, gint height, guint texture,
     gpointer stuff)
@@ -398,28 +332,28 @@ gst_gl_differencematte_interp (gint width, gint height, guint texture,
   gl->MatrixMode (GL_PROJECTION);
   glLoadIdentity ();
 
-  gst_gl_shader_use (differencematte->shader[3]);
+  gst_gl_shader_use (differencematte->shader[1]);
 
   gl->ActiveTexture (GL_TEXTURE0);
   gl->Enable (GL_TEXTURE_2D);
   gl->BindTexture (GL_TEXTURE_2D, texture);
   gl->Disable (GL_TEXTURE_2D);
 
-  gst_gl_shader_set_uniform_1i (differencematte->shader[3], "blend", 0);
+  gst_gl_shader_set_uniform_1i (differencematte->shader[1], "blend", 0);
 
   gl->ActiveTexture (GL_TEXTURE1);
   gl->Enable (GL_TEXTURE_2D);
   gl->BindTexture (GL_TEXTURE_2D, differencematte->newbgtexture);
   gl->Disable (GL_TEXTURE_2D);
 
-  gst_gl_shader_set_uniform_1i (differencematte->shader[3], "base", 1);
+  gst_gl_shader_set_uniform_1i (differencematte->shader[1], "base", 1);
 
   gl->ActiveTexture (GL_TEXTURE2);
   gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, differencematte->midtexture[2]);
+  gl->BindTexture (GL_TEXTURE_2D, differencematte->midtexture[1]);
   gl->Disable (GL_TEXTURE_2D);
 
-  gst_gl_shader_set_uniform_1i (differencematte->shader[3], "alpha", 2);
+  gst_gl_shader_set_uniform_1i (differencematte->shader[1], "alpha", 2);
 
   gst_gl_filter_draw_texture (filter, texture, width, height);
 }
@@ -473,12 +407,13 @@ gst_gl_differencematte_filter_texture (GstGLFilter * filter, guint in_tex,
     gst_gl_filter_render_to_target (filter, TRUE, in_tex,
         differencematte->midtexture[0], gst_gl_differencematte_diff,
         differencematte);
-    gst_gl_filter_render_to_target (filter, FALSE,
-        differencematte->midtexture[0], differencematte->midtexture[1],
-        gst_gl_differencematte_hblur, differencematte);
-    gst_gl_filter_render_to_target (filter, FALSE,
-        differencematte->midtexture[1], differencematte->midtexture[2],
-        gst_gl_differencematte_vblur, differencematte);
+    gst_gl_blur_pyramid_render (differencematte->blur,
+        differencematte->midtexture[0],
+        GST_VIDEO_INFO_WIDTH (&filter->out_info),
+        GST_VIDEO_INFO_HEIGHT (&filter->out_info),
+        differencematte->midtexture[1],
+        GST_VIDEO_INFO_WIDTH (&filter->out_info),
+        GST_VIDEO_INFO_HEIGHT (&filter->out_info));
     gst_gl_filter_render_to_target (filter, TRUE, in_tex, out_tex,
         gst_gl_differencematte_interp, differencematte);
   } else {
@@ -22,6 +22,7 @@
 #define _GST_GL_DIFFERENCEMATTE_H_
 
 #include <gst/gl/gstglfilter.h>
+#include "gstglblurpyramid.h"
 
 #define GST_TYPE_GL_DIFFERENCEMATTE            (gst_gl_differencematte_get_type())
 #define GST_GL_DIFFERENCEMATTE(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_GL_DIFFERENCEMATTE,GstGLDifferenceMatte))
@@ -37,7 +38,8 @@ struct _GstGLDifferenceMatte
 {
   GstGLFilter filter;
 
-  GstGLShader *shader[4];
+  GstGLShader *shader[2];
+  GstGLBlurPyramid *blur;
 
   gchar *location;
   gboolean bg_has_changed;
@@ -46,9 +48,8 @@ struct _GstGLDifferenceMatte
   gint pbuf_width, pbuf_height;
   GLuint savedbgtexture;
   GLuint newbgtexture;
-  GLuint midtexture[4];
+  GLuint midtexture[2];
   GLuint intexture;
-  float kernel[7];
 };
 
 struct _GstGLDifferenceMatteClass
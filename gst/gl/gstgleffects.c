@@ -196,17 +196,13 @@ gst_gl_effects_init_gl_resources (GstGLFilter * filter)
   gint i;
 
   for (i = 0; i < NEEDED_TEXTURES; i++) {
-    glGenTextures (1, &effects->midtexture[i]);
-    glBindTexture (GL_TEXTURE_2D, effects->midtexture[i]);
-    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
-        GST_VIDEO_INFO_WIDTH (&filter->out_info),
-        GST_VIDEO_INFO_HEIGHT (&filter->out_info),
-        0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    effects->midtexture[i] = gst_gl_context_acquire_texture (filter->context,
+        GST_VIDEO_FORMAT_RGBA, GST_VIDEO_INFO_WIDTH (&filter->out_info),
+        GST_VIDEO_INFO_HEIGHT (&filter->out_info));
   }
+#if GST_GL_HAVE_OPENGL
+  effects->blur = gst_gl_blur_pyramid_new (filter);
+#endif
 }
 
 /* free resources that need a gl context */
@@ -217,13 +213,17 @@ gst_gl_effects_reset_gl_resources (GstGLFilter * filter)
   gint i;
 
   for (i = 0; i < NEEDED_TEXTURES; i++) {
-    glDeleteTextures (1, &effects->midtexture[i]);
+    gst_gl_context_release_texture (filter->context, effects->midtexture[i]);
     effects->midtexture[i] = 0;
   }
   for (i = 0; i < GST_GL_EFFECTS_N_CURVES; i++) {
     glDeleteTextures (1, &effects->curve[i]);
     effects->curve[i] = 0;
   }
+#if GST_GL_HAVE_OPENGL
+  gst_gl_blur_pyramid_free (effects->blur);
+  effects->blur = NULL;
+#endif
 }
 
 static void
@@ -292,6 +292,37 @@ gst_gl_effects_init (GstGLEffects * effects)
   effects->horizontal_swap = FALSE;
 }
 
+/* Called in the gl thread.  Returns the shader stored as @shader_name,
+ * creating it from @shader_source on first use.  The program itself is
+ * shared with every other element using the same source. */
+GstGLShader *
+gst_gl_effects_get_fragment_shader (GstGLEffects * effects,
+    const gchar * shader_name, const gchar * shader_source)
+{
+  GstGLContext *context = GST_GL_FILTER (effects)->context;
+  GstGLShader *shader;
+  GError *error = NULL;
+
+  shader = g_hash_table_lookup (effects->shaderstable, shader_name);
+  if (shader)
+    return shader;
+
+  shader = gst_gl_shader_new_cached (context, NULL, shader_source, &error);
+  if (!shader) {
+    gst_gl_context_set_error (context, "Failed to initialize %s shader, %s",
+        shader_name, error->message);
+    g_error_free (error);
+    gst_gl_context_clear_shader (context);
+    GST_ELEMENT_ERROR (effects, RESOURCE, NOT_FOUND,
+        ("%s", gst_gl_context_get_error ()), (NULL));
+    return NULL;
+  }
+
+  g_hash_table_insert (effects->shaderstable, (gchar *) shader_name, shader);
+
+  return shader;
+}
+
 static void
 gst_gl_effects_ghash_func_clean (gpointer key, gpointer value, gpointer data)
 {
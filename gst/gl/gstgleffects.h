@@ -23,6 +23,7 @@
 
 #include <gst/gl/gstglfilter.h>
 #include "effects/gstgleffectssources.h"
+#include "gstglblurpyramid.h"
 
 G_BEGIN_DECLS
 
@@ -65,6 +66,8 @@ struct _GstGLEffects
 
   GHashTable *shaderstable;
 
+  GstGLBlurPyramid *blur;
+
   gboolean horizontal_swap; /* switch left to right */
 };
 
@@ -83,6 +86,9 @@ enum
 
 GType gst_gl_effects_get_type (void);
 
+GstGLShader *gst_gl_effects_get_fragment_shader (GstGLEffects *effects,
+    const gchar *shader_name, const gchar *shader_source);
+
 void gst_gl_effects_identity (GstGLEffects *effects);
 void gst_gl_effects_mirror (GstGLEffects *effects);
 void gst_gl_effects_squeeze (GstGLEffects *effects);
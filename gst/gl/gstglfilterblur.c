@@ -21,12 +21,19 @@
 /**
  * SECTION:element-glfilterblur
  *
- * Blur with 9x9 separable convolution.
+ * Gaussian blur of any radius.
+ *
+ * Small radii are blurred with a separable convolution at full resolution.
+ * Larger ones are blurred on a downsampled pyramid of the image so the cost
+ * stays about the same whatever #GstGLFilterBlur:sigma is.  The image is
+ * halved at most 8 times and never below 8 pixels, which limits the sigma to
+ * 3 pixels times 2 to the number of halvings, e.g. 384 for 1920x1080 or 48
+ * for 320x240.  Larger values are clamped and a warning is logged.
  *
  * <refsect2>
  * <title>Examples</title>
  * |[
- * gst-launch videotestsrc ! glupload ! glfilterblur ! glimagesink
+ * gst-launch videotestsrc ! glupload ! glfilterblur sigma=20 ! glimagesink
  * ]|
  * FBO (Frame Buffer Object) and GLSL (OpenGL Shading Language) are required.
  * </refsect2>
@@ -37,11 +44,18 @@
 #endif
 
 #include "gstglfilterblur.h"
-#include "effects/gstgleffectssources.h"
 
 #define GST_CAT_DEFAULT gst_gl_filterblur_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+enum
+{
+  PROP_0,
+  PROP_SIGMA
+};
+
+#define DEFAULT_SIGMA 3.0
+
 #define DEBUG_INIT \
   GST_DEBUG_CATEGORY_INIT (gst_gl_filterblur_debug, "glfilterblur", 0, "glfilterblur element");
 
@@ -52,42 +66,26 @@ static void gst_gl_filterblur_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_gl_filterblur_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
-static void gst_gl_filter_filterblur_reset (GstGLFilter * filter);
 
-static gboolean gst_gl_filterblur_init_shader (GstGLFilter * filter);
 static gboolean gst_gl_filterblur_filter_texture (GstGLFilter * filter,
     guint in_tex, guint out_tex);
-static void gst_gl_filterblur_hcallback (gint width, gint height, guint texture,
-    gpointer stuff);
-static void gst_gl_filterblur_vcallback (gint width, gint height, guint texture,
-    gpointer stuff);
 
 
 static void
 gst_gl_filterblur_init_resources (GstGLFilter * filter)
 {
   GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (filter);
-  GstGLFuncs *gl = filter->context->gl_vtable;
 
-  gl->GenTextures (1, &filterblur->midtexture);
-  gl->BindTexture (GL_TEXTURE_2D, filterblur->midtexture);
-  gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
-      GST_VIDEO_INFO_WIDTH (&filter->out_info),
-      GST_VIDEO_INFO_HEIGHT (&filter->out_info),
-      0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  filterblur->pyramid = gst_gl_blur_pyramid_new (filter);
 }
 
 static void
 gst_gl_filterblur_reset_resources (GstGLFilter * filter)
 {
   GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (filter);
-  GstGLFuncs *gl = filter->context->gl_vtable;
 
-  gl->DeleteTextures (1, &filterblur->midtexture);
+  gst_gl_blur_pyramid_free (filterblur->pyramid);
+  filterblur->pyramid = NULL;
 }
 
 static void
@@ -102,8 +100,15 @@ gst_gl_filterblur_class_init (GstGLFilterBlurClass * klass)
   gobject_class->set_property = gst_gl_filterblur_set_property;
   gobject_class->get_property = gst_gl_filterblur_get_property;
 
+  g_object_class_install_property (gobject_class, PROP_SIGMA,
+      g_param_spec_double ("sigma", "Sigma",
+          "Standard deviation of the gaussian blur in pixels, clamped to what "
+          "the frame size allows", 0.0, 1000.0,
+          DEFAULT_SIGMA,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_metadata (element_class, "Gstreamer OpenGL Blur",
-      "Filter/Effect/Video", "Blur with 9x9 separable convolution",
+      "Filter/Effect/Video", "Gaussian blur of any radius",
       "Filippo Argiolas <filippo.argiolas@gmail.com>");
 
   GST_GL_FILTER_CLASS (klass)->filter_texture =
@@ -112,45 +117,27 @@ gst_gl_filterblur_class_init (GstGLFilterBlurClass * klass)
       gst_gl_filterblur_init_resources;
   GST_GL_FILTER_CLASS (klass)->display_reset_cb =
       gst_gl_filterblur_reset_resources;
-  GST_GL_FILTER_CLASS (klass)->onInitFBO = gst_gl_filterblur_init_shader;
-  GST_GL_FILTER_CLASS (klass)->onReset = gst_gl_filter_filterblur_reset;
 }
 
 static void
 gst_gl_filterblur_init (GstGLFilterBlur * filterblur)
 {
-  filterblur->shader0 = NULL;
-  filterblur->shader1 = NULL;
-  filterblur->midtexture = 0;
-  /* gaussian kernel (well, actually vector), size 9, standard
-   * deviation 3.0 */
-  /* FIXME: eventually make this a runtime property */
-  fill_gaussian_kernel (filterblur->gauss_kernel, 7, 3.0);
-}
-
-static void
-gst_gl_filter_filterblur_reset (GstGLFilter * filter)
-{
-  GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (filter);
-
-  //blocking call, wait the opengl thread has destroyed the shader
-  if (filterblur->shader0)
-    gst_gl_context_del_shader (filter->context, filterblur->shader0);
-  filterblur->shader0 = NULL;
-
-  //blocking call, wait the opengl thread has destroyed the shader
-  if (filterblur->shader1)
-    gst_gl_context_del_shader (filter->context, filterblur->shader1);
-  filterblur->shader1 = NULL;
+  filterblur->pyramid = NULL;
+  filterblur->sigma = DEFAULT_SIGMA;
 }
 
 static void
 gst_gl_filterblur_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
-  /* GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (object); */
+  GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (object);
 
   switch (prop_id) {
+    case PROP_SIGMA:
+      GST_OBJECT_LOCK (filterblur);
+      filterblur->sigma = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (filterblur);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -161,97 +148,36 @@ static void
 gst_gl_filterblur_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
-  /* GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (object); */
+  GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (object);
 
   switch (prop_id) {
+    case PROP_SIGMA:
+      GST_OBJECT_LOCK (filterblur);
+      g_value_set_double (value, filterblur->sigma);
+      GST_OBJECT_UNLOCK (filterblur);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
-static gboolean
-gst_gl_filterblur_init_shader (GstGLFilter * filter)
-{
-  GstGLFilterBlur *blur_filter = GST_GL_FILTERBLUR (filter);
-
-  //blocking call, wait the opengl thread has compiled the shader
-  if (!gst_gl_context_gen_shader (filter->context, 0, hconv7_fragment_source,
-          &blur_filter->shader0))
-    return FALSE;
-
-  //blocking call, wait the opengl thread has compiled the shader
-  if (!gst_gl_context_gen_shader (filter->context, 0, vconv7_fragment_source,
-          &blur_filter->shader1))
-    return FALSE;
-
-  return TRUE;
-}
-
 static gboolean
 gst_gl_filterblur_filter_texture (GstGLFilter * filter, guint in_tex,
     guint out_tex)
 {
   GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (filter);
+  gdouble sigma;
 
-  gst_gl_filter_render_to_target (filter, TRUE, in_tex,
-      filterblur->midtexture, gst_gl_filterblur_hcallback, filterblur);
+  GST_OBJECT_LOCK (filterblur);
+  sigma = filterblur->sigma;
+  GST_OBJECT_UNLOCK (filterblur);
 
-  gst_gl_filter_render_to_target (filter, FALSE, filterblur->midtexture,
-      out_tex, gst_gl_filterblur_vcallback, filterblur);
+  gst_gl_blur_pyramid_set_sigma (filterblur->pyramid, sigma);
 
-  return TRUE;
-}
-
-static void
-gst_gl_filterblur_hcallback (gint width, gint height, guint texture,
-    gpointer stuff)
-{
-  GstGLFilter *filter = GST_GL_FILTER (stuff);
-  GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (filter);
-  GstGLFuncs *gl = filter->context->gl_vtable;
-
-  gl->MatrixMode (GL_PROJECTION);
-  gl->LoadIdentity ();
-
-  gst_gl_shader_use (filterblur->shader0);
-
-  gl->ActiveTexture (GL_TEXTURE1);
-  gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, texture);
-  gl->Disable (GL_TEXTURE_2D);
-
-  gst_gl_shader_set_uniform_1i (filterblur->shader0, "tex", 1);
-  gst_gl_shader_set_uniform_1fv (filterblur->shader0, "kernel", 7,
-      filterblur->gauss_kernel);
-  gst_gl_shader_set_uniform_1f (filterblur->shader0, "width", width);
-
-  gst_gl_filter_draw_texture (filter, texture, width, height);
-}
-
-
-static void
-gst_gl_filterblur_vcallback (gint width, gint height, guint texture,
-    gpointer stuff)
-{
-  GstGLFilter *filter = GST_GL_FILTER (stuff);
-  GstGLFilterBlur *filterblur = GST_GL_FILTERBLUR (filter);
-  GstGLFuncs *gl = filter->context->gl_vtable;
-
-  gl->MatrixMode (GL_PROJECTION);
-  gl->LoadIdentity ();
-
-  gst_gl_shader_use (filterblur->shader1);
-
-  gl->ActiveTexture (GL_TEXTURE1);
-  gl->Enable (GL_TEXTURE_2D);
-  gl->BindTexture (GL_TEXTURE_2D, texture);
-  gl->Disable (GL_TEXTURE_2D);
-
-  gst_gl_shader_set_uniform_1i (filterblur->shader1, "tex", 1);
-  gst_gl_shader_set_uniform_1fv (filterblur->shader1, "kernel", 7,
-      filterblur->gauss_kernel);
-  gst_gl_shader_set_uniform_1f (filterblur->shader1, "height", height);
-
-  gst_gl_filter_draw_texture (filter, texture, width, height);
+  return gst_gl_blur_pyramid_render (filterblur->pyramid, in_tex,
+      GST_VIDEO_INFO_WIDTH (&filter->in_info),
+      GST_VIDEO_INFO_HEIGHT (&filter->in_info), out_tex,
+      GST_VIDEO_INFO_WIDTH (&filter->out_info),
+      GST_VIDEO_INFO_HEIGHT (&filter->out_info));
 }
@@ -22,6 +22,7 @@
 #define _GST_GL_FILTERBLUR_H_
 
 #include <gst/gl/gstglfilter.h>
+#include "gstglblurpyramid.h"
 
 #define GST_TYPE_GL_FILTERBLUR            (gst_gl_filterblur_get_type())
 #define GST_GL_FILTERBLUR(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_GL_FILTERBLUR,GstGLFilterBlur))
@@ -36,11 +37,9 @@ typedef struct _GstGLFilterBlurClass GstGLFilterBlurClass;
 struct _GstGLFilterBlur
 {
   GstGLFilter filter;
-  GstGLShader *shader0;
-  GstGLShader *shader1;
 
-  GLuint midtexture;
-  float gauss_kernel[7];
+  GstGLBlurPyramid *pyramid;
+  gdouble sigma;
 };
 
 struct _GstGLFilterBlurClass
@@ -0,0 +1,670 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-glfilterfuse
+ *
+ * Applies a chain of effects in as few passes as possible.
+ *
+ * The #GstGLFilterFuse:stages property lists the effects to apply in order.
+ * Consecutive effects that only look at the colour of the current pixel are
+ * fused into a single fragment shader and rendered in one pass, without any
+ * intermediate texture.  A new pass is only started in front of an effect
+ * that samples the neighbourhood of the pixel, like blur.
+ *
+ * The built-in effects are desaturate, lumathreshold, sin, heat, sepia,
+ * xpro, lumaxpro, blur, hblur and vblur.  file:<replaceable>path</replaceable>
+ * loads a GLSL snippet defining either <code>vec4 process (vec4 color)</code>
+ * to transform the colour of a pixel or <code>vec4 process_texture
+ * (sampler2D tex, vec2 texcoord)</code> if it needs to sample around
+ * texcoord.  Snippets can use the width and height uniforms.
+ *
+ * <refsect2>
+ * <title>Examples</title>
+ * |[
+ * gst-launch-1.0 videotestsrc ! glfilterfuse stages="sepia,file:vignette.glsl" ! glimagesink
+ * ]| Two effects rendered in a single pass.
+ * |[
+ * gst-launch-1.0 videotestsrc ! glfilterfuse stages="blur,desaturate,sepia" ! glimagesink
+ * ]| Two passes for the separable blur, desaturate and sepia are fused into
+ * the second one.  With stages="desaturate,blur,sepia" desaturate needs a
+ * pass of its own since the blur samples the desaturated neighbourhood,
+ * making it three passes.
+ * FBO (Frame Buffer Object) and GLSL (OpenGL Shading Language) are required.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstglfilterfuse.h"
+#include "effects/gstgleffectscurves.h"
+
+#define GST_CAT_DEFAULT gst_gl_filter_fuse_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+enum
+{
+  PROP_0,
+  PROP_STAGES
+};
+
+#define DEBUG_INIT \
+  GST_DEBUG_CATEGORY_INIT (gst_gl_filter_fuse_debug, "glfilterfuse", 0, "glfilterfuse element");
+
+G_DEFINE_TYPE_WITH_CODE (GstGLFilterFuse, gst_gl_filter_fuse,
+    GST_TYPE_GL_FILTER, DEBUG_INIT);
+
+static void gst_gl_filter_fuse_finalize (GObject * object);
+static void gst_gl_filter_fuse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_gl_filter_fuse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static gboolean gst_gl_filter_fuse_init_shader (GstGLFilter * filter);
+static void gst_gl_filter_fuse_reset_gl (GstGLFilter * filter);
+static gboolean gst_gl_filter_fuse_filter_texture (GstGLFilter * filter,
+    guint in_tex, guint out_tex);
+
+typedef struct
+{
+  const gchar *name;
+  /* NULL for effects that don't change anything */
+  const gchar *function;
+  const gchar **source;
+  gboolean sampled;
+  gint curve;
+  const GstGLEffectsCurve *curve_data;
+} GstGLFilterFuseBuiltin;
+
+/* *INDENT-OFF* */
+static const GstGLFilterFuseBuiltin builtins[] = {
+  {"identity", NULL, NULL, FALSE, -1, NULL},
+  {"desaturate", "desaturate", &desaturate_snippet_source, FALSE, -1, NULL},
+  {"lumathreshold", "luma_threshold", &luma_threshold_snippet_source, FALSE,
+      -1, NULL},
+  {"sin", "sin_effect", &sin_snippet_source, FALSE, -1, NULL},
+  {"heat", "luma_to_curve", &luma_to_curve_snippet_source, FALSE,
+      GST_GL_EFFECTS_CURVE_HEAT, &heat_curve},
+  {"sepia", "luma_to_curve", &luma_to_curve_snippet_source, FALSE,
+      GST_GL_EFFECTS_CURVE_SEPIA, &sepia_curve},
+  {"xpro", "rgb_to_curve", &rgb_to_curve_snippet_source, FALSE,
+      GST_GL_EFFECTS_CURVE_XPRO, &xpro_curve},
+  {"lumaxpro", "luma_to_curve", &luma_to_curve_snippet_source, FALSE,
+      GST_GL_EFFECTS_CURVE_LUMA_XPRO, &luma_xpro_curve},
+  {"hblur", "hconv7", &hconv7_snippet_source, TRUE, -1, NULL},
+  {"vblur", "vconv7", &vconv7_snippet_source, TRUE, -1, NULL},
+};
+/* *INDENT-ON* */
+
+typedef struct
+{
+  gchar *function;
+  gchar *source;
+  gboolean sampled;
+  gint curve;
+  const GstGLEffectsCurve *curve_data;
+} GstGLFilterFuseStage;
+
+typedef struct
+{
+  GstGLShader *shader;
+  /* mask of the curves sampled by the shader */
+  guint curves;
+} GstGLFilterFusePass;
+
+static gfloat gauss_kernel[7];
+
+static void
+gst_gl_filter_fuse_class_init (GstGLFilterFuseClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *element_class;
+
+  gobject_class = (GObjectClass *) klass;
+  element_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->finalize = gst_gl_filter_fuse_finalize;
+  gobject_class->set_property = gst_gl_filter_fuse_set_property;
+  gobject_class->get_property = gst_gl_filter_fuse_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_STAGES,
+      g_param_spec_string ("stages", "Stages",
+          "Comma separated list of the effects to apply, either built-in "
+          "effect names or file:<path> for a GLSL snippet", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  gst_element_class_set_metadata (element_class,
+      "OpenGL fused effects filter", "Filter/Effect/Video",
+      "Applies a chain of GLSL effects in a minimal number of passes",
+      "Matthew Waters <ystreet00@gmail.com>");
+
+  GST_GL_FILTER_CLASS (klass)->filter_texture =
+      gst_gl_filter_fuse_filter_texture;
+  GST_GL_FILTER_CLASS (klass)->onInitFBO = gst_gl_filter_fuse_init_shader;
+  GST_GL_FILTER_CLASS (klass)->display_reset_cb = gst_gl_filter_fuse_reset_gl;
+
+  fill_gaussian_kernel (gauss_kernel, 7, 1.5);
+}
+
+static void
+gst_gl_filter_fuse_init (GstGLFilterFuse * fuse)
+{
+  fuse->stages_description = NULL;
+  fuse->stages = NULL;
+  fuse->passes = NULL;
+}
+
+static void
+_free_stage (GstGLFilterFuseStage * stage)
+{
+  g_free (stage->function);
+  g_free (stage->source);
+  g_slice_free (GstGLFilterFuseStage, stage);
+}
+
+static void
+_free_pass (GstGLFilterFusePass * pass)
+{
+  if (pass->shader)
+    g_object_unref (pass->shader);
+  g_slice_free (GstGLFilterFusePass, pass);
+}
+
+static void
+gst_gl_filter_fuse_finalize (GObject * object)
+{
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (object);
+
+  g_free (fuse->stages_description);
+  fuse->stages_description = NULL;
+
+  if (fuse->stages)
+    g_ptr_array_free (fuse->stages, TRUE);
+  fuse->stages = NULL;
+
+  G_OBJECT_CLASS (gst_gl_filter_fuse_parent_class)->finalize (object);
+}
+
+static void
+gst_gl_filter_fuse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (object);
+
+  switch (prop_id) {
+    case PROP_STAGES:
+      GST_OBJECT_LOCK (fuse);
+      g_free (fuse->stages_description);
+      fuse->stages_description = g_value_dup_string (value);
+      fuse->stages_changed = TRUE;
+      GST_OBJECT_UNLOCK (fuse);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_gl_filter_fuse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (object);
+
+  switch (prop_id) {
+    case PROP_STAGES:
+      GST_OBJECT_LOCK (fuse);
+      g_value_set_string (value, fuse->stages_description);
+      GST_OBJECT_UNLOCK (fuse);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+_add_builtin_stage (GPtrArray * stages, const GstGLFilterFuseBuiltin * builtin)
+{
+  GstGLFilterFuseStage *stage;
+
+  if (!builtin->function)
+    return;
+
+  stage = g_slice_new0 (GstGLFilterFuseStage);
+  stage->function = g_strdup (builtin->function);
+  stage->source = g_strdup (*builtin->source);
+  stage->sampled = builtin->sampled;
+  stage->curve = builtin->curve;
+  stage->curve_data = builtin->curve_data;
+
+  g_ptr_array_add (stages, stage);
+}
+
+static gboolean
+_add_builtin_stages (GPtrArray * stages, const gchar * name)
+{
+  guint i;
+
+  if (g_strcmp0 (name, "blur") == 0)
+    return _add_builtin_stages (stages, "hblur")
+        && _add_builtin_stages (stages, "vblur");
+
+  for (i = 0; i < G_N_ELEMENTS (builtins); i++) {
+    if (g_strcmp0 (name, builtins[i].name) == 0) {
+      _add_builtin_stage (stages, &builtins[i]);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Returns whether @code, without its comments, defines a vec4 function
+ * called @name */
+static gboolean
+_defines_function (const gchar * code, const gchar * name)
+{
+  gchar *pattern;
+  gboolean ret;
+
+  pattern = g_strdup_printf ("\\bvec4\\s+%s\\s*\\(", name);
+  ret = g_regex_match_simple (pattern, code, 0, 0);
+  g_free (pattern);
+
+  return ret;
+}
+
+/* the snippet's entry point is renamed so that several snippets can live in
+ * the same shader */
+static gboolean
+_add_user_stage (GPtrArray * stages, const gchar * filename, GError ** error)
+{
+  GstGLFilterFuseStage *stage;
+  const gchar *entry;
+  GRegex *comments;
+  gchar *contents, *code;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return FALSE;
+
+  comments = g_regex_new ("//[^\\n]*|/\\*.*?\\*/", G_REGEX_DOTALL, 0, NULL);
+  code = g_regex_replace_literal (comments, contents, -1, 0, " ", 0, NULL);
+  g_regex_unref (comments);
+
+  if (code && _defines_function (code, "process_texture")) {
+    entry = "process_texture";
+  } else if (code && _defines_function (code, "process")) {
+    entry = "process";
+  } else {
+    g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+        "%s does not define a process or process_texture function", filename);
+    g_free (contents);
+    g_free (code);
+    return FALSE;
+  }
+  g_free (code);
+
+  stage = g_slice_new0 (GstGLFilterFuseStage);
+  stage->function = g_strdup_printf ("fuse_stage%u", stages->len);
+  stage->source = g_strdup_printf ("#define %s %s\n%s\n#undef %s", entry,
+      stage->function, contents, entry);
+  stage->sampled = g_strcmp0 (entry, "process_texture") == 0;
+  stage->curve = -1;
+
+  g_ptr_array_add (stages, stage);
+  g_free (contents);
+
+  return TRUE;
+}
+
+static GPtrArray *
+_parse_stages (const gchar * description, GError ** error)
+{
+  GPtrArray *stages;
+  gchar **names;
+  guint i;
+
+  stages = g_ptr_array_new_with_free_func ((GDestroyNotify) _free_stage);
+  if (!description)
+    return stages;
+
+  names = g_strsplit (description, ",", -1);
+  for (i = 0; names[i]; i++) {
+    gchar *name = g_strstrip (names[i]);
+
+    if (name[0] == '\0')
+      continue;
+
+    if (g_str_has_prefix (name, "file:")) {
+      if (!_add_user_stage (stages, name + strlen ("file:"), error))
+        goto error;
+    } else if (!_add_builtin_stages (stages, name)) {
+      g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+          "Unknown effect \'%s\'", name);
+      goto error;
+    }
+  }
+  g_strfreev (names);
+
+  return stages;
+
+error:
+  g_strfreev (names);
+  g_ptr_array_free (stages, TRUE);
+  return NULL;
+}
+
+/* A pass starts with a sampling stage, if any, reading from the previous
+ * pass' output and runs all the following per-pixel stages on its result */
+static gchar *
+_generate_fragment_source (GstGLFilterFuse * fuse, guint first, guint end,
+    guint * curves)
+{
+  GHashTable *emitted = g_hash_table_new (g_str_hash, g_str_equal);
+  GString *src = g_string_new (NULL);
+  guint i;
+
+  *curves = 0;
+
+  g_string_append (src, "uniform sampler2D tex;\n"
+      "uniform float width;\n" "uniform float height;\n");
+
+  for (i = first; i < end; i++) {
+    GstGLFilterFuseStage *stage = g_ptr_array_index (fuse->stages, i);
+
+    if (stage->curve >= 0 && !(*curves & (1 << stage->curve))) {
+      g_string_append_printf (src, "uniform sampler1D curve%d;\n",
+          stage->curve);
+      *curves |= 1 << stage->curve;
+    }
+
+    if (!g_hash_table_contains (emitted, stage->function)) {
+      g_string_append_printf (src, "%s\n", stage->source);
+      g_hash_table_add (emitted, stage->function);
+    }
+  }
+
+  g_string_append (src, "void main () {\n");
+
+  i = first;
+  if (i < end && ((GstGLFilterFuseStage *)
+          g_ptr_array_index (fuse->stages, i))->sampled) {
+    GstGLFilterFuseStage *stage = g_ptr_array_index (fuse->stages, i);
+
+    g_string_append_printf (src,
+        "  vec4 color = %s (tex, gl_TexCoord[0].st);\n", stage->function);
+    i++;
+  } else {
+    g_string_append (src, "  vec4 color = texture2D (tex, gl_TexCoord[0].st);\n");
+  }
+
+  for (; i < end; i++) {
+    GstGLFilterFuseStage *stage = g_ptr_array_index (fuse->stages, i);
+
+    if (stage->curve >= 0)
+      g_string_append_printf (src, "  color = %s (color, curve%d);\n",
+          stage->function, stage->curve);
+    else
+      g_string_append_printf (src, "  color = %s (color);\n", stage->function);
+  }
+
+  g_string_append (src, "  gl_FragColor = color;\n}\n");
+
+  g_hash_table_destroy (emitted);
+
+  return g_string_free (src, FALSE);
+}
+
+/* Called in the gl thread */
+static void
+_upload_curve (GstGLFilterFuse * fuse, gint index,
+    const GstGLEffectsCurve * curve)
+{
+  GstGLFuncs *gl = GST_GL_FILTER (fuse)->context->gl_vtable;
+
+  if (fuse->curve[index])
+    return;
+
+  /* this parameters are needed to have a right, predictable, mapping */
+  gl->GenTextures (1, &fuse->curve[index]);
+  gl->Enable (GL_TEXTURE_1D);
+  gl->BindTexture (GL_TEXTURE_1D, fuse->curve[index]);
+  gl->TexParameteri (GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  gl->TexParameteri (GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  gl->TexParameteri (GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+  gl->TexParameteri (GL_TEXTURE_1D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+
+  gl->TexImage1D (GL_TEXTURE_1D, 0, curve->bytes_per_pixel,
+      curve->width, 0, GL_RGB, GL_UNSIGNED_BYTE, curve->pixel_data);
+
+  gl->Disable (GL_TEXTURE_1D);
+}
+
+typedef struct
+{
+  GstGLFilterFuse *fuse;
+  GError *error;
+} BuildPassesData;
+
+/* Called in the gl thread */
+static void
+_build_passes (GstGLContext * context, BuildPassesData * data)
+{
+  GstGLFilterFuse *fuse = data->fuse;
+  GstGLFilter *filter = GST_GL_FILTER (fuse);
+  guint i, len = fuse->stages->len;
+
+  fuse->passes =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) _free_pass);
+
+  i = 0;
+  do {
+    GstGLFilterFusePass *pass;
+    guint end = i;
+    gchar *frag;
+
+    if (end < len && ((GstGLFilterFuseStage *)
+            g_ptr_array_index (fuse->stages, end))->sampled)
+      end++;
+    while (end < len && !((GstGLFilterFuseStage *)
+            g_ptr_array_index (fuse->stages, end))->sampled)
+      end++;
+
+    pass = g_slice_new0 (GstGLFilterFusePass);
+    g_ptr_array_add (fuse->passes, pass);
+
+    frag = _generate_fragment_source (fuse, i, end, &pass->curves);
+    GST_LOG_OBJECT (fuse, "pass %u, stages %u-%u:\n%s", fuse->passes->len - 1,
+        i, end, frag);
+
+    pass->shader = gst_gl_shader_new_cached (context, NULL, frag,
+        &data->error);
+    g_free (frag);
+    if (!pass->shader)
+      return;
+
+    for (; i < end; i++) {
+      GstGLFilterFuseStage *stage = g_ptr_array_index (fuse->stages, i);
+
+      if (stage->curve >= 0)
+        _upload_curve (fuse, stage->curve, stage->curve_data);
+    }
+  } while (i < len);
+
+  for (i = 0; i < MIN (fuse->passes->len - 1, 2); i++) {
+    fuse->midtexture[i] = gst_gl_context_acquire_texture (context,
+        GST_VIDEO_FORMAT_RGBA, GST_VIDEO_INFO_WIDTH (&filter->out_info),
+        GST_VIDEO_INFO_HEIGHT (&filter->out_info));
+  }
+
+  GST_INFO_OBJECT (fuse, "fused %u stages into %u passes", len,
+      fuse->passes->len);
+}
+
+/* Called in the gl thread */
+static void
+gst_gl_filter_fuse_reset_gl (GstGLFilter * filter)
+{
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (filter);
+  GstGLFuncs *gl = filter->context->gl_vtable;
+  gint i;
+
+  if (fuse->passes)
+    g_ptr_array_free (fuse->passes, TRUE);
+  fuse->passes = NULL;
+
+  for (i = 0; i < 2; i++) {
+    if (fuse->midtexture[i])
+      gst_gl_context_release_texture (filter->context, fuse->midtexture[i]);
+    fuse->midtexture[i] = 0;
+  }
+
+  for (i = 0; i < GST_GL_EFFECTS_N_CURVES; i++) {
+    if (fuse->curve[i])
+      gl->DeleteTextures (1, &fuse->curve[i]);
+    fuse->curve[i] = 0;
+  }
+}
+
+static void
+_reset_gl (GstGLContext * context, GstGLFilterFuse * fuse)
+{
+  gst_gl_filter_fuse_reset_gl (GST_GL_FILTER (fuse));
+}
+
+static gboolean
+gst_gl_filter_fuse_init_shader (GstGLFilter * filter)
+{
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (filter);
+  BuildPassesData data;
+  GError *error = NULL;
+  GPtrArray *stages;
+
+  GST_OBJECT_LOCK (fuse);
+  stages = _parse_stages (fuse->stages_description, &error);
+  fuse->stages_changed = FALSE;
+  GST_OBJECT_UNLOCK (fuse);
+
+  if (!stages) {
+    GST_ELEMENT_ERROR (fuse, RESOURCE, SETTINGS, ("%s", error->message),
+        (NULL));
+    g_error_free (error);
+    return FALSE;
+  }
+
+  if (fuse->passes)
+    gst_gl_context_thread_add (filter->context,
+        (GstGLContextThreadFunc) _reset_gl, fuse);
+
+  if (fuse->stages)
+    g_ptr_array_free (fuse->stages, TRUE);
+  fuse->stages = stages;
+
+  data.fuse = fuse;
+  data.error = NULL;
+  gst_gl_context_thread_add (filter->context,
+      (GstGLContextThreadFunc) _build_passes, &data);
+
+  if (data.error) {
+    GST_ELEMENT_ERROR (fuse, RESOURCE, NOT_FOUND, ("%s", data.error->message),
+        (NULL));
+    g_error_free (data.error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_gl_filter_fuse_callback (gint width, gint height, guint texture,
+    gpointer stuff)
+{
+  GstGLFilter *filter = GST_GL_FILTER (stuff);
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (filter);
+  GstGLFilterFusePass *pass = fuse->current_pass;
+  GstGLFuncs *gl = filter->context->gl_vtable;
+  gint i;
+
+  gl->MatrixMode (GL_PROJECTION);
+  gl->LoadIdentity ();
+
+  gst_gl_shader_use (pass->shader);
+
+  for (i = 0; i < GST_GL_EFFECTS_N_CURVES; i++) {
+    gchar name[16];
+
+    if (!(pass->curves & (1 << i)))
+      continue;
+
+    gl->ActiveTexture (GL_TEXTURE2 + i);
+    gl->Enable (GL_TEXTURE_1D);
+    gl->BindTexture (GL_TEXTURE_1D, fuse->curve[i]);
+    gl->Disable (GL_TEXTURE_1D);
+
+    g_snprintf (name, sizeof (name), "curve%d", i);
+    gst_gl_shader_set_uniform_1i (pass->shader, name, 2 + i);
+  }
+
+  gl->ActiveTexture (GL_TEXTURE1);
+  gl->Enable (GL_TEXTURE_2D);
+  gl->BindTexture (GL_TEXTURE_2D, texture);
+  gl->Disable (GL_TEXTURE_2D);
+
+  gst_gl_shader_set_uniform_1i (pass->shader, "tex", 1);
+  gst_gl_shader_set_uniform_1f (pass->shader, "width", width);
+  gst_gl_shader_set_uniform_1f (pass->shader, "height", height);
+  gst_gl_shader_set_uniform_1fv (pass->shader, "hkernel", 7, gauss_kernel);
+  gst_gl_shader_set_uniform_1fv (pass->shader, "vkernel", 7, gauss_kernel);
+
+  gst_gl_filter_draw_texture (filter, texture, width, height);
+}
+
+static gboolean
+gst_gl_filter_fuse_filter_texture (GstGLFilter * filter, guint in_tex,
+    guint out_tex)
+{
+  GstGLFilterFuse *fuse = GST_GL_FILTER_FUSE (filter);
+  gboolean changed;
+  guint i, n_passes;
+
+  GST_OBJECT_LOCK (fuse);
+  changed = fuse->stages_changed;
+  GST_OBJECT_UNLOCK (fuse);
+
+  if (changed && !gst_gl_filter_fuse_init_shader (filter))
+    return FALSE;
+
+  n_passes = fuse->passes->len;
+  for (i = 0; i < n_passes; i++) {
+    GLuint input = i == 0 ? in_tex : fuse->midtexture[(i - 1) % 2];
+    GLuint target = i == n_passes - 1 ? out_tex : fuse->midtexture[i % 2];
+
+    fuse->current_pass = g_ptr_array_index (fuse->passes, i);
+    gst_gl_filter_render_to_target (filter, i == 0, input, target,
+        gst_gl_filter_fuse_callback, fuse);
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,65 @@
+/*
+ * GStreamer
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_GL_FILTER_FUSE_H_
+#define _GST_GL_FILTER_FUSE_H_
+
+#include <gst/gl/gstglfilter.h>
+#include "gstgleffects.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_GL_FILTER_FUSE            (gst_gl_filter_fuse_get_type())
+#define GST_GL_FILTER_FUSE(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_GL_FILTER_FUSE,GstGLFilterFuse))
+#define GST_IS_GL_FILTER_FUSE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_GL_FILTER_FUSE))
+#define GST_GL_FILTER_FUSE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass) ,GST_TYPE_GL_FILTER_FUSE,GstGLFilterFuseClass))
+#define GST_IS_GL_FILTER_FUSE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass) ,GST_TYPE_GL_FILTER_FUSE))
+#define GST_GL_FILTER_FUSE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj) ,GST_TYPE_GL_FILTER_FUSE,GstGLFilterFuseClass))
+
+typedef struct _GstGLFilterFuse GstGLFilterFuse;
+typedef struct _GstGLFilterFuseClass GstGLFilterFuseClass;
+
+struct _GstGLFilterFuse
+{
+  GstGLFilter filter;
+
+  gchar *stages_description;
+  gboolean stages_changed;
+
+  /* the parsed stages and the passes rendering them */
+  GPtrArray *stages;
+  GPtrArray *passes;
+  gpointer current_pass;
+
+  /* ping-pong targets between passes */
+  GLuint midtexture[2];
+  GLuint curve[GST_GL_EFFECTS_N_CURVES];
+};
+
+struct _GstGLFilterFuseClass
+{
+  GstGLFilterClass filter_class;
+};
+
+GType gst_gl_filter_fuse_get_type (void);
+
+G_END_DECLS
+
+#endif /* _GST_GL_FILTER_FUSE_H_ */
@@ -29,6 +29,10 @@
  * gst-launch videotestsrc ! glupload ! glfiltersobel ! glimagesink
  * ]|
  * FBO (Frame Buffer Object) and GLSL (OpenGL Shading Language) are required.
+ *
+ * Only the luma of the input is looked at.  When upstream fills
+ * #GstGLMemory of a planar or semi-planar YUV format, the Y plane is
+ * sampled directly and the frame is never converted into RGBA.
  * </refsect2>
  */
 
@@ -63,28 +67,39 @@ static void gst_gl_filter_filtersobel_reset (GstGLFilter * filter);
 static gboolean gst_gl_filtersobel_init_shader (GstGLFilter * filter);
 static gboolean gst_gl_filtersobel_filter_texture (GstGLFilter * filter,
     guint in_tex, guint out_tex);
+static gboolean gst_gl_filtersobel_filter_planes (GstGLFilter * filter,
+    const guint * in_planes, guint out_tex);
+
+static void gst_gl_filtersobel_luma (gint width, gint height, guint texture,
+    gpointer stuff);
 
 static void gst_gl_filtersobel_length (gint width, gint height, guint texture,
     gpointer stuff);
 
+/* *INDENT-OFF* */
+/* the Y plane stretched from the range of the input like desaturate would
+ * have produced it */
+static const gchar *luma_fragment_source =
+  "uniform sampler2D tex;"
+  "uniform float offset;"
+  "uniform float scale;"
+  "void main () {"
+  "  float luma = (texture2D (tex, gl_TexCoord[0].st).r + offset) * scale;"
+  "  gl_FragColor = vec4(vec3(luma), 1.0);"
+  "}";
+/* *INDENT-ON* */
+
 static void
 gst_gl_filtersobel_init_resources (GstGLFilter * filter)
 {
   GstGLFilterSobel *filtersobel = GST_GL_FILTERSOBEL (filter);
-  GstGLFuncs *gl = filter->context->gl_vtable;
   int i;
 
   for (i = 0; i < 2; i++) {
-    gl->GenTextures (1, &filtersobel->midtexture[i]);
-    gl->BindTexture (GL_TEXTURE_2D, filtersobel->midtexture[i]);
-    gl->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8,
+    filtersobel->midtexture[i] =
+        gst_gl_context_acquire_texture (filter->context, GST_VIDEO_FORMAT_RGBA,
         GST_VIDEO_INFO_WIDTH (&filter->out_info),
-        GST_VIDEO_INFO_HEIGHT (&filter->out_info),
-        0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GST_VIDEO_INFO_HEIGHT (&filter->out_info));
   }
 }
 
@@ -92,11 +107,11 @@ static void
 gst_gl_filtersobel_reset_resources (GstGLFilter * filter)
 {
   GstGLFilterSobel *filtersobel = GST_GL_FILTERSOBEL (filter);
-  GstGLFuncs *gl = filter->context->gl_vtable;
   int i;
 
   for (i = 0; i < 2; i++) {
-    gl->DeleteTextures (1, &filtersobel->midtexture[i]);
+    gst_gl_context_release_texture (filter->context,
+        filtersobel->midtexture[i]);
   }
 }
 
@@ -114,6 +129,8 @@ gst_gl_filtersobel_class_init (GstGLFilterSobelClass * klass)
 
   GST_GL_FILTER_CLASS (klass)->filter_texture =
       gst_gl_filtersobel_filter_texture;
+  GST_GL_FILTER_CLASS (klass)->filter_planes =
+      gst_gl_filtersobel_filter_planes;
   GST_GL_FILTER_CLASS (klass)->display_init_cb =
       gst_gl_filtersobel_init_resources;
   GST_GL_FILTER_CLASS (klass)->display_reset_cb =
@@ -155,6 +172,10 @@ gst_gl_filter_filtersobel_reset (GstGLFilter * filter)
     gst_gl_context_del_shader (filter->context, filtersobel->desat);
   filtersobel->desat = NULL;
 
+  if (filtersobel->luma)
+    gst_gl_context_del_shader (filter->context, filtersobel->luma);
+  filtersobel->luma = NULL;
+
   if (filtersobel->hconv)
     gst_gl_context_del_shader (filter->context, filtersobel->hconv);
   filtersobel->hconv = NULL;
@@ -210,6 +231,9 @@ gst_gl_filtersobel_init_shader (GstGLFilter * filter)
   ret =
       gst_gl_context_gen_shader (filter->context, 0, desaturate_fragment_source,
       &filtersobel->desat);
+  ret &=
+      gst_gl_context_gen_shader (filter->context, 0, luma_fragment_source,
+      &filtersobel->luma);
   ret &=
       gst_gl_context_gen_shader (filter->context, 0,
       sep_sobel_hconv3_fragment_source, &filtersobel->hconv);
@@ -223,14 +247,12 @@ gst_gl_filtersobel_init_shader (GstGLFilter * filter)
   return ret;
 }
 
-static gboolean
-gst_gl_filtersobel_filter_texture (GstGLFilter * filter, guint in_tex,
-    guint out_tex)
+/* the edges of the grey frame in midtexture[0] */
+static void
+gst_gl_filtersobel_edges (GstGLFilter * filter, guint out_tex)
 {
   GstGLFilterSobel *filtersobel = GST_GL_FILTERSOBEL (filter);
 
-  gst_gl_filter_render_to_target_with_shader (filter, TRUE, in_tex,
-      filtersobel->midtexture[0], filtersobel->desat);
   gst_gl_filter_render_to_target_with_shader (filter, FALSE,
       filtersobel->midtexture[0], filtersobel->midtexture[1],
       filtersobel->hconv);
@@ -239,10 +261,73 @@ gst_gl_filtersobel_filter_texture (GstGLFilter * filter, guint in_tex,
       filtersobel->vconv);
   gst_gl_filter_render_to_target (filter, FALSE, filtersobel->midtexture[0],
       out_tex, gst_gl_filtersobel_length, filtersobel);
+}
+
+static gboolean
+gst_gl_filtersobel_filter_texture (GstGLFilter * filter, guint in_tex,
+    guint out_tex)
+{
+  GstGLFilterSobel *filtersobel = GST_GL_FILTERSOBEL (filter);
+
+  gst_gl_filter_render_to_target_with_shader (filter, TRUE, in_tex,
+      filtersobel->midtexture[0], filtersobel->desat);
+  gst_gl_filtersobel_edges (filter, out_tex);
+
+  return TRUE;
+}
+
+static gboolean
+gst_gl_filtersobel_filter_planes (GstGLFilter * filter,
+    const guint * in_planes, guint out_tex)
+{
+  GstGLFilterSobel *filtersobel = GST_GL_FILTERSOBEL (filter);
+
+  GST_TRACE_OBJECT (filter, "sampling the luma of plane texture %u",
+      in_planes[0]);
+
+  /* the Y plane replaces both the conversion and desaturate */
+  gst_gl_filter_render_to_target (filter, TRUE, in_planes[0],
+      filtersobel->midtexture[0], gst_gl_filtersobel_luma, filtersobel);
+  gst_gl_filtersobel_edges (filter, out_tex);
 
   return TRUE;
 }
 
+static void
+gst_gl_filtersobel_luma (gint width, gint height, guint texture,
+    gpointer stuff)
+{
+  GstGLFilter *filter = GST_GL_FILTER (stuff);
+  GstGLFuncs *gl = filter->context->gl_vtable;
+  GstGLFilterSobel *filtersobel = GST_GL_FILTERSOBEL (filter);
+  gfloat offset, scale;
+
+  if (GST_VIDEO_INFO_COLORIMETRY (&filter->in_info).range ==
+      GST_VIDEO_COLOR_RANGE_0_255) {
+    offset = 0.0;
+    scale = 1.0;
+  } else {
+    offset = -16.0 / 255.0;
+    scale = 255.0 / 219.0;
+  }
+
+  glMatrixMode (GL_PROJECTION);
+  glLoadIdentity ();
+
+  gst_gl_shader_use (filtersobel->luma);
+
+  gl->ActiveTexture (GL_TEXTURE1);
+  gl->Enable (GL_TEXTURE_2D);
+  gl->BindTexture (GL_TEXTURE_2D, texture);
+  gl->Disable (GL_TEXTURE_2D);
+
+  gst_gl_shader_set_uniform_1i (filtersobel->luma, "tex", 1);
+  gst_gl_shader_set_uniform_1f (filtersobel->luma, "offset", offset);
+  gst_gl_shader_set_uniform_1f (filtersobel->luma, "scale", scale);
+
+  gst_gl_filter_draw_texture (filter, texture, width, height);
+}
+
 static void
 gst_gl_filtersobel_length (gint width, gint height, guint texture,
     gpointer stuff)
@@ -40,6 +40,7 @@ struct _GstGLFilterSobel
   GstGLShader *vconv;
   GstGLShader *len;
   GstGLShader *desat;
+  GstGLShader *luma;
 
   GLuint midtexture[5];
 
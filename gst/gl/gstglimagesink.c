@@ -1049,6 +1049,9 @@ gst_glimage_sink_on_draw (const GstGLImageSink * gl_sink)
         GST_VIDEO_INFO_HEIGHT (&gl_sink->info),
         gl_sink->client_data);
 
+    /* the application may have called GL directly */
+    gst_gl_context_invalidate_state (gl_sink->context);
+
     if (doRedisplay)
       gst_gl_window_draw_unlocked (window,
           GST_VIDEO_INFO_WIDTH (&gl_sink->info),
@@ -1058,16 +1061,6 @@ gst_glimage_sink_on_draw (const GstGLImageSink * gl_sink)
   else {
 #if GST_GL_HAVE_OPENGL
     if (USING_OPENGL (gl_sink->context)) {
-      GLfloat verts[8] = { 1.0f, 1.0f,
-        -1.0f, 1.0f,
-        -1.0f, -1.0f,
-        1.0f, -1.0f
-      };
-      GLfloat texcoords[8] = { 1.0f, 0.0f,
-        0.0f, 0.0f,
-        0.0f, 1.0f,
-        1.0f, 1.0f
-      };
       gl->Clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
       gl->MatrixMode (GL_PROJECTION);
@@ -1076,53 +1069,25 @@ gst_glimage_sink_on_draw (const GstGLImageSink * gl_sink)
       gl->Enable (GL_TEXTURE_2D);
       gl->BindTexture (GL_TEXTURE_2D, gl_sink->redisplay_texture);
 
-      gl->EnableClientState (GL_VERTEX_ARRAY);
-      gl->EnableClientState (GL_TEXTURE_COORD_ARRAY);
-      gl->VertexPointer (2, GL_FLOAT, 0, &verts);
-      gl->TexCoordPointer (2, GL_FLOAT, 0, &texcoords);
-
-      gl->DrawArrays (GL_TRIANGLE_FAN, 0, 4);
-
-      gl->DisableClientState (GL_VERTEX_ARRAY);
-      gl->DisableClientState (GL_TEXTURE_COORD_ARRAY);
+      /* the window origin is at the bottom */
+      gst_gl_context_draw_fullscreen_quad (gl_sink->context, -1, -1, TRUE);
 
       gl->Disable (GL_TEXTURE_2D);
     }
 #endif
 #if GST_GL_HAVE_GLES2
     if (USING_GLES2 (gl_sink->context)) {
-      const GLfloat vVertices[] = { 1.0f, 1.0f, 0.0f,
-        1.0f, 0.0f,
-        -1.0f, 1.0f, 0.0f,
-        0.0f, 0.0f,
-        -1.0f, -1.0f, 0.0f,
-        0.0f, 1.0f,
-        1.0f, -1.0f, 0.0f,
-        1.0f, 1.0f
-      };
-
-      GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
-
       gl->Clear (GL_COLOR_BUFFER_BIT);
 
       gst_gl_shader_use (gl_sink->redisplay_shader);
 
-      /* Load the vertex position */
-      gl->VertexAttribPointer (gl_sink->redisplay_attr_position_loc, 3,
-          GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), vVertices);
-
-      /* Load the texture coordinate */
-      gl->VertexAttribPointer (gl_sink->redisplay_attr_texture_loc, 2,
-          GL_FLOAT, GL_FALSE, 5 * sizeof (GLfloat), &vVertices[3]);
-
-      gl->EnableVertexAttribArray (gl_sink->redisplay_attr_position_loc);
-      gl->EnableVertexAttribArray (gl_sink->redisplay_attr_texture_loc);
-
       gl->ActiveTexture (GL_TEXTURE0);
       gl->BindTexture (GL_TEXTURE_2D, gl_sink->redisplay_texture);
       gst_gl_shader_set_uniform_1i (gl_sink->redisplay_shader, "s_texture", 0);
 
-      gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
+      gst_gl_context_draw_fullscreen_quad (gl_sink->context,
+          gl_sink->redisplay_attr_position_loc,
+          gl_sink->redisplay_attr_texture_loc, TRUE);
     }
 #endif
   }                             /* end default opengl scene */
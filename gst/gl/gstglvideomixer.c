@@ -23,14 +23,19 @@
  *
  * glmixer sub element. N gl sink pads to 1 source pad.
  * N + 1 OpenGL contexts shared together.
- * N <= 6 because the rendering is more a like a cube than a video_mixer
- * Each opengl input stream is rendered on a cube face
+ * Each input stream is scaled into the rectangle given by the xpos, ypos,
+ * width and height properties of its pad and blended over the streams of
+ * lower zorder with the alpha of the pad.  All the inputs are composited by
+ * as few draws as the available texture units allow.
  *
  * <refsect2>
  * <title>Examples</title>
  * |[
  * gst-launch-0.10 videotestsrc ! "video/x-raw-yuv, format=(fourcc)YUY2" ! glupload ! queue ! glvideomixer name=m ! glimagesink videotestsrc pattern=12 ! "video/x-raw-yuv, format=(fourcc)I420, framerate=(fraction)5/1, width=100, height=200" ! glupload ! queue ! m. videotestsrc ! "video/x-raw-rgb, framerate=(fraction)15/1, width=1500, height=1500" ! glupload ! gleffects effect=3 ! queue ! m. videotestsrc ! glupload ! gleffects effect=2 ! queue ! m.  videotestsrc ! glupload ! glfiltercube ! queue ! m. videotestsrc ! glupload ! gleffects effect=6 ! queue ! m.
  * ]|
+ * |[
+ * gst-launch-1.0 glvideomixer name=m sink_1::xpos=320 sink_1::alpha=0.5 ! glimagesink videotestsrc ! video/x-raw,width=640,height=480 ! m. videotestsrc pattern=1 ! m.
+ * ]|
  * FBO (Frame Buffer Object) is required.
  * </refsect2>
  */
@@ -68,27 +73,63 @@ static gboolean gst_gl_video_mixer_process_textures (GstGLMixer * mixer,
     GPtrArray * in_frames, guint out_tex);
 static void gst_gl_video_mixer_callback (gpointer stuff);
 
+/* upper bound of the inputs sampled by a single draw, GLES2 only
+ * guarantees 8 texture units in the fragment shader */
+#define MAX_BATCH_SIZE 16
+
+/* x, y, s, t, input index within the batch, alpha */
+#define VERTEX_FLOATS 6
+#define VERTEX_STRIDE (VERTEX_FLOATS * sizeof (GLfloat))
+
 /* vertex source */
 static const gchar *video_mixer_v_src =
-    "attribute vec4 a_position;                                   \n"
+    "attribute vec2 a_position;                                   \n"
     "attribute vec2 a_texCoord;                                   \n"
-    "uniform float x_scale;                                       \n"
-    "uniform float y_scale;                                       \n"
+    "attribute float a_input;                                     \n"
+    "attribute float a_alpha;                                     \n"
     "varying vec2 v_texCoord;                                     \n"
+    "varying float v_input;                                       \n"
+    "varying float v_alpha;                                       \n"
     "void main()                                                  \n"
     "{                                                            \n"
-    "   gl_Position = a_position * vec4(x_scale, y_scale, 1.0, 1.0);\n"
-    "   v_texCoord = a_texCoord;                                  \n" "}";
-
-/* fragment source */
-static const gchar *video_mixer_f_src =
-    "uniform sampler2D texture;                     \n"
-    "varying vec2 v_texCoord;                            \n"
-    "void main()                                         \n"
-    "{                                                   \n"
-    "  vec4 rgba = texture2D( texture, v_texCoord );\n"
-    "  gl_FragColor = vec4(rgba.rgb, 1.0);\n"
-    "}                                                   \n";
+    "   gl_Position = vec4(a_position, -1.0, 1.0);                \n"
+    "   v_texCoord = a_texCoord;                                  \n"
+    "   v_input = a_input;                                        \n"
+    "   v_alpha = a_alpha;                                        \n" "}";
+
+/* the fragment shader picks the texture of the quad being drawn from the
+ * batch, samplers can't be indexed dynamically in GLSL ES 1.0 */
+static gchar *
+_gen_fragment_source (guint batch_size)
+{
+  GString *src = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; i < batch_size; i++)
+    g_string_append_printf (src, "uniform sampler2D texture%u;\n", i);
+
+  g_string_append (src, "varying vec2 v_texCoord;\n"
+      "varying float v_input;\n"
+      "varying float v_alpha;\n"
+      "void main()\n"
+      "{\n"
+      "  vec4 rgba;\n");
+
+  for (i = 0; i < batch_size; i++) {
+    if (i < batch_size - 1)
+      g_string_append_printf (src, "  %sif (v_input < %u.5)\n",
+          i > 0 ? "else " : "", i);
+    else if (i > 0)
+      g_string_append (src, "  else\n");
+    g_string_append_printf (src,
+        "    rgba = texture2D (texture%u, v_texCoord);\n", i);
+  }
+
+  g_string_append (src, "  gl_FragColor = vec4(rgba.rgb, rgba.a * v_alpha);\n"
+      "}\n");
+
+  return g_string_free (src, FALSE);
+}
 
 static void
 gst_gl_video_mixer_class_init (GstGLVideoMixerClass * klass)
@@ -117,6 +158,10 @@ gst_gl_video_mixer_init (GstGLVideoMixer * video_mixer)
 {
   video_mixer->shader = NULL;
   video_mixer->input_frames = NULL;
+  video_mixer->batch_size = 0;
+  video_mixer->vertex_buffer = 0;
+  video_mixer->index_buffer = 0;
+  video_mixer->n_quads = 0;
 }
 
 static void
@@ -141,6 +186,26 @@ gst_gl_video_mixer_get_property (GObject * object, guint prop_id,
   }
 }
 
+static void
+_reset_gl (GstGLContext * context, GstGLVideoMixer * video_mixer)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+
+  if (video_mixer->vertex_buffer)
+    gl->DeleteBuffers (1, &video_mixer->vertex_buffer);
+  video_mixer->vertex_buffer = 0;
+
+  if (video_mixer->index_buffer)
+    gl->DeleteBuffers (1, &video_mixer->index_buffer);
+  video_mixer->index_buffer = 0;
+
+  video_mixer->n_quads = 0;
+
+  if (video_mixer->shader)
+    g_object_unref (video_mixer->shader);
+  video_mixer->shader = NULL;
+}
+
 static void
 gst_gl_video_mixer_reset (GstGLMixer * mixer)
 {
@@ -148,9 +213,39 @@ gst_gl_video_mixer_reset (GstGLMixer * mixer)
 
   video_mixer->input_frames = NULL;
 
+  if (mixer->context)
+    gst_gl_context_thread_add (mixer->context,
+        (GstGLContextThreadFunc) _reset_gl, video_mixer);
+}
+
+static void
+_init_shader_gl (GstGLContext * context, GstGLVideoMixer * video_mixer)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GError *error = NULL;
+  GLint max_units = 0;
+  gchar *frag_src;
+
   if (video_mixer->shader)
-    gst_gl_context_del_shader (mixer->context, video_mixer->shader);
-  video_mixer->shader = NULL;
+    return;
+
+  gl->GetIntegerv (GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+  video_mixer->batch_size = CLAMP (max_units, 1, MAX_BATCH_SIZE);
+
+  frag_src = _gen_fragment_source (video_mixer->batch_size);
+  video_mixer->shader = gst_gl_shader_new_cached (context, video_mixer_v_src,
+      frag_src, &error);
+  g_free (frag_src);
+
+  if (!video_mixer->shader) {
+    GST_ERROR_OBJECT (video_mixer, "failed to build the shader: %s",
+        error ? error->message : "unknown error");
+    g_clear_error (&error);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (video_mixer, "compositing up to %u inputs per draw",
+      video_mixer->batch_size);
 }
 
 static gboolean
@@ -158,8 +253,10 @@ gst_gl_video_mixer_init_shader (GstGLMixer * mixer, GstCaps * outcaps)
 {
   GstGLVideoMixer *video_mixer = GST_GL_VIDEO_MIXER (mixer);
 
-  return gst_gl_context_gen_shader (mixer->context, video_mixer_v_src,
-      video_mixer_f_src, &video_mixer->shader);
+  gst_gl_context_thread_add (mixer->context,
+      (GstGLContextThreadFunc) _init_shader_gl, video_mixer);
+
+  return video_mixer->shader != NULL;
 }
 
 static gboolean
@@ -168,6 +265,9 @@ gst_gl_video_mixer_process_textures (GstGLMixer * mix, GPtrArray * frames,
 {
   GstGLVideoMixer *video_mixer = GST_GL_VIDEO_MIXER (mix);
 
+  if (!video_mixer->shader)
+    return FALSE;
+
   video_mixer->input_frames = frames;
 
   gst_gl_context_use_fbo_v2 (mix->context,
@@ -178,7 +278,64 @@ gst_gl_video_mixer_process_textures (GstGLMixer * mix, GPtrArray * frames,
   return TRUE;
 }
 
-/* opengl scene, params: input texture (not the output mixer->texture) */
+/* the index buffer only depends on the number of quads so it is only
+ * rewritten when more inputs show up */
+static void
+_ensure_buffers (GstGLVideoMixer * video_mixer, guint n_quads)
+{
+  GstGLMixer *mixer = GST_GL_MIXER (video_mixer);
+  const GstGLFuncs *gl = mixer->context->gl_vtable;
+  GLushort *indices;
+  guint i;
+
+  if (!video_mixer->vertex_buffer)
+    gl->GenBuffers (1, &video_mixer->vertex_buffer);
+  if (!video_mixer->index_buffer)
+    gl->GenBuffers (1, &video_mixer->index_buffer);
+
+  gl->BindBuffer (GL_ARRAY_BUFFER, video_mixer->vertex_buffer);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, video_mixer->index_buffer);
+
+  if (n_quads <= video_mixer->n_quads)
+    return;
+
+  indices = g_new (GLushort, n_quads * 6);
+  for (i = 0; i < n_quads; i++) {
+    indices[i * 6 + 0] = i * 4 + 0;
+    indices[i * 6 + 1] = i * 4 + 1;
+    indices[i * 6 + 2] = i * 4 + 2;
+    indices[i * 6 + 3] = i * 4 + 0;
+    indices[i * 6 + 4] = i * 4 + 2;
+    indices[i * 6 + 5] = i * 4 + 3;
+  }
+
+  gl->BufferData (GL_ELEMENT_ARRAY_BUFFER, n_quads * 6 * sizeof (GLushort),
+      indices, GL_STATIC_DRAW);
+  gl->BufferData (GL_ARRAY_BUFFER, n_quads * 4 * VERTEX_STRIDE, NULL,
+      GL_STREAM_DRAW);
+  g_free (indices);
+
+  video_mixer->n_quads = n_quads;
+}
+
+static inline void
+_set_vertex (GLfloat * v, gfloat x, gfloat y, gfloat s, gfloat t, gfloat unit,
+    gfloat alpha)
+{
+  v[0] = x;
+  v[1] = y;
+  v[2] = s;
+  v[3] = t;
+  v[4] = unit;
+  v[5] = alpha;
+}
+
+/* opengl scene, params: input texture (not the output mixer->texture)
+ *
+ * The quads of all the inputs are written to a single vertex buffer and
+ * drawn by batches of batch_size inputs, each input of a batch being bound
+ * to its own texture unit, so that compositing costs one draw per batch
+ * instead of one per input. */
 static void
 gst_gl_video_mixer_callback (gpointer stuff)
 {
@@ -188,14 +345,13 @@ gst_gl_video_mixer_callback (gpointer stuff)
 
   GLint attr_position_loc = 0;
   GLint attr_texture_loc = 0;
+  GLint attr_input_loc = 0;
+  GLint attr_alpha_loc = 0;
   guint out_width, out_height;
-
-  const GLushort indices[] = {
-    0, 1, 2,
-    0, 2, 3
-  };
-
-  guint count = 0;
+  GLfloat *v_vertices;
+  GLuint *textures;
+  guint n_inputs = 0;
+  guint count, i;
 
   out_width = GST_VIDEO_INFO_WIDTH (&mixer->out_info);
   out_height = GST_VIDEO_INFO_HEIGHT (&mixer->out_info);
@@ -210,83 +366,136 @@ gst_gl_video_mixer_callback (gpointer stuff)
   gl->ClearColor (0.0, 0.0, 0.0, 0.0);
   gl->Clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  gst_gl_shader_use (video_mixer->shader);
+  v_vertices = g_newa (GLfloat,
+      video_mixer->input_frames->len * 4 * VERTEX_FLOATS);
+  textures = g_newa (GLuint, video_mixer->input_frames->len);
 
-  attr_position_loc =
-      gst_gl_shader_get_attribute_location (video_mixer->shader, "a_position");
-  attr_texture_loc =
-      gst_gl_shader_get_attribute_location (video_mixer->shader, "a_texCoord");
-
-  gl->Enable (GL_BLEND);
-
-  while (count < video_mixer->input_frames->len) {
+  for (count = 0; count < video_mixer->input_frames->len; count++) {
     GstGLMixerFrameData *frame;
-    GLfloat *v_vertices;
+    GLfloat *v;
+    GstGLMixerPad *pad;
     guint in_tex;
     guint in_width, in_height;
-    gfloat w, h;
+    gint width, height;
+    gfloat x0, y0, x1, y1, unit, alpha;
 
     frame = g_ptr_array_index (video_mixer->input_frames, count);
+    if (!frame) {
+      GST_DEBUG ("skipping empty frame %u", count);
+      continue;
+    }
+
+    pad = frame->pad;
     in_tex = frame->texture;
-    in_width = GST_VIDEO_INFO_WIDTH (&frame->pad->in_info);
-    in_height = GST_VIDEO_INFO_HEIGHT (&frame->pad->in_info);
+    in_width = GST_VIDEO_INFO_WIDTH (&pad->in_info);
+    in_height = GST_VIDEO_INFO_HEIGHT (&pad->in_info);
 
-    if (!frame || !in_tex || in_width <= 0 || in_height <= 0) {
+    if (!in_tex || in_width <= 0 || in_height <= 0) {
       GST_DEBUG ("skipping texture:%u frame:%p width:%u height %u",
           in_tex, frame, in_width, in_height);
-      count++;
       continue;
     }
 
-    GST_TRACE ("processing texture:%u dimensions:%ux%u", in_tex, in_width,
-        in_height);
-
-    w = ((gfloat) in_width / (gfloat) out_width);
-    h = ((gfloat) in_height / (gfloat) out_height);
-    GST_TRACE ("processing texture:%u dimensions:%ux%u, %fx%f", in_tex,
-        in_width, in_height, w, h);
-
-    /* *INDENT-OFF* */
-    v_vertices = (GLfloat[]) {
-      /* front face */
-      -1.0, -1.0, -1.0f,
-      0.0f, 0.0f,
-      1.0, -1.0, -1.0f,
-      1.0f, 0.0f,
-      1.0, 1.0, -1.0f,
-      1.0f, 1.0f,
-      -1.0, 1.0, -1.0f,
-      0.0f, 1.0f,
-    };
-    /* *INDENT-ON* */
-
-    gl->VertexAttribPointer (attr_position_loc, 3, GL_FLOAT,
-        GL_FALSE, 5 * sizeof (GLfloat), &v_vertices[0]);
-
-    gl->VertexAttribPointer (attr_texture_loc, 2, GL_FLOAT,
-        GL_FALSE, 5 * sizeof (GLfloat), &v_vertices[3]);
-
-    gl->EnableVertexAttribArray (attr_position_loc);
-    gl->EnableVertexAttribArray (attr_texture_loc);
-
-    gl->BlendFunc (GL_SRC_COLOR, GL_ONE_MINUS_SRC_COLOR);
-    gl->BlendEquation (GL_FUNC_ADD);
-
-    gl->ActiveTexture (GL_TEXTURE0);
-    gl->BindTexture (GL_TEXTURE_2D, in_tex);
-    gst_gl_shader_set_uniform_1i (video_mixer->shader, "texture", 0);
-    gst_gl_shader_set_uniform_1f (video_mixer->shader, "x_scale", w);
-    gst_gl_shader_set_uniform_1f (video_mixer->shader, "y_scale", h);
-
-    gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices);
-
-    ++count;
+    if (pad->alpha <= 0.0) {
+      GST_TRACE ("skipping transparent texture:%u", in_tex);
+      continue;
+    }
+
+    /* the input is scaled into its rectangle by the draw itself */
+    width = pad->width > 0 ? pad->width : in_width;
+    height = pad->height > 0 ? pad->height : in_height;
+
+    x0 = 2.0f * pad->xpos / (gfloat) out_width - 1.0f;
+    y0 = 2.0f * pad->ypos / (gfloat) out_height - 1.0f;
+    x1 = 2.0f * (pad->xpos + width) / (gfloat) out_width - 1.0f;
+    y1 = 2.0f * (pad->ypos + height) / (gfloat) out_height - 1.0f;
+    alpha = (gfloat) pad->alpha;
+
+    GST_TRACE ("processing texture:%u dimensions:%ux%u into %dx%d+%d+%d "
+        "alpha %f", in_tex, in_width, in_height, width, height, pad->xpos,
+        pad->ypos, alpha);
+
+    unit = (gfloat) (n_inputs % video_mixer->batch_size);
+    v = &v_vertices[n_inputs * 4 * VERTEX_FLOATS];
+
+    _set_vertex (&v[0 * VERTEX_FLOATS], x0, y0, 0.0f, 0.0f, unit, alpha);
+    _set_vertex (&v[1 * VERTEX_FLOATS], x1, y0, 1.0f, 0.0f, unit, alpha);
+    _set_vertex (&v[2 * VERTEX_FLOATS], x1, y1, 1.0f, 1.0f, unit, alpha);
+    _set_vertex (&v[3 * VERTEX_FLOATS], x0, y1, 0.0f, 1.0f, unit, alpha);
+
+    textures[n_inputs++] = in_tex;
+  }
+
+  if (n_inputs == 0)
+    return;
+
+  _ensure_buffers (video_mixer, n_inputs);
+  gl->BufferSubData (GL_ARRAY_BUFFER, 0, n_inputs * 4 * VERTEX_STRIDE,
+      v_vertices);
+
+  gst_gl_shader_use (video_mixer->shader);
+
+  attr_position_loc =
+      gst_gl_shader_get_attribute_location (video_mixer->shader, "a_position");
+  attr_texture_loc =
+      gst_gl_shader_get_attribute_location (video_mixer->shader, "a_texCoord");
+  attr_input_loc =
+      gst_gl_shader_get_attribute_location (video_mixer->shader, "a_input");
+  attr_alpha_loc =
+      gst_gl_shader_get_attribute_location (video_mixer->shader, "a_alpha");
+
+  gl->VertexAttribPointer (attr_position_loc, 2, GL_FLOAT,
+      GL_FALSE, VERTEX_STRIDE, (gpointer) 0);
+  gl->VertexAttribPointer (attr_texture_loc, 2, GL_FLOAT,
+      GL_FALSE, VERTEX_STRIDE, (gpointer) (2 * sizeof (GLfloat)));
+  gl->VertexAttribPointer (attr_input_loc, 1, GL_FLOAT,
+      GL_FALSE, VERTEX_STRIDE, (gpointer) (4 * sizeof (GLfloat)));
+  gl->VertexAttribPointer (attr_alpha_loc, 1, GL_FLOAT,
+      GL_FALSE, VERTEX_STRIDE, (gpointer) (5 * sizeof (GLfloat)));
+
+  gl->EnableVertexAttribArray (attr_position_loc);
+  gl->EnableVertexAttribArray (attr_texture_loc);
+  gl->EnableVertexAttribArray (attr_input_loc);
+  gl->EnableVertexAttribArray (attr_alpha_loc);
+
+  for (i = 0; i < video_mixer->batch_size; i++) {
+    gchar name[16];
+
+    g_snprintf (name, sizeof (name), "texture%u", i);
+    gst_gl_shader_set_uniform_1i (video_mixer->shader, name, i);
+  }
+
+  gl->Enable (GL_BLEND);
+  gl->BlendFuncSeparate (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+      GL_ONE_MINUS_SRC_ALPHA);
+  gl->BlendEquation (GL_FUNC_ADD);
+
+  /* quads are rasterized in order within a draw so the blending result is
+   * the same as drawing the inputs one after the other */
+  for (count = 0; count < n_inputs; count += video_mixer->batch_size) {
+    guint n = MIN (video_mixer->batch_size, n_inputs - count);
+
+    for (i = 0; i < n; i++) {
+      gl->ActiveTexture (GL_TEXTURE0 + i);
+      gl->BindTexture (GL_TEXTURE_2D, textures[count + i]);
+    }
+
+    gl->DrawElements (GL_TRIANGLES, n * 6, GL_UNSIGNED_SHORT,
+        (gpointer) (count * 6 * sizeof (GLushort)));
   }
 
   gl->DisableVertexAttribArray (attr_position_loc);
   gl->DisableVertexAttribArray (attr_texture_loc);
+  gl->DisableVertexAttribArray (attr_input_loc);
+  gl->DisableVertexAttribArray (attr_alpha_loc);
 
-  gl->BindTexture (GL_TEXTURE_2D, 0);
+  gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  for (i = MIN (video_mixer->batch_size, n_inputs); i > 0; i--) {
+    gl->ActiveTexture (GL_TEXTURE0 + i - 1);
+    gl->BindTexture (GL_TEXTURE_2D, 0);
+  }
 
   gl->Disable (GL_BLEND);
 
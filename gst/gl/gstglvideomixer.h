@@ -41,6 +41,15 @@ struct _GstGLVideoMixer
 
     GstGLShader *shader;
     GPtrArray *input_frames;
+
+    /* number of inputs composited by a single draw, bounded by the
+     * texture units available to the fragment shader */
+    guint batch_size;
+
+    /* the quads of every input, kept from one frame to the next */
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    guint n_quads;
 };
 
 struct _GstGLVideoMixerClass
@@ -65,6 +65,7 @@ GType gst_gl_effects_get_type (void);
 #include "gstglfilterapp.h"
 #include "gstglfilterreflectedscreen.h"
 #include "gstglfiltershader.h"
+#include "gstglfilterfuse.h"
 #include "gstgldeinterlace.h"
 #include "gstglmosaic.h"
 #include "gstglvideomixer.h"
@@ -144,6 +145,11 @@ plugin_init (GstPlugin * plugin)
     return FALSE;
   }
 
+  if (!gst_element_register (plugin, "glfilterfuse",
+          GST_RANK_NONE, GST_TYPE_GL_FILTER_FUSE)) {
+    return FALSE;
+  }
+
   if (!gst_element_register (plugin, "glfiltersobel",
           GST_RANK_NONE, gst_gl_filtersobel_get_type ())) {
     return FALSE;
@@ -25,6 +25,7 @@
 #include <gst/check/gstcheck.h>
 
 #include <gst/gl/gstglcontext.h>
+#include <gst/gl/gstglsyncmeta.h>
 
 #include <stdio.h>
 
@@ -281,6 +282,613 @@ GST_START_TEST (test_share)
 
 GST_END_TEST;
 
+static void
+_redundant_state_changes (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  guint64 *n_elided = data;
+
+  gl->Viewport (0, 0, 320, 240);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+  n_elided[0] = gst_gl_context_get_n_elided_state_changes (context);
+
+  gl->Viewport (0, 0, 320, 240);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+  n_elided[1] = gst_gl_context_get_n_elided_state_changes (context);
+
+  gst_gl_context_invalidate_state (context);
+  gl->Viewport (0, 0, 320, 240);
+  n_elided[2] = gst_gl_context_get_n_elided_state_changes (context);
+}
+
+GST_START_TEST (test_state_tracking)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GError *error = NULL;
+  guint64 n_elided[3];
+
+  context = gst_gl_context_new (display);
+
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating context %s\n",
+      error ? error->message : "Unknown Error");
+
+  gst_gl_context_thread_add (context, _redundant_state_changes, n_elided);
+
+  /* the repeated calls never reach the driver */
+  fail_unless_equals_int (n_elided[1] - n_elided[0], 2);
+  /* nothing is elided after the cache was dropped */
+  fail_unless_equals_int (n_elided[2] - n_elided[1], 0);
+
+  gst_object_unref (window);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
+
+#ifndef GL_TEXTURE_IMMUTABLE_FORMAT
+#define GL_TEXTURE_IMMUTABLE_FORMAT 0x912F
+#endif
+
+static void
+_check_texture_storage (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLint *immutable = data;
+  GLuint texture;
+
+  texture = gst_gl_context_acquire_texture (context, GST_VIDEO_FORMAT_RGBA,
+      320, 240);
+  fail_if (texture == 0);
+
+  gl->BindTexture (GL_TEXTURE_2D, texture);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT,
+      immutable);
+  fail_unless (gl->GetError () == GL_NO_ERROR);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+
+  gst_gl_context_release_texture (context, texture);
+}
+
+GST_START_TEST (test_texture_storage)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GError *error = NULL;
+  GLint immutable = GL_FALSE;
+
+  context = gst_gl_context_new (display);
+
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating context %s\n",
+      error ? error->message : "Unknown Error");
+
+  /* textures declare their whole storage up front where that is possible */
+  if (context->gl_vtable->TexStorage2D) {
+    gst_gl_context_thread_add (context, _check_texture_storage, &immutable);
+    fail_unless (immutable == GL_TRUE);
+  }
+
+  gst_object_unref (window);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
+
+/* gst_gl_context_release_texture() keeps at most this many textures */
+#define MAX_FREE_TEXTURES 16
+
+static void
+_check_texture_reuse (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLuint *texture = data;
+  GLuint reused;
+  GLint param;
+
+  *texture = gst_gl_context_acquire_texture (context, GST_VIDEO_FORMAT_RGBA,
+      64, 64);
+  fail_if (*texture == 0);
+
+  gl->BindTexture (GL_TEXTURE_2D, *texture);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  gl->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+  gst_gl_context_release_texture (context, *texture);
+
+  /* the released texture is handed out again with its parameters reset */
+  reused = gst_gl_context_acquire_texture (context, GST_VIDEO_FORMAT_RGBA,
+      64, 64);
+  fail_unless (reused == *texture);
+
+  gl->BindTexture (GL_TEXTURE_2D, reused);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &param);
+  fail_unless_equals_int (param, GL_LINEAR);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &param);
+  fail_unless_equals_int (param, GL_LINEAR);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &param);
+  fail_unless_equals_int (param, GL_CLAMP_TO_EDGE);
+  gl->GetTexParameteriv (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &param);
+  fail_unless_equals_int (param, GL_CLAMP_TO_EDGE);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+  fail_unless (gl->GetError () == GL_NO_ERROR);
+
+  gst_gl_context_release_texture (context, reused);
+}
+
+static void
+_check_texture_pool_cap (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLuint textures[MAX_FREE_TEXTURES + 2];
+  GLuint *reused = data;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (textures); i++) {
+    textures[i] = gst_gl_context_acquire_texture (context,
+        GST_VIDEO_FORMAT_RGBA, 32, 32);
+    fail_if (textures[i] == 0);
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (textures); i++)
+    gst_gl_context_release_texture (context, textures[i]);
+
+  /* the least recently released textures, including the one released by
+   * _check_texture_reuse(), were deleted to make room for the others */
+  fail_if (gl->IsTexture (*reused));
+  for (i = 0; i < 2; i++)
+    fail_if (gl->IsTexture (textures[i]));
+  for (; i < G_N_ELEMENTS (textures); i++)
+    fail_unless (gl->IsTexture (textures[i]));
+}
+
+static void
+_pool_texture (GstGLContext * context, gpointer data)
+{
+  GLuint *texture = data;
+
+  *texture = gst_gl_context_acquire_texture (context, GST_VIDEO_FORMAT_RGBA,
+      16, 16);
+  fail_if (*texture == 0);
+  gst_gl_context_release_texture (context, *texture);
+}
+
+static void
+_check_texture_deleted (GstGLContext * context, gpointer data)
+{
+  GLuint *texture = data;
+
+  fail_if (context->gl_vtable->IsTexture (*texture));
+}
+
+GST_START_TEST (test_texture_pool)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GstGLContext *other_context;
+  GstGLWindow *other_window;
+  GError *error = NULL;
+  GLuint texture;
+
+  context = gst_gl_context_new (display);
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating master context %s\n",
+      error ? error->message : "Unknown Error");
+
+  gst_gl_context_thread_add (context, _check_texture_reuse, &texture);
+  gst_gl_context_thread_add (context, _check_texture_pool_cap, &texture);
+
+  other_context = gst_gl_context_new (display);
+  other_window = gst_gl_window_new (display);
+  gst_gl_context_set_window (other_context, other_window);
+  gst_gl_context_create (other_context, context, &error);
+
+  fail_if (error != NULL, "Error creating secondary context %s\n",
+      error ? error->message : "Unknown Error");
+
+  /* the free list of a context doesn't outlive it in the share group */
+  gst_gl_context_thread_add (other_context, _pool_texture, &texture);
+  gst_object_unref (other_window);
+  gst_object_unref (other_context);
+  gst_gl_context_thread_add (context, _check_texture_deleted, &texture);
+
+  gst_object_unref (window);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
+
+/* *INDENT-OFF* */
+static const gchar *quad_vertex_src =
+    "attribute vec4 a_position;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_Position = a_position;\n"
+    "}\n";
+
+static const gchar *quad_fragment_src =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = vec4 (1.0, 0.0, 0.0, 1.0);\n"
+    "}\n";
+/* *INDENT-ON* */
+
+struct fullscreen_quad
+{
+  GLuint vertex_buffer;
+  GLuint index_buffer;
+};
+
+static void
+_get_quad_buffers (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  struct fullscreen_quad *quad = user_data;
+  guint vao, vbo, ibo;
+
+  if (sscanf (gst_debug_message_get (message),
+          "created fullscreen quad vao:%u vbo:%u ibo:%u", &vao, &vbo,
+          &ibo) == 3) {
+    quad->vertex_buffer = vbo;
+    quad->index_buffer = ibo;
+  }
+}
+
+/* draws the quad in red over a black texture and checks it covers all of it */
+static void
+_draw_quad (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  guint8 pixels[16 * 16 * 4];
+  GstGLShader *shader;
+  GLuint texture, fbo;
+  guint i;
+
+  shader = gst_gl_shader_new (context);
+  gst_gl_shader_set_vertex_source (shader, quad_vertex_src);
+  gst_gl_shader_set_fragment_source (shader, quad_fragment_src);
+  fail_unless (gst_gl_shader_compile (shader, NULL));
+
+  texture = gst_gl_context_acquire_texture (context, GST_VIDEO_FORMAT_RGBA,
+      16, 16);
+  gl->GenFramebuffers (1, &fbo);
+  gl->BindFramebuffer (GL_FRAMEBUFFER, fbo);
+  gl->FramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+      GL_TEXTURE_2D, texture, 0);
+  fail_unless (gst_gl_context_check_framebuffer_status (context));
+
+  gl->Viewport (0, 0, 16, 16);
+  gl->ClearColor (0.0, 0.0, 0.0, 1.0);
+  gl->Clear (GL_COLOR_BUFFER_BIT);
+
+  gst_gl_shader_use (shader);
+  gst_gl_context_draw_fullscreen_quad (context,
+      gst_gl_shader_get_attribute_location (shader, "a_position"), -1, FALSE);
+  gst_gl_context_clear_shader (context);
+
+  gl->ReadPixels (0, 0, 16, 16, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  for (i = 0; i < 16 * 16; i++) {
+    fail_unless (pixels[i * 4] == 0xff && pixels[i * 4 + 1] == 0x00
+        && pixels[i * 4 + 2] == 0x00, "pixel %u isn't covered by the quad", i);
+  }
+
+  gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
+  gl->DeleteFramebuffers (1, &fbo);
+  gst_gl_context_release_texture (context, texture);
+  gst_object_unref (shader);
+  fail_unless (gl->GetError () == GL_NO_ERROR);
+}
+
+static void
+_check_quad_deleted (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  struct fullscreen_quad *quad = data;
+
+  fail_if (gl->IsBuffer (quad->vertex_buffer));
+  fail_if (gl->IsBuffer (quad->index_buffer));
+}
+
+GST_START_TEST (test_fullscreen_quad)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GstGLContext *other_context;
+  GstGLWindow *other_window;
+  struct fullscreen_quad quad = { 0, 0 };
+  GError *error = NULL;
+
+  context = gst_gl_context_new (display);
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating master context %s\n",
+      error ? error->message : "Unknown Error");
+
+  other_context = gst_gl_context_new (display);
+  other_window = gst_gl_window_new (display);
+  gst_gl_context_set_window (other_context, other_window);
+  gst_gl_context_create (other_context, context, &error);
+
+  fail_if (error != NULL, "Error creating secondary context %s\n",
+      error ? error->message : "Unknown Error");
+
+  /* the ids of the buffers are only known from the debug log */
+  gst_debug_set_active (TRUE);
+  gst_debug_set_threshold_for_name ("default", GST_LEVEL_DEBUG);
+  gst_debug_add_log_function (_get_quad_buffers, &quad, NULL);
+
+  gst_gl_context_thread_add (other_context, _draw_quad, NULL);
+  /* drawn again from the same buffers */
+  gst_gl_context_thread_add (other_context, _draw_quad, NULL);
+
+  gst_debug_remove_log_function (_get_quad_buffers);
+  fail_if (quad.vertex_buffer == 0 || quad.index_buffer == 0);
+
+  /* the buffers don't outlive their context in the share group */
+  gst_object_unref (other_window);
+  gst_object_unref (other_context);
+  gst_gl_context_thread_add (context, _check_quad_deleted, &quad);
+
+  gst_object_unref (window);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
+
+static void
+_check_is_sync (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLSyncMeta *sync_meta = data;
+
+  fail_unless (gl->IsSync (sync_meta->glsync));
+  fail_unless (gl->GetError () == GL_NO_ERROR);
+}
+
+GST_START_TEST (test_sync_meta)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GstGLContext *other_context;
+  GstGLWindow *other_window;
+  GstGLSyncMeta *sync_meta, *copy_meta;
+  GstBuffer *buffer, *copy;
+  GError *error = NULL;
+
+  context = gst_gl_context_new (display);
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating master context %s\n",
+      error ? error->message : "Unknown Error");
+
+  other_context = gst_gl_context_new (display);
+  other_window = gst_gl_window_new (display);
+  gst_gl_context_set_window (other_context, other_window);
+  gst_gl_context_create (other_context, context, &error);
+
+  fail_if (error != NULL, "Error creating secondary context %s\n",
+      error ? error->message : "Unknown Error");
+
+  buffer = gst_buffer_new ();
+  sync_meta = gst_buffer_add_gl_sync_meta (context, buffer);
+  fail_unless (sync_meta != NULL);
+  fail_unless (gst_buffer_get_gl_sync_meta (buffer) == sync_meta);
+  fail_unless (sync_meta->glsync == NULL);
+  fail_unless (sync_meta->sync_id == 0);
+
+  /* waiting before the producer set a sync point is a no-op */
+  gst_gl_sync_meta_wait (sync_meta, other_context);
+
+  gst_gl_sync_meta_set_sync_point (sync_meta, context);
+  fail_unless (sync_meta->context == context);
+  fail_unless (sync_meta->sync_id != 0);
+
+  /* the sync point is set asynchronously */
+  gst_gl_context_thread_wait (context, sync_meta->sync_id);
+
+  if (context->gl_vtable->FenceSync) {
+    fail_unless (sync_meta->glsync != NULL);
+
+    /* the sync object is shared with the consumer's context */
+    gst_gl_context_thread_add (other_context, _check_is_sync, sync_meta);
+    gst_gl_sync_meta_wait (sync_meta, other_context);
+
+    /* copies don't depend on the lifetime of the original sync object */
+    copy = gst_buffer_copy (buffer);
+    copy_meta = gst_buffer_get_gl_sync_meta (copy);
+    fail_unless (copy_meta != NULL);
+    gst_gl_context_thread_wait (context, copy_meta->sync_id);
+    fail_unless (copy_meta->glsync != NULL);
+    fail_unless (copy_meta->glsync != sync_meta->glsync);
+
+    gst_buffer_unref (buffer);
+    gst_gl_context_thread_add (other_context, _check_is_sync, copy_meta);
+    gst_buffer_unref (copy);
+  } else {
+    gst_buffer_unref (buffer);
+  }
+
+  gst_object_unref (window);
+  gst_object_unref (other_window);
+  gst_object_unref (other_context);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
+
+#define N_COMMANDS 16
+
+struct ordering
+{
+  GThread *gl_thread;
+  guint64 ids[N_COMMANDS + 1];
+  guint n_run;
+};
+
+struct command
+{
+  struct ordering *ordering;
+  guint64 id;
+};
+
+static void
+_record_command (GstGLContext * context, struct command *cmd)
+{
+  struct ordering *ordering = cmd->ordering;
+
+  ordering->gl_thread = g_thread_self ();
+  ordering->ids[ordering->n_run++] = cmd->id;
+}
+
+static void
+_record_sync (GstGLContext * context, struct ordering *ordering)
+{
+  /* marks where the synchronous call ran among the queued commands */
+  ordering->ids[ordering->n_run++] = G_MAXUINT64;
+}
+
+GST_START_TEST (test_async_ordering)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GError *error = NULL;
+  struct ordering ordering = { NULL, };
+  struct command commands[N_COMMANDS];
+  guint64 last = 0;
+  guint i;
+
+  context = gst_gl_context_new (display);
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating context %s\n",
+      error ? error->message : "Unknown Error");
+
+  for (i = 0; i < N_COMMANDS; i++) {
+    commands[i].ordering = &ordering;
+    commands[i].id = gst_gl_context_thread_add_async (context,
+        (GstGLContextThreadFunc) _record_command, &commands[i], NULL);
+    fail_unless (commands[i].id > last);
+    last = commands[i].id;
+
+    /* a synchronous call runs after everything queued before it */
+    if (i == N_COMMANDS / 2 - 1) {
+      gst_gl_context_thread_add (context,
+          (GstGLContextThreadFunc) _record_sync, &ordering);
+      fail_unless_equals_int (ordering.n_run, N_COMMANDS / 2 + 1);
+    }
+  }
+
+  gst_gl_context_thread_wait (context, last);
+
+  fail_unless_equals_int (ordering.n_run, N_COMMANDS + 1);
+  fail_if (ordering.gl_thread == g_thread_self ());
+  for (i = 0; i < N_COMMANDS / 2; i++)
+    fail_unless (ordering.ids[i] == commands[i].id);
+  fail_unless (ordering.ids[N_COMMANDS / 2] == G_MAXUINT64);
+  for (i = N_COMMANDS / 2; i < N_COMMANDS; i++)
+    fail_unless (ordering.ids[i + 1] == commands[i].id);
+
+  gst_object_unref (window);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
+
+struct barrier
+{
+  gint done;
+  gint nested_done;
+  gboolean nested_seen;
+};
+
+static void
+_slow_command (GstGLContext * context, struct barrier *barrier)
+{
+  g_usleep (100 * 1000);
+  g_atomic_int_set (&barrier->done, 1);
+}
+
+static void
+_nested_command (GstGLContext * context, struct barrier *barrier)
+{
+  g_atomic_int_set (&barrier->nested_done, 1);
+}
+
+static void
+_waiting_command (GstGLContext * context, struct barrier *barrier)
+{
+  guint64 id;
+
+  /* waiting from a queued command runs the commands queued after it */
+  id = gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _nested_command, barrier, NULL);
+  gst_gl_context_thread_wait (context, id);
+  barrier->nested_seen = g_atomic_int_get (&barrier->nested_done);
+}
+
+GST_START_TEST (test_thread_wait)
+{
+  GstGLContext *context;
+  GstGLWindow *window;
+  GError *error = NULL;
+  struct barrier barrier = { 0, };
+  guint64 id;
+
+  context = gst_gl_context_new (display);
+  window = gst_gl_window_new (display);
+  gst_gl_context_set_window (context, window);
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating context %s\n",
+      error ? error->message : "Unknown Error");
+
+  /* returns only once the command has completed */
+  id = gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _slow_command, &barrier, NULL);
+  gst_gl_context_thread_wait (context, id);
+  fail_unless (g_atomic_int_get (&barrier.done));
+
+  /* re-entrant waits don't return early */
+  id = gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _waiting_command, &barrier, NULL);
+  gst_gl_context_thread_wait (context, id);
+  fail_unless (barrier.nested_seen);
+
+  /* nor block forever once the gl thread is gone */
+  gst_gl_window_quit (window);
+  id = gst_gl_context_thread_add_async (context,
+      (GstGLContextThreadFunc) _nested_command, &barrier, NULL);
+  gst_gl_context_thread_wait (context, id);
+
+  gst_object_unref (window);
+  gst_object_unref (context);
+}
+
+GST_END_TEST;
 
 Suite *
 gst_gl_memory_suite (void)
@@ -291,6 +899,13 @@ gst_gl_memory_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_checked_fixture (tc_chain, setup, teardown);
   tcase_add_test (tc_chain, test_share);
+  tcase_add_test (tc_chain, test_state_tracking);
+  tcase_add_test (tc_chain, test_texture_storage);
+  tcase_add_test (tc_chain, test_texture_pool);
+  tcase_add_test (tc_chain, test_fullscreen_quad);
+  tcase_add_test (tc_chain, test_sync_meta);
+  tcase_add_test (tc_chain, test_async_ordering);
+  tcase_add_test (tc_chain, test_thread_wait);
 
   return s;
 }
@@ -0,0 +1,429 @@
+/* GStreamer
+ *
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include <gst/gl/gstglcontext.h>
+#include <gst/gl/gstgldownload.h>
+
+#include <string.h>
+
+#define FORMAT GST_VIDEO_FORMAT_RGBA
+#define WIDTH 16
+#define HEIGHT 8
+#define N_FRAMES (GST_GL_DOWNLOAD_MAX_PENDING + 2)
+
+static GstGLDisplay *display;
+static GstGLContext *context;
+static GstGLDownload *download;
+static GLuint textures[N_FRAMES];
+
+/* every frame is filled with a different value */
+#define FRAME_VALUE(n) ((guint8) (0x20 + (n) * 0x18))
+
+static void
+_fill_textures (GstGLContext * context, gpointer data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  guint8 pixels[WIDTH * HEIGHT * 4];
+  guint i;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    memset (pixels, FRAME_VALUE (i), sizeof (pixels));
+
+    gl->BindTexture (GL_TEXTURE_2D, textures[i]);
+    gl->TexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA,
+        GL_UNSIGNED_BYTE, pixels);
+  }
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+}
+
+void
+setup (void)
+{
+  GError *error = NULL;
+  guint i;
+
+  display = gst_gl_display_new ();
+  context = gst_gl_context_new (display);
+
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating context: %s\n",
+      error ? error->message : "Unknown Error");
+
+  for (i = 0; i < N_FRAMES; i++)
+    gst_gl_context_gen_texture (context, &textures[i], FORMAT, WIDTH, HEIGHT);
+  gst_gl_context_thread_add (context, _fill_textures, NULL);
+
+  download = gst_gl_download_new (context);
+  fail_unless (gst_gl_download_init_format (download, FORMAT, WIDTH, HEIGHT));
+}
+
+void
+teardown (void)
+{
+  GLuint error = context->gl_vtable->GetError ();
+  guint i;
+
+  fail_if (error != GL_NONE, "GL error 0x%x encountered during processing\n",
+      error);
+
+  for (i = 0; i < N_FRAMES; i++)
+    gst_gl_context_del_texture (context, &textures[i]);
+
+  gst_object_unref (download);
+  gst_object_unref (context);
+  gst_object_unref (display);
+}
+
+static void
+_check_frame (guint8 * pixels, guint n)
+{
+  guint i;
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++) {
+    fail_unless (pixels[i] == FRAME_VALUE (n), "byte %u of frame %u is 0x%02x "
+        "instead of 0x%02x", i, n, pixels[i], FRAME_VALUE (n));
+  }
+}
+
+GST_START_TEST (test_download_data)
+{
+  guint8 pixels[WIDTH * HEIGHT * 4];
+  gpointer data[GST_VIDEO_MAX_PLANES] = { pixels, NULL, NULL, NULL };
+  guint i;
+
+  /* every call returns the texture it was given */
+  for (i = 0; i < N_FRAMES; i++) {
+    memset (pixels, 0, sizeof (pixels));
+    fail_unless (gst_gl_download_perform_with_data (download, textures[i],
+            data));
+    _check_frame (pixels, i);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_download_submit)
+{
+  guint8 pixels[WIDTH * HEIGHT * 4];
+  gpointer data[GST_VIDEO_MAX_PLANES] = { pixels, NULL, NULL, NULL };
+  guint64 frame;
+  guint max_pending, i;
+
+  g_object_get (download, "max-pending", &max_pending, NULL);
+  fail_unless_equals_int (max_pending, 2);
+  g_object_set (download, "max-pending", GST_GL_DOWNLOAD_MAX_PENDING, NULL);
+
+  fail_if (gst_gl_download_retrieve (download, data, &frame));
+
+  /* fill the ring */
+  for (i = 0; i < GST_GL_DOWNLOAD_MAX_PENDING; i++) {
+    fail_unless (gst_gl_download_submit (download, textures[i], &frame));
+    fail_unless_equals_int (frame, i);
+  }
+  fail_unless_equals_int (gst_gl_download_get_n_pending (download),
+      GST_GL_DOWNLOAD_MAX_PENDING);
+  fail_if (gst_gl_download_submit (download, textures[i], &frame));
+
+  /* the readbacks come back in order, frame N holding texture N, while the
+   * remaining ones are submitted around the end of the ring */
+  for (i = 0; i < N_FRAMES; i++) {
+    memset (pixels, 0, sizeof (pixels));
+    fail_unless (gst_gl_download_retrieve (download, data, &frame));
+    fail_unless_equals_int (frame, i);
+    _check_frame (pixels, i);
+
+    if (i + GST_GL_DOWNLOAD_MAX_PENDING < N_FRAMES) {
+      guint next = i + GST_GL_DOWNLOAD_MAX_PENDING;
+
+      fail_unless (gst_gl_download_submit (download, textures[next], &frame));
+      fail_unless_equals_int (frame, next);
+    }
+  }
+
+  fail_unless_equals_int (gst_gl_download_get_n_pending (download), 0);
+  fail_if (gst_gl_download_retrieve (download, data, &frame));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_download_flush)
+{
+  guint8 pixels[WIDTH * HEIGHT * 4];
+  gpointer data[GST_VIDEO_MAX_PLANES] = { pixels, NULL, NULL, NULL };
+  guint64 frame;
+
+  /* the default ring holds two readbacks */
+  fail_unless (gst_gl_download_submit (download, textures[0], &frame));
+  fail_unless (gst_gl_download_submit (download, textures[1], &frame));
+  fail_if (gst_gl_download_submit (download, textures[2], &frame));
+
+  gst_gl_download_flush (download);
+  fail_unless_equals_int (gst_gl_download_get_n_pending (download), 0);
+  fail_if (gst_gl_download_retrieve (download, data, &frame));
+
+  /* the ring is recreated with the new depth once it's empty, and the
+   * numbering carries on after the discarded readbacks */
+  g_object_set (download, "max-pending", 1, NULL);
+  fail_unless (gst_gl_download_submit (download, textures[3], &frame));
+  fail_unless_equals_int (frame, 2);
+  fail_if (gst_gl_download_submit (download, textures[4], &frame));
+
+  memset (pixels, 0, sizeof (pixels));
+  fail_unless (gst_gl_download_retrieve (download, data, &frame));
+  fail_unless_equals_int (frame, 2);
+  _check_frame (pixels, 3);
+}
+
+GST_END_TEST;
+
+/* 5K I420, larger than the offsets the packed shader addresses in one draw */
+#define LARGE_WIDTH 5120
+#define LARGE_HEIGHT 2880
+
+struct fill_red
+{
+  GLuint texture;
+  guint width;
+  guint height;
+};
+
+static void
+_fill_red (GstGLContext * context, struct fill_red *fill)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  guint8 *pixels = g_malloc (fill->width * fill->height * 4);
+  guint i;
+
+  for (i = 0; i < fill->width * fill->height; i++) {
+    pixels[4 * i + 0] = 0xff;
+    pixels[4 * i + 1] = 0x00;
+    pixels[4 * i + 2] = 0x00;
+    pixels[4 * i + 3] = 0xff;
+  }
+
+  gl->BindTexture (GL_TEXTURE_2D, fill->texture);
+  gl->TexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, fill->width, fill->height,
+      GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+
+  g_free (pixels);
+}
+
+static void
+_download_red_i420 (guint width, guint height, GstVideoInfo * info,
+    guint8 * pixels)
+{
+  GstGLDownload *i420_download = gst_gl_download_new (context);
+  gpointer data[GST_VIDEO_MAX_PLANES] = { NULL, };
+  struct fill_red fill = { 0, width, height };
+  guint i;
+
+  gst_gl_context_gen_texture (context, &fill.texture, FORMAT, width, height);
+  gst_gl_context_thread_add (context,
+      (GstGLContextThreadFunc) _fill_red, &fill);
+
+  gst_video_info_set_format (info, GST_VIDEO_FORMAT_I420, width, height);
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (info); i++)
+    data[i] = pixels + GST_VIDEO_INFO_PLANE_OFFSET (info, i);
+
+  fail_unless (gst_gl_download_init_format (i420_download,
+          GST_VIDEO_FORMAT_I420, width, height));
+  fail_unless (gst_gl_download_perform_with_data (i420_download, fill.texture,
+          data));
+
+  gst_gl_context_del_texture (context, &fill.texture);
+  gst_object_unref (i420_download);
+}
+
+GST_START_TEST (test_download_i420_large)
+{
+  GstVideoInfo small_info, large_info;
+  guint8 small[WIDTH * HEIGHT * 3 / 2];
+  guint8 *large;
+  guint i;
+
+  /* a small frame of the same colour gives the expected values */
+  _download_red_i420 (WIDTH, HEIGHT, &small_info, small);
+
+  large = g_malloc0 (LARGE_WIDTH * LARGE_HEIGHT * 3 / 2);
+  _download_red_i420 (LARGE_WIDTH, LARGE_HEIGHT, &large_info, large);
+
+  fail_unless (GST_VIDEO_INFO_SIZE (&large_info) >= (1 << 24));
+
+  /* every byte of each plane matches, across all the draws */
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&large_info); i++) {
+    guint8 expected = small[GST_VIDEO_INFO_PLANE_OFFSET (&small_info, i)];
+    gsize start = GST_VIDEO_INFO_PLANE_OFFSET (&large_info, i);
+    gsize end = i + 1 < GST_VIDEO_INFO_N_PLANES (&large_info) ?
+        GST_VIDEO_INFO_PLANE_OFFSET (&large_info, i + 1) :
+        GST_VIDEO_INFO_SIZE (&large_info);
+    gsize j;
+
+    for (j = start; j < end; j++) {
+      fail_unless (large[j] == expected, "byte %" G_GSIZE_FORMAT " of plane "
+          "%u is 0x%02x instead of 0x%02x", j, i, large[j], expected);
+    }
+  }
+
+  g_free (large);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_download_dmabuf)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+  gboolean supported;
+  GLuint texture;
+
+  supported = gst_gl_download_check_dmabuf_export (context);
+  fail_unless (gst_gl_download_check_dmabuf_export (context) == supported);
+
+  /* the probe agrees with the export itself */
+  gst_gl_context_gen_texture (context, &texture, FORMAT, WIDTH, HEIGHT);
+  fail_unless (gst_gl_download_perform_with_dmabuf (download, texture,
+          buffer) == supported);
+  if (supported) {
+    fail_unless_equals_int (gst_buffer_n_memory (buffer), 1);
+    fail_unless (gst_buffer_get_video_meta (buffer) != NULL);
+  } else {
+    fail_unless_equals_int (gst_buffer_n_memory (buffer), 0);
+  }
+
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+static gboolean
+_has_dmabuf_caps (GstCaps * caps)
+{
+  guint i;
+
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    if (gst_caps_features_contains (gst_caps_get_features (caps, i),
+            GST_CAPS_FEATURE_MEMORY_DMABUF))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static void
+_check_no_dmabuf_before_probe (const gchar * factory)
+{
+  GstElement *element = gst_element_factory_make (factory, NULL);
+  GstPad *pad;
+  GstCaps *caps;
+
+  fail_unless (element != NULL, "no %s element", factory);
+
+  pad = gst_element_get_static_pad (element, "src");
+  caps = gst_pad_query_caps (pad, NULL);
+  fail_if (_has_dmabuf_caps (caps), "%s offers dmabuf without a context",
+      factory);
+
+  gst_caps_unref (caps);
+  gst_object_unref (pad);
+  gst_object_unref (element);
+}
+
+GST_START_TEST (test_dmabuf_caps)
+{
+  GstElement *pipeline, *src, *filter, *capsfilter, *sink;
+  GstMessage *msg;
+  gboolean supported;
+  GstCaps *caps;
+  GstBus *bus;
+  GstPad *pad;
+
+  supported = gst_gl_download_check_dmabuf_export (context);
+
+  /* the elements don't know about the context yet */
+  _check_no_dmabuf_before_probe ("glfiltercube");
+  _check_no_dmabuf_before_probe ("glvideomixer");
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("videotestsrc", NULL);
+  filter = gst_element_factory_make ("glfiltercube", NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+
+  g_object_set (src, "num-buffers", 10, NULL);
+  caps = gst_caps_from_string ("video/x-raw(" GST_CAPS_FEATURE_MEMORY_DMABUF
+      "), format=RGBA; video/x-raw, format=RGBA");
+  g_object_set (capsfilter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, filter, capsfilter, sink, NULL);
+  fail_unless (gst_element_link_many (src, filter, capsfilter, sink, NULL));
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  /* renegotiated to dmabuf once the context was probed, only if it can
+   * actually be exported */
+  pad = gst_element_get_static_pad (filter, "src");
+  caps = gst_pad_get_current_caps (pad);
+  fail_unless (caps != NULL);
+  fail_unless (_has_dmabuf_caps (caps) == supported);
+  gst_caps_unref (caps);
+  gst_object_unref (pad);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+Suite *
+gst_gl_download_suite (void)
+{
+  Suite *s = suite_create ("GstGLDownload");
+  TCase *tc_chain = tcase_create ("download");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup, teardown);
+  tcase_add_test (tc_chain, test_download_data);
+  tcase_add_test (tc_chain, test_download_submit);
+  tcase_add_test (tc_chain, test_download_flush);
+  tcase_add_test (tc_chain, test_download_i420_large);
+  tcase_add_test (tc_chain, test_download_dmabuf);
+  tcase_add_test (tc_chain, test_dmabuf_caps);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_gl_download);
@@ -29,6 +29,7 @@
 #include <gst/gl/gstglmemory.h>
 
 #include <stdio.h>
+#include <string.h>
 
 static GstGLDisplay *display;
 static GstGLContext *context;
@@ -55,6 +56,7 @@ GST_START_TEST (test_basic)
   GstGLMemory *gl_mem, *gl_mem2;
   GstAllocator *gl_allocator;
   GstVideoInfo vinfo;
+  GstMapInfo map_info;
   gint i;
   static GstVideoFormat formats[15] = {
     GST_VIDEO_FORMAT_RGBx, GST_VIDEO_FORMAT_BGRx, GST_VIDEO_FORMAT_xRGB,
@@ -82,6 +84,10 @@ GST_START_TEST (test_basic)
     fail_if (GST_VIDEO_INFO_HEIGHT (&gl_mem->v_info) != height);
     fail_if (GST_VIDEO_INFO_FORMAT (&gl_mem->v_info) != formats[i]);
     fail_if (gl_mem->context != context);
+
+    /* the texture is created on first use from GL */
+    fail_unless (gst_memory_map (mem, &map_info, GST_MAP_READ | GST_MAP_GL));
+    gst_memory_unmap (mem, &map_info);
     fail_if (gl_mem->tex_id == 0);
 
     /* copy the memory */
@@ -114,6 +120,103 @@ GST_START_TEST (test_basic)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shared_converters)
+{
+  GstMemory *mem, *mem2, *mem3;
+  GstGLMemory *gl_mem, *gl_mem2, *gl_mem3;
+  GstVideoInfo vinfo, vinfo2;
+  GstMapInfo map_info;
+
+  gst_video_info_set_format (&vinfo, GST_VIDEO_FORMAT_I420, 320, 240);
+  gst_video_info_set_format (&vinfo2, GST_VIDEO_FORMAT_I420, 160, 120);
+
+  mem = gst_gl_memory_alloc (context, vinfo);
+  mem2 = gst_gl_memory_alloc (context, vinfo);
+  mem3 = gst_gl_memory_alloc (context, vinfo2);
+  gl_mem = (GstGLMemory *) mem;
+  gl_mem2 = (GstGLMemory *) mem2;
+  gl_mem3 = (GstGLMemory *) mem3;
+
+  /* nothing is created until a conversion is needed */
+  fail_unless (gl_mem->upload == NULL);
+  fail_unless (gl_mem->download == NULL);
+
+  fail_unless (gst_memory_map (mem, &map_info, GST_MAP_WRITE));
+  gst_memory_unmap (mem, &map_info);
+  fail_unless (gst_memory_map (mem2, &map_info, GST_MAP_WRITE));
+  gst_memory_unmap (mem2, &map_info);
+  fail_unless (gst_memory_map (mem3, &map_info, GST_MAP_WRITE));
+  gst_memory_unmap (mem3, &map_info);
+
+  fail_unless (gst_memory_map (mem, &map_info, GST_MAP_READ | GST_MAP_GL));
+  gst_memory_unmap (mem, &map_info);
+  fail_unless (gst_memory_map (mem2, &map_info, GST_MAP_READ | GST_MAP_GL));
+  gst_memory_unmap (mem2, &map_info);
+  fail_unless (gst_memory_map (mem3, &map_info, GST_MAP_READ | GST_MAP_GL));
+  gst_memory_unmap (mem3, &map_info);
+
+  /* same format and size share the upload, a different size doesn't */
+  fail_unless (gl_mem->upload != NULL);
+  fail_unless (gl_mem->upload == gl_mem2->upload);
+  fail_unless (gl_mem->upload != gl_mem3->upload);
+  fail_unless (gl_mem->download == NULL);
+
+  gst_memory_unref (mem);
+  gst_memory_unref (mem2);
+  gst_memory_unref (mem3);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_deferred_conversion)
+{
+  GstMemory *mem;
+  GstGLMemory *gl_mem;
+  GstVideoInfo vinfo;
+  GstMapInfo map_info;
+  GLuint *planes;
+
+  gst_video_info_set_format (&vinfo, GST_VIDEO_FORMAT_I420, 320, 240);
+
+  mem = gst_gl_memory_alloc (context, vinfo);
+  gl_mem = (GstGLMemory *) mem;
+
+  fail_unless (gst_memory_map (mem, &map_info, GST_MAP_WRITE));
+  memset (map_info.data, 0x80, map_info.size);
+  gst_memory_unmap (mem, &map_info);
+
+  /* mapping the planes doesn't need the RGBA texture */
+  fail_unless (gst_memory_map (mem, &map_info,
+          GST_MAP_READ | GST_MAP_GL | GST_MAP_GL_PLANES));
+  planes = (GLuint *) map_info.data;
+  fail_if (planes[0] == 0 || planes[1] == 0 || planes[2] == 0);
+  gst_memory_unmap (mem, &map_info);
+
+  fail_unless (gl_mem->tex_id == 0);
+  fail_unless (GST_GL_MEMORY_FLAG_IS_SET (gl_mem,
+          GST_GL_MEMORY_FLAG_NEED_CONVERT));
+  fail_if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_UPLOAD));
+
+  /* planes can't be written to */
+  fail_if (gst_memory_map (mem, &map_info,
+          GST_MAP_WRITE | GST_MAP_GL | GST_MAP_GL_PLANES));
+
+  /* the texture is converted from the planes on its first map */
+  fail_unless (gst_memory_map (mem, &map_info, GST_MAP_READ | GST_MAP_GL));
+  gst_memory_unmap (mem, &map_info);
+
+  fail_if (gl_mem->tex_id == 0);
+  fail_if (GST_GL_MEMORY_FLAG_IS_SET (gl_mem, GST_GL_MEMORY_FLAG_NEED_CONVERT));
+
+  if (gst_gl_context_get_error ())
+    printf ("%s\n", gst_gl_context_get_error ());
+  fail_if (gst_gl_context_get_error () != NULL);
+
+  gst_memory_unref (mem);
+}
+
+GST_END_TEST;
+
 
 Suite *
 gst_gl_memory_suite (void)
@@ -124,6 +227,8 @@ gst_gl_memory_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_checked_fixture (tc_chain, setup, teardown);
   tcase_add_test (tc_chain, test_basic);
+  tcase_add_test (tc_chain, test_shared_converters);
+  tcase_add_test (tc_chain, test_deferred_conversion);
 
   return s;
 }
@@ -0,0 +1,375 @@
+/* GStreamer
+ *
+ * Copyright (C) 2014 Matthew Waters <ystreet00@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include <gst/gl/gstglcontext.h>
+#include <gst/gl/gstglshader.h>
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+/* *INDENT-OFF* */
+static const gchar *vertex_src =
+    "attribute vec4 a_position;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_Position = a_position;\n"
+    "}\n";
+
+static const gchar *fragment_src =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = color;\n"
+    "}\n";
+/* *INDENT-ON* */
+
+static GstGLDisplay *display;
+static GstGLContext *context;
+
+void
+setup (void)
+{
+  display = gst_gl_display_new ();
+}
+
+void
+teardown (void)
+{
+  gst_object_unref (display);
+}
+
+static void
+_create_context (void)
+{
+  GError *error = NULL;
+
+  context = gst_gl_context_new (display);
+  gst_gl_context_create (context, 0, &error);
+
+  fail_if (error != NULL, "Error creating context: %s\n",
+      error ? error->message : "Unknown Error");
+}
+
+static void
+_destroy_context (void)
+{
+  GLuint error = context->gl_vtable->GetError ();
+
+  fail_if (error != GL_NONE, "GL error 0x%x encountered during processing\n",
+      error);
+
+  gst_object_unref (context);
+  context = NULL;
+}
+
+typedef struct
+{
+  gboolean binaries_supported;
+  gboolean compiled;
+} CompileData;
+
+static void
+_compile_shader (GstGLContext * context, CompileData * data)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLShader *shader;
+  GLint n_formats = 0;
+
+  if (gl->GetProgramBinary && gl->ProgramBinary)
+    gl->GetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  data->binaries_supported = n_formats > 0;
+
+  shader = gst_gl_shader_new (context);
+  gst_gl_shader_set_vertex_source (shader, vertex_src);
+  gst_gl_shader_set_fragment_source (shader, fragment_src);
+  data->compiled = gst_gl_shader_compile (shader, NULL);
+  gst_object_unref (shader);
+}
+
+static gint n_binaries_loaded;
+
+static void
+_count_binary_loads (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  if (g_strcmp0 (gst_debug_category_get_name (category), "glshader") == 0
+      && strstr (gst_debug_message_get (message), "loaded from program binary"))
+    g_atomic_int_inc (&n_binaries_loaded);
+}
+
+/* lists the program binaries written to @dir */
+static GList *
+_list_binaries (const gchar * dir)
+{
+  GList *files = NULL;
+  const gchar *name;
+  GDir *d;
+
+  d = g_dir_open (dir, 0, NULL);
+  fail_unless (d != NULL);
+  while ((name = g_dir_read_name (d)))
+    files = g_list_prepend (files, g_build_filename (dir, name, NULL));
+  g_dir_close (d);
+
+  return files;
+}
+
+GST_START_TEST (test_program_binary_cache)
+{
+  CompileData data;
+  gchar *dir;
+  GList *files;
+
+  dir = g_dir_make_tmp ("gstglshader-XXXXXX", NULL);
+  fail_unless (dir != NULL);
+
+  /* nothing is written unless asked for */
+  g_unsetenv ("GST_GL_SHADER_CACHE");
+  _create_context ();
+  gst_gl_context_thread_add (context,
+      (GstGLContextThreadFunc) _compile_shader, &data);
+  fail_unless (data.compiled);
+  _destroy_context ();
+  fail_unless (_list_binaries (dir) == NULL);
+
+  g_setenv ("GST_GL_SHADER_CACHE", dir, TRUE);
+
+  gst_debug_set_active (TRUE);
+  gst_debug_set_threshold_for_name ("glshader", GST_LEVEL_DEBUG);
+  gst_debug_add_log_function (_count_binary_loads, NULL, NULL);
+
+  /* the first compile stores the binary, the second links from it */
+  _create_context ();
+  gst_gl_context_thread_add (context,
+      (GstGLContextThreadFunc) _compile_shader, &data);
+  fail_unless (data.compiled);
+  fail_unless_equals_int (g_atomic_int_get (&n_binaries_loaded), 0);
+  _destroy_context ();
+
+  files = _list_binaries (dir);
+
+  if (data.binaries_supported) {
+    fail_unless_equals_int (g_list_length (files), 1);
+
+    _create_context ();
+    gst_gl_context_thread_add (context,
+        (GstGLContextThreadFunc) _compile_shader, &data);
+    fail_unless (data.compiled);
+    fail_unless_equals_int (g_atomic_int_get (&n_binaries_loaded), 1);
+    _destroy_context ();
+
+    /* a binary the driver rejects falls back to the sources without leaving
+     * a GL error behind, checked when the context is destroyed */
+    fail_unless (g_file_set_contents (files->data,
+            "GSTGLPB1\0\0\0\0corrupted binary", 28, NULL));
+
+    _create_context ();
+    gst_gl_context_thread_add (context,
+        (GstGLContextThreadFunc) _compile_shader, &data);
+    fail_unless (data.compiled);
+    fail_unless_equals_int (g_atomic_int_get (&n_binaries_loaded), 1);
+    _destroy_context ();
+  } else {
+    fail_unless (files == NULL);
+  }
+
+  gst_debug_remove_log_function (_count_binary_loads);
+  g_unsetenv ("GST_GL_SHADER_CACHE");
+
+  g_list_foreach (files, (GFunc) g_unlink, NULL);
+  g_list_free_full (files, g_free);
+  g_rmdir (dir);
+  g_free (dir);
+}
+
+GST_END_TEST;
+
+#ifndef GL_CURRENT_PROGRAM
+#define GL_CURRENT_PROGRAM 0x8B8D
+#endif
+
+static void
+_check_color (GstGLContext * context, gfloat r, gfloat g, gfloat b, gfloat a)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLint program = 0;
+  gfloat color[4];
+
+  gl->GetIntegerv (GL_CURRENT_PROGRAM, &program);
+  fail_if (program == 0);
+  gl->GetUniformfv (program, gl->GetUniformLocation (program, "color"),
+      color);
+
+  fail_unless (color[0] == r && color[1] == g && color[2] == b
+      && color[3] == a, "color is (%f,%f,%f,%f), expected (%f,%f,%f,%f)",
+      color[0], color[1], color[2], color[3], r, g, b, a);
+}
+
+static void
+_check_uniform_cache (GstGLContext * context, gpointer data)
+{
+  static gfloat red[] = { 1.0, 0.0, 0.0, 1.0 };
+  const GstGLFuncs *gl = context->gl_vtable;
+  GstGLShader *shader;
+  GLint program = 0;
+
+  shader = gst_gl_shader_new (context);
+  gst_gl_shader_set_vertex_source (shader, vertex_src);
+  gst_gl_shader_set_fragment_source (shader, fragment_src);
+  fail_unless (gst_gl_shader_compile (shader, NULL));
+  gst_gl_shader_use (shader);
+
+  gst_gl_shader_set_uniform_4f (shader, "color", 1.0, 0.0, 0.0, 1.0);
+  _check_color (context, 1.0, 0.0, 0.0, 1.0);
+
+  /* change the value behind the shader's back, writing the value it last
+   * wrote again is skipped */
+  gl->GetIntegerv (GL_CURRENT_PROGRAM, &program);
+  gl->Uniform4f (gl->GetUniformLocation (program, "color"), 0.0, 1.0, 0.0,
+      1.0);
+  gst_gl_shader_set_uniform_4f (shader, "color", 1.0, 0.0, 0.0, 1.0);
+  _check_color (context, 0.0, 1.0, 0.0, 1.0);
+
+  /* other values are written */
+  gst_gl_shader_set_uniform_4f (shader, "color", 0.0, 0.0, 1.0, 1.0);
+  _check_color (context, 0.0, 0.0, 1.0, 1.0);
+  gst_gl_shader_set_uniform_4fv (shader, "color", 1, red);
+  _check_color (context, 1.0, 0.0, 0.0, 1.0);
+
+  /* relinking resets the uniforms and drops the cached values with them */
+  gst_gl_shader_release (shader);
+  fail_unless (gst_gl_shader_compile (shader, NULL));
+  gst_gl_shader_use (shader);
+  _check_color (context, 0.0, 0.0, 0.0, 0.0);
+  gst_gl_shader_set_uniform_4f (shader, "color", 1.0, 0.0, 0.0, 1.0);
+  _check_color (context, 1.0, 0.0, 0.0, 1.0);
+
+  gst_gl_context_clear_shader (context);
+  gst_object_unref (shader);
+}
+
+GST_START_TEST (test_uniform_cache)
+{
+  _create_context ();
+  gst_gl_context_thread_add (context, _check_uniform_cache, NULL);
+  _destroy_context ();
+}
+
+GST_END_TEST;
+
+/* *INDENT-OFF* */
+static const gchar *other_fragment_src =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = vec4 (1.0);\n"
+    "}\n";
+/* *INDENT-ON* */
+
+static void
+_check_shader_sharing (GstGLContext * context, gpointer data)
+{
+  GstGLShader *shader, *same, *other;
+  gchar *vertex_copy;
+  gpointer weak;
+
+  shader = gst_gl_shader_new_cached (context, vertex_src, fragment_src, NULL);
+  fail_unless (shader != NULL);
+  fail_unless (gst_gl_shader_is_compiled (shader));
+
+  /* equal sources share the program, down to the uniform values */
+  vertex_copy = g_strdup (vertex_src);
+  same = gst_gl_shader_new_cached (context, vertex_copy, fragment_src, NULL);
+  fail_unless (same == shader);
+  g_free (vertex_copy);
+
+  gst_gl_shader_use (shader);
+  gst_gl_shader_set_uniform_4f (shader, "color", 1.0, 0.0, 0.0, 1.0);
+  gst_gl_shader_use (same);
+  _check_color (context, 1.0, 0.0, 0.0, 1.0);
+
+  other = gst_gl_shader_new_cached (context, vertex_src, other_fragment_src,
+      NULL);
+  fail_unless (other != NULL);
+  fail_unless (other != shader);
+  gst_object_unref (other);
+
+  gst_gl_context_clear_shader (context);
+
+  /* the cache doesn't keep the shader alive, once its last user is gone the
+   * same sources are compiled again */
+  weak = shader;
+  g_object_add_weak_pointer (G_OBJECT (shader), &weak);
+  gst_object_unref (same);
+  fail_unless (weak == shader);
+  gst_object_unref (shader);
+  fail_unless (weak == NULL);
+
+  shader = gst_gl_shader_new_cached (context, vertex_src, fragment_src, NULL);
+  fail_unless (shader != NULL);
+  fail_unless (gst_gl_shader_is_compiled (shader));
+  gst_gl_shader_use (shader);
+  _check_color (context, 0.0, 0.0, 0.0, 0.0);
+
+  gst_gl_context_clear_shader (context);
+  gst_object_unref (shader);
+}
+
+GST_START_TEST (test_shader_cache)
+{
+  _create_context ();
+  gst_gl_context_thread_add (context, _check_shader_sharing, NULL);
+  _destroy_context ();
+}
+
+GST_END_TEST;
+
+Suite *
+gst_gl_shader_suite (void)
+{
+  Suite *s = suite_create ("GstGLShader");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup, teardown);
+  tcase_add_test (tc_chain, test_program_binary_cache);
+  tcase_add_test (tc_chain, test_uniform_cache);
+  tcase_add_test (tc_chain, test_shader_cache);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_gl_shader);
@@ -22,12 +22,28 @@
 #  include "config.h"
 #endif
 
+/* for memfd_create () */
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
 #include <gst/check/gstcheck.h>
 
 #include <gst/gl/gstglcontext.h>
 #include <gst/gl/gstglupload.h>
 
 #include <stdio.h>
+#include <string.h>
+
+#if GST_GL_HAVE_PLATFORM_EGL && defined (HAVE_LINUX_UDMABUF_H) && defined (HAVE_MEMFD_CREATE)
+#define HAVE_UDMABUF 1
+#include <gst/allocators/gstdmabuf.h>
+#include <linux/udmabuf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #if GST_GL_HAVE_GLES2
 /* *INDENT-OFF* */
@@ -228,7 +244,9 @@ GST_START_TEST (test_shader_compile)
 {
   const gchar *formats[] = { "RGB", "RGBx", "RGBA", "BGR", "BGRx", "BGRA",
     "xRGB", "xBGR", "ARGB", "ABGR", "Y444", "I420", "YV12", "Y42B", "Y41B",
-    "NV12", "NV21", "YUY2", "UYVY", "AYUV", "GRAY8", "GRAY16_LE", "GRAY16_BE"
+    "NV12", "NV21", "NV16", "YUY2", "UYVY", "AYUV", "GRAY8", "GRAY16_LE",
+    "GRAY16_BE", "I420_10LE", "I420_10BE", "I422_10LE", "I422_10BE",
+    "Y444_10LE", "Y444_10BE", "v210"
   };
   guint i;
   gboolean res;
@@ -286,6 +304,373 @@ GST_START_TEST (test_upload_data)
 
 GST_END_TEST;
 
+static gint n_pbo_transfers;
+static gint n_pbo_unsupported;
+
+static void
+_count_pbo_transfers (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  const gchar *msg;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "glupload") != 0)
+    return;
+
+  msg = gst_debug_message_get (message);
+  if (g_str_has_prefix (msg, "data transfer") && strstr (msg, "from PBO"))
+    g_atomic_int_inc (&n_pbo_transfers);
+  else if (g_str_has_prefix (msg, "Pixel unpack buffers are not supported"))
+    g_atomic_int_inc (&n_pbo_unsupported);
+}
+
+struct read_texture
+{
+  GLuint tex_id;
+  guint8 pixels[WIDTH * HEIGHT * 4];
+};
+
+static void
+_read_texture (GstGLContext * context, struct read_texture *read)
+{
+  const GstGLFuncs *gl = context->gl_vtable;
+  GLuint fbo;
+
+  gl->GenFramebuffers (1, &fbo);
+  gl->BindFramebuffer (GL_FRAMEBUFFER, fbo);
+  gl->FramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+      GL_TEXTURE_2D, read->tex_id, 0);
+  fail_unless (gst_gl_context_check_framebuffer_status (context));
+
+  gl->ReadPixels (0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE,
+      read->pixels);
+
+  gl->BindFramebuffer (GL_FRAMEBUFFER, 0);
+  gl->DeleteFramebuffers (1, &fbo);
+}
+
+GST_START_TEST (test_upload_data_pbo)
+{
+  gpointer data[GST_VIDEO_MAX_PLANES] = { NULL, NULL, NULL, NULL };
+  guint8 frame[sizeof (rgba_data)];
+  struct read_texture read;
+  GstVideoInfo in_info;
+  GstVideoInfo out_info;
+  gboolean res, use_pbo;
+  gint i = 0;
+
+  gst_video_info_set_format (&in_info, FORMAT, WIDTH, HEIGHT);
+  gst_video_info_set_format (&out_info, FORMAT, WIDTH, HEIGHT);
+
+  gst_gl_context_gen_texture (context, &tex_id, FORMAT, WIDTH, HEIGHT);
+
+  g_object_set (upload, "use-pbo", TRUE, NULL);
+  gst_gl_upload_init_format (upload, in_info, out_info);
+
+  n_pbo_transfers = n_pbo_unsupported = 0;
+  gst_debug_set_threshold_for_name ("glupload", GST_LEVEL_LOG);
+  gst_debug_add_log_function (_count_pbo_transfers, NULL, NULL);
+
+  /* cycle through the whole buffer ring with a different frame every time so
+   * that data left in a slot by a previous upload would show */
+  data[0] = frame;
+  read.tex_id = tex_id;
+  for (i = 0; i < 4; i++) {
+    memcpy (frame, rgba_data, sizeof (frame));
+    frame[i * 4 + 1] = 0x80;
+
+    res = gst_gl_upload_perform_with_data (upload, tex_id, data);
+    fail_if (res == FALSE, "Failed to upload buffer: %s\n",
+        gst_gl_context_get_error ());
+
+    gst_gl_context_thread_add (context,
+        (GstGLContextThreadFunc) _read_texture, &read);
+    fail_unless (memcmp (read.pixels, frame, sizeof (frame)) == 0,
+        "upload %i doesn't match the uploaded frame", i);
+  }
+
+  gst_debug_remove_log_function (_count_pbo_transfers);
+
+  /* every upload went through a PBO unless the context has none, in which
+   * case the property still says what was asked for */
+  if (g_atomic_int_get (&n_pbo_unsupported) == 0)
+    fail_unless_equals_int (g_atomic_int_get (&n_pbo_transfers), 4);
+  else
+    fail_unless_equals_int (g_atomic_int_get (&n_pbo_transfers), 0);
+
+  g_object_get (upload, "use-pbo", &use_pbo, NULL);
+  fail_unless (use_pbo);
+
+  gst_gl_window_draw (window, WIDTH, HEIGHT);
+
+  gst_gl_window_send_message (window, GST_GL_WINDOW_CB (init), context);
+
+  i = 0;
+  while (i < 2) {
+    gst_gl_window_send_message (window, GST_GL_WINDOW_CB (draw_render),
+        context);
+    i++;
+  }
+
+  gst_gl_context_del_texture (context, &tex_id);
+}
+
+GST_END_TEST;
+
+/* packs every row of a v210 frame with the luma of each pixel from @luma
+ * and constant chroma */
+static void
+_fill_v210 (guint8 * data, gint stride, const guint16 * luma, guint32 cb,
+    guint32 cr)
+{
+  guint32 l[6];
+  guint32 *row;
+  guint x, y, i;
+
+  for (y = 0; y < HEIGHT; y++) {
+    row = (guint32 *) (data + y * stride);
+
+    for (x = 0; x < WIDTH; x += 6) {
+      for (i = 0; i < 6; i++)
+        l[i] = x + i < WIDTH ? luma[x + i] : 0;
+
+      row[0] = GUINT32_TO_LE (cb | l[0] << 10 | cr << 20);
+      row[1] = GUINT32_TO_LE (l[1] | cb << 10 | l[2] << 20);
+      row[2] = GUINT32_TO_LE (cr | l[3] << 10 | cb << 20);
+      row[3] = GUINT32_TO_LE (l[4] | cr << 10 | l[5] << 20);
+      row += 4;
+    }
+  }
+}
+
+/* the RGB of 10 bit YUV, straight from the definition of the matrix */
+static void
+_yuv_to_rgb (gdouble kr, gdouble kb, gboolean full_range, guint y, guint cb,
+    guint cr, gint rgb[3])
+{
+  gdouble Y, U, V, r, g, b;
+
+  if (full_range) {
+    Y = y / 1023.0;
+    U = (cb - 512.0) / 1023.0;
+    V = (cr - 512.0) / 1023.0;
+  } else {
+    Y = (y - 64.0) / 876.0;
+    U = (cb - 512.0) / 896.0;
+    V = (cr - 512.0) / 896.0;
+  }
+
+  r = Y + 2.0 * (1.0 - kr) * V;
+  b = Y + 2.0 * (1.0 - kb) * U;
+  g = (Y - kr * r - kb * b) / (1.0 - kr - kb);
+
+  rgb[0] = CLAMP (r * 255.0 + 0.5, 0, 255);
+  rgb[1] = CLAMP (g * 255.0 + 0.5, 0, 255);
+  rgb[2] = CLAMP (b * 255.0 + 0.5, 0, 255);
+}
+
+/* uploads v210 with the given colorimetry and checks a row of the result */
+static void
+_check_v210 (GstVideoColorMatrix matrix, GstVideoColorRange range,
+    gdouble kr, gdouble kb, const guint16 * luma, guint cb, guint cr)
+{
+  gpointer data[GST_VIDEO_MAX_PLANES] = { NULL, NULL, NULL, NULL };
+  struct read_texture read;
+  GstVideoInfo in_info;
+  GstVideoInfo out_info;
+  guint8 *frame;
+  gint rgb[3];
+  guint x, i;
+
+  gst_video_info_set_format (&in_info, GST_VIDEO_FORMAT_v210, WIDTH, HEIGHT);
+  in_info.colorimetry.matrix = matrix;
+  in_info.colorimetry.range = range;
+  gst_video_info_set_format (&out_info, FORMAT, WIDTH, HEIGHT);
+
+  frame = g_malloc0 (GST_VIDEO_INFO_SIZE (&in_info));
+  _fill_v210 (frame, GST_VIDEO_INFO_PLANE_STRIDE (&in_info, 0), luma, cb, cr);
+  data[0] = frame;
+
+  gst_object_unref (upload);
+  upload = gst_gl_upload_new (context);
+  fail_unless (gst_gl_upload_init_format (upload, in_info, out_info));
+  fail_unless (gst_gl_upload_perform_with_data (upload, tex_id, data),
+      "Failed to upload buffer: %s\n", gst_gl_context_get_error ());
+
+  read.tex_id = tex_id;
+  gst_gl_context_thread_add (context,
+      (GstGLContextThreadFunc) _read_texture, &read);
+
+  for (x = 0; x < WIDTH; x++) {
+    _yuv_to_rgb (kr, kb, range == GST_VIDEO_COLOR_RANGE_0_255, luma[x], cb,
+        cr, rgb);
+
+    for (i = 0; i < 3; i++) {
+      gint value = read.pixels[x * 4 + i];
+
+      fail_unless (ABS (value - rgb[i]) <= 2, "component %u of pixel %u is "
+          "%i instead of %i for matrix %i range %i", i, x, value, rgb[i],
+          matrix, range);
+    }
+  }
+
+  g_free (frame);
+}
+
+GST_START_TEST (test_upload_v210)
+{
+  guint16 ramp[WIDTH], flat[WIDTH];
+  guint x;
+
+  /* a different luma for each of the 6 positions of a block */
+  for (x = 0; x < WIDTH; x++) {
+    ramp[x] = 64 + x * 94;
+    flat[x] = 600;
+  }
+
+  gst_gl_context_gen_texture (context, &tex_id, FORMAT, WIDTH, HEIGHT);
+
+  /* the range decides where black and white are */
+  _check_v210 (GST_VIDEO_COLOR_MATRIX_BT601, GST_VIDEO_COLOR_RANGE_16_235,
+      0.299, 0.114, ramp, 512, 512);
+  _check_v210 (GST_VIDEO_COLOR_MATRIX_BT601, GST_VIDEO_COLOR_RANGE_0_255,
+      0.299, 0.114, ramp, 512, 512);
+
+  /* and the matrix how the chroma is mixed in */
+  _check_v210 (GST_VIDEO_COLOR_MATRIX_BT601, GST_VIDEO_COLOR_RANGE_16_235,
+      0.299, 0.114, flat, 300, 700);
+  _check_v210 (GST_VIDEO_COLOR_MATRIX_BT709, GST_VIDEO_COLOR_RANGE_16_235,
+      0.2126, 0.0722, flat, 300, 700);
+  _check_v210 (GST_VIDEO_COLOR_MATRIX_BT709, GST_VIDEO_COLOR_RANGE_0_255,
+      0.2126, 0.0722, flat, 300, 700);
+
+  gst_gl_context_del_texture (context, &tex_id);
+}
+
+GST_END_TEST;
+
+#ifdef HAVE_UDMABUF
+/* Wraps @size bytes of @data into a dmabuf without needing a GPU driver.
+ * Returns -1 if udmabuf is not available */
+static gint
+_create_udmabuf (gpointer data, gsize size)
+{
+  struct udmabuf_create create = { 0, };
+  gint memfd, dev, fd = -1;
+  gpointer ptr;
+
+  /* udmabuf requires page aligned sizes and a sealed memfd */
+  size = (size + getpagesize () - 1) & ~(getpagesize () - 1);
+
+  if ((dev = open ("/dev/udmabuf", O_RDWR)) < 0)
+    return -1;
+
+  memfd = memfd_create ("gl-upload-test", MFD_ALLOW_SEALING);
+  fail_if (memfd < 0);
+  fail_if (ftruncate (memfd, size) < 0);
+  fail_if (fcntl (memfd, F_ADD_SEALS, F_SEAL_SHRINK) < 0);
+
+  ptr = mmap (NULL, size, PROT_WRITE, MAP_SHARED, memfd, 0);
+  fail_if (ptr == MAP_FAILED);
+  memcpy (ptr, data, WIDTH * HEIGHT * 4);
+  munmap (ptr, size);
+
+  create.memfd = memfd;
+  create.flags = UDMABUF_FLAGS_CLOEXEC;
+  create.offset = 0;
+  create.size = size;
+  fd = ioctl (dev, UDMABUF_CREATE, &create);
+
+  close (memfd);
+  close (dev);
+
+  return fd;
+}
+
+static gint n_dmabuf_imported;
+static gint n_dmabuf_unsupported;
+
+static void
+_count_dmabuf_imports (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  const gchar *msg;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "glupload") != 0)
+    return;
+
+  msg = gst_debug_message_get (message);
+  if (strstr (msg, "imported dmabuf fd:"))
+    g_atomic_int_inc (&n_dmabuf_imported);
+  else if (strstr (msg, "dmabuf import not supported"))
+    g_atomic_int_inc (&n_dmabuf_unsupported);
+}
+
+GST_START_TEST (test_upload_dmabuf)
+{
+  GstAllocator *allocator;
+  GstBuffer *buffer;
+  GstVideoInfo in_info;
+  GstVideoInfo out_info;
+  gboolean res;
+  gint i = 0, fd;
+
+  gst_video_info_set_format (&in_info, FORMAT, WIDTH, HEIGHT);
+  gst_video_info_set_format (&out_info, FORMAT, WIDTH, HEIGHT);
+
+  fd = _create_udmabuf (rgba_data, GST_VIDEO_INFO_SIZE (&in_info));
+  if (fd < 0) {
+    GST_INFO ("udmabuf not available, skipping");
+    return;
+  }
+
+  allocator = gst_dmabuf_allocator_new ();
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, gst_dmabuf_allocator_alloc (allocator, fd,
+          GST_VIDEO_INFO_SIZE (&in_info)));
+  gst_object_unref (allocator);
+
+  gst_gl_upload_init_format (upload, in_info, out_info);
+
+  n_dmabuf_imported = n_dmabuf_unsupported = 0;
+  gst_debug_set_threshold_for_name ("glupload", GST_LEVEL_LOG);
+  gst_debug_add_log_function (_count_dmabuf_imports, NULL, NULL);
+
+  res = gst_gl_upload_perform_with_buffer (upload, buffer, &tex_id);
+  fail_if (res == FALSE, "Failed to upload buffer: %s\n",
+      gst_gl_context_get_error ());
+
+  /* mapping the dmabuf is only acceptable when the context cannot import */
+  if (g_atomic_int_get (&n_dmabuf_unsupported) == 0)
+    fail_unless_equals_int (g_atomic_int_get (&n_dmabuf_imported), 1);
+
+  /* a second buffer with the same layout is imported again */
+  if (g_atomic_int_get (&n_dmabuf_imported) > 0) {
+    gst_gl_upload_release_buffer (upload);
+    res = gst_gl_upload_perform_with_buffer (upload, buffer, &tex_id);
+    fail_unless (res);
+    fail_unless_equals_int (g_atomic_int_get (&n_dmabuf_imported), 2);
+  }
+
+  gst_debug_remove_log_function (_count_dmabuf_imports);
+
+  gst_gl_window_draw (window, WIDTH, HEIGHT);
+  gst_gl_window_send_message (window, GST_GL_WINDOW_CB (init), context);
+
+  while (i < 2) {
+    gst_gl_window_send_message (window, GST_GL_WINDOW_CB (draw_render),
+        context);
+    i++;
+  }
+
+  gst_gl_upload_release_buffer (upload);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+#endif
+
 GST_START_TEST (test_upload_memory)
 {
   GstGLMemory *gl_mem;
@@ -413,9 +798,14 @@ gst_gl_upload_suite (void)
   tcase_add_checked_fixture (tc_chain, setup, teardown);
   tcase_add_test (tc_chain, test_shader_compile);
   tcase_add_test (tc_chain, test_upload_data);
+  tcase_add_test (tc_chain, test_upload_data_pbo);
+  tcase_add_test (tc_chain, test_upload_v210);
   tcase_add_test (tc_chain, test_upload_memory);
   tcase_add_test (tc_chain, test_upload_buffer);
   tcase_add_test (tc_chain, test_upload_meta_producer);
+#ifdef HAVE_UDMABUF
+  tcase_add_test (tc_chain, test_upload_dmabuf);
+#endif
 
   return s;
 }
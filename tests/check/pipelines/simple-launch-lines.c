@@ -24,6 +24,11 @@
 
 #include <gst/check/gstcheck.h>
 
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
 #ifndef GST_DISABLE_PARSE
 
 static GstElement *
@@ -129,6 +134,86 @@ GST_START_TEST (test_glfiltercube)
       GST_MESSAGE_UNKNOWN, target_state);
 }
 
+GST_END_TEST;
+
+static gint n_retrieved;
+
+static void
+_count_retrieved (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  if (g_strcmp0 (gst_debug_category_get_name (category), "gldownload") == 0
+      && g_str_has_prefix (gst_debug_message_get (message),
+          "retrieving download of frame"))
+    g_atomic_int_inc (&n_retrieved);
+}
+
+static void
+_check_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    guint * n_buffers)
+{
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer),
+      gst_util_uint64_scale_int (*n_buffers, GST_SECOND, 30));
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer),
+      gst_util_uint64_scale_int (1, GST_SECOND, 30));
+  (*n_buffers)++;
+}
+
+GST_START_TEST (test_glfilter_system_memory)
+{
+  GstElement *pipeline, *sink;
+  guint n_buffers = 0;
+  gchar *s;
+
+  gst_debug_set_active (TRUE);
+  gst_debug_set_threshold_for_name ("gldownload", GST_LEVEL_LOG);
+  gst_debug_add_log_function (_count_retrieved, NULL, NULL);
+  g_atomic_int_set (&n_retrieved, 0);
+
+  /* videoconvert provides a system memory pool, so every frame is read back
+   * through gst_gl_download_submit() and comes out one frame late with its
+   * own timestamps, the last one being pushed on EOS */
+  s = "videotestsrc num-buffers=10 ! video/x-raw,framerate=30/1 ! "
+      "glfiltercube ! video/x-raw,format=RGBA ! videoconvert ! "
+      "video/x-raw,format=RGBx ! fakesink name=sink signal-handoffs=true";
+  pipeline = setup_pipeline (s);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (_check_handoff), &n_buffers);
+  gst_object_unref (sink);
+
+  run_pipeline (pipeline, s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_EOS, GST_STATE_PLAYING);
+
+  fail_unless_equals_int (n_buffers, 10);
+  fail_unless_equals_int (g_atomic_int_get (&n_retrieved), 10);
+
+  gst_debug_remove_log_function (_count_retrieved);
+}
+
+GST_END_TEST;
+
+static const gchar *download_formats[] = {
+  "I420", "YV12", "Y444", "Y42B", "Y41B", "NV12", "NV21", "GRAY8"
+};
+
+GST_START_TEST (test_gldownload_formats)
+{
+  gchar *s;
+  GstState target_state = GST_STATE_PLAYING;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (download_formats); i++) {
+    s = g_strdup_printf ("videotestsrc num-buffers=10 ! glfiltercube "
+        "! video/x-raw,format=%s ! fakesink", download_formats[i]);
+    run_pipeline (setup_pipeline (s), s,
+        GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+        GST_MESSAGE_UNKNOWN, target_state);
+    g_free (s);
+  }
+}
+
 GST_END_TEST
 #if GST_GL_HAVE_GLES2
 # define N_EFFECTS 3
@@ -186,6 +271,11 @@ GST_START_TEST (test_glfilterblur)
   run_pipeline (setup_pipeline (s), s,
       GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
       GST_MESSAGE_UNKNOWN, target_state);
+
+  s = "videotestsrc num-buffers=10 ! glfilterblur sigma=40 ! fakesink";
+  run_pipeline (setup_pipeline (s), s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_UNKNOWN, target_state);
 }
 
 GST_END_TEST
@@ -205,7 +295,59 @@ GST_START_TEST (test_glfiltersobel)
       GST_MESSAGE_UNKNOWN, target_state);
 }
 
-GST_END_TEST
+GST_END_TEST;
+
+static gint n_plane_uploads, n_conversions, n_luma_samples;
+
+static void
+_count_plane_uploads (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  const gchar *name = gst_debug_category_get_name (category);
+  const gchar *msg = gst_debug_message_get (message);
+
+  if (g_strcmp0 (name, "glupload") == 0) {
+    if (g_str_has_prefix (msg, "Uploading planes of memory"))
+      g_atomic_int_inc (&n_plane_uploads);
+    else if (g_str_has_prefix (msg, "uploading to texture")
+        || g_str_has_prefix (msg, "Converting planes of memory"))
+      g_atomic_int_inc (&n_conversions);
+  } else if (g_strcmp0 (name, "glfiltersobel") == 0
+      && g_str_has_prefix (msg, "sampling the luma of plane texture")) {
+    g_atomic_int_inc (&n_luma_samples);
+  }
+}
+
+GST_START_TEST (test_glfiltersobel_planes)
+{
+  gchar *s;
+
+  gst_debug_set_active (TRUE);
+  gst_debug_set_threshold_for_name ("glupload", GST_LEVEL_TRACE);
+  gst_debug_set_threshold_for_name ("glfiltersobel", GST_LEVEL_TRACE);
+  gst_debug_add_log_function (_count_plane_uploads, NULL, NULL);
+  g_atomic_int_set (&n_plane_uploads, 0);
+  g_atomic_int_set (&n_conversions, 0);
+  g_atomic_int_set (&n_luma_samples, 0);
+
+  /* videotestsrc fills the GstGLMemory of the pool proposed by the filter,
+   * whose Y plane is sampled without ever converting the frame to RGBA */
+  s = "videotestsrc num-buffers=10 ! video/x-raw,format=I420 ! "
+      "glfiltersobel ! video/x-raw,format=RGBA ! fakesink";
+  run_pipeline (setup_pipeline (s), s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_EOS, GST_STATE_PLAYING);
+
+  fail_unless_equals_int (g_atomic_int_get (&n_plane_uploads), 10);
+  fail_unless_equals_int (g_atomic_int_get (&n_luma_samples), 10);
+  fail_unless_equals_int (g_atomic_int_get (&n_conversions), 0);
+
+  gst_debug_remove_log_function (_count_plane_uploads);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_glfilterglass)
 {
   gchar *s;
@@ -273,6 +415,160 @@ GST_START_TEST (test_glmosaic)
       GST_MESSAGE_UNKNOWN, target_state);
 }
 
+GST_END_TEST
+/* uploads and texture reuses of sink_0 and sink_1 */
+static gint mixer_uploads[2];
+static gint mixer_reuses[2];
+
+static void
+_count_mixer_uploads (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  const gchar *text;
+  guint pad;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "glmixer") != 0
+      || !GST_IS_PAD (object)
+      || sscanf (GST_OBJECT_NAME (object), "sink_%u", &pad) != 1 || pad > 1)
+    return;
+
+  text = gst_debug_message_get (message);
+  if (g_str_has_prefix (text, "uploaded "))
+    g_atomic_int_inc (&mixer_uploads[pad]);
+  else if (g_str_has_prefix (text, "reusing the texture of "))
+    g_atomic_int_inc (&mixer_reuses[pad]);
+}
+
+GST_START_TEST (test_glvideomixer)
+{
+  GString *launch;
+  gchar *s;
+  GstState target_state = GST_STATE_PLAYING;
+  guint i;
+
+  /* more inputs than can be composited by a single draw, uploaded from a
+   * few shared contexts */
+  launch = g_string_new ("glvideomixer name=m upload-contexts=4 ! fakesink");
+  for (i = 0; i < 20; i++)
+    g_string_append_printf (launch, " videotestsrc num-buffers=10 "
+        "pattern=%u ! video/x-raw,width=%u,height=%u ! m.", i,
+        320 - i * 8, 240 - i * 6);
+
+  s = launch->str;
+  run_pipeline (setup_pipeline (s), s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_UNKNOWN, target_state);
+
+  g_string_free (launch, TRUE);
+
+  s = "glvideomixer name=m sink_0::zorder=1 sink_1::xpos=16 sink_1::ypos=8 "
+      "sink_1::width=64 sink_1::height=48 sink_1::alpha=0.5 ! fakesink "
+      "videotestsrc num-buffers=10 ! m.sink_0 "
+      "videotestsrc num-buffers=10 pattern=1 ! m.sink_1";
+  run_pipeline (setup_pipeline (s), s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_UNKNOWN, target_state);
+
+  /* the lower rate input is only uploaded when it changes, its texture is
+   * reused for the 5 output frames in between */
+  gst_debug_set_active (TRUE);
+  gst_debug_set_threshold_for_name ("glmixer", GST_LEVEL_TRACE);
+  gst_debug_add_log_function (_count_mixer_uploads, NULL, NULL);
+  memset (mixer_uploads, 0, sizeof (mixer_uploads));
+  memset (mixer_reuses, 0, sizeof (mixer_reuses));
+
+  s = "glvideomixer name=m ! fakesink sync=false "
+      "videotestsrc num-buffers=30 ! video/x-raw,framerate=30/1 ! m.sink_0 "
+      "videotestsrc num-buffers=5 ! video/x-raw,framerate=5/1 ! m.sink_1";
+  run_pipeline (setup_pipeline (s), s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_EOS, target_state);
+
+  gst_debug_remove_log_function (_count_mixer_uploads);
+
+  fail_unless_equals_int (g_atomic_int_get (&mixer_uploads[0]), 30);
+  fail_unless_equals_int (g_atomic_int_get (&mixer_reuses[0]), 0);
+  fail_unless_equals_int (g_atomic_int_get (&mixer_uploads[1]), 5);
+  fail_unless_equals_int (g_atomic_int_get (&mixer_reuses[1]), 25);
+}
+
+GST_END_TEST
+
+static gint fuse_n_passes;
+
+static void
+_get_fuse_passes (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  guint n_stages, n_passes;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "glfilterfuse") == 0
+      && sscanf (gst_debug_message_get (message),
+          "fused %u stages into %u passes", &n_stages, &n_passes) == 2)
+    g_atomic_int_set (&fuse_n_passes, n_passes);
+}
+
+/* runs a glfilterfuse with @stages and returns the number of passes it
+ * rendered them in */
+static gint
+run_fuse_pipeline (const gchar * src, const gchar * stages)
+{
+  gchar *s;
+
+  s = g_strdup_printf ("%s num-buffers=10 ! glfilterfuse stages=\"%s\" ! "
+      "fakesink", src, stages);
+  g_atomic_int_set (&fuse_n_passes, 0);
+  run_pipeline (setup_pipeline (s), s,
+      GST_MESSAGE_ANY & ~(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING),
+      GST_MESSAGE_UNKNOWN, GST_STATE_PLAYING);
+  g_free (s);
+
+  return g_atomic_int_get (&fuse_n_passes);
+}
+
+GST_START_TEST (test_glfilterfuse)
+{
+  gchar *snippet, *stages;
+  gint fd;
+
+  gst_debug_set_active (TRUE);
+  gst_debug_set_threshold_for_name ("glfilterfuse", GST_LEVEL_INFO);
+  gst_debug_add_log_function (_get_fuse_passes, NULL, NULL);
+
+  /* per-pixel effects share a pass, each half of the blur starts one */
+  fail_unless_equals_int (run_fuse_pipeline ("videotestsrc",
+          "sepia,desaturate"), 1);
+  fail_unless_equals_int (run_fuse_pipeline ("gltestsrc", "xpro,blur,sin"),
+      3);
+  fail_unless_equals_int (run_fuse_pipeline ("videotestsrc",
+          "blur,desaturate,sepia"), 2);
+  fail_unless_equals_int (run_fuse_pipeline ("videotestsrc",
+          "desaturate,blur,sepia"), 3);
+
+  /* only the signature of the entry point counts, not a mention of the
+   * other one in a comment */
+  fd = g_file_open_tmp ("glfilterfuse-XXXXXX.glsl", &snippet, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (snippet,
+          "/* per-pixel, so no process_texture (sampler2D, vec2) */\n"
+          "vec4 process (vec4 color)\n"
+          "{\n"
+          "  return color.bgra;\n"
+          "}\n", -1, NULL));
+
+  stages = g_strdup_printf ("sepia,file:%s", snippet);
+  fail_unless_equals_int (run_fuse_pipeline ("videotestsrc", stages), 1);
+  g_free (stages);
+
+  g_unlink (snippet);
+  g_free (snippet);
+
+  gst_debug_remove_log_function (_get_fuse_passes);
+}
+
 GST_END_TEST
 #if 0
 GST_START_TEST (test_glshader)
@@ -324,15 +620,20 @@ GST_END_TEST
 #ifndef GST_DISABLE_PARSE
   tcase_add_test (tc_chain, test_glimagesink);
   tcase_add_test (tc_chain, test_glfiltercube);
+  tcase_add_test (tc_chain, test_glfilter_system_memory);
+  tcase_add_test (tc_chain, test_gldownload_formats);
   tcase_add_test (tc_chain, test_gleffects);
 #if GST_GL_HAVE_OPENGL
   tcase_add_test (tc_chain, test_gltestsrc);
   tcase_add_test (tc_chain, test_glfilterblur);
   tcase_add_test (tc_chain, test_glfiltersobel);
+  tcase_add_test (tc_chain, test_glfiltersobel_planes);
   tcase_add_test (tc_chain, test_glfilterglass);
   tcase_add_test (tc_chain, test_glfilterreflectedscreen);
   tcase_add_test (tc_chain, test_gldeinterlace);
   tcase_add_test (tc_chain, test_glmosaic);
+  tcase_add_test (tc_chain, test_glvideomixer);
+  tcase_add_test (tc_chain, test_glfilterfuse);
 #if 0
   tcase_add_test (tc_chain, test_glshader);
   tcase_add_test (tc_chain, test_glfilterapp);